@@ -29,11 +29,49 @@
 #define OFONO_API_SUBJECT_TO_CHANGE
 #include <ofono/plugin.h>
 #include <ofono/types.h>
+#include <ofono/log.h>
 
 #include "atmodem.h"
 
+static void at_trace(GAtTraceEvent event, guint chat, const char *prefix,
+			guint usec, gpointer user_data)
+{
+	switch (event) {
+	case G_AT_TRACE_COMMAND:
+		ofono_trace(OFONO_TRACE_AT_COMMAND, chat, 0, prefix);
+		break;
+	case G_AT_TRACE_RESPONSE:
+		ofono_trace(OFONO_TRACE_AT_RESPONSE, chat, usec, prefix);
+		break;
+	case G_AT_TRACE_NOTIFY:
+		ofono_trace(OFONO_TRACE_AT_NOTIFY, chat, 0, prefix);
+		break;
+	}
+}
+
+static void at_latency_dump(guint chat, const char *prefix, guint count,
+				guint p50, guint p99, guint max,
+				gpointer user_data)
+{
+	FILE *out = user_data;
+
+	fprintf(out, "%u %s %u %u %u %u\n", chat, prefix, count,
+			p50, p99, max);
+}
+
+static void at_trace_dump(FILE *out, void *user_data)
+{
+	fprintf(out, "AT command latencies: chat prefix count "
+			"p50-ms p99-ms max-ms\n");
+
+	g_at_chat_foreach_latency(at_latency_dump, out);
+}
+
 static int atmodem_init(void)
 {
+	g_at_chat_set_trace_func(at_trace, NULL);
+	ofono_trace_dump_register(at_trace_dump, NULL);
+
 	at_voicecall_init();
 	at_devinfo_init();
 	at_call_barring_init();
@@ -74,6 +112,9 @@ static void atmodem_exit(void)
 	at_call_volume_exit();
 	at_gprs_exit();
 	at_gprs_context_exit();
+
+	ofono_trace_dump_unregister(at_trace_dump);
+	g_at_chat_set_trace_func(NULL, NULL);
 }
 
 OFONO_PLUGIN_DEFINE(atmodem, "AT modem driver", VERSION,
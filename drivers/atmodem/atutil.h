@@ -104,6 +104,42 @@ static inline int at_util_convert_signal_strength(int strength)
 	return result;
 }
 
+/*
+ * How often to ask for the state of a data session while it changes.
+ * Firmware without notifications is polled once a second, firmware that
+ * sends them only as a safety net against a lost notification.
+ */
+#define AT_UTIL_POLL_INTERVAL 1000
+#define AT_UTIL_POLL_FALLBACK_INTERVAL 5000
+#define AT_UTIL_POLL_FALLBACK_MAX_INTERVAL 20000
+
+struct at_util_poll {
+	gboolean notifications;
+	unsigned int interval;
+};
+
+static inline void at_util_poll_init(struct at_util_poll *poll,
+					gboolean notifications)
+{
+	poll->notifications = notifications;
+	poll->interval = 0;
+}
+
+/* Returns the ms to the next poll, the fallback doubles every time */
+static inline unsigned int at_util_poll_next(struct at_util_poll *poll)
+{
+	if (poll->notifications == FALSE)
+		return AT_UTIL_POLL_INTERVAL;
+
+	if (poll->interval == 0)
+		poll->interval = AT_UTIL_POLL_FALLBACK_INTERVAL;
+	else
+		poll->interval = MIN(poll->interval * 2,
+					AT_UTIL_POLL_FALLBACK_MAX_INTERVAL);
+
+	return poll->interval;
+}
+
 #define DECLARE_FAILURE(e) 			\
 	struct ofono_error e;			\
 	e.type = OFONO_ERROR_TYPE_FAILURE;	\
@@ -0,0 +1,130 @@
+/*
+ *
+ *  oFono - Open Source Telephony
+ *
+ *  Copyright (C) 2008-2010  Intel Corporation. All rights reserved.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <glib.h>
+
+#include <ofono/types.h>
+
+#include "gatresult.h"
+#include "common.h"
+
+#include "vendor.h"
+#include "call-progress.h"
+
+static const char *huawei_prefixes[] = { "^ORIG:", "^CONF:", "^CONN:",
+						"^CEND:", NULL };
+
+const char **at_call_progress_prefixes(unsigned int vendor)
+{
+	switch (vendor) {
+	case OFONO_VENDOR_HUAWEI:
+		return huawei_prefixes;
+	default:
+		return NULL;
+	}
+}
+
+static const struct {
+	const char *prefix;
+	int status;
+} huawei_indications[] = {
+	{ "^ORIG:", CALL_STATUS_DIALING },
+	{ "^CONF:", CALL_STATUS_ALERTING },
+	{ "^CONN:", CALL_STATUS_ACTIVE },
+	{ "^CEND:", CALL_STATUS_DISCONNECTED },
+};
+
+static gboolean parse_huawei(GAtResult *result, int *id, int *status)
+{
+	GAtResultIter iter;
+	unsigned int i;
+
+	for (i = 0; i < G_N_ELEMENTS(huawei_indications); i++) {
+		const char *prefix = huawei_indications[i].prefix;
+
+		g_at_result_iter_init(&iter, result);
+
+		if (!g_at_result_iter_next(&iter, prefix))
+			continue;
+
+		if (!g_at_result_iter_next_number(&iter, id))
+			return FALSE;
+
+		*status = huawei_indications[i].status;
+
+		return TRUE;
+	}
+
+	return FALSE;
+}
+
+gboolean at_call_progress_parse(GAtResult *result, unsigned int vendor,
+					int *id, int *status)
+{
+	switch (vendor) {
+	case OFONO_VENDOR_HUAWEI:
+		return parse_huawei(result, id, status);
+	default:
+		return FALSE;
+	}
+}
+
+void at_call_poll_init(struct at_call_poll *poll, gboolean indications)
+{
+	poll->indications = indications;
+	poll->interval = 0;
+}
+
+/*
+ * Returns how many ms to wait before the next CLCC, or 0 if there is no
+ * call in a transitional state and polling can stop.  Every poll that
+ * brings no news doubles the interval up to its maximum, any change in
+ * the call list starts over from the minimum.
+ */
+unsigned int at_call_poll_next(struct at_call_poll *poll,
+				gboolean transitional, gboolean changed)
+{
+	unsigned int min, max;
+
+	if (poll->indications) {
+		min = POLL_CLCC_FALLBACK_INTERVAL;
+		max = POLL_CLCC_FALLBACK_MAX_INTERVAL;
+	} else {
+		min = POLL_CLCC_INTERVAL;
+		max = POLL_CLCC_MAX_INTERVAL;
+	}
+
+	if (transitional == FALSE) {
+		poll->interval = 0;
+		return 0;
+	}
+
+	if (changed || poll->interval == 0)
+		poll->interval = min;
+	else
+		poll->interval = MIN(poll->interval * 2, max);
+
+	return poll->interval;
+}
@@ -0,0 +1,47 @@
+/*
+ *
+ *  oFono - Open Source Telephony
+ *
+ *  Copyright (C) 2008-2010  Intel Corporation. All rights reserved.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+/* Amount of ms we wait between CLCC calls while a call changes state */
+#define POLL_CLCC_INTERVAL 500
+
+/* Upper bound of the backoff when CLCC is the only source of call state */
+#define POLL_CLCC_MAX_INTERVAL 2000
+
+/*
+ * With call progress indications CLCC is only a safety net against lost
+ * indications, so it starts and stays much slower
+ */
+#define POLL_CLCC_FALLBACK_INTERVAL 5000
+#define POLL_CLCC_FALLBACK_MAX_INTERVAL 20000
+
+struct at_call_poll {
+	gboolean indications;
+	unsigned int interval;
+};
+
+const char **at_call_progress_prefixes(unsigned int vendor);
+
+gboolean at_call_progress_parse(GAtResult *result, unsigned int vendor,
+					int *id, int *status);
+
+void at_call_poll_init(struct at_call_poll *poll, gboolean indications);
+unsigned int at_call_poll_next(struct at_call_poll *poll,
+				gboolean transitional, gboolean changed);
@@ -48,6 +48,9 @@ static const char *csq_prefix[] = { "+CSQ:", NULL };
 static const char *cind_prefix[] = { "+CIND:", NULL };
 static const char *option_tech_prefix[] = { "_OCTI:", "_OUWCTI:", NULL };
 
+/* A full scan can legitimately take minutes, but must not hang the chat */
+#define COPS_LIST_TIMEOUT 180000
+
 struct netreg_data {
 	GAtChat *chat;
 	char mcc[OFONO_MAX_MCC_LENGTH + 1];
@@ -77,6 +80,20 @@ static void extract_mcc_mnc(const char *str, char *mcc, char *mnc)
 	mnc[OFONO_MAX_MNC_LENGTH] = '\0';
 }
 
+/*
+ * Copies a field returned by g_at_result_iter_next_slice into a buffer
+ * of max + 1 bytes, truncating it to at most max characters.
+ */
+static void copy_slice(char *dest, const char *str, unsigned int len,
+			unsigned int max)
+{
+	if (len > max)
+		len = max;
+
+	memcpy(dest, str, len);
+	dest[len] = '\0';
+}
+
 static int option_parse_tech(GAtResult *result)
 {
 	GAtResultIter iter;
@@ -419,7 +436,7 @@ static void cops_list_cb(gboolean ok, GAtResult *result, gpointer user_data)
 	while (g_at_result_iter_next(&iter, "+COPS:")) {
 		int status, tech;
 		const char *l, *s, *n;
-		gboolean have_long = FALSE;
+		unsigned int l_len, s_len, n_len;
 
 		while (1) {
 			if (!g_at_result_iter_open_list(&iter))
@@ -430,28 +447,30 @@ static void cops_list_cb(gboolean ok, GAtResult *result, gpointer user_data)
 
 			list[num].status = status;
 
-			if (!g_at_result_iter_next_string(&iter, &l))
+			if (!g_at_result_iter_next_slice(&iter, &l, &l_len))
 				break;
 
-			if (strlen(l) > 0) {
-				have_long = TRUE;
-				strncpy(list[num].name, l,
-					OFONO_MAX_OPERATOR_NAME_LENGTH);
-			}
-
-			if (!g_at_result_iter_next_string(&iter, &s))
+			if (!g_at_result_iter_next_slice(&iter, &s, &s_len))
 				break;
 
-			if (strlen(s) > 0 && !have_long)
-				strncpy(list[num].name, s,
+			if (l_len > 0)
+				copy_slice(list[num].name, l, l_len,
+					OFONO_MAX_OPERATOR_NAME_LENGTH);
+			else
+				copy_slice(list[num].name, s, s_len,
 					OFONO_MAX_OPERATOR_NAME_LENGTH);
 
-			list[num].name[OFONO_MAX_OPERATOR_NAME_LENGTH] = '\0';
-
-			if (!g_at_result_iter_next_string(&iter, &n))
+			if (!g_at_result_iter_next_slice(&iter, &n, &n_len))
 				break;
 
-			extract_mcc_mnc(n, list[num].mcc, list[num].mnc);
+			copy_slice(list[num].mcc, n, n_len,
+					OFONO_MAX_MCC_LENGTH);
+
+			if (n_len > OFONO_MAX_MCC_LENGTH)
+				copy_slice(list[num].mnc,
+					n + OFONO_MAX_MCC_LENGTH,
+					n_len - OFONO_MAX_MCC_LENGTH,
+					OFONO_MAX_MNC_LENGTH);
 
 			if (!g_at_result_iter_next_number(&iter, &tech))
 				tech = 0;
@@ -491,8 +510,9 @@ static void at_list_operators(struct ofono_netreg *netreg,
 	if (!cbd)
 		goto error;
 
-	if (g_at_chat_send(nd->chat, "AT+COPS=?", cops_prefix,
-				cops_list_cb, cbd, g_free) > 0)
+	if (g_at_chat_send_with_timeout(nd->chat, "AT+COPS=?", cops_prefix,
+					COPS_LIST_TIMEOUT, cops_list_cb,
+					cbd, g_free) > 0)
 		return;
 
 error:
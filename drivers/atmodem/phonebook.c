@@ -66,12 +66,40 @@ static void warn_bad()
 			" is required by 27.007.");
 }
 
-static gboolean parse_text(GAtResultIter *iter, char **str, int encoding)
+/*
+ * The text fields of one +CPBR entry are copied back to back into a
+ * single buffer, they never add up to more than the line they came from.
+ */
+struct text_buf {
+	char data[G_AT_RESULT_LINE_LENGTH_MAX + 1];
+	unsigned int used;
+};
+
+static const char *text_buf_add(struct text_buf *tb, const char *str,
+					unsigned int len)
+{
+	char *out;
+
+	if (len >= sizeof(tb->data) - tb->used)
+		return NULL;
+
+	out = tb->data + tb->used;
+	memcpy(out, str, len);
+	out[len] = '\0';
+	tb->used += len + 1;
+
+	return out;
+}
+
+static gboolean parse_text(GAtResultIter *iter, const char **str,
+				int encoding, struct text_buf *tb)
 {
 	const char *string;
+	unsigned int slen;
 	const guint8 *hex;
 	int len;
 	char *utf8;
+	gsize utf8_len;
 	/* charset_current is CHARSET_UCS2, CHARSET_IRA or CHARSET_UTF8 */
 	if (encoding == CHARSET_UCS2) {
 		/*
@@ -83,26 +111,27 @@ static gboolean parse_text(GAtResultIter *iter, char **str, int encoding)
 
 		utf8 = g_convert((const gchar*) hex, len,
 					"UTF-8//TRANSLIT", "UCS-2BE",
-					NULL, NULL, NULL);
+					NULL, &utf8_len, NULL);
 
-		if (utf8) {
-			*str = utf8;
-			return TRUE;
-		}
+		if (utf8 == NULL)
+			return FALSE;
 
-		return FALSE;
+		*str = text_buf_add(tb, utf8, utf8_len);
+		g_free(utf8);
+
+		return *str != NULL;
 	}
 
 	/*
 	 * In the case of IRA charset, assume these are Latin1
 	 * characters, same as in UTF8
 	 */
-	if (g_at_result_iter_next_string(iter, &string)) {
-		*str = g_strdup(string);
-		return TRUE;
-	}
+	if (g_at_result_iter_next_slice(iter, &string, &slen) == FALSE)
+		return FALSE;
+
+	*str = text_buf_add(tb, string, slen);
 
-	return FALSE;
+	return *str != NULL;
 }
 
 static const char *best_charset(int supported)
@@ -127,6 +156,7 @@ static void at_cpbr_notify(GAtResult *result, gpointer user_data)
 	struct ofono_phonebook *pb = cbd->user;
 	struct pb_data *pbd = ofono_phonebook_get_data(pb);
 	GAtResultIter iter;
+	struct text_buf tb;
 	int current;
 
 	if (pbd->supported & CHARSET_IRA)
@@ -144,15 +174,15 @@ static void at_cpbr_notify(GAtResult *result, gpointer user_data)
 		int index;
 		const char *number;
 		int type;
-		char *text;
+		const char *text;
 		int hidden = -1;
-		char *group = NULL;
+		const char *group = NULL;
 		const char *adnumber = NULL;
 		int adtype = -1;
-		char *secondtext = NULL;
-		char *email = NULL;
-		char *sip_uri = NULL;
-		char *tel_uri = NULL;
+		const char *secondtext = NULL;
+		const char *email = NULL;
+		const char *sip_uri = NULL;
+		const char *tel_uri = NULL;
 
 		if (!g_at_result_iter_next_number(&iter, &index))
 			continue;
@@ -163,31 +193,26 @@ static void at_cpbr_notify(GAtResult *result, gpointer user_data)
 		if (!g_at_result_iter_next_number(&iter, &type))
 			continue;
 
-		if (!parse_text(&iter, &text, current)) {
+		tb.used = 0;
+
+		if (!parse_text(&iter, &text, current, &tb)) {
 			warn_bad();
 			continue;
 		}
 
 		g_at_result_iter_next_number(&iter, &hidden);
-		parse_text(&iter, &group, current);
+		parse_text(&iter, &group, current, &tb);
 		g_at_result_iter_next_string(&iter, &adnumber);
 		g_at_result_iter_next_number(&iter, &adtype);
-		parse_text(&iter, &secondtext, current);
-		parse_text(&iter, &email, current);
-		parse_text(&iter, &sip_uri, current);
-		parse_text(&iter, &tel_uri, current);
+		parse_text(&iter, &secondtext, current, &tb);
+		parse_text(&iter, &email, current, &tb);
+		parse_text(&iter, &sip_uri, current, &tb);
+		parse_text(&iter, &tel_uri, current, &tb);
 
 		ofono_phonebook_entry(pb, index, number, type,
 			text, hidden, group, adnumber,
 			adtype, secondtext, email,
 			sip_uri, tel_uri);
-
-		g_free(text);
-		g_free(group);
-		g_free(secondtext);
-		g_free(email);
-		g_free(sip_uri);
-		g_free(tel_uri);
 	}
 }
 
@@ -32,6 +32,7 @@
 #include <ofono/modem.h>
 #include <ofono/sim.h>
 #include <ofono/stk.h>
+#include <ofono/voicecall.h>
 
 #include "gatchat.h"
 #include "gatresult.h"
@@ -50,7 +51,7 @@ struct sim_poll_data {
 	unsigned int stk_watch;
 	unsigned int sim_state_watch;
 	gboolean inserted;
-	int idle_poll_interval;
+	unsigned int interval;
 	gint status_timeout;
 	gint poll_timeout;
 	guint status_cmd;
@@ -58,23 +59,47 @@ struct sim_poll_data {
 
 static const char *csim_prefix[] = { "+CSIM:", NULL };
 
+static sim_poll_timeout_func timeout_add = g_timeout_add_seconds;
+
 static gboolean sim_status_poll(gpointer user_data);
 
-static void sim_status_poll_schedule(struct sim_poll_data *spd)
+static gboolean sim_poll_busy(struct sim_poll_data *spd)
+{
+	struct ofono_atom *vc_atom;
+
+	if (spd->stk && __ofono_stk_session_active(spd->stk))
+		return TRUE;
+
+	vc_atom = __ofono_modem_find_atom(spd->modem,
+						OFONO_ATOM_TYPE_VOICECALL);
+	if (vc_atom == NULL)
+		return FALSE;
+
+	return __ofono_voicecall_is_busy(__ofono_atom_get_data(vc_atom),
+					OFONO_VOICECALL_INTERACTION_NONE);
+}
+
+static void sim_status_poll_schedule(struct sim_poll_data *spd,
+					gboolean proactive)
 {
-	/* TODO: Decide on the interval based on whether any call is active */
-	/* TODO: On idle, possibly only schedule if proactive commands enabled
-	 * as indicated by EFphase + EFsst (51.011: 11.6.1) */
-	int interval = spd->idle_poll_interval;
+	unsigned int requested = 0;
+	gboolean busy;
 
-	/* When a SIM is inserted, the SIM might have requested a different
+	/* When a SIM is inserted, the SIM might have requested an
 	 * interval.  */
 	if (spd->inserted)
-		interval = ofono_modem_get_integer(spd->modem,
+		requested = ofono_modem_get_integer(spd->modem,
 				"status-poll-interval");
 
-	spd->poll_timeout = g_timeout_add_seconds(interval,
-			sim_status_poll, spd);
+	/* An absent card is looked for at the usual pace */
+	busy = proactive || !spd->inserted || sim_poll_busy(spd);
+
+	spd->interval = sim_poll_next_interval(spd->interval, requested,
+						busy);
+
+	DBG("next STATUS in %u s", spd->interval);
+
+	spd->poll_timeout = timeout_add(spd->interval, sim_status_poll, spd);
 }
 
 static gboolean sim_status_timeout(gpointer user_data)
@@ -91,19 +116,47 @@ static gboolean sim_status_timeout(gpointer user_data)
 		ofono_sim_inserted_notify(spd->sim, FALSE);
 	}
 
-	sim_status_poll_schedule(spd);
+	sim_status_poll_schedule(spd, FALSE);
 
 	return FALSE;
 }
 
-static void at_csim_status_cb(gboolean ok, GAtResult *result,
-		gpointer user_data)
+/* Returns the length of the pending proactive command, or -1 if none */
+static int csim_status_fetch_length(gboolean ok, GAtResult *result)
 {
-	struct sim_poll_data *spd = user_data;
 	GAtResultIter iter;
 	const guint8 *response;
 	gint rlen, len;
 
+	if (!ok)
+		return -1;
+
+	g_at_result_iter_init(&iter, result);
+
+	if (!g_at_result_iter_next(&iter, "+CSIM:"))
+		return -1;
+
+	if (!g_at_result_iter_next_number(&iter, &rlen))
+		return -1;
+
+	if (!g_at_result_iter_next_hexstring(&iter, &response, &len))
+		return -1;
+
+	if (rlen != len * 2 || len < 2)
+		return -1;
+
+	if (response[len - 2] != 0x91)
+		return -1;
+
+	return response[len - 1];
+}
+
+static void at_csim_status_cb(gboolean ok, GAtResult *result,
+		gpointer user_data)
+{
+	struct sim_poll_data *spd = user_data;
+	int fetch;
+
 	spd->status_cmd = 0;
 
 	if (!spd->status_timeout)
@@ -120,44 +173,44 @@ static void at_csim_status_cb(gboolean ok, GAtResult *result,
 		ofono_sim_inserted_notify(spd->sim, TRUE);
 	}
 
-	sim_status_poll_schedule(spd);
-
 	/* Check if we have a proactive command */
+	fetch = csim_status_fetch_length(ok, result);
 
-	if (!ok)
-		return;
+	sim_status_poll_schedule(spd, fetch >= 0);
 
-	g_at_result_iter_init(&iter, result);
-
-	if (!g_at_result_iter_next(&iter, "+CSIM:"))
-		return;
-
-	if (!g_at_result_iter_next_number(&iter, &rlen))
-		return;
-
-	if (!g_at_result_iter_next_hexstring(&iter, &response, &len))
-		return;
-
-	if (rlen != len * 2 || len < 2)
-		return;
-
-	if (response[len - 2] != 0x91)
+	if (fetch < 0)
 		return;
 
 	/* We have a proactive command pending, FETCH it */
-	at_sim_fetch_command(spd->stk, response[len - 1]);
+	at_sim_fetch_command(spd->stk, fetch);
 }
 
 static gboolean sim_status_poll(gpointer user_data)
 {
 	struct sim_poll_data *spd = user_data;
+	unsigned int idle;
 
 	spd->poll_timeout = 0;
 
+	/*
+	 * No STATUS is needed if other commands went to the card within
+	 * the interval, wait for the interval to pass since the last.
+	 * Only STATUS is checked for a pending proactive command though,
+	 * so it is never skipped while the SIM Toolkit is in use.
+	 */
+	if (spd->inserted && spd->stk == NULL) {
+		idle = __ofono_sim_get_idle_time(spd->sim);
+
+		if (idle < spd->interval) {
+			spd->poll_timeout = timeout_add(spd->interval - idle,
+							sim_status_poll, spd);
+			return FALSE;
+		}
+	}
+
 	/* The SIM must respond in a given time frame which is of at
 	 * least 5 seconds in TS 11.11.  */
-	spd->status_timeout = g_timeout_add_seconds(5,
-			sim_status_timeout, spd);
+	spd->status_timeout = timeout_add(5, sim_status_timeout, spd);
 
 	/* Send STATUS */
 	spd->status_cmd = g_at_chat_send(spd->chat, "AT+CSIM=8,A0F200C0",
@@ -174,9 +227,12 @@ static void sim_state_watch(enum ofono_sim_state new_state, void *user)
 
 	spd->inserted = new_state != OFONO_SIM_STATE_NOT_PRESENT;
 
-	if (!spd->inserted)
+	/* A new card starts over, with no interval of its own */
+	if (!spd->inserted) {
 		ofono_modem_set_integer(spd->modem,
-				"status-poll-interval", 30);
+				"status-poll-interval", 0);
+		spd->interval = 0;
+	}
 }
 
 static void sim_watch(struct ofono_atom *atom,
@@ -252,7 +308,6 @@ void atmodem_poll_enable(struct ofono_modem *modem, GAtChat *chat)
 	spd = g_new0(struct sim_poll_data, 1);
 	spd->chat = chat;
 	spd->modem = modem;
-	spd->idle_poll_interval = 30;
 
 	spd->stk_watch = __ofono_modem_add_atom_watch(spd->modem,
 			OFONO_ATOM_TYPE_STK, stk_watch, spd, NULL);
@@ -266,3 +321,8 @@ void atmodem_poll_enable(struct ofono_modem *modem, GAtChat *chat)
 		sim_watch(sim_atom,
 				OFONO_ATOM_WATCH_CONDITION_REGISTERED, spd);
 }
+
+void atmodem_poll_set_timeout_func(sim_poll_timeout_func func)
+{
+	timeout_add = func;
+}
@@ -20,3 +20,33 @@
  */
 
 void atmodem_poll_enable(struct ofono_modem *modem, GAtChat *chat);
+
+/*
+ * Arms the poll timers, in s.  It is g_timeout_add_seconds, the unit
+ * test makes time go by faster.
+ */
+typedef guint (*sim_poll_timeout_func)(guint interval, GSourceFunc function,
+					gpointer data);
+
+void atmodem_poll_set_timeout_func(sim_poll_timeout_func func);
+
+/*
+ * STATUS is sent every 30 s while a call is up or the SIM Toolkit is in
+ * use, and backs off up to 5 min while the modem is idle.  Only a poll
+ * interval requested by the SIM makes it faster.  Intervals are in s.
+ */
+#define SIM_POLL_INTERVAL 30
+#define SIM_POLL_IDLE_MAX_INTERVAL 300
+
+static inline unsigned int sim_poll_next_interval(unsigned int interval,
+							unsigned int requested,
+							gboolean busy)
+{
+	if (requested)
+		return requested;
+
+	if (busy || interval == 0)
+		return SIM_POLL_INTERVAL;
+
+	return MIN(interval * 2, SIM_POLL_IDLE_MAX_INTERVAL);
+}
@@ -50,15 +50,29 @@ static const char *cpms_prefix[] = { "+CPMS:", NULL };
 static const char *cnmi_prefix[] = { "+CNMI:", NULL };
 static const char *cmgs_prefix[] = { "+CMGS:", NULL };
 static const char *cmgl_prefix[] = { "+CMGL:", NULL };
+static const char *cmgd_prefix[] = { "+CMGD:", NULL };
 static const char *none_prefix[] = { NULL };
 
 static gboolean set_cmgf(gpointer user_data);
 static gboolean set_cpms(gpointer user_data);
+static gboolean at_cmti_sweep(gpointer user_data);
 static void at_cmgl_set_cpms(struct ofono_sms *sms, int store);
 
 #define MAX_CMGF_RETRIES 10
 #define MAX_CPMS_RETRIES 10
 
+/*
+ * CMTI indications arriving within this many ms of each other are
+ * served by a single listing of the storage
+ */
+#define CMTI_COALESCE_INTERVAL 100
+
+/*
+ * AT+CMGS commands handed over before the first one is answered, the
+ * chat queues them so that the next one goes out without a round-trip
+ */
+#define AT_CMGS_MAX_IN_FLIGHT 4
+
 static const char *storages[] = {
 	"SM",
 	"ME",
@@ -76,6 +90,13 @@ struct sms_data {
 	char *cnma_ack_pdu;
 	int cnma_ack_pdu_len;
 	guint timeout_source;
+	guint cmti_source;
+	unsigned int cmti_stores;	/* Stores with unread messages */
+	gboolean cmti_sweeping;
+	gboolean cmgd_bulk;		/* AT+CMGD=<index>,1 is supported */
+	int cmgl_count;			/* Messages found by this listing */
+	int cmgl_index;
+	int cmms; /* last AT+CMMS mode requested */
 	GAtChat *chat;
 	unsigned int vendor;
 };
@@ -230,18 +251,32 @@ static void at_cmgs(struct ofono_sms *sms, unsigned char *pdu, int pdu_len,
 	if (!cbd)
 		goto error;
 
-	if (mms) {
+	/*
+	 * Mode 1 lapses by itself a few seconds after the last send, so it
+	 * is renewed with every PDU.  Mode 2 lasts until it is reset, which
+	 * is done once the last PDU of a burst has been queued.
+	 */
+	if (mms == 1 || (mms == 2 && data->cmms != 2)) {
 		snprintf(buf, sizeof(buf), "AT+CMMS=%d", mms);
 		g_at_chat_send(data->chat, buf, none_prefix,
 				NULL, NULL, NULL);
+		data->cmms = mms;
 	}
 
 	len = snprintf(buf, sizeof(buf), "AT+CMGS=%d\r", tpdu_len);
 	encode_hex_own_buf(pdu, pdu_len, 0, buf+len);
 
 	if (g_at_chat_send(data->chat, buf, cmgs_prefix,
-				at_cmgs_cb, cbd, g_free) > 0)
-		return;
+				at_cmgs_cb, cbd, g_free) == 0)
+		goto error;
+
+	if (mms == 0 && data->cmms == 2) {
+		g_at_chat_send(data->chat, "AT+CMMS=0", none_prefix,
+				NULL, NULL, NULL);
+		data->cmms = 0;
+	}
+
+	return;
 
 error:
 	g_free(cbd);
@@ -547,6 +582,7 @@ static void at_send_cmgr_cpms(struct ofono_sms *sms, int store, int index,
 static void at_cmti_notify(GAtResult *result, gpointer user_data)
 {
 	struct ofono_sms *sms = user_data;
+	struct sms_data *data = ofono_sms_get_data(sms);
 	enum at_util_sms_store store;
 	int index;
 
@@ -554,11 +590,23 @@ static void at_cmti_notify(GAtResult *result, gpointer user_data)
 						&store, &index) == FALSE)
 		goto error;
 
-	if (store != AT_UTIL_SMS_STORE_SM && store != AT_UTIL_SMS_STORE_ME)
-		goto error;
-
 	DBG("Got a CMTI indication at %s, index: %d", storages[store], index);
-	at_send_cmgr_cpms(sms, store, index, FALSE);
+
+	/* Only the SMS stores are listed, others are read one by one */
+	if (store != AT_UTIL_SMS_STORE_SM && store != AT_UTIL_SMS_STORE_ME) {
+		at_send_cmgr_cpms(sms, store, index,
+					store == AT_UTIL_SMS_STORE_SR);
+		return;
+	}
+
+	/* The message is picked up by the next listing of the store */
+	data->cmti_stores |= 1 << store;
+
+	if (data->cmti_sweeping || data->cmti_source > 0)
+		return;
+
+	data->cmti_source = g_timeout_add(CMTI_COALESCE_INTERVAL,
+						at_cmti_sweep, sms);
 	return;
 
 error:
@@ -659,6 +707,13 @@ static void at_cmgl_notify(GAtResult *result, gpointer user_data)
 		decode_hex_own_buf(hexpdu, -1, &pdu_len, 0, pdu);
 		ofono_sms_deliver_notify(sms, pdu, pdu_len, tpdu_len);
 
+		data->cmgl_count += 1;
+		data->cmgl_index = index;
+
+		/* With bulk delete, all are removed once listed */
+		if (data->cmgd_bulk)
+			continue;
+
 		/* We don't buffer SMS on the SIM/ME, send along a CMGD */
 		snprintf(buf, sizeof(buf), "AT+CMGD=%d", index);
 		g_at_chat_send(data->chat, buf, none_prefix,
@@ -670,6 +725,27 @@ err:
 	ofono_error("Unable to parse CMGL response");
 }
 
+/*
+ * Listing a message marks it as read, so once the listing is over all
+ * of them go away with a single delete of the read messages.  The
+ * index is ignored, but some modems want a valid one anyway.
+ */
+static void at_cmgl_delete(struct ofono_sms *sms)
+{
+	struct sms_data *data = ofono_sms_get_data(sms);
+	char buf[32];
+
+	if (data->cmgd_bulk && data->cmgl_count > 0) {
+		DBG("Deleting %d messages", data->cmgl_count);
+
+		snprintf(buf, sizeof(buf), "AT+CMGD=%d,1", data->cmgl_index);
+		g_at_chat_send(data->chat, buf, none_prefix,
+				at_cmgd_cb, NULL, NULL);
+	}
+
+	data->cmgl_count = 0;
+}
+
 static void at_cmgl_cb(gboolean ok, GAtResult *result, gpointer user_data)
 {
 	struct ofono_sms *sms = user_data;
@@ -677,6 +753,7 @@ static void at_cmgl_cb(gboolean ok, GAtResult *result, gpointer user_data)
 	if (!ok)
 		DBG("Initial listing SMS storage failed!");
 
+	at_cmgl_delete(sms);
 	at_cmgl_done(sms);
 }
 
@@ -726,10 +803,135 @@ static void at_cmgl_set_cpms(struct ofono_sms *sms, int store)
 	}
 }
 
+static void at_cmti_sweep_next(struct ofono_sms *sms);
+
+static void at_cmti_cmgl_cb(gboolean ok, GAtResult *result,
+				gpointer user_data)
+{
+	struct ofono_sms *sms = user_data;
+
+	if (!ok)
+		ofono_error("Received CMTI, but CMGL request failed");
+
+	at_cmgl_delete(sms);
+	at_cmti_sweep_next(sms);
+}
+
+static void at_cmti_cpms_cb(gboolean ok, GAtResult *result,
+				gpointer user_data)
+{
+	struct cpms_request *req = user_data;
+	struct ofono_sms *sms = req->sms;
+	struct sms_data *data = ofono_sms_get_data(sms);
+
+	if (!ok) {
+		ofono_error("Received CMTI, but CPMS request failed");
+		at_cmti_sweep_next(sms);
+		return;
+	}
+
+	data->store = req->store;
+
+	/* Only the unread ones, those are the ones we were told about */
+	g_at_chat_send_pdu_listing(data->chat, "AT+CMGL=0", cmgl_prefix,
+					at_cmgl_notify, at_cmti_cmgl_cb,
+					sms, NULL);
+}
+
+static void at_cmti_sweep_next(struct ofono_sms *sms)
+{
+	struct sms_data *data = ofono_sms_get_data(sms);
+	int store;
+
+	for (store = 0; store < (int) G_N_ELEMENTS(storages); store++)
+		if (data->cmti_stores & (1 << store))
+			break;
+
+	if (store == (int) G_N_ELEMENTS(storages)) {
+		data->cmti_sweeping = FALSE;
+		return;
+	}
+
+	data->cmti_stores &= ~(1 << store);
+
+	if (store == data->store) {
+		struct cpms_request req;
+
+		req.sms = sms;
+		req.store = store;
+
+		at_cmti_cpms_cb(TRUE, NULL, &req);
+	} else {
+		char buf[128];
+		const char *incoming = storages[data->incoming];
+		struct cpms_request *req = g_new(struct cpms_request, 1);
+
+		req->sms = sms;
+		req->store = store;
+
+		snprintf(buf, sizeof(buf), "AT+CPMS=\"%s\",\"%s\",\"%s\"",
+				storages[store], storages[store], incoming);
+
+		g_at_chat_send(data->chat, buf, cpms_prefix, at_cmti_cpms_cb,
+				req, g_free);
+	}
+}
+
+/*
+ * Lists every store a CMTI was received for, instead of reading and
+ * deleting each message on its own.  CMTIs arriving meanwhile trigger
+ * another pass over their store.
+ */
+static gboolean at_cmti_sweep(gpointer user_data)
+{
+	struct ofono_sms *sms = user_data;
+	struct sms_data *data = ofono_sms_get_data(sms);
+
+	data->cmti_source = 0;
+	data->cmti_sweeping = TRUE;
+
+	at_cmti_sweep_next(sms);
+
+	return FALSE;
+}
+
+static void at_cmgd_query_cb(gboolean ok, GAtResult *result,
+				gpointer user_data)
+{
+	struct ofono_sms *sms = user_data;
+	struct sms_data *data = ofono_sms_get_data(sms);
+	GAtResultIter iter;
+	int min, max;
+
+	if (!ok)
+		return;
+
+	g_at_result_iter_init(&iter, result);
+
+	if (!g_at_result_iter_next(&iter, "+CMGD:"))
+		return;
+
+	/* The list of indexes in use, then the supported delflags */
+	if (!g_at_result_iter_skip_next(&iter))
+		return;
+
+	if (!g_at_result_iter_open_list(&iter))
+		return;
+
+	while (g_at_result_iter_next_range(&iter, &min, &max))
+		if (min <= 1 && max >= 1)
+			data->cmgd_bulk = TRUE;
+
+	DBG("Bulk delete %ssupported", data->cmgd_bulk ? "" : "not ");
+}
+
 static void at_sms_initialized(struct ofono_sms *sms)
 {
 	struct sms_data *data = ofono_sms_get_data(sms);
 
+	g_at_chat_send(data->chat, "AT+CMGD=?", cmgd_prefix,
+			at_cmgd_query_cb, sms, NULL);
+
 	/* Inspect and free the incoming SMS storage */
 	if (data->incoming == AT_UTIL_SMS_STORE_MT)
 		at_cmgl_set_cpms(sms, AT_UTIL_SMS_STORE_ME);
@@ -1223,6 +1425,7 @@ static int at_sms_probe(struct ofono_sms *sms, unsigned int vendor,
 	data->vendor = vendor;
 
 	ofono_sms_set_data(sms, data);
+	ofono_sms_set_max_in_flight(sms, AT_CMGS_MAX_IN_FLIGHT);
 
 	g_at_chat_send(data->chat, "AT+CSMS=?", csms_prefix,
 			at_csms_query_cb, sms, NULL);
@@ -1239,6 +1442,9 @@ static void at_sms_remove(struct ofono_sms *sms)
 	if (data->timeout_source > 0)
 		g_source_remove(data->timeout_source);
 
+	if (data->cmti_source > 0)
+		g_source_remove(data->cmti_source);
+
 	g_at_chat_unref(data->chat);
 	g_free(data);
 }
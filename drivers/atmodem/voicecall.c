@@ -37,11 +37,10 @@
 
 #include "gatchat.h"
 #include "gatresult.h"
+#include "common.h"
 
 #include "atmodem.h"
-
-/* Amount of ms we wait between CLCC calls */
-#define POLL_CLCC_INTERVAL 500
+#include "call-progress.h"
 
  /* Amount of time we give for CLIP to arrive before we commence CLCC poll */
 #define CLIP_INTERVAL 200
@@ -56,6 +55,7 @@ struct voicecall_data {
 	GSList *calls;
 	unsigned int local_release;
 	unsigned int clcc_source;
+	struct at_call_poll poll;
 	GAtChat *chat;
 	unsigned int vendor;
 };
@@ -76,6 +76,36 @@ struct change_state_req {
 
 static gboolean poll_clcc(gpointer user_data);
 
+static gboolean has_transitional_calls(GSList *calls)
+{
+	GSList *l;
+
+	for (l = calls; l; l = l->next) {
+		struct ofono_call *call = l->data;
+
+		if (call->status >= CALL_STATUS_DIALING &&
+				call->status <= CALL_STATUS_WAITING)
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
+static void schedule_clcc_poll(struct ofono_voicecall *vc, gboolean changed)
+{
+	struct voicecall_data *vd = ofono_voicecall_get_data(vc);
+	unsigned int interval;
+
+	interval = at_call_poll_next(&vd->poll,
+					has_transitional_calls(vd->calls),
+					changed);
+
+	if (interval == 0 || vd->clcc_source)
+		return;
+
+	vd->clcc_source = g_timeout_add(interval, poll_clcc, vc);
+}
+
 static int class_to_call_type(int cls)
 {
 	switch (cls) {
@@ -132,7 +162,7 @@ static void clcc_poll_cb(gboolean ok, GAtResult *result, gpointer user_data)
 	GSList *calls;
 	GSList *n, *o;
 	struct ofono_call *nc, *oc;
-	gboolean poll_again = FALSE;
+	gboolean changed = FALSE;
 
 	if (!ok) {
 		ofono_error("We are polling CLCC and received an error");
@@ -149,9 +179,6 @@ static void clcc_poll_cb(gboolean ok, GAtResult *result, gpointer user_data)
 		nc = n ? n->data : NULL;
 		oc = o ? o->data : NULL;
 
-		if (nc && nc->status >= 2 && nc->status <= 5)
-			poll_again = TRUE;
-
 		if (oc && (!nc || (nc->id > oc->id))) {
 			enum ofono_disconnect_reason reason;
 
@@ -164,12 +191,14 @@ static void clcc_poll_cb(gboolean ok, GAtResult *result, gpointer user_data)
 				ofono_voicecall_disconnected(vc, oc->id,
 								reason, NULL);
 
+			changed = TRUE;
 			o = o->next;
 		} else if (nc && (!oc || (nc->id < oc->id))) {
 			/* new call, signal it */
 			if (nc->type == 0)
 				ofono_voicecall_notify(vc, nc);
 
+			changed = TRUE;
 			n = n->next;
 		} else {
 			/* Always use the clip_validity from old call
@@ -181,9 +210,12 @@ static void clcc_poll_cb(gboolean ok, GAtResult *result, gpointer user_data)
 			 */
 			nc->clip_validity = oc->clip_validity;
 
-			if (memcmp(nc, oc, sizeof(struct ofono_call)) &&
-					!nc->type)
-				ofono_voicecall_notify(vc, nc);
+			if (memcmp(nc, oc, sizeof(struct ofono_call))) {
+				if (!nc->type)
+					ofono_voicecall_notify(vc, nc);
+
+				changed = TRUE;
+			}
 
 			n = n->next;
 			o = o->next;
@@ -197,9 +229,7 @@ static void clcc_poll_cb(gboolean ok, GAtResult *result, gpointer user_data)
 
 	vd->local_release = 0;
 
-	if (poll_again && !vd->clcc_source)
-		vd->clcc_source = g_timeout_add(POLL_CLCC_INTERVAL,
-						poll_clcc, vc);
+	schedule_clcc_poll(vc, changed);
 }
 
 static gboolean poll_clcc(gpointer user_data)
@@ -321,9 +351,7 @@ static void atd_cb(gboolean ok, GAtResult *result, gpointer user_data)
 	if (validity != 2)
 		ofono_voicecall_notify(vc, call);
 
-	if (!vd->clcc_source)
-		vd->clcc_source = g_timeout_add(POLL_CLCC_INTERVAL,
-						poll_clcc, vc);
+	schedule_clcc_poll(vc, TRUE);
 
 out:
 	cb(&error, cbd->data);
@@ -772,9 +800,71 @@ static void ccwa_notify(GAtResult *result, gpointer user_data)
 	if (call->type == 0) /* Only notify voice calls */
 		ofono_voicecall_notify(vc, call);
 
-	if (vd->clcc_source == 0)
-		vd->clcc_source = g_timeout_add(POLL_CLCC_INTERVAL,
-						poll_clcc, vc);
+	schedule_clcc_poll(vc, TRUE);
+}
+
+static void call_progress_notify(GAtResult *result, gpointer user_data)
+{
+	struct ofono_voicecall *vc = user_data;
+	struct voicecall_data *vd = ofono_voicecall_get_data(vc);
+	struct ofono_call *call;
+	GSList *l;
+	int id, status;
+
+	if (!at_call_progress_parse(result, vd->vendor, &id, &status))
+		return;
+
+	DBG("call %d status %d", id, status);
+
+	l = g_slist_find_custom(vd->calls, GINT_TO_POINTER(id),
+				at_util_call_compare_by_id);
+
+	if (l == NULL) {
+		/*
+		 * Dialing can be indicated before ATD returns, in which
+		 * case atd_cb creates the call.  For anything else we
+		 * do not know about, ask CLCC once.
+		 */
+		if (status == CALL_STATUS_DIALING ||
+				status == CALL_STATUS_DISCONNECTED)
+			return;
+
+		g_at_chat_send(vd->chat, "AT+CLCC", clcc_prefix,
+				clcc_poll_cb, vc, NULL);
+		return;
+	}
+
+	call = l->data;
+
+	if (status == CALL_STATUS_DISCONNECTED) {
+		enum ofono_disconnect_reason reason;
+
+		if (vd->local_release & (0x1 << call->id))
+			reason = OFONO_DISCONNECT_REASON_LOCAL_HANGUP;
+		else
+			reason = OFONO_DISCONNECT_REASON_REMOTE_HANGUP;
+
+		if (!call->type)
+			ofono_voicecall_disconnected(vc, call->id,
+							reason, NULL);
+
+		vd->local_release &= ~(0x1 << call->id);
+		vd->calls = g_slist_remove(vd->calls, call);
+		g_free(call);
+	} else if (call->status != status) {
+		call->status = status;
+
+		if (!call->type)
+			ofono_voicecall_notify(vc, call);
+	}
+
+	/* Nothing left in flux, the fallback poll is no longer needed */
+	if (!has_transitional_calls(vd->calls) && vd->clcc_source) {
+		g_source_remove(vd->clcc_source);
+		vd->clcc_source = 0;
+	}
+
+	schedule_clcc_poll(vc, TRUE);
 }
 
 static void no_carrier_notify(GAtResult *result, gpointer user_data)
@@ -813,6 +903,8 @@ static void at_voicecall_initialized(gboolean ok, GAtResult *result,
 {
 	struct ofono_voicecall *vc = user_data;
 	struct voicecall_data *vd = ofono_voicecall_get_data(vc);
+	const char **prefixes = at_call_progress_prefixes(vd->vendor);
+	int i;
 
 	DBG("voicecall_init: registering to notifications");
 
@@ -821,14 +913,23 @@ static void at_voicecall_initialized(gboolean ok, GAtResult *result,
 	g_at_chat_register(vd->chat, "+CLIP:", clip_notify, FALSE, vc, NULL);
 	g_at_chat_register(vd->chat, "+CCWA:", ccwa_notify, FALSE, vc, NULL);
 
-	/* Modems with 'better' call progress indicators should
-	 * probably not even bother registering to these
-	 */
-	g_at_chat_register(vd->chat, "NO CARRIER",
-				no_carrier_notify, FALSE, vc, NULL);
-	g_at_chat_register(vd->chat, "NO ANSWER",
-				no_answer_notify, FALSE, vc, NULL);
-	g_at_chat_register(vd->chat, "BUSY", busy_notify, FALSE, vc, NULL);
+	if (prefixes) {
+		for (i = 0; prefixes[i]; i++)
+			g_at_chat_register(vd->chat, prefixes[i],
+						call_progress_notify,
+						FALSE, vc, NULL);
+	} else {
+		/*
+		 * Without call progress indications the end of a call
+		 * can only be learned by polling CLCC
+		 */
+		g_at_chat_register(vd->chat, "NO CARRIER",
+					no_carrier_notify, FALSE, vc, NULL);
+		g_at_chat_register(vd->chat, "NO ANSWER",
+					no_answer_notify, FALSE, vc, NULL);
+		g_at_chat_register(vd->chat, "BUSY", busy_notify,
+					FALSE, vc, NULL);
+	}
 
 	ofono_voicecall_register(vc);
 
@@ -846,6 +947,8 @@ static int at_voicecall_probe(struct ofono_voicecall *vc, unsigned int vendor,
 	vd->chat = g_at_chat_clone(chat);
 	vd->vendor = vendor;
 
+	at_call_poll_init(&vd->poll, at_call_progress_prefixes(vendor) != NULL);
+
 	ofono_voicecall_set_data(vc, vd);
 
 	g_at_chat_send(vd->chat, "AT+CRC=1", NULL, NULL, NULL, NULL);
@@ -49,6 +49,11 @@ struct gprs_context_data {
 	GAtChat *chat;
 	unsigned int active_context;
 	unsigned int dhcp_source;
+	unsigned int dhcp_id;
+	struct at_util_poll dhcp_poll;
+	gboolean have_notify;
+	gboolean activating;		/* Until ^NDISDUP is answered */
+	gboolean link_down;		/* Reported meanwhile */
 	union {
 		ofono_gprs_context_cb_t down_cb;	/* Down callback */
 		ofono_gprs_context_up_cb_t up_cb;	/* Up callback */
@@ -105,8 +110,15 @@ static void dhcp_query_cb(gboolean ok, GAtResult *result, gpointer user_data)
 
 	DBG("");
 
+	gcd->dhcp_id = 0;
+
+	if (gcd->active_context == 0 || gcd->up_cb == NULL)
+		return;
+
 	if (!ok) {
-		gcd->dhcp_source = g_timeout_add_seconds(1, dhcp_poll, gc);
+		gcd->dhcp_source = g_timeout_add(
+					at_util_poll_next(&gcd->dhcp_poll),
+					dhcp_poll, gc);
 		return;
 	}
 
@@ -149,10 +161,94 @@ static void check_dhcp(struct ofono_gprs_context *gc)
 {
 	struct gprs_context_data *gcd = ofono_gprs_context_get_data(gc);
 
-	g_at_chat_send(gcd->chat, "AT^DHCP?", dhcp_prefix,
+	if (gcd->dhcp_source) {
+		g_source_remove(gcd->dhcp_source);
+		gcd->dhcp_source = 0;
+	}
+
+	/* A query is already on its way */
+	if (gcd->dhcp_id > 0)
+		return;
+
+	gcd->dhcp_id = g_at_chat_send(gcd->chat, "AT^DHCP?", dhcp_prefix,
 					dhcp_query_cb, gc, NULL);
 }
 
+static void huawei_connected(struct ofono_gprs_context *gc)
+{
+	struct gprs_context_data *gcd = ofono_gprs_context_get_data(gc);
+
+	DBG("");
+
+	gcd->have_notify = TRUE;
+
+	if (gcd->active_context == 0 || gcd->up_cb == NULL)
+		return;
+
+	/* The link is up, no need to wait for the next poll */
+	check_dhcp(gc);
+}
+
+static void huawei_disconnected(struct ofono_gprs_context *gc)
+{
+	struct gprs_context_data *gcd = ofono_gprs_context_get_data(gc);
+
+	DBG("");
+
+	gcd->have_notify = TRUE;
+
+	if (gcd->active_context == 0)
+		return;
+
+	/* Fail the activation once the modem answers the request */
+	if (gcd->activating) {
+		gcd->link_down = TRUE;
+		return;
+	}
+
+	/* Still coming up, the modem may report the link down meanwhile */
+	if (gcd->up_cb != NULL)
+		return;
+
+	ofono_gprs_context_deactivated(gc, gcd->active_context);
+	gcd->active_context = 0;
+}
+
+static void dconn_notify(GAtResult *result, gpointer user_data)
+{
+	huawei_connected(user_data);
+}
+
+static void dend_notify(GAtResult *result, gpointer user_data)
+{
+	huawei_disconnected(user_data);
+}
+
+static void ndisstat_notify(GAtResult *result, gpointer user_data)
+{
+	GAtResultIter iter;
+	int stat;
+
+	g_at_result_iter_init(&iter, result);
+
+	if (g_at_result_iter_next(&iter, "^NDISSTAT:") == FALSE)
+		return;
+
+	if (g_at_result_iter_next_number(&iter, &stat) == FALSE)
+		return;
+
+	/* 0 and 3 mean disconnected, 2 is still connecting */
+	switch (stat) {
+	case 0:
+	case 3:
+		huawei_disconnected(user_data);
+		break;
+	case 1:
+		huawei_connected(user_data);
+		break;
+	}
+}
+
 static void at_ndisdup_down_cb(gboolean ok, GAtResult *result,
 				gpointer user_data)
 {
@@ -165,6 +261,7 @@ static void at_ndisdup_down_cb(gboolean ok, GAtResult *result,
 	DBG("");
 
 	if (ok) {
+		gcd->active_context = 0;
 		gcd->down_cb = cb;
 		gcd->cb_data = cbd->data;
 	}
@@ -184,10 +281,25 @@ static void at_ndisdup_up_cb(gboolean ok, GAtResult *result,
 
 	DBG("");
 
+	gcd->activating = FALSE;
+
+	if (ok && gcd->link_down) {
+		gcd->active_context = 0;
+
+		CALLBACK_WITH_FAILURE(cb, NULL, FALSE, NULL, NULL, NULL, NULL,
+					cbd->data);
+		return;
+	}
+
 	if (ok) {
 		gcd->up_cb = cb;
 		gcd->cb_data = cbd->data;
 
+		/*
+		 * Firmware that announced the link before only needs a slow
+		 * poll in case the announcement gets lost
+		 */
+		at_util_poll_init(&gcd->dhcp_poll, gcd->have_notify);
 		check_dhcp(gc);
 		return;
 	}
@@ -213,6 +325,7 @@ static void at_cgdcont_cb(gboolean ok, GAtResult *result, gpointer user_data)
 		struct ofono_error error;
 
 		gcd->active_context = 0;
+		gcd->activating = FALSE;
 
 		decode_at_error(&error, g_at_result_final_response(result));
 		cb(&error, NULL, 0, NULL, NULL, NULL, NULL, cbd->data);
@@ -230,6 +343,7 @@ static void at_cgdcont_cb(gboolean ok, GAtResult *result, gpointer user_data)
 	g_free(ncbd);
 
 	gcd->active_context = 0;
+	gcd->activating = FALSE;
 
 	CALLBACK_WITH_FAILURE(cb, NULL, 0, NULL, NULL, NULL, NULL, cbd->data);
 }
@@ -249,6 +363,8 @@ static void huawei_gprs_activate_primary(struct ofono_gprs_context *gc,
 		goto error;
 
 	gcd->active_context = ctx->cid;
+	gcd->activating = TRUE;
+	gcd->link_down = FALSE;
 
 	cbd->user = gc;
 
@@ -262,6 +378,9 @@ static void huawei_gprs_activate_primary(struct ofono_gprs_context *gc,
 				at_cgdcont_cb, cbd, g_free) > 0)
 		return;
 
+	gcd->active_context = 0;
+	gcd->activating = FALSE;
+
 error:
 	g_free(cbd);
 
@@ -306,6 +425,11 @@ static int huawei_gprs_context_probe(struct ofono_gprs_context *gc,
 
 	ofono_gprs_context_set_data(gc, gcd);
 
+	g_at_chat_register(gcd->chat, "^DCONN", dconn_notify, FALSE, gc, NULL);
+	g_at_chat_register(gcd->chat, "^DEND", dend_notify, FALSE, gc, NULL);
+	g_at_chat_register(gcd->chat, "^NDISSTAT:", ndisstat_notify,
+				FALSE, gc, NULL);
+
 	return 0;
 }
 
@@ -315,6 +439,9 @@ static void huawei_gprs_context_remove(struct ofono_gprs_context *gc)
 
 	ofono_gprs_context_set_data(gc, NULL);
 
+	if (gcd->dhcp_source)
+		g_source_remove(gcd->dhcp_source);
+
 	g_at_chat_unref(gcd->chat);
 	g_free(gcd);
 }
@@ -281,7 +281,7 @@ static void isi_submit(struct ofono_sms *sms, unsigned char *pdu,
 
 	uint8_t msg[] = {
 		SMS_MESSAGE_SEND_REQ,
-		mms,
+		mms != 0,	/* More messages to send */
 		SMS_ROUTE_CS_PREF,
 		0,	/* Is this a re-send? */
 		SMS_SENDER_ANY,
@@ -68,6 +68,7 @@ struct gprs_context_data {
 	gboolean have_e2nap;
 	gboolean have_e2ipcfg;
 	unsigned int enap_source;
+	struct at_util_poll enap_poll;
 	enum mbm_state mbm_state;
 	union {
 		ofono_gprs_context_cb_t down_cb;        /* Down callback */
@@ -165,6 +166,38 @@ static void mbm_get_ip_details(struct ofono_gprs_context *gc)
 	gcd->cb_data = NULL;
 }
 
+static void mbm_enap_poll_stop(struct gprs_context_data *gcd)
+{
+	if (gcd->enap_source) {
+		g_source_remove(gcd->enap_source);
+		gcd->enap_source = 0;
+	}
+
+	at_util_poll_init(&gcd->enap_poll, gcd->have_e2nap);
+}
+
+static void mbm_enap_poll_schedule(struct ofono_gprs_context *gc)
+{
+	struct gprs_context_data *gcd = ofono_gprs_context_get_data(gc);
+
+	if (gcd->enap_source)
+		g_source_remove(gcd->enap_source);
+
+	gcd->enap_source = g_timeout_add(at_util_poll_next(&gcd->enap_poll),
+						mbm_enap_poll, gc);
+}
+
+/* Whether we are waiting for the session to finish coming up or down */
+static gboolean mbm_enap_transitional(struct gprs_context_data *gcd)
+{
+	if (gcd->mbm_state == MBM_NONE)
+		return FALSE;
+
+	return gcd->enap == MBM_E2NAP_CONNECTING ||
+		(gcd->enap == MBM_E2NAP_CONNECTED &&
+			gcd->mbm_state == MBM_DISABLING);
+}
+
 static void mbm_state_changed(struct ofono_gprs_context *gc, int state)
 {
 	struct gprs_context_data *gcd = ofono_gprs_context_get_data(gc);
@@ -176,6 +209,8 @@ static void mbm_state_changed(struct ofono_gprs_context *gc, int state)
 	case MBM_E2NAP_DISCONNECTED:
 		DBG("MBM Context: disconnected");
 
+		mbm_enap_poll_stop(gcd);
+
 		if (gcd->mbm_state == MBM_DISABLING) {
 			CALLBACK_WITH_SUCCESS(gcd->down_cb, gcd->cb_data);
 			gcd->down_cb = NULL;
@@ -196,8 +231,10 @@ static void mbm_state_changed(struct ofono_gprs_context *gc, int state)
 	case MBM_E2NAP_CONNECTED:
 		DBG("MBM Context: connected");
 
-		if (gcd->mbm_state == MBM_ENABLING)
+		if (gcd->mbm_state == MBM_ENABLING) {
+			mbm_enap_poll_stop(gcd);
 			mbm_get_ip_details(gc);
+		}
 
 		break;
 
@@ -221,16 +258,37 @@ static void mbm_enap_poll_cb(gboolean ok, GAtResult *result, gpointer user_data)
 
 	g_at_result_iter_init(&iter, result);
 
-	if (g_at_result_iter_next(&iter, "*ENAP:") == FALSE)
-		return;
+	if (g_at_result_iter_next(&iter, "*ENAP:") == FALSE ||
+			g_at_result_iter_next_number(&iter, &state) == FALSE) {
+		if (gcd->mbm_state != MBM_NONE)
+			mbm_enap_poll_schedule(gc);
 
-	g_at_result_iter_next_number(&iter, &state);
+		return;
+	}
 
 	mbm_state_changed(gc, state);
 
-	if ((state == MBM_E2NAP_CONNECTED && gcd->mbm_state == MBM_DISABLING) ||
-			state == MBM_E2NAP_CONNECTING)
-		gcd->enap_source = g_timeout_add_seconds(1, mbm_enap_poll, gc);
+	if (mbm_enap_transitional(gcd))
+		mbm_enap_poll_schedule(gc);
+}
+
+/*
+ * Without *E2NAP the session is polled once a second, with it
+ * only a slow poll guards against a lost notification.
+ */
+static void mbm_enap_wait(struct ofono_gprs_context *gc)
+{
+	struct gprs_context_data *gcd = ofono_gprs_context_get_data(gc);
+
+	mbm_enap_poll_stop(gcd);
+
+	if (gcd->have_e2nap) {
+		mbm_enap_poll_schedule(gc);
+		return;
+	}
+
+	g_at_chat_send(gcd->chat, "AT*ENAP?", enap_prefix,
+			mbm_enap_poll_cb, gc, NULL);
 }
 
 static gboolean mbm_enap_poll(gpointer user_data)
@@ -260,9 +318,7 @@ static void at_enap_down_cb(gboolean ok, GAtResult *result, gpointer user_data)
 		gcd->down_cb = cb;
 		gcd->cb_data = cbd->data;
 
-		if (gcd->have_e2nap == FALSE)
-			g_at_chat_send(gcd->chat, "AT*ENAP?", enap_prefix,
-					mbm_enap_poll_cb, gc, NULL);
+		mbm_enap_wait(gc);
 
 		return;
 	}
@@ -284,9 +340,7 @@ static void mbm_enap_up_cb(gboolean ok, GAtResult *result, gpointer user_data)
 		gcd->up_cb = cb;
 		gcd->cb_data = cbd->data;
 
-		if (gcd->have_e2nap == FALSE)
-			g_at_chat_send(gcd->chat, "AT*ENAP?", enap_prefix,
-					mbm_enap_poll_cb, gc, NULL);
+		mbm_enap_wait(gc);
 
 		return;
 	}
@@ -400,6 +454,7 @@ error:
 static void e2nap_notifier(GAtResult *result, gpointer user_data)
 {
 	struct ofono_gprs_context *gc = user_data;
+	struct gprs_context_data *gcd = ofono_gprs_context_get_data(gc);
 	GAtResultIter iter;
 	int state;
 
@@ -411,6 +466,12 @@ static void e2nap_notifier(GAtResult *result, gpointer user_data)
 	g_at_result_iter_next_number(&iter, &state);
 
 	mbm_state_changed(gc, state);
+
+	/* Progress was reported, start the safety net over */
+	if (mbm_enap_transitional(gcd)) {
+		mbm_enap_poll_stop(gcd);
+		mbm_enap_poll_schedule(gc);
+	}
 }
 
 static void mbm_e2nap_cb(gboolean ok, GAtResult *result, gpointer user_data)
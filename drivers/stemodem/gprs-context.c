@@ -57,7 +57,9 @@
 static const char *cgact_prefix[] = { "+CGACT:", NULL };
 static const char *none_prefix[] = { NULL };
 
+/* Shared by all instances of the driver, one per context */
 static GSList *g_caif_devices;
+static unsigned int g_caif_users;
 
 struct gprs_context_data {
 	GAtChat *chat;
@@ -515,6 +517,9 @@ static int ste_gprs_context_probe(struct ofono_gprs_context *gc,
 
 	ofono_gprs_context_set_data(gc, gcd);
 
+	if (g_caif_users++ > 0)
+		return 0;
+
 	for (i = 0; i < MAX_CAIF_DEVICES; i++) {
 		ci = conn_info_create(i, i+1);
 		if (ci)
@@ -528,9 +533,11 @@ static void ste_gprs_context_remove(struct ofono_gprs_context *gc)
 {
 	struct gprs_context_data *gcd = ofono_gprs_context_get_data(gc);
 
-	g_slist_foreach(g_caif_devices, (GFunc) g_free, NULL);
-	g_slist_free(g_caif_devices);
-	g_caif_devices = NULL;
+	if (--g_caif_users == 0) {
+		g_slist_foreach(g_caif_devices, (GFunc) g_free, NULL);
+		g_slist_free(g_caif_devices);
+		g_caif_devices = NULL;
+	}
 
 	ofono_gprs_context_set_data(gc, NULL);
 
@@ -0,0 +1,228 @@
+/*
+ *
+ *  AT chat library with GLib integration
+ *
+ *  Copyright (C) 2008-2010  Intel Corporation. All rights reserved.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+
+#include <glib.h>
+
+#include "gatcapture.h"
+
+/*
+ * A capture file starts with an 8 byte header, the magic followed by the
+ * format version and a padding byte.  Each record is then a 16 byte
+ * header and the data:
+ *
+ *	usec		8 bytes, monotonic clock
+ *	length		4 bytes, of the data
+ *	channel		1 byte, G_AT_CAPTURE_CHANNEL_RAW or DLC number
+ *	direction	1 byte, 0x01 sent or 0x02 received as in pppdump
+ *	reserved	2 bytes
+ *
+ * All numbers are in network byte order.
+ */
+#define CAPTURE_MAGIC "GATCAP"
+#define CAPTURE_MAGIC_LEN 6
+#define CAPTURE_VERSION 1
+#define CAPTURE_HEADER_LEN 8
+#define RECORD_HEADER_LEN 16
+
+#define RECORD_SENT 0x01
+#define RECORD_RECEIVED 0x02
+
+struct _GAtCapture {
+	gint ref_count;
+	int fd;
+};
+
+static guint64 capture_now(void)
+{
+	struct timespec ts;
+
+	if (clock_gettime(CLOCK_MONOTONIC, &ts) < 0)
+		return 0;
+
+	return (guint64) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void put_be(guint8 *buf, guint64 value, int bytes)
+{
+	while (bytes--) {
+		buf[bytes] = value & 0xff;
+		value >>= 8;
+	}
+}
+
+static guint64 get_be(const guint8 *buf, int bytes)
+{
+	guint64 value = 0;
+	int i;
+
+	for (i = 0; i < bytes; i++)
+		value = (value << 8) | buf[i];
+
+	return value;
+}
+
+GAtCapture *g_at_capture_new(const char *filename)
+{
+	GAtCapture *capture;
+	struct stat st;
+	int fd;
+
+	if (filename == NULL)
+		return NULL;
+
+	/* Captures hold PINs and messages, keep them to ourselves */
+	fd = open(filename, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC,
+				S_IRUSR | S_IWUSR);
+	if (fd < 0)
+		return NULL;
+
+	/* Records of several runs or modems may go into the same file */
+	if (fstat(fd, &st) < 0)
+		goto error;
+
+	if (st.st_size == 0) {
+		guint8 header[CAPTURE_HEADER_LEN];
+
+		memcpy(header, CAPTURE_MAGIC, CAPTURE_MAGIC_LEN);
+		header[6] = CAPTURE_VERSION;
+		header[7] = 0;
+
+		if (write(fd, header, sizeof(header)) != sizeof(header))
+			goto error;
+	}
+
+	capture = g_try_new0(GAtCapture, 1);
+	if (capture == NULL)
+		goto error;
+
+	capture->ref_count = 1;
+	capture->fd = fd;
+
+	return capture;
+
+error:
+	close(fd);
+	return NULL;
+}
+
+GAtCapture *g_at_capture_ref(GAtCapture *capture)
+{
+	if (capture == NULL)
+		return NULL;
+
+	g_atomic_int_inc(&capture->ref_count);
+
+	return capture;
+}
+
+void g_at_capture_unref(GAtCapture *capture)
+{
+	if (capture == NULL)
+		return;
+
+	if (g_atomic_int_dec_and_test(&capture->ref_count) == FALSE)
+		return;
+
+	close(capture->fd);
+	g_free(capture);
+}
+
+void g_at_capture_write(GAtCapture *capture, guint8 channel, gboolean in,
+				const void *data, gsize len)
+{
+	guint8 header[RECORD_HEADER_LEN];
+	struct iovec iov[2];
+	ssize_t err;
+
+	if (capture == NULL || len == 0)
+		return;
+
+	put_be(header, capture_now(), 8);
+	put_be(header + 8, len, 4);
+	header[12] = channel;
+	header[13] = in ? RECORD_RECEIVED : RECORD_SENT;
+	header[14] = 0;
+	header[15] = 0;
+
+	iov[0].iov_base = header;
+	iov[0].iov_len = sizeof(header);
+	iov[1].iov_base = (void *) data;
+	iov[1].iov_len = len;
+
+	/* A single append, so records of several writers never interleave */
+	err = writev(capture->fd, iov, 2);
+	(void) err;
+}
+
+gboolean g_at_capture_read(const char *filename, GAtCaptureFunc func,
+				gpointer user_data)
+{
+	gchar *contents;
+	gsize size;
+	gsize offset;
+
+	if (filename == NULL || func == NULL)
+		return FALSE;
+
+	if (g_file_get_contents(filename, &contents, &size, NULL) == FALSE)
+		return FALSE;
+
+	if (size < CAPTURE_HEADER_LEN ||
+			memcmp(contents, CAPTURE_MAGIC, CAPTURE_MAGIC_LEN) ||
+			contents[6] != CAPTURE_VERSION) {
+		g_free(contents);
+		return FALSE;
+	}
+
+	offset = CAPTURE_HEADER_LEN;
+
+	/* A record cut short by a crash ends the capture */
+	while (size - offset >= RECORD_HEADER_LEN) {
+		const guint8 *header = (const guint8 *) contents + offset;
+		guint64 usec = get_be(header, 8);
+		gsize len = get_be(header + 8, 4);
+
+		if (len > size - offset - RECORD_HEADER_LEN)
+			break;
+
+		if (func(usec, header[12], header[13] == RECORD_RECEIVED,
+				header + RECORD_HEADER_LEN, len,
+				user_data) == FALSE)
+			break;
+
+		offset += RECORD_HEADER_LEN + len;
+	}
+
+	g_free(contents);
+
+	return TRUE;
+}
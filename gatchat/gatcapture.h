@@ -0,0 +1,65 @@
+/*
+ *
+ *  AT chat library with GLib integration
+ *
+ *  Copyright (C) 2008-2010  Intel Corporation. All rights reserved.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef __G_AT_CAPTURE_H
+#define __G_AT_CAPTURE_H
+
+#include "gat.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct _GAtCapture;
+
+typedef struct _GAtCapture GAtCapture;
+
+/*
+ * Channel of the traffic on the serial port itself, whether plain AT or
+ * multiplexed.  Traffic of a GAtMux DLC is recorded with the DLC number.
+ */
+#define G_AT_CAPTURE_CHANNEL_RAW 0
+
+/*
+ * Called for each record of a capture file, in the order they were
+ * written.  in is TRUE for data read from the modem.  Return FALSE to
+ * stop reading.
+ */
+typedef gboolean (*GAtCaptureFunc)(guint64 usec, guint8 channel, gboolean in,
+					const guint8 *data, gsize len,
+					gpointer user_data);
+
+GAtCapture *g_at_capture_new(const char *filename);
+
+GAtCapture *g_at_capture_ref(GAtCapture *capture);
+void g_at_capture_unref(GAtCapture *capture);
+
+void g_at_capture_write(GAtCapture *capture, guint8 channel, gboolean in,
+				const void *data, gsize len);
+
+gboolean g_at_capture_read(const char *filename, GAtCaptureFunc func,
+				gpointer user_data);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __G_AT_CAPTURE_H */
@@ -43,6 +43,27 @@ static void chat_wakeup_writer(struct at_chat *chat);
 
 static const char *none_prefix[] = { NULL };
 
+/* Latencies are counted in power of two buckets of milliseconds */
+#define AT_LATENCY_BUCKETS 16
+
+#define AT_PREFIX_LEN 16
+
+/* Longest wait for the late response to a command that timed out, in ms */
+#define AT_STALE_RESPONSE_MAX_WAIT 10000
+
+/* All live chats, for g_at_chat_foreach_latency */
+static GSList *chat_list;
+static guint next_chat_id;
+
+static GAtTraceFunc trace_func;
+static gpointer trace_data;
+
+struct at_latency {
+	guint count;
+	guint max;
+	guint buckets[AT_LATENCY_BUCKETS];
+};
+
 struct at_command {
 	char *cmd;
 	char **prefixes;
@@ -53,6 +74,10 @@ struct at_command {
 	GAtNotifyFunc listing;
 	gpointer user_data;
 	GDestroyNotify notify;
+	guint timeout;				/* In ms, 0 for none */
+	gdouble deadline;			/* Set once it is written */
+	gdouble issued;				/* When it was written */
+	char prefix[AT_PREFIX_LEN];
 };
 
 struct at_notify_node {
@@ -90,10 +115,17 @@ struct at_chat {
 	gdouble inactivity_time;		/* Period of inactivity */
 	guint wakeup_timeout;			/* How long to wait for resp */
 	GTimer *wakeup_timer;			/* Keep track of elapsed time */
+	GTimer *clock;				/* Time base for deadlines */
+	guint deadline_source;			/* Fires at earliest deadline */
+	gdouble deadline_armed;			/* Deadline it was armed for */
+	guint stale_source;			/* Awaiting a late response */
+	char **stale_prefixes;			/* Those of the late command */
 	GAtSyntax *syntax;
 	gboolean destroyed;			/* Re-entrancy guard */
 	gboolean in_read_handler;		/* Re-entrancy guard */
 	GSList *terminator_list;		/* Non-standard terminator */
+	guint id;				/* Identifies it in traces */
+	GHashTable *latencies;			/* Per command prefix */
 };
 
 struct _GAtChat {
@@ -154,6 +186,36 @@ static gint at_command_compare_by_id(gconstpointer a, gconstpointer b)
 	return 0;
 }
 
+/*
+ * Extended and vendor commands are known by their name, such as +CMGS,
+ * basic ones by their first letter, D for ATD123; and so on.
+ */
+static void at_command_prefix(const char *cmd, char *buf)
+{
+	unsigned int i = 0;
+
+	if (g_ascii_strncasecmp(cmd, "AT", 2) == 0)
+		cmd += 2;
+
+	if (cmd[0] != '\0' && strchr("+*^%$@&", cmd[0])) {
+		buf[i] = cmd[i];
+		i += 1;
+
+		while (i < AT_PREFIX_LEN - 1 && g_ascii_isalnum(cmd[i])) {
+			buf[i] = g_ascii_toupper(cmd[i]);
+			i += 1;
+		}
+	} else if (g_ascii_isalpha(cmd[0]))
+		buf[i++] = g_ascii_toupper(cmd[0]);
+
+	if (i == 0) {
+		strcpy(buf, "AT");
+		return;
+	}
+
+	buf[i] = '\0';
+}
+
 static struct at_command *at_command_create(guint gid, const char *cmd,
 						const char **prefix_list,
 						gboolean expect_pdu,
@@ -216,6 +278,9 @@ static struct at_command *at_command_create(guint gid, const char *cmd,
 	c->listing = listing;
 	c->user_data = user_data;
 	c->notify = notify;
+	c->issued = -1;
+
+	at_command_prefix(cmd, c->prefix);
 
 	return c;
 }
@@ -278,6 +343,24 @@ static void chat_cleanup(struct at_chat *chat)
 		chat->timeout_source = 0;
 	}
 
+	if (chat->deadline_source) {
+		g_source_remove(chat->deadline_source);
+		chat->deadline_source = 0;
+	}
+
+	if (chat->stale_source) {
+		g_source_remove(chat->stale_source);
+		chat->stale_source = 0;
+	}
+
+	g_strfreev(chat->stale_prefixes);
+	chat->stale_prefixes = NULL;
+
+	if (chat->clock) {
+		g_timer_destroy(chat->clock);
+		chat->clock = NULL;
+	}
+
 	g_at_syntax_unref(chat->syntax);
 	chat->syntax = NULL;
 
@@ -339,6 +422,10 @@ static gboolean at_chat_match_notify(struct at_chat *chat, char *line)
 		if (!result.lines)
 			result.lines = g_slist_prepend(NULL, line);
 
+		if (trace_func)
+			trace_func(G_AT_TRACE_NOTIFY, chat->id, key,
+					0, trace_data);
+
 		g_slist_foreach(notify->nodes, at_notify_call_callback,
 					&result);
 		ret = TRUE;
@@ -352,6 +439,34 @@ static gboolean at_chat_match_notify(struct at_chat *chat, char *line)
 	return ret;
 }
 
+static void at_chat_add_latency(struct at_chat *chat, const char *prefix,
+					gdouble seconds)
+{
+	struct at_latency *latency;
+	guint ms = seconds * 1000;
+	guint bucket = 0;
+
+	latency = g_hash_table_lookup(chat->latencies, prefix);
+
+	if (latency == NULL) {
+		latency = g_new0(struct at_latency, 1);
+		g_hash_table_insert(chat->latencies, g_strdup(prefix), latency);
+	}
+
+	while (bucket < AT_LATENCY_BUCKETS - 1 && (1U << bucket) <= ms)
+		bucket += 1;
+
+	latency->buckets[bucket] += 1;
+	latency->count += 1;
+
+	if (ms > latency->max)
+		latency->max = ms;
+
+	if (trace_func)
+		trace_func(G_AT_TRACE_RESPONSE, chat->id, prefix,
+				seconds * 1000000, trace_data);
+}
+
 static void at_chat_finish_command(struct at_chat *p, gboolean ok, char *final)
 {
 	struct at_command *cmd = g_queue_pop_head(p->command_queue);
@@ -363,6 +478,10 @@ static void at_chat_finish_command(struct at_chat *p, gboolean ok, char *final)
 
 	p->cmd_bytes_written = 0;
 
+	if (cmd->issued >= 0 && p->clock)
+		at_chat_add_latency(p, cmd->prefix,
+				g_timer_elapsed(p->clock, NULL) - cmd->issued);
+
 	if (g_queue_peek_head(p->command_queue))
 		chat_wakeup_writer(p);
 
@@ -421,29 +540,39 @@ static gboolean check_terminator(struct terminator_info *info, char *line)
 	return FALSE;
 }
 
-static gboolean at_chat_handle_command_response(struct at_chat *p,
-							struct at_command *cmd,
+static struct terminator_info *at_chat_find_terminator(struct at_chat *p,
 							char *line)
 {
 	int i;
 	int size = sizeof(terminator_table) / sizeof(struct terminator_info);
-	int hint;
 	GSList *l;
 
 	for (i = 0; i < size; i++) {
 		struct terminator_info *info = &terminator_table[i];
-		if (check_terminator(info, line)) {
-			at_chat_finish_command(p, info->success, line);
-			return TRUE;
-		}
+		if (check_terminator(info, line))
+			return info;
 	}
 
 	for (l = p->terminator_list; l; l = l->next) {
 		struct terminator_info *info = l->data;
-		if (check_terminator(info, line)) {
-			at_chat_finish_command(p, info->success, line);
-			return TRUE;
-		}
+		if (check_terminator(info, line))
+			return info;
+	}
+
+	return NULL;
+}
+
+static gboolean at_chat_handle_command_response(struct at_chat *p,
+							struct at_command *cmd,
+							char *line)
+{
+	struct terminator_info *info;
+	int hint;
+
+	info = at_chat_find_terminator(p, line);
+	if (info) {
+		at_chat_finish_command(p, info->success, line);
+		return TRUE;
 	}
 
 	if (cmd->prefixes) {
@@ -486,6 +615,36 @@ out:
 	return TRUE;
 }
 
+/* Stops waiting for the late response, lets the queue move on */
+static void at_chat_stale_done(struct at_chat *p)
+{
+	if (p->stale_source) {
+		g_source_remove(p->stale_source);
+		p->stale_source = 0;
+	}
+
+	g_strfreev(p->stale_prefixes);
+	p->stale_prefixes = NULL;
+
+	if (g_queue_peek_head(p->command_queue))
+		chat_wakeup_writer(p);
+}
+
+/* Whether the command that timed out would have taken the line */
+static gboolean at_chat_stale_line(struct at_chat *p, const char *line)
+{
+	int i;
+
+	if (p->stale_prefixes == NULL)
+		return TRUE;
+
+	for (i = 0; p->stale_prefixes[i]; i++)
+		if (g_str_has_prefix(line, p->stale_prefixes[i]))
+			return TRUE;
+
+	return FALSE;
+}
+
 static void have_line(struct at_chat *p, char *str)
 {
 	/* We're not going to copy terminal <CR><LF> */
@@ -498,6 +657,30 @@ static void have_line(struct at_chat *p, char *str)
 	if (!strncmp(str, "AT", 2) == TRUE)
 		goto done;
 
+	/*
+	 * The response to a command that timed out may still come.  Nothing
+	 * else has been written since, so a final response can only be its
+	 * own, as can any line the command would have taken.
+	 */
+	if (p->stale_source > 0 && p->cmd_bytes_written == 0) {
+		if (at_chat_find_terminator(p, str)) {
+			if (p->debugf)
+				p->debugf("Late final response dropped\n",
+						p->debug_data);
+
+			at_chat_stale_done(p);
+			goto done;
+		}
+
+		if (at_chat_stale_line(p, str)) {
+			if (p->debugf)
+				p->debugf("Late response line dropped\n",
+						p->debug_data);
+
+			goto done;
+		}
+	}
+
 	cmd = g_queue_peek_head(p->command_queue);
 
 	if (cmd && p->cmd_bytes_written > 0) {
@@ -689,6 +872,133 @@ static void new_bytes(struct ring_buffer *rbuf, gpointer user_data)
 		g_free(p);
 }
 
+static gboolean deadline_expired(gpointer user_data);
+static void at_chat_unref(struct at_chat *chat);
+
+static struct at_command *at_chat_earliest_deadline(struct at_chat *chat)
+{
+	struct at_command *earliest = NULL;
+	GList *l;
+
+	for (l = chat->command_queue->head; l; l = l->next) {
+		struct at_command *cmd = l->data;
+
+		if (cmd->deadline == 0)
+			continue;
+
+		if (earliest == NULL || cmd->deadline < earliest->deadline)
+			earliest = cmd;
+	}
+
+	return earliest;
+}
+
+/*
+ * All command deadlines of a chat share a single timeout source, which is
+ * always armed for the earliest one.  Commands that complete or are
+ * canceled before their deadline leave the source armed; it then simply
+ * finds nothing expired and re-arms for whatever is next.
+ */
+static void at_chat_schedule_deadline(struct at_chat *chat)
+{
+	struct at_command *cmd;
+	gdouble remaining;
+
+	if (chat->command_queue == NULL)
+		return;
+
+	cmd = at_chat_earliest_deadline(chat);
+
+	if (chat->deadline_source) {
+		if (cmd && cmd->deadline == chat->deadline_armed)
+			return;
+
+		g_source_remove(chat->deadline_source);
+		chat->deadline_source = 0;
+	}
+
+	if (cmd == NULL)
+		return;
+
+	remaining = cmd->deadline - g_timer_elapsed(chat->clock, NULL);
+	if (remaining < 0)
+		remaining = 0;
+
+	chat->deadline_armed = cmd->deadline;
+	chat->deadline_source = g_timeout_add(remaining * 1000 + 1,
+						deadline_expired, chat);
+}
+
+static gboolean stale_expired(gpointer user_data)
+{
+	struct at_chat *chat = user_data;
+
+	chat->stale_source = 0;
+	at_chat_stale_done(chat);
+
+	return FALSE;
+}
+
+static void at_chat_expire_command(struct at_chat *chat,
+					struct at_command *cmd)
+{
+	if (chat->debugf)
+		chat->debugf("Command timed out\n", chat->debug_data);
+
+	/* Only the command on the wire has a deadline */
+	if (cmd != g_queue_peek_head(chat->command_queue) ||
+			chat->cmd_bytes_written == 0) {
+		cmd->deadline = 0;
+		return;
+	}
+
+	/*
+	 * The modem may still answer.  Writing the next command now would
+	 * make that late final response look like the answer to it, so
+	 * hold the queue until the response comes, or as long again as
+	 * the deadline has passed.
+	 */
+	chat->stale_source = g_timeout_add(MIN(cmd->timeout,
+						AT_STALE_RESPONSE_MAX_WAIT),
+						stale_expired, chat);
+
+	/* The command goes away, its intermediate lines may still come */
+	g_strfreev(chat->stale_prefixes);
+	chat->stale_prefixes = cmd->prefixes;
+	cmd->prefixes = NULL;
+
+	at_chat_finish_command(chat, FALSE,
+				g_strdup(G_AT_CHAT_TIMEOUT_RESPONSE));
+}
+
+static gboolean deadline_expired(gpointer user_data)
+{
+	struct at_chat *chat = user_data;
+	struct at_command *cmd;
+
+	chat->deadline_source = 0;
+
+	/* Callbacks may drop the last reference to the chat */
+	g_atomic_int_inc(&chat->ref_count);
+
+	/* Callbacks may queue or cancel commands, so look again each time */
+	while (chat->command_queue != NULL) {
+		gdouble now = g_timer_elapsed(chat->clock, NULL);
+
+		cmd = at_chat_earliest_deadline(chat);
+
+		if (cmd == NULL || cmd->deadline > now)
+			break;
+
+		at_chat_expire_command(chat, cmd);
+	}
+
+	at_chat_schedule_deadline(chat);
+	at_chat_unref(chat);
+
+	return FALSE;
+}
+
 static void wakeup_cb(gboolean ok, GAtResult *result, gpointer user_data)
 {
 	struct at_chat *chat = user_data;
@@ -747,6 +1057,10 @@ static gboolean can_write_data(gpointer data)
 	if (cmd == NULL)
 		return FALSE;
 
+	/* Wait for the late response to a command that timed out */
+	if (chat->stale_source > 0 && chat->cmd_bytes_written == 0)
+		return FALSE;
+
 	len = strlen(cmd->cmd);
 
 	/* For some reason write watcher fired, but we've already
@@ -781,6 +1095,24 @@ static gboolean can_write_data(gpointer data)
 						wakeup_no_response, chat);
 	}
 
+	if (chat->cmd_bytes_written == 0) {
+		cmd->issued = g_timer_elapsed(chat->clock, NULL);
+
+		/*
+		 * The deadline runs from the time the modem gets the
+		 * command, a slow one ahead of it does not count.
+		 */
+		if (cmd->timeout > 0) {
+			cmd->deadline = cmd->issued +
+					(gdouble) cmd->timeout / 1000;
+			at_chat_schedule_deadline(chat);
+		}
+
+		if (trace_func)
+			trace_func(G_AT_TRACE_COMMAND, chat->id, cmd->prefix,
+					0, trace_data);
+	}
+
 	towrite = len - chat->cmd_bytes_written;
 
 	cr = strchr(cmd->cmd + chat->cmd_bytes_written, '\r');
@@ -861,6 +1193,9 @@ static void at_chat_unref(struct at_chat *chat)
 		chat_cleanup(chat);
 	}
 
+	chat_list = g_slist_remove(chat_list, chat);
+	g_hash_table_destroy(chat->latencies);
+
 	if (chat->in_read_handler)
 		chat->destroyed = TRUE;
 	else
@@ -908,6 +1243,7 @@ static guint at_chat_send_common(struct at_chat *chat, guint gid,
 					const char *cmd,
 					const char **prefix_list,
 					gboolean expect_pdu,
+					guint timeout,
 					GAtNotifyFunc listing,
 					GAtResultFunc func,
 					gpointer user_data,
@@ -925,6 +1261,7 @@ static guint at_chat_send_common(struct at_chat *chat, guint gid,
 		return 0;
 
 	c->id = chat->next_cmd_id++;
+	c->timeout = timeout;
 
 	g_queue_push_tail(chat->command_queue, c);
 
@@ -1183,6 +1520,8 @@ static struct at_chat *create_chat(GIOChannel *channel, GIOFlags flags,
 	if (!chat->command_queue)
 		goto error;
 
+	chat->clock = g_timer_new();
+
 	chat->notify_list = g_hash_table_new_full(g_str_hash, g_str_equal,
 						g_free, at_notify_destroy);
 
@@ -1190,6 +1529,11 @@ static struct at_chat *create_chat(GIOChannel *channel, GIOFlags flags,
 
 	chat->syntax = g_at_syntax_ref(syntax);
 
+	chat->id = ++next_chat_id;
+	chat->latencies = g_hash_table_new_full(g_str_hash, g_str_equal,
+						g_free, g_free);
+	chat_list = g_slist_prepend(chat_list, chat);
+
 	return chat;
 
 error:
@@ -1359,7 +1703,17 @@ guint g_at_chat_send(GAtChat *chat, const char *cmd,
 			gpointer user_data, GDestroyNotify notify)
 {
 	return at_chat_send_common(chat->parent, chat->group,
-					cmd, prefix_list, FALSE, NULL,
+					cmd, prefix_list, FALSE, 0, NULL,
+					func, user_data, notify);
+}
+
+guint g_at_chat_send_with_timeout(GAtChat *chat, const char *cmd,
+				const char **prefix_list, guint timeout,
+				GAtResultFunc func, gpointer user_data,
+				GDestroyNotify notify)
+{
+	return at_chat_send_common(chat->parent, chat->group,
+					cmd, prefix_list, FALSE, timeout, NULL,
 					func, user_data, notify);
 }
 
@@ -1372,7 +1726,7 @@ guint g_at_chat_send_listing(GAtChat *chat, const char *cmd,
 		return 0;
 
 	return at_chat_send_common(chat->parent, chat->group,
-					cmd, prefix_list, FALSE,
+					cmd, prefix_list, FALSE, 0,
 					listing, func, user_data, notify);
 }
 
@@ -1385,7 +1739,7 @@ guint g_at_chat_send_pdu_listing(GAtChat *chat, const char *cmd,
 		return 0;
 
 	return at_chat_send_common(chat->parent, chat->group,
-					cmd, prefix_list, TRUE,
+					cmd, prefix_list, TRUE, 0,
 					listing, func, user_data, notify);
 }
 
@@ -1433,3 +1787,48 @@ gboolean g_at_chat_unregister_all(GAtChat *chat)
 
 	return at_chat_unregister_group(chat->parent, chat->group);
 }
+
+void g_at_chat_set_trace_func(GAtTraceFunc func, gpointer user_data)
+{
+	trace_func = func;
+	trace_data = user_data;
+}
+
+static guint at_latency_percentile(const struct at_latency *latency,
+					guint percent)
+{
+	guint target = (latency->count * percent + 99) / 100;
+	guint seen = 0;
+	guint bucket;
+
+	for (bucket = 0; bucket < AT_LATENCY_BUCKETS - 1; bucket++) {
+		seen += latency->buckets[bucket];
+
+		if (seen >= target)
+			break;
+	}
+
+	return MIN(1U << bucket, latency->max);
+}
+
+void g_at_chat_foreach_latency(GAtLatencyFunc func, gpointer user_data)
+{
+	GHashTableIter iter;
+	gpointer key, value;
+	GSList *l;
+
+	for (l = chat_list; l; l = l->next) {
+		struct at_chat *chat = l->data;
+
+		g_hash_table_iter_init(&iter, chat->latencies);
+
+		while (g_hash_table_iter_next(&iter, &key, &value)) {
+			struct at_latency *latency = value;
+
+			func(chat->id, key, latency->count,
+				at_latency_percentile(latency, 50),
+				at_latency_percentile(latency, 99),
+				latency->max, user_data);
+		}
+	}
+}
@@ -39,6 +39,20 @@ typedef void (*GAtResultFunc)(gboolean success, GAtResult *result,
 				gpointer user_data);
 typedef void (*GAtNotifyFunc)(GAtResult *result, gpointer user_data);
 
+typedef enum _GAtTraceEvent {
+	G_AT_TRACE_COMMAND,	/* Command started to be written */
+	G_AT_TRACE_RESPONSE,	/* Final response, with the latency */
+	G_AT_TRACE_NOTIFY,	/* Unsolicited result matched a handler */
+} GAtTraceEvent;
+
+typedef void (*GAtTraceFunc)(GAtTraceEvent event, guint chat,
+				const char *prefix, guint usec,
+				gpointer user_data);
+
+typedef void (*GAtLatencyFunc)(guint chat, const char *prefix, guint count,
+				guint p50, guint p99, guint max,
+				gpointer user_data);
+
 GAtChat *g_at_chat_new(GIOChannel *channel, GAtSyntax *syntax);
 GAtChat *g_at_chat_new_blocking(GIOChannel *channel, GAtSyntax *syntax);
 
@@ -121,6 +135,26 @@ guint g_at_chat_send_pdu_listing(GAtChat *chat, const char *cmd,
 				GAtNotifyFunc listing, GAtResultFunc func,
 				gpointer user_data, GDestroyNotify notify);
 
+/*!
+ * Final response reported to the callback of a command whose timeout
+ * expired before the modem answered.
+ */
+#define G_AT_CHAT_TIMEOUT_RESPONSE "TIMEOUT"
+
+/*!
+ * Same as g_at_chat_send, except that the command is given a deadline of
+ * timeout milliseconds from the time it is written to the modem.  If the
+ * modem has not sent a final response by then, the callback is called
+ * with success set to FALSE and G_AT_CHAT_TIMEOUT_RESPONSE as the final
+ * response.  The next command is only written once the late final
+ * response has arrived and been dropped, or the same timeout has passed
+ * again, at most 10 seconds.  A timeout of 0 means no deadline.
+ */
+guint g_at_chat_send_with_timeout(GAtChat *chat, const char *cmd,
+				const char **valid_resp, guint timeout,
+				GAtResultFunc func, gpointer user_data,
+				GDestroyNotify notify);
+
 gboolean g_at_chat_cancel(GAtChat *chat, guint id);
 gboolean g_at_chat_cancel_all(GAtChat *chat);
 
@@ -137,6 +171,23 @@ gboolean g_at_chat_set_wakeup_command(GAtChat *chat, const char *cmd,
 void g_at_chat_add_terminator(GAtChat *chat, char *terminator,
 				int len, gboolean success);
 
+/*!
+ * Installs a process wide function that is told about every command
+ * issued, every final response and every unsolicited result handled by
+ * any GAtChat.  Commands are identified by their prefix, such as +CMGS
+ * for AT+CMGS=..., and chats by a number unique for the process.  The
+ * function is called from the I/O path and should be cheap.
+ */
+void g_at_chat_set_trace_func(GAtTraceFunc func, gpointer user_data);
+
+/*!
+ * Calls func for every command prefix seen by every live GAtChat with
+ * the number of completed commands and their latency percentiles and
+ * maximum in milliseconds.  Percentiles are the upper bounds of
+ * power of two buckets.
+ */
+void g_at_chat_foreach_latency(GAtLatencyFunc func, gpointer user_data);
+
 #ifdef __cplusplus
 }
 #endif
@@ -35,6 +35,7 @@
 #include "ringbuffer.h"
 #include "gatio.h"
 #include "gatutil.h"
+#include "gatcapture.h"
 
 struct _GAtIO {
 	gint ref_count;				/* Ref count */
@@ -52,6 +53,8 @@ struct _GAtIO {
 	gpointer write_data;			/* Write callback userdata */
 	GAtDebugFunc debugf;			/* debugging output function */
 	gpointer debug_data;			/* Data to pass to debug func */
+	GAtCapture *capture;			/* Traffic capture, if any */
+	guint8 capture_channel;			/* Channel of the capture */
 	gboolean destroyed;			/* Re-entrancy guard */
 };
 
@@ -104,6 +107,8 @@ static gboolean received_data(GIOChannel *channel, GIOCondition cond,
 		err = g_io_channel_read(channel, (char *) buf, toread, &rbytes);
 		g_at_util_debug_chat(TRUE, (char *)buf, rbytes,
 					io->debugf, io->debug_data);
+		g_at_capture_write(io->capture, io->capture_channel, TRUE,
+					buf, rbytes);
 
 		read_count++;
 
@@ -145,6 +150,8 @@ gsize g_at_io_write(GAtIO *io, const gchar *data, gsize count)
 
 	g_at_util_debug_chat(FALSE, data, bytes_written,
 				io->debugf, io->debug_data);
+	g_at_capture_write(io->capture, io->capture_channel, FALSE,
+				data, bytes_written);
 
 	return bytes_written;
 }
@@ -332,6 +339,9 @@ void g_at_io_unref(GAtIO *io)
 
 	io_shutdown(io);
 
+	g_at_capture_unref(io->capture);
+	io->capture = NULL;
+
 	/* glib delays the destruction of the watcher until it exits, this
 	 * means we can't free the data just yet, even though we've been
 	 * destroyed already.  We have to wait until the read_watcher
@@ -365,3 +375,17 @@ gboolean g_at_io_set_debug(GAtIO *io, GAtDebugFunc func, gpointer user_data)
 
 	return TRUE;
 }
+
+gboolean g_at_io_set_capture(GAtIO *io, GAtCapture *capture, guint8 channel)
+{
+	if (io == NULL)
+		return FALSE;
+
+	g_at_capture_ref(capture);
+	g_at_capture_unref(io->capture);
+
+	io->capture = capture;
+	io->capture_channel = channel;
+
+	return TRUE;
+}
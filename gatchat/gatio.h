@@ -27,6 +27,7 @@ extern "C" {
 #endif
 
 #include "gat.h"
+#include "gatcapture.h"
 
 struct _GAtIO;
 
@@ -56,6 +57,8 @@ gboolean g_at_io_set_disconnect_function(GAtIO *io,
 
 gboolean g_at_io_set_debug(GAtIO *io, GAtDebugFunc func, gpointer user_data);
 
+gboolean g_at_io_set_capture(GAtIO *io, GAtCapture *capture, guint8 channel);
+
 #ifdef __cplusplus
 }
 #endif
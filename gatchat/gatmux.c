@@ -83,6 +83,7 @@ struct _GAtMux {
 	gpointer user_disconnect_data;		/* user disconnect data */
 	GAtDebugFunc debugf;			/* debugging output function */
 	gpointer debug_data;			/* Data to pass to debug func */
+	GAtCapture *capture;			/* Traffic capture, if any */
 	GAtMuxChannel *dlcs[MAX_CHANNELS];	/* DLCs opened by the MUX */
 	guint8 newdata[BITMAP_SIZE];		/* Channels that got new data */
 	const GAtMuxDriver *driver;		/* Driver functions */
@@ -184,6 +185,9 @@ static gboolean received_data(GIOChannel *channel, GIOCondition cond,
 					sizeof(mux->buf) - mux->buf_used,
 					&bytes_read, &error);
 
+	g_at_capture_write(mux->capture, G_AT_CAPTURE_CHANNEL_RAW, TRUE,
+				mux->buf + mux->buf_used, bytes_read);
+
 	mux->buf_used += bytes_read;
 
 	if (bytes_read > 0 && mux->driver->feed_data) {
@@ -302,6 +306,9 @@ int g_at_mux_raw_write(GAtMux *mux, const void *data, int towrite)
 	g_io_channel_write_chars(mux->channel, (gchar *) data,
 					count, &bytes_written, &error);
 
+	g_at_capture_write(mux->capture, G_AT_CAPTURE_CHANNEL_RAW, FALSE,
+				data, bytes_written);
+
 	return bytes_written;
 }
 
@@ -319,6 +326,8 @@ void g_at_mux_feed_dlc_data(GAtMux *mux, guint8 dlc,
 	if (dlc < 1 || dlc > MAX_CHANNELS)
 		return;
 
+	g_at_capture_write(mux->capture, dlc, TRUE, data, tofeed);
+
 	channel = mux->dlcs[dlc-1];
 
 	if (channel == NULL)
@@ -445,6 +454,8 @@ static GIOStatus channel_write(GIOChannel *channel, const gchar *buf,
 	GAtMuxChannel *mux_channel = (GAtMuxChannel *) channel;
 	GAtMux *mux = mux_channel->mux;
 
+	g_at_capture_write(mux->capture, mux_channel->dlc, FALSE, buf, count);
+
 	if (mux->driver->write)
 		mux->driver->write(mux, mux_channel->dlc, buf, count);
 	*bytes_written = count;
@@ -583,6 +594,7 @@ void g_at_mux_unref(GAtMux *mux)
 		if (mux->driver->remove)
 			mux->driver->remove(mux);
 
+		g_at_capture_unref(mux->capture);
 		g_free(mux);
 	}
 }
@@ -658,6 +670,19 @@ gboolean g_at_mux_set_debug(GAtMux *mux, GAtDebugFunc func, gpointer user_data)
 	return TRUE;
 }
 
+gboolean g_at_mux_set_capture(GAtMux *mux, GAtCapture *capture)
+{
+	if (mux == NULL)
+		return FALSE;
+
+	g_at_capture_ref(capture);
+	g_at_capture_unref(mux->capture);
+
+	mux->capture = capture;
+
+	return TRUE;
+}
+
 GIOChannel *g_at_mux_create_channel(GAtMux *mux)
 {
 	GAtMuxChannel *mux_channel;
@@ -28,6 +28,7 @@ extern "C" {
 #endif
 
 #include "gatchat.h"
+#include "gatcapture.h"
 
 struct _GAtMux;
 
@@ -69,6 +70,8 @@ gboolean g_at_mux_set_disconnect_function(GAtMux *mux,
 
 gboolean g_at_mux_set_debug(GAtMux *mux, GAtDebugFunc func, gpointer user_data);
 
+gboolean g_at_mux_set_capture(GAtMux *mux, GAtCapture *capture);
+
 GIOChannel *g_at_mux_create_channel(GAtMux *mux);
 
 /*!
@@ -0,0 +1,419 @@
+/*
+ *
+ *  AT chat library with GLib integration
+ *
+ *  Copyright (C) 2008-2010  Intel Corporation. All rights reserved.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/socket.h>
+
+#include <glib.h>
+
+#include "gatcapture.h"
+#include "gatreplay.h"
+
+struct replay_record {
+	guint64 usec;
+	gboolean in;
+	gsize len;
+	guint8 data[0];
+};
+
+struct _GAtReplay {
+	gint ref_count;
+	GPtrArray *records;		/* Records of the channel played */
+	guint played;			/* Records up to the last received */
+	guint next;			/* Record being played */
+	gsize offset;			/* Bytes of it matched or written */
+	gboolean waited;		/* Its delay has passed */
+	guint64 last_usec;		/* Time of the last record played */
+	GByteArray *early;		/* Host data ahead of the capture */
+	int fd;				/* Modem side of the socket pair */
+	GIOChannel *channel;		/* Modem side, for the watches */
+	GIOChannel *host;		/* Host side, given to the user */
+	guint read_watch;
+	guint write_watch;
+	guint timeout;
+	gboolean realtime;
+	gboolean started;
+	gboolean finished;
+	guint mismatches;
+	GAtReplayFunc func;
+	gpointer user_data;
+};
+
+struct replay_load {
+	GPtrArray *records;
+	guint8 channel;
+};
+
+static gboolean load_record(guint64 usec, guint8 channel, gboolean in,
+				const guint8 *data, gsize len,
+				gpointer user_data)
+{
+	struct replay_load *load = user_data;
+	struct replay_record *record;
+
+	if (channel != load->channel)
+		return TRUE;
+
+	record = g_malloc(sizeof(struct replay_record) + len);
+	record->usec = usec;
+	record->in = in;
+	record->len = len;
+	memcpy(record->data, data, len);
+
+	g_ptr_array_add(load->records, record);
+
+	return TRUE;
+}
+
+static void replay_play(GAtReplay *replay);
+
+static void replay_finish(GAtReplay *replay)
+{
+	if (replay->finished)
+		return;
+
+	replay->finished = TRUE;
+
+	if (replay->func)
+		replay->func(replay->user_data);
+}
+
+/* Matches what the host wrote against the data it sent in the capture */
+static void replay_consume(GAtReplay *replay, const guint8 *data, gsize len)
+{
+	while (len > 0) {
+		struct replay_record *record;
+		gsize n, i;
+
+		if (replay->next == replay->records->len) {
+			replay->mismatches += len;
+			return;
+		}
+
+		record = g_ptr_array_index(replay->records, replay->next);
+
+		if (record->in) {
+			g_byte_array_append(replay->early, data, len);
+			return;
+		}
+
+		n = MIN(len, record->len - replay->offset);
+
+		for (i = 0; i < n; i++)
+			if (data[i] != record->data[replay->offset + i])
+				replay->mismatches += 1;
+
+		replay->offset += n;
+		data += n;
+		len -= n;
+
+		if (replay->offset < record->len)
+			continue;
+
+		replay->last_usec = record->usec;
+		replay->next += 1;
+		replay->offset = 0;
+	}
+}
+
+static gboolean replay_write_ready(GIOChannel *channel, GIOCondition cond,
+					gpointer user_data)
+{
+	GAtReplay *replay = user_data;
+
+	replay->write_watch = 0;
+
+	g_at_replay_ref(replay);
+	replay_play(replay);
+	g_at_replay_unref(replay);
+
+	return FALSE;
+}
+
+/* Returns FALSE while the socket is full, the write watch resumes */
+static gboolean replay_write(GAtReplay *replay, struct replay_record *record)
+{
+	while (replay->offset < record->len) {
+		ssize_t n;
+
+		/* No SIGPIPE if the host has gone away */
+		n = send(replay->fd, record->data + replay->offset,
+				record->len - replay->offset, MSG_NOSIGNAL);
+		if (n > 0) {
+			replay->offset += n;
+			continue;
+		}
+
+		if (n < 0 && errno == EINTR)
+			continue;
+
+		if (n < 0 && errno != EAGAIN) {
+			replay_finish(replay);
+			return FALSE;
+		}
+
+		if (replay->write_watch == 0)
+			replay->write_watch = g_io_add_watch(replay->channel,
+						G_IO_OUT | G_IO_HUP | G_IO_ERR,
+						replay_write_ready, replay);
+
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+static gboolean replay_timeout(gpointer user_data)
+{
+	GAtReplay *replay = user_data;
+
+	replay->timeout = 0;
+
+	g_at_replay_ref(replay);
+	replay_play(replay);
+	g_at_replay_unref(replay);
+
+	return FALSE;
+}
+
+static void replay_play(GAtReplay *replay)
+{
+	/* A delay or a full socket is already being waited for */
+	if (replay->timeout > 0 || replay->write_watch > 0)
+		return;
+
+	while (replay->finished == FALSE &&
+			replay->next < replay->records->len) {
+		struct replay_record *record;
+
+		record = g_ptr_array_index(replay->records, replay->next);
+
+		/* Wait for the host to send what it sent in the capture */
+		if (record->in == FALSE)
+			break;
+
+		if (replay->realtime && replay->waited == FALSE) {
+			guint64 delay = 0;
+
+			if (record->usec > replay->last_usec)
+				delay = record->usec - replay->last_usec;
+
+			replay->waited = TRUE;
+
+			if (delay >= 1000) {
+				replay->timeout = g_timeout_add(delay / 1000,
+							replay_timeout, replay);
+				return;
+			}
+		}
+
+		if (replay_write(replay, record) == FALSE)
+			return;
+
+		replay->last_usec = record->usec;
+		replay->next += 1;
+		replay->offset = 0;
+		replay->waited = FALSE;
+
+		if (replay->early->len > 0) {
+			GByteArray *early = replay->early;
+
+			replay->early = g_byte_array_new();
+			replay_consume(replay, early->data, early->len);
+			g_byte_array_free(early, TRUE);
+		}
+	}
+
+	/* What the host sends afterwards is still matched */
+	if (replay->next >= replay->played)
+		replay_finish(replay);
+}
+
+static gboolean replay_received(GIOChannel *channel, GIOCondition cond,
+					gpointer user_data)
+{
+	GAtReplay *replay = user_data;
+	guint8 buf[4096];
+	gboolean ret = TRUE;
+	ssize_t n;
+
+	g_at_replay_ref(replay);
+
+	while ((n = read(replay->fd, buf, sizeof(buf))) > 0)
+		replay_consume(replay, buf, n);
+
+	if (n == 0 || (n < 0 && errno != EAGAIN && errno != EINTR) ||
+			(cond & (G_IO_HUP | G_IO_ERR))) {
+		replay->read_watch = 0;
+		ret = FALSE;
+	}
+
+	replay_play(replay);
+
+	if (ret == FALSE)
+		replay_finish(replay);
+
+	g_at_replay_unref(replay);
+
+	return ret;
+}
+
+GAtReplay *g_at_replay_new(const char *filename, guint8 channel)
+{
+	GAtReplay *replay;
+	struct replay_load load;
+	int fds[2];
+	guint i;
+
+	load.records = g_ptr_array_new();
+	load.channel = channel;
+
+	if (g_at_capture_read(filename, load_record, &load) == FALSE)
+		goto error;
+
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0)
+		goto error;
+
+	replay = g_try_new0(GAtReplay, 1);
+	if (replay == NULL) {
+		close(fds[0]);
+		close(fds[1]);
+		goto error;
+	}
+
+	replay->ref_count = 1;
+	replay->records = load.records;
+
+	for (i = 0; i < replay->records->len; i++) {
+		struct replay_record *record;
+
+		record = g_ptr_array_index(replay->records, i);
+		if (record->in)
+			replay->played = i + 1;
+	}
+	replay->early = g_byte_array_new();
+
+	replay->host = g_io_channel_unix_new(fds[0]);
+	g_io_channel_set_close_on_unref(replay->host, TRUE);
+
+	replay->fd = fds[1];
+	fcntl(replay->fd, F_SETFL, fcntl(replay->fd, F_GETFL) | O_NONBLOCK);
+
+	replay->channel = g_io_channel_unix_new(replay->fd);
+	g_io_channel_set_close_on_unref(replay->channel, TRUE);
+
+	return replay;
+
+error:
+	g_ptr_array_foreach(load.records, (GFunc) g_free, NULL);
+	g_ptr_array_free(load.records, TRUE);
+
+	return NULL;
+}
+
+GAtReplay *g_at_replay_ref(GAtReplay *replay)
+{
+	if (replay == NULL)
+		return NULL;
+
+	g_atomic_int_inc(&replay->ref_count);
+
+	return replay;
+}
+
+void g_at_replay_unref(GAtReplay *replay)
+{
+	if (replay == NULL)
+		return;
+
+	if (g_atomic_int_dec_and_test(&replay->ref_count) == FALSE)
+		return;
+
+	if (replay->read_watch > 0)
+		g_source_remove(replay->read_watch);
+
+	if (replay->write_watch > 0)
+		g_source_remove(replay->write_watch);
+
+	if (replay->timeout > 0)
+		g_source_remove(replay->timeout);
+
+	g_io_channel_unref(replay->channel);
+	g_io_channel_unref(replay->host);
+
+	g_byte_array_free(replay->early, TRUE);
+
+	g_ptr_array_foreach(replay->records, (GFunc) g_free, NULL);
+	g_ptr_array_free(replay->records, TRUE);
+
+	g_free(replay);
+}
+
+GIOChannel *g_at_replay_get_channel(GAtReplay *replay)
+{
+	if (replay == NULL)
+		return NULL;
+
+	return replay->host;
+}
+
+gboolean g_at_replay_start(GAtReplay *replay, gboolean realtime,
+				GAtReplayFunc func, gpointer user_data)
+{
+	if (replay == NULL || replay->started)
+		return FALSE;
+
+	replay->started = TRUE;
+	replay->realtime = realtime;
+	replay->func = func;
+	replay->user_data = user_data;
+
+	if (replay->records->len > 0) {
+		struct replay_record *first;
+
+		first = g_ptr_array_index(replay->records, 0);
+		replay->last_usec = first->usec;
+	}
+
+	replay->read_watch = g_io_add_watch(replay->channel,
+					G_IO_IN | G_IO_HUP | G_IO_ERR,
+					replay_received, replay);
+
+	/* Play from the main loop, the host may not be set up yet */
+	replay->timeout = g_idle_add(replay_timeout, replay);
+
+	return TRUE;
+}
+
+guint g_at_replay_get_mismatches(GAtReplay *replay)
+{
+	if (replay == NULL)
+		return 0;
+
+	return replay->mismatches;
+}
@@ -0,0 +1,68 @@
+/*
+ *
+ *  AT chat library with GLib integration
+ *
+ *  Copyright (C) 2008-2010  Intel Corporation. All rights reserved.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef __G_AT_REPLAY_H
+#define __G_AT_REPLAY_H
+
+#include "gat.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct _GAtReplay;
+
+typedef struct _GAtReplay GAtReplay;
+
+typedef void (*GAtReplayFunc)(gpointer user_data);
+
+/*
+ * Plays the modem side of one channel of a capture.  The data received
+ * by the host is written to the channel returned by
+ * g_at_replay_get_channel, which can be given to GAtChat or GAtMux.
+ * The data sent by the host is expected back in the same order: each
+ * received record is held until all the data sent before it has been
+ * written, so responses never overtake their commands.
+ */
+GAtReplay *g_at_replay_new(const char *filename, guint8 channel);
+
+GAtReplay *g_at_replay_ref(GAtReplay *replay);
+void g_at_replay_unref(GAtReplay *replay);
+
+GIOChannel *g_at_replay_get_channel(GAtReplay *replay);
+
+/*
+ * With realtime, received records keep their original spacing, otherwise
+ * they are written as fast as the host reads them.  func is called once
+ * the last received record has been written, or the host has closed its
+ * channel.
+ */
+gboolean g_at_replay_start(GAtReplay *replay, gboolean realtime,
+				GAtReplayFunc func, gpointer user_data);
+
+/* Number of bytes written by the host which differ from the capture */
+guint g_at_replay_get_mismatches(GAtReplay *replay);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __G_AT_REPLAY_H */
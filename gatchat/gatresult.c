@@ -37,6 +37,7 @@ void g_at_result_iter_init(GAtResultIter *iter, GAtResult *result)
 	iter->pre.data = NULL;
 	iter->l = &iter->pre;
 	iter->line_pos = 0;
+	iter->line_len = 0;
 }
 
 gboolean g_at_result_iter_next(GAtResultIter *iter, const char *prefix)
@@ -62,7 +63,7 @@ gboolean g_at_result_iter_next(GAtResultIter *iter, const char *prefix)
 
 		iter->line_pos = prefix_len;
 
-		while (iter->line_pos < strlen(line) &&
+		while (iter->line_pos < (unsigned int) linelen &&
 			line[iter->line_pos] == ' ')
 			iter->line_pos += 1;
 
@@ -72,8 +73,12 @@ gboolean g_at_result_iter_next(GAtResultIter *iter, const char *prefix)
 	return FALSE;
 
 out:
-	/* Already checked the length to be no more than buflen */
-	strcpy(iter->buf, line);
+	/*
+	 * Tokens are parsed straight from the line, only strings returned
+	 * NUL terminated get copied into buf, at the same offset.  The
+	 * length was already checked to be no more than buflen.
+	 */
+	iter->line_len = linelen;
 	return TRUE;
 }
 
@@ -120,7 +125,7 @@ gboolean g_at_result_iter_next_unquoted_string(GAtResultIter *iter,
 		return FALSE;
 
 	line = iter->l->data;
-	len = strlen(line);
+	len = iter->line_len;
 
 	pos = iter->line_pos;
 
@@ -139,6 +144,7 @@ gboolean g_at_result_iter_next_unquoted_string(GAtResultIter *iter,
 	while (end < len && line[end] != ',' && line[end] != ')')
 		end += 1;
 
+	memcpy(iter->buf + pos, line + pos, end - pos);
 	iter->buf[end] = '\0';
 
 out:
@@ -164,7 +170,7 @@ gboolean g_at_result_iter_next_string(GAtResultIter *iter, const char **str)
 		return FALSE;
 
 	line = iter->l->data;
-	len = strlen(line);
+	len = iter->line_len;
 
 	pos = iter->line_pos;
 
@@ -186,6 +192,7 @@ gboolean g_at_result_iter_next_string(GAtResultIter *iter, const char **str)
 	if (line[end] != '"')
 		return FALSE;
 
+	memcpy(iter->buf + pos, line + pos, end - pos);
 	iter->buf[end] = '\0';
 
 	/* Skip " */
@@ -200,6 +207,67 @@ out:
 	return TRUE;
 }
 
+gboolean g_at_result_iter_next_slice(GAtResultIter *iter,
+					const char **str, unsigned int *length)
+{
+	unsigned int pos;
+	unsigned int end;
+	unsigned int len;
+	char *line;
+
+	if (!iter)
+		return FALSE;
+
+	if (!iter->l)
+		return FALSE;
+
+	line = iter->l->data;
+	len = iter->line_len;
+
+	pos = iter->line_pos;
+
+	if (pos >= len)
+		return FALSE;
+
+	if (line[pos] == '(' || line[pos] == ')')
+		return FALSE;
+
+	if (line[pos] == '"') {
+		pos += 1;
+		end = pos;
+
+		while (end < len && line[end] != '"')
+			end += 1;
+
+		if (end >= len)
+			return FALSE;
+
+		if (str)
+			*str = line + pos;
+
+		if (length)
+			*length = end - pos;
+
+		/* Skip " */
+		end += 1;
+	} else {
+		end = pos;
+
+		while (end < len && line[end] != ',' && line[end] != ')')
+			end += 1;
+
+		if (str)
+			*str = line + pos;
+
+		if (length)
+			*length = end - pos;
+	}
+
+	iter->line_pos = skip_to_next_field(line, end, len);
+
+	return TRUE;
+}
+
 gboolean g_at_result_iter_next_hexstring(GAtResultIter *iter,
 		const guint8 **str, gint *length)
 {
@@ -216,7 +284,7 @@ gboolean g_at_result_iter_next_hexstring(GAtResultIter *iter,
 		return FALSE;
 
 	line = iter->l->data;
-	len = strlen(line);
+	len = iter->line_len;
 
 	pos = iter->line_pos;
 	bufpos = iter->buf + pos;
@@ -271,7 +339,7 @@ gboolean g_at_result_iter_next_number(GAtResultIter *iter, gint *number)
 		return FALSE;
 
 	line = iter->l->data;
-	len = strlen(line);
+	len = iter->line_len;
 
 	pos = iter->line_pos;
 	end = pos;
@@ -308,7 +376,7 @@ gboolean g_at_result_iter_next_range(GAtResultIter *iter, gint *min, gint *max)
 		return FALSE;
 
 	line = iter->l->data;
-	len = strlen(line);
+	len = iter->line_len;
 
 	pos = iter->line_pos;
 
@@ -352,9 +420,8 @@ out:
 	return TRUE;
 }
 
-static gint skip_until(const char *line, int start, const char delim)
+static gint skip_until(const char *line, int start, int len, const char delim)
 {
-	int len = strlen(line);
 	int i = start;
 
 	while (i < len) {
@@ -377,7 +444,7 @@ static gint skip_until(const char *line, int start, const char delim)
 			continue;
 		}
 
-		i = skip_until(line, i+1, ')');
+		i = skip_until(line, i+1, len, ')');
 
 		if (i < len)
 			i += 1;
@@ -399,12 +466,12 @@ gboolean g_at_result_iter_skip_next(GAtResultIter *iter)
 
 	line = iter->l->data;
 
-	skipped_to = skip_until(line, iter->line_pos, ',');
+	skipped_to = skip_until(line, iter->line_pos, iter->line_len, ',');
 
 	if (skipped_to == iter->line_pos && line[skipped_to] != ',')
 		return FALSE;
 
-	iter->line_pos = skip_to_next_field(line, skipped_to, strlen(line));
+	iter->line_pos = skip_to_next_field(line, skipped_to, iter->line_len);
 
 	return TRUE;
 }
@@ -421,7 +488,7 @@ gboolean g_at_result_iter_open_list(GAtResultIter *iter)
 		return FALSE;
 
 	line = iter->l->data;
-	len = strlen(line);
+	len = iter->line_len;
 
 	if (iter->line_pos >= len)
 		return FALSE;
@@ -431,8 +498,7 @@ gboolean g_at_result_iter_open_list(GAtResultIter *iter)
 
 	iter->line_pos += 1;
 
-	while (iter->line_pos < strlen(line) &&
-		line[iter->line_pos] == ' ')
+	while (iter->line_pos < len && line[iter->line_pos] == ' ')
 		iter->line_pos += 1;
 
 	return TRUE;
@@ -450,7 +516,7 @@ gboolean g_at_result_iter_close_list(GAtResultIter *iter)
 		return FALSE;
 
 	line = iter->l->data;
-	len = strlen(line);
+	len = iter->line_len;
 
 	if (iter->line_pos >= len)
 		return FALSE;
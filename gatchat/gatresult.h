@@ -40,6 +40,7 @@ struct _GAtResultIter {
 	GSList *l;
 	char buf[G_AT_RESULT_LINE_LENGTH_MAX + 1];
 	unsigned int line_pos;
+	unsigned int line_len;
 	GSList pre;
 };
 
@@ -58,6 +59,15 @@ gboolean g_at_result_iter_next_string(GAtResultIter *iter, const char **str);
 gboolean g_at_result_iter_next_unquoted_string(GAtResultIter *iter,
 						const char **str);
 gboolean g_at_result_iter_next_number(GAtResultIter *iter, gint *number);
+
+/*
+ * Returns the next field as a pointer into the response line and its
+ * length, without copying.  Quotes are stripped, an omitted field yields
+ * a zero length slice.  The slice is not NUL terminated and is only valid
+ * as long as the GAtResult is.
+ */
+gboolean g_at_result_iter_next_slice(GAtResultIter *iter,
+					const char **str, unsigned int *length);
 gboolean g_at_result_iter_next_hexstring(GAtResultIter *iter,
 		const guint8 **str, gint *length);
 
@@ -56,6 +56,7 @@ static gboolean option_legacy = FALSE;
 static gchar *option_username = NULL;
 static gchar *option_password = NULL;
 static gchar *option_pppdump = NULL;
+static gchar *option_capture = NULL;
 
 static GAtPPP *ppp;
 static GAtChat *control;
@@ -618,6 +619,8 @@ static GOptionEntry options[] = {
 				"Specify PPP password" },
 	{ "pppdump", 'D', 0, G_OPTION_ARG_STRING, &option_pppdump,
 				"Specify pppdump filename" },
+	{ "capture", 'C', 0, G_OPTION_ARG_STRING, &option_capture,
+				"Specify traffic capture filename" },
 	{ NULL },
 };
 
@@ -671,6 +674,23 @@ int main(int argc, char **argv)
 			goto out;
 	}
 
+	if (option_capture) {
+		GAtCapture *capture = g_at_capture_new(option_capture);
+
+		if (capture == NULL)
+			g_printerr("Unable to open %s\n", option_capture);
+
+		/* The control port is channel 0, a separate modem port 1 */
+		g_at_io_set_capture(g_at_chat_get_io(control), capture, 0);
+
+		if (modem != control)
+			g_at_io_set_capture(g_at_chat_get_io(modem),
+						capture, 1);
+
+		g_at_capture_unref(capture);
+		g_free(option_capture);
+	}
+
 	g_print("APN: %s\n", option_apn);
 	g_print("CID: %d\n", option_cid);
 
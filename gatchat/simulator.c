@@ -0,0 +1,597 @@
+/*
+ *
+ *  AT modem simulator for testing
+ *
+ *  Copyright (C) 2008-2010  Intel Corporation. All rights reserved.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include <glib.h>
+
+#include "gatserver.h"
+#include "simulator.h"
+
+#define SIMULATOR_GROUP "Simulator"
+#define URC_GROUP_PREFIX "URC "
+
+enum latency_type {
+	LATENCY_FIXED,
+	LATENCY_UNIFORM,
+	LATENCY_EXPONENTIAL,
+};
+
+/* A delay in ms, drawn anew every time it is used */
+struct latency {
+	enum latency_type type;
+	unsigned int min;
+	unsigned int max;	/* The mean for the exponential */
+};
+
+struct command {
+	char *key;
+	char **lines;
+	char *result;
+	struct latency latency;
+	struct latency line_interval;
+};
+
+struct urc {
+	char **lines;
+	char *after;
+	struct latency start;
+	struct latency interval;
+	unsigned int count;
+	unsigned int sent;
+	guint source;
+	struct at_simulator *sim;
+};
+
+struct prefix {
+	char *name;
+	struct at_simulator *sim;
+};
+
+struct at_simulator {
+	GAtServer *server;
+	GRand *rand;
+	GHashTable *commands;
+	GSList *prefixes;
+	GSList *urcs;
+	struct command *pending;
+	unsigned int pending_line;
+	guint response_source;
+	unsigned int command_count;
+	unsigned int urc_count;
+};
+
+static gboolean parse_latency(const char *str, struct latency *latency)
+{
+	char *end;
+
+	memset(latency, 0, sizeof(*latency));
+
+	if (str == NULL)
+		return TRUE;
+
+	if (g_str_has_prefix(str, "exp:")) {
+		latency->type = LATENCY_EXPONENTIAL;
+		latency->max = strtoul(str + 4, &end, 10);
+
+		return *end == '\0' && end != str + 4;
+	}
+
+	latency->min = strtoul(str, &end, 10);
+	if (end == str)
+		return FALSE;
+
+	latency->max = latency->min;
+
+	if (*end == '-') {
+		const char *max = end + 1;
+
+		latency->type = LATENCY_UNIFORM;
+		latency->max = strtoul(max, &end, 10);
+
+		if (end == max || latency->max < latency->min)
+			return FALSE;
+	}
+
+	return *end == '\0';
+}
+
+static unsigned int latency_draw(struct at_simulator *sim,
+					const struct latency *latency)
+{
+	double u;
+
+	switch (latency->type) {
+	case LATENCY_FIXED:
+		return latency->min;
+	case LATENCY_UNIFORM:
+		return g_rand_int_range(sim->rand, latency->min,
+						latency->max + 1);
+	case LATENCY_EXPONENTIAL:
+		u = g_rand_double(sim->rand);
+		return -log(1.0 - u) * latency->max;
+	}
+
+	return 0;
+}
+
+static void send_result(GAtServer *server, const char *result)
+{
+	static const struct {
+		const char *str;
+		GAtServerResult result;
+	} finals[] = {
+		{ "OK",			G_AT_SERVER_RESULT_OK },
+		{ "CONNECT",		G_AT_SERVER_RESULT_CONNECT },
+		{ "NO CARRIER",		G_AT_SERVER_RESULT_NO_CARRIER },
+		{ "ERROR",		G_AT_SERVER_RESULT_ERROR },
+		{ "NO DIALTONE",	G_AT_SERVER_RESULT_NO_DIALTONE },
+		{ "BUSY",		G_AT_SERVER_RESULT_BUSY },
+		{ "NO ANSWER",		G_AT_SERVER_RESULT_NO_ANSWER },
+	};
+	unsigned int i;
+
+	if (result == NULL) {
+		g_at_server_send_final(server, G_AT_SERVER_RESULT_OK);
+		return;
+	}
+
+	for (i = 0; i < G_N_ELEMENTS(finals); i++) {
+		if (g_str_equal(result, finals[i].str)) {
+			g_at_server_send_final(server, finals[i].result);
+			return;
+		}
+	}
+
+	/* Anything else is an extended result, e.g. +CME ERROR: 10 */
+	g_at_server_send_ext_final(server, result);
+}
+
+static gboolean urc_send(gpointer user_data)
+{
+	struct urc *urc = user_data;
+	struct at_simulator *sim = urc->sim;
+	unsigned int n = g_strv_length(urc->lines);
+	unsigned int delay;
+
+	urc->source = 0;
+
+	/* URCs with no interval drawn go back to back, making a storm */
+	do {
+		g_at_server_send_unsolicited(sim->server,
+						urc->lines[urc->sent % n]);
+		urc->sent += 1;
+		sim->urc_count += 1;
+
+		if (urc->sent == urc->count)
+			return FALSE;
+
+		delay = latency_draw(sim, &urc->interval);
+	} while (delay == 0);
+
+	urc->source = g_timeout_add(delay, urc_send, urc);
+
+	return FALSE;
+}
+
+static void urc_start(struct urc *urc)
+{
+	unsigned int delay = latency_draw(urc->sim, &urc->start);
+
+	urc->sent = 0;
+	urc->source = g_timeout_add(delay, urc_send, urc);
+}
+
+static void urc_trigger(struct at_simulator *sim, const char *key)
+{
+	GSList *l;
+
+	for (l = sim->urcs; l; l = l->next) {
+		struct urc *urc = l->data;
+
+		if (urc->after == NULL || !g_str_equal(urc->after, key))
+			continue;
+
+		if (urc->source)
+			g_source_remove(urc->source);
+
+		urc_start(urc);
+	}
+}
+
+static gboolean response_send(gpointer user_data)
+{
+	struct at_simulator *sim = user_data;
+	struct command *command = sim->pending;
+	unsigned int n = g_strv_length(command->lines);
+
+	sim->response_source = 0;
+
+	while (sim->pending_line < n) {
+		unsigned int i = sim->pending_line++;
+		unsigned int delay;
+
+		g_at_server_send_info(sim->server, command->lines[i],
+						i + 1 == n);
+
+		if (i + 1 == n)
+			break;
+
+		delay = latency_draw(sim, &command->line_interval);
+		if (delay == 0)
+			continue;
+
+		sim->response_source = g_timeout_add(delay, response_send,
+							sim);
+		return FALSE;
+	}
+
+	sim->pending = NULL;
+
+	send_result(sim->server, command->result);
+	urc_trigger(sim, command->key);
+
+	return FALSE;
+}
+
+static struct command *command_find(struct at_simulator *sim,
+					const char *prefix,
+					GAtServerRequestType type,
+					const char *text)
+{
+	struct command *command;
+	char *key;
+
+	key = g_ascii_strup(text, -1);
+	command = g_hash_table_lookup(sim->commands, key);
+	g_free(key);
+
+	if (command)
+		return command;
+
+	switch (type) {
+	case G_AT_SERVER_REQUEST_TYPE_QUERY:
+		key = g_strconcat(prefix, "?", NULL);
+		break;
+	case G_AT_SERVER_REQUEST_TYPE_SUPPORT:
+		key = g_strconcat(prefix, "=?", NULL);
+		break;
+	case G_AT_SERVER_REQUEST_TYPE_SET:
+		key = g_strconcat(prefix, "=", NULL);
+		break;
+	default:
+		key = NULL;
+		break;
+	}
+
+	if (key) {
+		command = g_hash_table_lookup(sim->commands, key);
+		g_free(key);
+
+		if (command)
+			return command;
+	}
+
+	return g_hash_table_lookup(sim->commands, prefix);
+}
+
+static void command_cb(GAtServerRequestType type, GAtResult *result,
+			gpointer user_data)
+{
+	struct prefix *prefix = user_data;
+	struct at_simulator *sim = prefix->sim;
+	struct command *command;
+	unsigned int delay;
+
+	command = command_find(sim, prefix->name, type, result->lines->data);
+	if (command == NULL) {
+		g_at_server_send_final(sim->server, G_AT_SERVER_RESULT_ERROR);
+		return;
+	}
+
+	sim->command_count += 1;
+	sim->pending = command;
+	sim->pending_line = 0;
+
+	delay = latency_draw(sim, &command->latency);
+
+	if (delay == 0)
+		response_send(sim);
+	else
+		sim->response_source = g_timeout_add(delay, response_send,
+							sim);
+}
+
+/* The name under which GAtServer dispatches a command, see V.250 5.3 */
+static char *command_prefix(const char *key)
+{
+	unsigned int len;
+
+	switch (key[0]) {
+	case '+':
+	case '*':
+	case '!':
+	case '%':
+		len = strcspn(key, "=?");
+		break;
+	case '&':
+		len = 2;
+		break;
+	case 'S':
+		len = 1 + strspn(key + 1, "0123456789");
+		break;
+	default:
+		len = 1;
+		break;
+	}
+
+	return g_strndup(key, len);
+}
+
+static void prefix_free(gpointer user_data)
+{
+	struct prefix *prefix = user_data;
+
+	g_free(prefix->name);
+	g_free(prefix);
+}
+
+static void command_free(gpointer user_data)
+{
+	struct command *command = user_data;
+
+	g_free(command->key);
+	g_strfreev(command->lines);
+	g_free(command->result);
+	g_free(command);
+}
+
+static void urc_free(struct urc *urc)
+{
+	if (urc->source)
+		g_source_remove(urc->source);
+
+	g_strfreev(urc->lines);
+	g_free(urc->after);
+	g_free(urc);
+}
+
+static gboolean load_latency(GKeyFile *script, const char *group,
+				const char *key, struct latency *latency,
+				GError **error)
+{
+	char *str;
+	gboolean ret;
+
+	str = g_key_file_get_string(script, group, key, NULL);
+	ret = parse_latency(str, latency);
+	g_free(str);
+
+	if (ret == FALSE)
+		g_set_error(error, G_KEY_FILE_ERROR,
+				G_KEY_FILE_ERROR_INVALID_VALUE,
+				"[%s] %s: expected <ms>, <min>-<max> "
+				"or exp:<mean>", group, key);
+
+	return ret;
+}
+
+static char **load_lines(GKeyFile *script, const char *group,
+				const char *key)
+{
+	char *str;
+	char **lines;
+
+	str = g_key_file_get_string(script, group, key, NULL);
+	if (str == NULL)
+		return g_new0(char *, 1);
+
+	lines = g_strsplit(str, "\n", -1);
+	g_free(str);
+
+	return lines;
+}
+
+static gboolean load_command(struct at_simulator *sim, GKeyFile *script,
+				const char *group, GError **error)
+{
+	struct command *command;
+	struct prefix *prefix;
+	char *name;
+	GSList *l;
+
+	command = g_new0(struct command, 1);
+	command->key = g_ascii_strup(group + 2, -1);
+	command->lines = load_lines(script, group, "Response");
+	command->result = g_key_file_get_string(script, group,
+						"Result", NULL);
+
+	g_hash_table_replace(sim->commands, command->key, command);
+
+	if (!load_latency(script, group, "Latency", &command->latency,
+				error))
+		return FALSE;
+
+	if (!load_latency(script, group, "LineInterval",
+				&command->line_interval, error))
+		return FALSE;
+
+	name = command_prefix(command->key);
+
+	for (l = sim->prefixes; l; l = l->next) {
+		prefix = l->data;
+
+		if (g_str_equal(prefix->name, name)) {
+			g_free(name);
+			return TRUE;
+		}
+	}
+
+	prefix = g_new0(struct prefix, 1);
+	prefix->name = name;
+	prefix->sim = sim;
+
+	sim->prefixes = g_slist_prepend(sim->prefixes, prefix);
+
+	g_at_server_register(sim->server, prefix->name, command_cb,
+				prefix, prefix_free);
+
+	return TRUE;
+}
+
+static gboolean load_urc(struct at_simulator *sim, GKeyFile *script,
+				const char *group, GError **error)
+{
+	struct urc *urc;
+	char *after;
+
+	urc = g_new0(struct urc, 1);
+	urc->sim = sim;
+	urc->lines = load_lines(script, group, "Line");
+	urc->count = g_key_file_get_integer(script, group, "Count", NULL);
+
+	if (urc->count == 0)
+		urc->count = 1;
+
+	sim->urcs = g_slist_prepend(sim->urcs, urc);
+
+	if (urc->lines[0] == NULL) {
+		g_set_error(error, G_KEY_FILE_ERROR,
+				G_KEY_FILE_ERROR_KEY_NOT_FOUND,
+				"[%s] needs a Line", group);
+		return FALSE;
+	}
+
+	if (!load_latency(script, group, "Start", &urc->start, error))
+		return FALSE;
+
+	if (!load_latency(script, group, "Interval", &urc->interval, error))
+		return FALSE;
+
+	after = g_key_file_get_string(script, group, "After", NULL);
+	if (after == NULL) {
+		urc_start(urc);
+		return TRUE;
+	}
+
+	if (g_ascii_strncasecmp(after, "AT", 2) == 0)
+		urc->after = g_ascii_strup(after + 2, -1);
+	else
+		urc->after = g_ascii_strup(after, -1);
+
+	g_free(after);
+
+	return TRUE;
+}
+
+struct at_simulator *at_simulator_new(GAtServer *server, GKeyFile *script,
+					GError **error)
+{
+	struct at_simulator *sim;
+	char **groups;
+	gboolean ok = TRUE;
+	int seed;
+	int i;
+
+	sim = g_new0(struct at_simulator, 1);
+	sim->server = server;
+	sim->commands = g_hash_table_new_full(g_str_hash, g_str_equal,
+						NULL, command_free);
+
+	/* The same script and seed always play out the same way */
+	seed = g_key_file_get_integer(script, SIMULATOR_GROUP, "Seed", NULL);
+	sim->rand = g_rand_new_with_seed(seed);
+
+	groups = g_key_file_get_groups(script, NULL);
+
+	for (i = 0; ok && groups[i]; i++) {
+		const char *group = groups[i];
+
+		if (g_str_equal(group, SIMULATOR_GROUP))
+			continue;
+
+		if (g_str_has_prefix(group, URC_GROUP_PREFIX))
+			ok = load_urc(sim, script, group, error);
+		else if (g_ascii_strncasecmp(group, "AT", 2) == 0 &&
+				group[2] != '\0')
+			ok = load_command(sim, script, group, error);
+		else {
+			g_set_error(error, G_KEY_FILE_ERROR,
+					G_KEY_FILE_ERROR_GROUP_NOT_FOUND,
+					"[%s] is neither a command nor a URC",
+					group);
+			ok = FALSE;
+		}
+	}
+
+	g_strfreev(groups);
+
+	if (ok == FALSE) {
+		at_simulator_free(sim);
+		return NULL;
+	}
+
+	return sim;
+}
+
+void at_simulator_free(struct at_simulator *sim)
+{
+	GSList *l;
+
+	if (sim == NULL)
+		return;
+
+	if (sim->response_source)
+		g_source_remove(sim->response_source);
+
+	g_slist_foreach(sim->urcs, (GFunc) urc_free, NULL);
+	g_slist_free(sim->urcs);
+
+	/* Unregistering frees the prefix, so take the name first */
+	for (l = sim->prefixes; l; l = l->next) {
+		struct prefix *prefix = l->data;
+		char *name = g_strdup(prefix->name);
+
+		g_at_server_unregister(sim->server, name);
+		g_free(name);
+	}
+
+	g_slist_free(sim->prefixes);
+	g_hash_table_destroy(sim->commands);
+	g_rand_free(sim->rand);
+	g_free(sim);
+}
+
+unsigned int at_simulator_get_commands(struct at_simulator *sim)
+{
+	return sim->command_count;
+}
+
+unsigned int at_simulator_get_unsolicited(struct at_simulator *sim)
+{
+	return sim->urc_count;
+}
@@ -0,0 +1,49 @@
+/*
+ *
+ *  AT modem simulator for testing
+ *
+ *  Copyright (C) 2008-2010  Intel Corporation. All rights reserved.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef __AT_SIMULATOR_H
+#define __AT_SIMULATOR_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "gatserver.h"
+
+struct at_simulator;
+
+/*
+ * Answers the commands arriving on the server as described by a script
+ * in key file format, see simulator.conf for a commented example.  The
+ * server must outlive the simulator.
+ */
+struct at_simulator *at_simulator_new(GAtServer *server, GKeyFile *script,
+					GError **error);
+void at_simulator_free(struct at_simulator *sim);
+
+unsigned int at_simulator_get_commands(struct at_simulator *sim);
+unsigned int at_simulator_get_unsolicited(struct at_simulator *sim);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __AT_SIMULATOR_H */
@@ -0,0 +1,307 @@
+/*
+ *
+ *  AT chat library with GLib integration
+ *
+ *  Copyright (C) 2008-2010  Intel Corporation. All rights reserved.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+
+#include <glib.h>
+
+#include "gatchat.h"
+#include "gatcapture.h"
+#include "gatreplay.h"
+
+static gboolean option_debug = FALSE;
+static gboolean option_realtime = FALSE;
+static gboolean option_permissive = FALSE;
+static gint option_channel = G_AT_CAPTURE_CHANNEL_RAW;
+static gint option_rounds = 1;
+
+static GMainLoop *event_loop;
+
+/* Unsolicited results mostly start with one of these */
+static const char *unsolicited_prefixes[] = { "+", "*", "^", "%", "RING",
+						NULL };
+
+struct round {
+	GAtReplay *replay;
+	GAtChat *chat;
+	guint sent;
+	guint answered;
+	guint failed;
+	guint unsolicited;
+	guint mismatches;
+	gboolean played;
+	guint timeout;
+};
+
+static gboolean collect_sent(guint64 usec, guint8 channel, gboolean in,
+				const guint8 *data, gsize len,
+				gpointer user_data)
+{
+	GString *sent = user_data;
+
+	if (in == FALSE && channel == option_channel)
+		g_string_append_len(sent, (const char *) data, len);
+
+	return TRUE;
+}
+
+/*
+ * Splits what the host sent into commands for g_at_chat_send.  A PDU is
+ * sent after the prompt and ended by Ctrl-Z, GAtChat takes it after a CR
+ * in the command.
+ */
+static GSList *parse_commands(const GString *sent)
+{
+	GSList *commands = NULL;
+	const char *p = sent->str;
+	const char *end = sent->str + sent->len;
+
+	while (p < end) {
+		const char *cr = memchr(p, '\r', end - p);
+		const char *next;
+		const char *ctrlz;
+		char *cmd;
+
+		if (cr == NULL)
+			cr = end;
+
+		cmd = g_strndup(p, cr - p);
+		next = cr < end ? cr + 1 : end;
+
+		ctrlz = memchr(next, 26, end - next);
+		if (ctrlz && memchr(next, '\r', ctrlz - next) == NULL) {
+			char *pdu = g_strndup(next, ctrlz - next);
+			char *tmp = g_strconcat(cmd, "\r", pdu, NULL);
+
+			g_free(pdu);
+			g_free(cmd);
+			cmd = tmp;
+			next = ctrlz + 1;
+		}
+
+		g_strstrip(cmd);
+
+		if (*cmd != '\0')
+			commands = g_slist_prepend(commands, cmd);
+		else
+			g_free(cmd);
+
+		p = next;
+	}
+
+	return g_slist_reverse(commands);
+}
+
+static void replay_debug(const char *str, gpointer user_data)
+{
+	g_print("%s%s\n", (const char *) user_data, str);
+}
+
+static void check_done(struct round *round)
+{
+	if (round->played && round->answered == round->sent)
+		g_main_loop_quit(event_loop);
+}
+
+static void command_cb(gboolean ok, GAtResult *result, gpointer user_data)
+{
+	struct round *round = user_data;
+
+	round->answered += 1;
+
+	if (!ok)
+		round->failed += 1;
+
+	check_done(round);
+}
+
+static void unsolicited_cb(GAtResult *result, gpointer user_data)
+{
+	struct round *round = user_data;
+
+	round->unsolicited += 1;
+}
+
+static gboolean give_up(gpointer user_data)
+{
+	struct round *round = user_data;
+
+	round->timeout = 0;
+	g_main_loop_quit(event_loop);
+
+	return FALSE;
+}
+
+static void played_cb(gpointer user_data)
+{
+	struct round *round = user_data;
+
+	round->played = TRUE;
+
+	/* Commands the capture does not answer would wait forever */
+	round->timeout = g_timeout_add_seconds(5, give_up, round);
+
+	check_done(round);
+}
+
+static gboolean run_round(const char *filename, GSList *commands,
+				struct round *round)
+{
+	GAtSyntax *syntax;
+	GSList *l;
+	int i;
+
+	memset(round, 0, sizeof(*round));
+
+	round->replay = g_at_replay_new(filename, option_channel);
+	if (round->replay == NULL)
+		return FALSE;
+
+	if (option_permissive)
+		syntax = g_at_syntax_new_gsm_permissive();
+	else
+		syntax = g_at_syntax_new_gsmv1();
+
+	round->chat = g_at_chat_new(g_at_replay_get_channel(round->replay),
+					syntax);
+	g_at_syntax_unref(syntax);
+
+	if (round->chat == NULL) {
+		g_at_replay_unref(round->replay);
+		return FALSE;
+	}
+
+	if (option_debug)
+		g_at_chat_set_debug(round->chat, replay_debug, "");
+
+	for (i = 0; unsolicited_prefixes[i]; i++)
+		g_at_chat_register(round->chat, unsolicited_prefixes[i],
+					unsolicited_cb, FALSE, round, NULL);
+
+	for (l = commands; l; l = l->next) {
+		g_at_chat_send(round->chat, l->data, NULL, command_cb,
+				round, NULL);
+		round->sent += 1;
+	}
+
+	g_at_replay_start(round->replay, option_realtime, played_cb, round);
+
+	g_main_loop_run(event_loop);
+
+	if (round->timeout > 0)
+		g_source_remove(round->timeout);
+
+	round->mismatches = g_at_replay_get_mismatches(round->replay);
+
+	g_at_chat_unref(round->chat);
+	g_at_replay_unref(round->replay);
+
+	return TRUE;
+}
+
+static GOptionEntry options[] = {
+	{ "debug", 'd', 0, G_OPTION_ARG_NONE, &option_debug,
+				"Enable debugging" },
+	{ "realtime", 'r', 0, G_OPTION_ARG_NONE, &option_realtime,
+				"Keep the original timing" },
+	{ "permissive", 'p', 0, G_OPTION_ARG_NONE, &option_permissive,
+				"Use the permissive syntax" },
+	{ "channel", 'c', 0, G_OPTION_ARG_INT, &option_channel,
+				"Specify the channel, 0 or a DLC" },
+	{ "rounds", 'n', 0, G_OPTION_ARG_INT, &option_rounds,
+				"Specify how many times to replay" },
+	{ NULL },
+};
+
+int main(int argc, char **argv)
+{
+	GOptionContext *context;
+	GError *err = NULL;
+	GString *sent;
+	GSList *commands;
+	GTimer *timer;
+	struct round round;
+	guint mismatches = 0;
+	gint i;
+
+	context = g_option_context_new("<capture file>");
+	g_option_context_add_main_entries(context, options, NULL);
+
+	if (g_option_context_parse(context, &argc, &argv, &err) == FALSE) {
+		if (err != NULL) {
+			g_printerr("%s\n", err->message);
+			g_error_free(err);
+			return 1;
+		}
+
+		g_printerr("An unknown error occurred\n");
+		return 1;
+	}
+
+	g_option_context_free(context);
+
+	if (argc != 2 || option_channel < 0 || option_channel > 255) {
+		g_printerr("Usage: %s [options] <capture file>\n", argv[0]);
+		return 1;
+	}
+
+	sent = g_string_new(NULL);
+
+	if (g_at_capture_read(argv[1], collect_sent, sent) == FALSE) {
+		g_printerr("Unable to read capture %s\n", argv[1]);
+		g_string_free(sent, TRUE);
+		return 1;
+	}
+
+	commands = parse_commands(sent);
+	g_string_free(sent, TRUE);
+
+	event_loop = g_main_loop_new(NULL, FALSE);
+	timer = g_timer_new();
+
+	for (i = 0; i < option_rounds; i++) {
+		if (run_round(argv[1], commands, &round) == FALSE) {
+			g_printerr("Unable to replay %s\n", argv[1]);
+			break;
+		}
+
+		mismatches += round.mismatches;
+	}
+
+	g_print("%d rounds of %u commands in %.3f s\n", i, round.sent,
+			g_timer_elapsed(timer, NULL));
+	g_print("Last round: %u answered, %u failed, %u unsolicited\n",
+			round.answered, round.failed, round.unsolicited);
+	g_print("Bytes differing from the capture: %u\n", mismatches);
+
+	g_timer_destroy(timer);
+	g_main_loop_unref(event_loop);
+
+	g_slist_foreach(commands, (GFunc) g_free, NULL);
+	g_slist_free(commands);
+
+	return mismatches > 0 || i < option_rounds;
+}
@@ -47,6 +47,7 @@
 #include "gatserver.h"
 #include "gatppp.h"
 #include "ringbuffer.h"
+#include "simulator.h"
 
 #define DEFAULT_TCP_PORT 12346
 #define DEFAULT_SOCK_PATH "./server_sock"
@@ -67,6 +68,10 @@ static GAtServer *server;
 static GAtPPP *ppp;
 unsigned int server_watch;
 
+static GKeyFile *script;
+static struct at_simulator *simulator;
+static const char *pty_link;
+
 static gboolean server_cleanup()
 {
 	if (server_watch)
@@ -77,6 +82,18 @@ static gboolean server_cleanup()
 		ppp = NULL;
 	}
 
+	if (simulator) {
+		g_print("Simulator answered %u commands, sent %u URCs\n",
+				at_simulator_get_commands(simulator),
+				at_simulator_get_unsolicited(simulator));
+
+		at_simulator_free(simulator);
+		simulator = NULL;
+	}
+
+	if (pty_link)
+		unlink(pty_link);
+
 	g_at_server_unref(server);
 	server = NULL;
 
@@ -812,8 +829,24 @@ error:
 
 static void add_handler(GAtServer *server)
 {
+	GError *error = NULL;
+
 	g_at_server_set_debug(server, server_debug, "Server");
 
+	if (script) {
+		/* Only the latest connection is simulated */
+		at_simulator_free(simulator);
+
+		simulator = at_simulator_new(server, script, &error);
+		if (simulator == NULL) {
+			g_printerr("Invalid script: %s\n", error->message);
+			g_error_free(error);
+			exit(1);
+		}
+
+		return;
+	}
+
 	g_at_server_register(server, "+CGMI",    cgmi_cb,    server, NULL);
 	g_at_server_register(server, "+CGMM",    cgmm_cb,    server, NULL);
 	g_at_server_register(server, "+CGMR",    cgmr_cb,    server, NULL);
@@ -871,6 +904,14 @@ static gboolean create_tty(const char *modem_path)
 
 	g_print("new pty is created at %s\n", pty_name);
 
+	if (pty_link) {
+		unlink(pty_link);
+
+		if (symlink(pty_name, pty_link) < 0)
+			g_printerr("Can't link %s: %s\n", pty_link,
+					strerror(errno));
+	}
+
 	server_io = g_io_channel_unix_new(master);
 
 	server = g_at_server_new(server_io);
@@ -1128,11 +1169,30 @@ static void usage(void)
 {
 	g_print("test-server - AT Server testing\n"
 		"Usage:\n");
-	g_print("\ttest-server [-t type]\n");
+	g_print("\ttest-server [-t type] [-s script] [-l link]\n");
 	g_print("Types:\n"
 		"\t0: Pseudo TTY port (default)\n"
 		"\t1: TCP sock at port 12346)\n"
 		"\t2: Unix sock at ./server_sock\n");
+	g_print("Options:\n"
+		"\t-s: Answer as described by a simulator script,\n"
+		"\t    see gatchat/simulator.conf\n"
+		"\t-l: Symbolic link to the pseudo TTY, e.g. for the\n"
+		"\t    Device of an atgen modem in modem.conf\n");
+}
+
+static void load_script(const char *path)
+{
+	GError *error = NULL;
+
+	script = g_key_file_new();
+
+	if (g_key_file_load_from_file(script, path, G_KEY_FILE_NONE,
+					&error) == FALSE) {
+		g_printerr("Can't load %s: %s\n", path, error->message);
+		g_error_free(error);
+		exit(1);
+	}
 }
 
 int main(int argc, char **argv)
@@ -1140,11 +1200,17 @@ int main(int argc, char **argv)
 	int opt, signal_source;
 	int type = 0;
 
-	while ((opt = getopt(argc, argv, "ht:")) != EOF) {
+	while ((opt = getopt(argc, argv, "ht:s:l:")) != EOF) {
 		switch (opt) {
 		case 't':
 			type = atoi(optarg);
 			break;
+		case 's':
+			load_script(optarg);
+			break;
+		case 'l':
+			pty_link = optarg;
+			break;
 		case 'h':
 			usage();
 			exit(1);
@@ -1166,5 +1232,8 @@ int main(int argc, char **argv)
 
 	g_source_remove(signal_source);
 
+	if (script)
+		g_key_file_free(script);
+
 	return 0;
 }
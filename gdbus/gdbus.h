@@ -57,6 +57,12 @@ typedef DBusMessage * (* GDBusMethodFunction) (DBusConnection *connection,
 
 typedef guint32 GDBusPendingReply;
 
+typedef void (* GDBusInterfaceFunction) (DBusConnection *connection,
+						const char *path,
+						const char *interface,
+						gboolean registered,
+						void *user_data);
+
 typedef void (* GDBusSecurityFunction) (DBusConnection *connection,
 						const char *action,
 						gboolean interaction,
@@ -120,6 +126,14 @@ gboolean g_dbus_register_interface(DBusConnection *connection,
 gboolean g_dbus_unregister_interface(DBusConnection *connection,
 					const char *path, const char *name);
 
+void g_dbus_set_interface_function(GDBusInterfaceFunction function,
+							void *user_data);
+gboolean g_dbus_append_interface(DBusConnection *connection,
+					const char *path, const char *name,
+					DBusMessageIter *array);
+void g_dbus_append_objects(DBusConnection *connection, const char *path,
+						DBusMessageIter *array);
+
 gboolean g_dbus_register_security(const GDBusSecurityTable *security);
 gboolean g_dbus_unregister_security(const GDBusSecurityTable *security);
 
@@ -669,6 +669,217 @@ fail:
 	return ret;
 }
 
+static GDBusInterfaceFunction interface_function = NULL;
+static void *interface_user_data = NULL;
+
+void g_dbus_set_interface_function(GDBusInterfaceFunction function,
+							void *user_data)
+{
+	interface_function = function;
+	interface_user_data = user_data;
+}
+
+static void copy_iter(DBusMessageIter *src, DBusMessageIter *dst)
+{
+	int type;
+
+	while ((type = dbus_message_iter_get_arg_type(src)) !=
+							DBUS_TYPE_INVALID) {
+		DBusMessageIter src_sub, dst_sub;
+		char *sig = NULL;
+
+		if (dbus_type_is_basic(type)) {
+			union {
+				dbus_uint64_t u64;
+				double dbl;
+				const char *str;
+			} value;
+
+			dbus_message_iter_get_basic(src, &value);
+			dbus_message_iter_append_basic(dst, type, &value);
+			dbus_message_iter_next(src);
+			continue;
+		}
+
+		dbus_message_iter_recurse(src, &src_sub);
+
+		if (type == DBUS_TYPE_ARRAY || type == DBUS_TYPE_VARIANT)
+			sig = dbus_message_iter_get_signature(&src_sub);
+
+		dbus_message_iter_open_container(dst, type, sig, &dst_sub);
+		copy_iter(&src_sub, &dst_sub);
+		dbus_message_iter_close_container(dst, &dst_sub);
+
+		dbus_free(sig);
+		dbus_message_iter_next(src);
+	}
+}
+
+/*
+ * Only a GetProperties that answers straight away is called, the
+ * asynchronous ones would go to the network and reply on their own.
+ */
+static DBusMessage *get_properties(DBusConnection *connection,
+					const char *path,
+					struct interface_data *iface)
+{
+	const GDBusMethodTable *method;
+	DBusMessage *call, *reply;
+
+	for (method = iface->methods; method &&
+			method->name && method->function; method++) {
+		if (strcmp(method->name, "GetProperties") == 0)
+			break;
+	}
+
+	if (method == NULL || method->name == NULL || method->function == NULL)
+		return NULL;
+
+	if (method->flags & G_DBUS_METHOD_FLAG_ASYNC || method->privilege)
+		return NULL;
+
+	call = dbus_message_new_method_call(NULL, path, iface->name,
+							method->name);
+	if (call == NULL)
+		return NULL;
+
+	dbus_message_set_serial(call, 1);
+
+	reply = method->function(connection, call, iface->user_data);
+
+	dbus_message_unref(call);
+
+	if (reply == NULL)
+		return NULL;
+
+	if (dbus_message_get_type(reply) != DBUS_MESSAGE_TYPE_METHOD_RETURN ||
+			!dbus_message_has_signature(reply, "a{sv}")) {
+		dbus_message_unref(reply);
+		return NULL;
+	}
+
+	return reply;
+}
+
+static void append_interface(DBusConnection *connection, const char *path,
+				struct interface_data *iface,
+				DBusMessageIter *array)
+{
+	DBusMessageIter entry, dict;
+	DBusMessage *reply;
+
+	dbus_message_iter_open_container(array, DBUS_TYPE_DICT_ENTRY,
+							NULL, &entry);
+	dbus_message_iter_append_basic(&entry, DBUS_TYPE_STRING, &iface->name);
+	dbus_message_iter_open_container(&entry, DBUS_TYPE_ARRAY,
+					DBUS_DICT_ENTRY_BEGIN_CHAR_AS_STRING
+					DBUS_TYPE_STRING_AS_STRING
+					DBUS_TYPE_VARIANT_AS_STRING
+					DBUS_DICT_ENTRY_END_CHAR_AS_STRING,
+					&dict);
+
+	reply = get_properties(connection, path, iface);
+	if (reply != NULL) {
+		DBusMessageIter iter, props;
+
+		dbus_message_iter_init(reply, &iter);
+		dbus_message_iter_recurse(&iter, &props);
+		copy_iter(&props, &dict);
+
+		dbus_message_unref(reply);
+	}
+
+	dbus_message_iter_close_container(&entry, &dict);
+	dbus_message_iter_close_container(array, &entry);
+}
+
+gboolean g_dbus_append_interface(DBusConnection *connection,
+					const char *path, const char *name,
+					DBusMessageIter *array)
+{
+	struct generic_data *data = NULL;
+	struct interface_data *iface;
+
+	if (dbus_connection_get_object_path_data(connection, path,
+						(void *) &data) == FALSE)
+		return FALSE;
+
+	if (data == NULL)
+		return FALSE;
+
+	iface = find_interface(data->interfaces, name);
+	if (iface == NULL)
+		return FALSE;
+
+	append_interface(connection, path, iface, array);
+
+	return TRUE;
+}
+
+static void append_object(DBusConnection *connection, const char *path,
+				struct generic_data *data,
+				DBusMessageIter *array)
+{
+	DBusMessageIter entry, dict;
+	GSList *list;
+
+	dbus_message_iter_open_container(array, DBUS_TYPE_DICT_ENTRY,
+							NULL, &entry);
+	dbus_message_iter_append_basic(&entry, DBUS_TYPE_OBJECT_PATH, &path);
+	dbus_message_iter_open_container(&entry, DBUS_TYPE_ARRAY,
+					DBUS_DICT_ENTRY_BEGIN_CHAR_AS_STRING
+					DBUS_TYPE_STRING_AS_STRING
+					DBUS_TYPE_ARRAY_AS_STRING
+					DBUS_DICT_ENTRY_BEGIN_CHAR_AS_STRING
+					DBUS_TYPE_STRING_AS_STRING
+					DBUS_TYPE_VARIANT_AS_STRING
+					DBUS_DICT_ENTRY_END_CHAR_AS_STRING
+					DBUS_DICT_ENTRY_END_CHAR_AS_STRING,
+					&dict);
+
+	for (list = data->interfaces; list; list = list->next) {
+		struct interface_data *iface = list->data;
+
+		if (strcmp(iface->name, DBUS_INTERFACE_INTROSPECTABLE) == 0)
+			continue;
+
+		append_interface(connection, path, iface, &dict);
+	}
+
+	dbus_message_iter_close_container(&entry, &dict);
+	dbus_message_iter_close_container(array, &entry);
+}
+
+void g_dbus_append_objects(DBusConnection *connection, const char *path,
+						DBusMessageIter *array)
+{
+	char **children;
+	int i;
+
+	if (!dbus_connection_list_registered(connection, path, &children))
+		return;
+
+	for (i = 0; children[i]; i++) {
+		struct generic_data *data = NULL;
+		char *child;
+
+		if (strcmp(path, "/") == 0)
+			child = g_strdup_printf("/%s", children[i]);
+		else
+			child = g_strdup_printf("%s/%s", path, children[i]);
+
+		if (dbus_connection_get_object_path_data(connection, child,
+						(void *) &data) && data)
+			append_object(connection, child, data, array);
+
+		g_dbus_append_objects(connection, child, array);
+
+		g_free(child);
+	}
+
+	dbus_free_string_array(children);
+}
+
 gboolean g_dbus_register_interface(DBusConnection *connection,
 					const char *path, const char *name,
 					const GDBusMethodTable *methods,
@@ -694,6 +905,10 @@ gboolean g_dbus_register_interface(DBusConnection *connection,
 	g_free(data->introspect);
 	data->introspect = NULL;
 
+	if (interface_function)
+		interface_function(connection, path, name, TRUE,
+						interface_user_data);
+
 	return TRUE;
 }
 
@@ -720,6 +935,10 @@ gboolean g_dbus_unregister_interface(DBusConnection *connection,
 
 	object_path_unref(connection, path);
 
+	if (interface_function)
+		interface_function(connection, path, name, FALSE,
+						interface_user_data);
+
 	return TRUE;
 }
 
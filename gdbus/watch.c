@@ -41,7 +41,43 @@ static DBusHandlerResult message_filter(DBusConnection *connection,
 					DBusMessage *message, void *user_data);
 
 static guint listener_id = 0;
-static GSList *listeners = NULL;
+static GList *listeners = NULL;
+
+/* Which match fields a filter is restricted on */
+#define FILTER_PATH		(1 << 0)
+#define FILTER_INTERFACE	(1 << 1)
+#define FILTER_MEMBER		(1 << 2)
+#define FILTER_ARGUMENT		(1 << 3)
+#define FILTER_MASKS		(1 << 4)
+
+struct filter_key {
+	DBusConnection *connection;
+	char *path;
+	char *interface;
+	char *member;
+	char *argument;
+};
+
+/* All filters with the same match fields, differing only in sender */
+struct filter_bucket {
+	struct filter_key key;
+	GSList *filters;
+};
+
+/*
+ * Filters are indexed by their match fields, so that dispatching a
+ * signal is a few hash lookups, one for each combination of fields
+ * in use, no matter how many watches there are.
+ */
+static GHashTable *filter_index = NULL;
+static guint mask_count[FILTER_MASKS];
+static guint filter_serial = 0;
+
+/* Filters by well-known sender name, for the name owner cache */
+static GHashTable *name_index = NULL;
+
+/* Filters by the ids of their callbacks */
+static GHashTable *callback_index = NULL;
 
 struct service_data {
 	DBusConnection *conn;
@@ -76,8 +112,192 @@ struct filter_data {
 	guint name_watch;
 	gboolean lock;
 	gboolean registered;
+	guint serial;
+	unsigned int mask;
+	struct filter_bucket *bucket;
+	GList *link;
 };
 
+static guint filter_key_hash(gconstpointer p)
+{
+	const struct filter_key *key = p;
+	guint h = g_direct_hash(key->connection);
+
+	if (key->path)
+		h = h * 31 + g_str_hash(key->path);
+	if (key->interface)
+		h = h * 31 + g_str_hash(key->interface);
+	if (key->member)
+		h = h * 31 + g_str_hash(key->member);
+	if (key->argument)
+		h = h * 31 + g_str_hash(key->argument);
+
+	return h;
+}
+
+static gboolean filter_key_equal(gconstpointer a, gconstpointer b)
+{
+	const struct filter_key *k1 = a;
+	const struct filter_key *k2 = b;
+
+	return k1->connection == k2->connection &&
+		g_strcmp0(k1->path, k2->path) == 0 &&
+		g_strcmp0(k1->interface, k2->interface) == 0 &&
+		g_strcmp0(k1->member, k2->member) == 0 &&
+		g_strcmp0(k1->argument, k2->argument) == 0;
+}
+
+static void filter_bucket_free(gpointer user_data)
+{
+	struct filter_bucket *bucket = user_data;
+
+	g_free(bucket->key.path);
+	g_free(bucket->key.interface);
+	g_free(bucket->key.member);
+	g_free(bucket->key.argument);
+	g_slist_free(bucket->filters);
+	g_free(bucket);
+}
+
+static unsigned int filter_key_init(struct filter_key *key,
+					DBusConnection *connection,
+					const char *path,
+					const char *interface,
+					const char *member,
+					const char *argument)
+{
+	unsigned int mask = 0;
+
+	key->connection = connection;
+	key->path = (char *) path;
+	key->interface = (char *) interface;
+	key->member = (char *) member;
+	key->argument = (char *) argument;
+
+	if (path)
+		mask |= FILTER_PATH;
+	if (interface)
+		mask |= FILTER_INTERFACE;
+	if (member)
+		mask |= FILTER_MEMBER;
+	if (argument)
+		mask |= FILTER_ARGUMENT;
+
+	return mask;
+}
+
+static gboolean connection_has_listeners(DBusConnection *connection)
+{
+	GList *l;
+
+	for (l = listeners; l != NULL; l = l->next) {
+		struct filter_data *data = l->data;
+
+		if (data->connection == connection)
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
+static void name_index_add(struct filter_data *data)
+{
+	GSList *list;
+
+	if (data->name == NULL)
+		return;
+
+	list = g_hash_table_lookup(name_index, data->name);
+	list = g_slist_append(list, data);
+	g_hash_table_replace(name_index, g_strdup(data->name), list);
+}
+
+static void name_index_remove(struct filter_data *data)
+{
+	GSList *list;
+
+	if (data->name == NULL)
+		return;
+
+	list = g_hash_table_lookup(name_index, data->name);
+	list = g_slist_remove(list, data);
+
+	if (list == NULL)
+		g_hash_table_remove(name_index, data->name);
+	else
+		g_hash_table_replace(name_index, g_strdup(data->name), list);
+}
+
+static void filter_data_link(struct filter_data *data)
+{
+	struct filter_bucket *bucket;
+	struct filter_key key;
+
+	if (filter_index == NULL) {
+		filter_index = g_hash_table_new_full(filter_key_hash,
+							filter_key_equal,
+							NULL,
+							filter_bucket_free);
+		name_index = g_hash_table_new_full(g_str_hash, g_str_equal,
+							g_free, NULL);
+		callback_index = g_hash_table_new(g_direct_hash,
+							g_direct_equal);
+	}
+
+	data->mask = filter_key_init(&key, data->connection, data->path,
+					data->interface, data->member,
+					data->argument);
+
+	bucket = g_hash_table_lookup(filter_index, &key);
+	if (bucket == NULL) {
+		bucket = g_new0(struct filter_bucket, 1);
+		bucket->key.connection = data->connection;
+		bucket->key.path = g_strdup(data->path);
+		bucket->key.interface = g_strdup(data->interface);
+		bucket->key.member = g_strdup(data->member);
+		bucket->key.argument = g_strdup(data->argument);
+
+		g_hash_table_insert(filter_index, &bucket->key, bucket);
+	}
+
+	data->serial = ++filter_serial;
+	data->bucket = bucket;
+	bucket->filters = g_slist_append(bucket->filters, data);
+	mask_count[data->mask] += 1;
+
+	name_index_add(data);
+
+	data->link = listeners = g_list_prepend(listeners, data);
+}
+
+static void filter_data_unlink(struct filter_data *data)
+{
+	struct filter_bucket *bucket = data->bucket;
+	GSList *l;
+
+	for (l = data->callbacks; l; l = l->next) {
+		struct filter_callback *cb = l->data;
+		g_hash_table_remove(callback_index, GUINT_TO_POINTER(cb->id));
+	}
+	for (l = data->processed; l; l = l->next) {
+		struct filter_callback *cb = l->data;
+		g_hash_table_remove(callback_index, GUINT_TO_POINTER(cb->id));
+	}
+
+	name_index_remove(data);
+
+	mask_count[data->mask] -= 1;
+	bucket->filters = g_slist_remove(bucket->filters, data);
+	if (bucket->filters == NULL)
+		g_hash_table_remove(filter_index, &bucket->key);
+
+	data->bucket = NULL;
+
+	listeners = g_list_delete_link(listeners, data->link);
+	data->link = NULL;
+}
+
+/* Finds the filter registered for exactly these match fields */
 static struct filter_data *filter_data_find(DBusConnection *connection,
 							const char *name,
 							const char *owner,
@@ -86,43 +306,88 @@ static struct filter_data *filter_data_find(DBusConnection *connection,
 							const char *member,
 							const char *argument)
 {
-	GSList *current;
+	struct filter_bucket *bucket;
+	struct filter_key key;
+	GSList *l;
 
-	for (current = listeners;
-			current != NULL; current = current->next) {
-		struct filter_data *data = current->data;
+	if (filter_index == NULL)
+		return NULL;
 
-		if (connection != data->connection)
-			continue;
+	filter_key_init(&key, connection, path, interface, member, argument);
 
-		if (name && data->name &&
-				g_str_equal(name, data->name) == FALSE)
-			continue;
+	bucket = g_hash_table_lookup(filter_index, &key);
+	if (bucket == NULL)
+		return NULL;
+
+	for (l = bucket->filters; l; l = l->next) {
+		struct filter_data *data = l->data;
 
-		if (owner && data->owner &&
-				g_str_equal(owner, data->owner) == FALSE)
+		if (g_strcmp0(name, data->name) != 0)
 			continue;
 
-		if (path && data->path &&
-				g_str_equal(path, data->path) == FALSE)
+		if (name == NULL && g_strcmp0(owner, data->owner) != 0)
 			continue;
 
-		if (interface && data->interface &&
-				g_str_equal(interface, data->interface) == FALSE)
+		return data;
+	}
+
+	return NULL;
+}
+
+/*
+ * Finds the earliest registered filter a signal matches.  Fields the
+ * filter is not restricted on match anything, so every combination of
+ * fields some filter uses is looked up.
+ */
+static struct filter_data *filter_data_match(DBusConnection *connection,
+							const char *sender,
+							const char *path,
+							const char *interface,
+							const char *member,
+							const char *argument)
+{
+	struct filter_data *match = NULL;
+	unsigned int mask;
+
+	if (filter_index == NULL)
+		return NULL;
+
+	for (mask = 0; mask < FILTER_MASKS; mask++) {
+		struct filter_bucket *bucket;
+		struct filter_key key;
+		GSList *l;
+
+		if (mask_count[mask] == 0)
 			continue;
 
-		if (member && data->member &&
-				g_str_equal(member, data->member) == FALSE)
+		/* A filter on a field the signal lacks can not match */
+		if (filter_key_init(&key, connection,
+				mask & FILTER_PATH ? path : NULL,
+				mask & FILTER_INTERFACE ? interface : NULL,
+				mask & FILTER_MEMBER ? member : NULL,
+				mask & FILTER_ARGUMENT ? argument : NULL) !=
+									mask)
 			continue;
 
-		if (argument && data->argument &&
-				g_str_equal(argument, data->argument) == FALSE)
+		bucket = g_hash_table_lookup(filter_index, &key);
+		if (bucket == NULL)
 			continue;
 
-		return data;
+		for (l = bucket->filters; l; l = l->next) {
+			struct filter_data *data = l->data;
+
+			if (sender && data->owner &&
+				g_str_equal(sender, data->owner) == FALSE)
+				continue;
+
+			if (match == NULL || data->serial < match->serial)
+				match = data;
+
+			break;
+		}
 	}
 
-	return NULL;
+	return match;
 }
 
 static void format_rule(struct filter_data *data, char *rule, size_t size)
@@ -204,8 +469,7 @@ static struct filter_data *filter_data_get(DBusConnection *connection,
 	struct filter_data *data;
 	const char *name = NULL, *owner = NULL;
 
-	if (!filter_data_find(connection, NULL, NULL, NULL, NULL, NULL,
-				NULL)) {
+	if (!connection_has_listeners(connection)) {
 		if (!dbus_connection_add_filter(connection,
 					message_filter, NULL, NULL)) {
 			error("dbus_connection_add_filter() failed");
@@ -242,7 +506,7 @@ proceed:
 		return NULL;
 	}
 
-	listeners = g_slist_append(listeners, data);
+	filter_data_link(data);
 
 	return data;
 }
@@ -299,6 +563,9 @@ static void filter_data_call_and_free(struct filter_data *data)
 		g_free(cb);
 	}
 
+	g_slist_free(data->callbacks);
+	data->callbacks = NULL;
+
 	filter_data_free(data);
 }
 
@@ -321,6 +588,8 @@ static struct filter_callback *filter_data_add_callback(
 	cb->user_data = user_data;
 	cb->id = ++listener_id;
 
+	g_hash_table_insert(callback_index, GUINT_TO_POINTER(cb->id), data);
+
 	if (data->lock)
 		data->processed = g_slist_append(data->processed, cb);
 	else
@@ -355,6 +624,8 @@ static gboolean filter_data_remove_callback(struct filter_data *data,
 	data->callbacks = g_slist_remove(data->callbacks, cb);
 	data->processed = g_slist_remove(data->processed, cb);
 
+	g_hash_table_remove(callback_index, GUINT_TO_POINTER(cb->id));
+
 	/* Cancel pending operations */
 	if (cb->data) {
 		if (cb->data->call)
@@ -376,13 +647,11 @@ static gboolean filter_data_remove_callback(struct filter_data *data,
 		return FALSE;
 
 	connection = dbus_connection_ref(data->connection);
-	listeners = g_slist_remove(listeners, data);
+	filter_data_unlink(data);
 	filter_data_free(data);
 
 	/* Remove filter if there are no listeners left for the connection */
-	data = filter_data_find(connection, NULL, NULL, NULL, NULL, NULL,
-					NULL);
-	if (!data)
+	if (!connection_has_listeners(connection))
 		dbus_connection_remove_filter(connection, message_filter,
 						NULL);
 
@@ -422,11 +691,13 @@ static void update_name_cache(const char *name, const char *owner)
 {
 	GSList *l;
 
-	for (l = listeners; l != NULL; l = l->next) {
-		struct filter_data *data = l->data;
+	if (name_index == NULL || name == NULL)
+		return;
 
-		if (g_strcmp0(data->name, name) != 0)
-			continue;
+	l = g_hash_table_lookup(name_index, name);
+
+	for (; l != NULL; l = l->next) {
+		struct filter_data *data = l->data;
 
 		g_free(data->owner);
 		data->owner = g_strdup(owner);
@@ -437,16 +708,14 @@ static const char *check_name_cache(const char *name)
 {
 	GSList *l;
 
-	for (l = listeners; l != NULL; l = l->next) {
-		struct filter_data *data = l->data;
-
-		if (g_strcmp0(data->name, name) != 0)
-			continue;
+	if (name_index == NULL || name == NULL)
+		return NULL;
 
-		return data->owner;
-	}
+	l = g_hash_table_lookup(name_index, name);
+	if (l == NULL)
+		return NULL;
 
-	return NULL;
+	return ((struct filter_data *) l->data)->owner;
 }
 
 static DBusHandlerResult service_filter(DBusConnection *connection,
@@ -515,8 +784,7 @@ static DBusHandlerResult message_filter(DBusConnection *connection,
 	dbus_message_get_args(message, NULL, DBUS_TYPE_STRING, &arg, DBUS_TYPE_INVALID);
 
 	/* Sender is always bus name */
-	data = filter_data_find(connection, NULL, sender, path, iface, member,
-					arg);
+	data = filter_data_match(connection, sender, path, iface, member, arg);
 	if (!data) {
 		error("Got %s.%s signal which has no listeners", iface, member);
 		return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
@@ -537,13 +805,11 @@ static DBusHandlerResult message_filter(DBusConnection *connection,
 
 	remove_match(data);
 
-	listeners = g_slist_remove(listeners, data);
+	filter_data_unlink(data);
 	filter_data_free(data);
 
 	/* Remove filter if there no listener left for the connection */
-	data = filter_data_find(connection, NULL, NULL, NULL, NULL, NULL,
-					NULL);
-	if (!data)
+	if (!connection_has_listeners(connection))
 		dbus_connection_remove_filter(connection, message_filter,
 						NULL);
 
@@ -717,32 +983,40 @@ gboolean g_dbus_remove_watch(DBusConnection *connection, guint id)
 {
 	struct filter_data *data;
 	struct filter_callback *cb;
-	GSList *ldata;
 
-	if (id == 0)
+	if (id == 0 || callback_index == NULL)
 		return FALSE;
 
-	for (ldata = listeners; ldata; ldata = ldata->next) {
-		data = ldata->data;
+	data = g_hash_table_lookup(callback_index, GUINT_TO_POINTER(id));
+	if (data == NULL)
+		return FALSE;
 
-		cb = filter_data_find_callback(data, id);
-		if (cb) {
-			filter_data_remove_callback(data, cb);
-			return TRUE;
-		}
-	}
+	cb = filter_data_find_callback(data, id);
+	if (cb == NULL)
+		return FALSE;
 
-	return FALSE;
+	filter_data_remove_callback(data, cb);
+
+	return TRUE;
 }
 
 void g_dbus_remove_all_watches(DBusConnection *connection)
 {
-	struct filter_data *data;
+	GList *l = listeners;
+
+	while (l != NULL) {
+		struct filter_data *data = l->data;
 
-	while ((data = filter_data_find(connection, NULL, NULL, NULL, NULL,
-					NULL, NULL))) {
-		listeners = g_slist_remove(listeners, data);
+		if (data->connection != connection) {
+			l = l->next;
+			continue;
+		}
+
+		filter_data_unlink(data);
 		filter_data_call_and_free(data);
+
+		/* Callbacks may have removed other filters */
+		l = listeners;
 	}
 
 	dbus_connection_remove_filter(connection, message_filter, NULL);
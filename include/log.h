@@ -22,6 +22,8 @@
 #ifndef __OFONO_LOG_H
 #define __OFONO_LOG_H
 
+#include <stdio.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -67,6 +69,29 @@ struct ofono_debug_desc {
 					__FILE__, __FUNCTION__ , ## arg); \
 } while (0)
 
+enum ofono_trace_event {
+	OFONO_TRACE_AT_COMMAND = 1,
+	OFONO_TRACE_AT_RESPONSE,
+	OFONO_TRACE_AT_NOTIFY,
+	OFONO_TRACE_ATOM_REGISTER,
+	OFONO_TRACE_ATOM_UNREGISTER,
+	OFONO_TRACE_MODEM_MILESTONE,
+};
+
+/*
+ * Records an event in a fixed size in memory ring, which is written out
+ * together with the output of all dump functions on SIGUSR1.  Unlike
+ * DBG() this is always enabled, so it must stay cheap: no formatting is
+ * done and the tag is truncated to a few characters.
+ */
+void ofono_trace(enum ofono_trace_event event, unsigned int id,
+			unsigned int value, const char *tag);
+
+typedef void (*ofono_trace_dump_func)(FILE *out, void *user_data);
+
+void ofono_trace_dump_register(ofono_trace_dump_func func, void *user_data);
+void ofono_trace_dump_unregister(ofono_trace_dump_func func);
+
 #ifdef __cplusplus
 }
 #endif
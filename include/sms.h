@@ -51,6 +51,11 @@ struct ofono_sms_driver {
 	void (*sca_set)(struct ofono_sms *sms,
 			const struct ofono_phone_number *sca,
 			ofono_sms_sca_set_cb_t cb, void *data);
+	/*
+	 * mms tells whether more PDUs follow, as for AT+CMMS: 0 if this
+	 * is the last one queued, 1 if the rest of the same concatenated
+	 * message follows, 2 if other messages are queued behind it too.
+	 */
 	void (*submit)(struct ofono_sms *sms, unsigned char *pdu,
 			int pdu_len, int tpdu_len, int mms,
 			ofono_sms_submit_cb_t cb, void *data);
@@ -78,6 +83,13 @@ void ofono_sms_remove(struct ofono_sms *sms);
 void ofono_sms_set_data(struct ofono_sms *sms, void *data);
 void *ofono_sms_get_data(struct ofono_sms *sms);
 
+/*
+ * Lets the driver be handed up to count PDUs before the first one is
+ * confirmed.  The default is 1, a submit only starts once the previous
+ * one has returned.
+ */
+void ofono_sms_set_max_in_flight(struct ofono_sms *sms, unsigned int count);
+
 #ifdef __cplusplus
 }
 #endif
@@ -142,6 +142,25 @@ static int atgen_enable(struct ofono_modem *modem)
 	if (getenv("OFONO_AT_DEBUG"))
 		g_at_chat_set_debug(chat, atgen_debug, NULL);
 
+	value = getenv("OFONO_AT_CAPTURE");
+	if (value) {
+		char *filename;
+		GAtCapture *capture;
+
+		/* One file per modem, named after its object path */
+		filename = g_strconcat(value, ".",
+					ofono_modem_get_path(modem) + 1, NULL);
+		capture = g_at_capture_new(filename);
+
+		if (capture == NULL)
+			ofono_error("Unable to open capture %s", filename);
+
+		g_at_io_set_capture(g_at_chat_get_io(chat), capture,
+					G_AT_CAPTURE_CHANNEL_RAW);
+		g_at_capture_unref(capture);
+		g_free(filename);
+	}
+
 	ofono_modem_set_data(modem, chat);
 
 	return 0;
@@ -128,6 +128,34 @@ static int set_interface(struct ofono_modem *modem,
 	return 0;
 }
 
+static const char *netreg_opts[] = {
+	"StrengthMinDelta",
+	"StrengthMinInterval",
+	"StrengthAverage",
+	NULL,
+};
+
+static void set_netreg_policy(struct ofono_modem *modem,
+					GKeyFile *keyfile, const char *group)
+{
+	GError *err = NULL;
+	int value;
+	int i;
+
+	for (i = 0; netreg_opts[i]; i++) {
+		value = g_key_file_get_integer(keyfile, group,
+						netreg_opts[i], &err);
+
+		if (err) {
+			g_error_free(err);
+			err = NULL;
+			continue;
+		}
+
+		ofono_modem_set_integer(modem, netreg_opts[i], value);
+	}
+}
+
 static struct {
 	const char *driver;
 	int (*func) (struct ofono_modem *modem,
@@ -165,6 +193,8 @@ static struct ofono_modem *create_modem(GKeyFile *keyfile, const char *group)
 			setup_helpers[i].func(modem, keyfile, group);
 	}
 
+	set_netreg_policy(modem, keyfile, group);
+
 error:
 	g_free(driver);
 
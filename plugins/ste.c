@@ -64,6 +64,8 @@
 #include <drivers/stemodem/caif_socket.h>
 #include <drivers/stemodem/if_caif.h>
 
+#define NUM_GPRS_CONTEXTS 4
+
 static const char *cpin_prefix[] = { "+CPIN:", NULL };
 
 struct ste_data {
@@ -339,6 +341,7 @@ static void ste_post_online(struct ofono_modem *modem)
 	struct ofono_message_waiting *mw;
 	struct ofono_gprs *gprs;
 	struct ofono_gprs_context *gc;
+	int i;
 
 	DBG("%p", modem);
 
@@ -355,10 +358,16 @@ static void ste_post_online(struct ofono_modem *modem)
 
 	gprs = ofono_gprs_create(modem, OFONO_VENDOR_MBM,
 					"atmodem", data->chat);
-	gc = ofono_gprs_context_create(modem, 0, "stemodem", data->chat);
 
-	if (gprs && gc)
+	/* Each context runs over a CAIF interface of its own */
+	for (i = 0; gprs && i < NUM_GPRS_CONTEXTS; i++) {
+		gc = ofono_gprs_context_create(modem, 0, "stemodem",
+						data->chat);
+		if (gc == NULL)
+			break;
+
 		ofono_gprs_add_context(gprs, gc);
+	}
 
 	mw = ofono_message_waiting_create(modem);
 
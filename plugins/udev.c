@@ -36,56 +36,88 @@
 #include <ofono/modem.h>
 #include <ofono/log.h>
 
-static GSList *modem_list = NULL;
+/*
+ * A modem shows up as a burst of add events, one per interface.  It is
+ * only registered once no event for it came in for this many ms, so the
+ * driver sees all of its interfaces at once.
+ */
+#define MODEM_SETTLE_TIMEOUT 250
+
+struct modem_info {
+	char *devpath;
+	struct ofono_modem *modem;
+	GSList *devices;		/* Paths of the interfaces seen */
+	guint settle_source;
+	gboolean ready;
+	gboolean registered;
+};
+
+/* Modems by the devpath of their device, and by those of interfaces */
+static GHashTable *modem_list = NULL;
 static GHashTable *devpath_list = NULL;
 
-static struct ofono_modem *find_modem(const char *devpath)
+static void modem_info_free(gpointer data)
 {
-	GSList *list;
+	struct modem_info *info = data;
 
-	for (list = modem_list; list; list = list->next) {
-		struct ofono_modem *modem = list->data;
-		const char *path = ofono_modem_get_string(modem, "Path");
+	if (info->settle_source > 0)
+		g_source_remove(info->settle_source);
 
-		if (g_strcmp0(devpath, path) == 0)
-			return modem;
-	}
+	ofono_modem_remove(info->modem);
+
+	g_slist_foreach(info->devices, (GFunc) g_free, NULL);
+	g_slist_free(info->devices);
 
-	return NULL;
+	g_free(info->devpath);
+	g_free(info);
 }
 
-static const char *get_driver(struct udev_device *udev_device)
+static gboolean modem_settled(gpointer user_data)
 {
-	struct udev_list_entry *entry;
-	const char *driver = NULL;
+	struct modem_info *info = user_data;
 
-	entry = udev_device_get_properties_list_entry(udev_device);
-	while (entry) {
-		const char *name = udev_list_entry_get_name(entry);
+	info->settle_source = 0;
 
-		if (g_strcmp0(name, "OFONO_DRIVER") == 0)
-			driver = udev_list_entry_get_value(entry);
+	if (info->ready == FALSE || info->registered == TRUE)
+		return FALSE;
 
-		entry = udev_list_entry_get_next(entry);
-	}
+	DBG("%s", info->devpath);
+
+	info->registered = TRUE;
+
+	/* From now on the drivers below leave the modem alone */
+	ofono_modem_set_integer(info->modem, "Registered", 1);
+
+	if (ofono_modem_register(info->modem) < 0)
+		ofono_error("Failed to register modem %s", info->devpath);
 
-	return driver;
+	return FALSE;
 }
 
-static const char *get_serial(struct udev_device *udev_device)
+/* Called by the drivers below once all the needed interfaces are in */
+static void modem_ready(struct ofono_modem *modem)
 {
-	struct udev_list_entry *entry;
-	const char *serial = NULL;
+	const char *devpath = ofono_modem_get_string(modem, "Path");
+	struct modem_info *info;
 
-	entry = udev_device_get_properties_list_entry(udev_device);
-	while (entry) {
-		const char *name = udev_list_entry_get_name(entry);
+	info = g_hash_table_lookup(modem_list, devpath);
+	if (info == NULL)
+		return;
 
-		if (g_strcmp0(name, "ID_SERIAL_SHORT") == 0)
-			serial = udev_list_entry_get_value(entry);
+	info->ready = TRUE;
+}
 
-		entry = udev_list_entry_get_next(entry);
-	}
+static const char *get_driver(struct udev_device *udev_device)
+{
+	return udev_device_get_property_value(udev_device, "OFONO_DRIVER");
+}
+
+static const char *get_serial(struct udev_device *udev_device)
+{
+	const char *serial;
+
+	serial = udev_device_get_property_value(udev_device,
+							"ID_SERIAL_SHORT");
 
 	if (serial != NULL) {
 		unsigned int i, len = strlen(serial);
@@ -158,8 +190,7 @@ static void add_mbm(struct ofono_modem *modem,
 	network = ofono_modem_get_string(modem, NETWORK_INTERFACE);
 
 	if (device != NULL && data != NULL && network != NULL) {
-		ofono_modem_set_integer(modem, "Registered", 1);
-		ofono_modem_register(modem);
+		modem_ready(modem);
 	}
 }
 
@@ -205,8 +236,7 @@ static void add_hso(struct ofono_modem *modem,
 	network = ofono_modem_get_string(modem, NETWORK_INTERFACE);
 
 	if (app != NULL && control != NULL && network != NULL) {
-		ofono_modem_set_integer(modem, "Registered", 1);
-		ofono_modem_register(modem);
+		modem_ready(modem);
 	}
 }
 
@@ -259,7 +289,7 @@ static void add_zte(struct ofono_modem *modem,
 	}
 
 	if (ppp && aux)
-		ofono_modem_register(modem);
+		modem_ready(modem);
 }
 
 static void add_huawei(struct ofono_modem *modem,
@@ -329,7 +359,7 @@ static void add_huawei(struct ofono_modem *modem,
 	}
 
 	if (ppp && pcui)
-		ofono_modem_register(modem);
+		modem_ready(modem);
 }
 
 static void add_novatel(struct ofono_modem *modem,
@@ -358,8 +388,7 @@ static void add_novatel(struct ofono_modem *modem,
 		devnode = udev_device_get_devnode(udev_device);
 		ofono_modem_set_string(modem, "SecondaryDevice", devnode);
 
-		ofono_modem_set_integer(modem, "Registered", 1);
-		ofono_modem_register(modem);
+		modem_ready(modem);
 	}
 }
 
@@ -388,40 +417,41 @@ static void add_nokia(struct ofono_modem *modem,
 		devnode = udev_device_get_devnode(udev_device);
 		ofono_modem_set_string(modem, "Control", devnode);
 
-		ofono_modem_set_integer(modem, "Registered", 1);
-		ofono_modem_register(modem);
+		modem_ready(modem);
 	}
 }
 
 static void add_modem(struct udev_device *udev_device)
 {
-	struct ofono_modem *modem;
+	struct modem_info *info;
 	struct udev_device *parent;
-	const char *devpath, *curpath, *driver;
+	const char *devpath, *curpath, *driver = NULL;
+	int i;
 
 	parent = udev_device_get_parent(udev_device);
 	if (parent == NULL)
 		return;
 
-	driver = get_driver(parent);
-	if (driver == NULL) {
-		parent = udev_device_get_parent(parent);
+	/* The driver is set on one of the three closest ancestors */
+	for (i = 0; i < 3 && parent != NULL; i++) {
 		driver = get_driver(parent);
-		if (driver == NULL) {
-			parent = udev_device_get_parent(parent);
-			driver = get_driver(parent);
-			if (driver == NULL)
-				return;
-		}
+		if (driver != NULL)
+			break;
+
+		parent = udev_device_get_parent(parent);
 	}
 
+	if (parent == NULL || driver == NULL)
+		return;
+
 	devpath = udev_device_get_devpath(parent);
 	if (devpath == NULL)
 		return;
 
-	modem = find_modem(devpath);
-	if (modem == NULL) {
+	info = g_hash_table_lookup(modem_list, devpath);
+	if (info == NULL) {
 		const char *serial = get_serial(parent);
+		struct ofono_modem *modem;
 
 		modem = ofono_modem_create(serial, driver);
 		if (modem == NULL)
@@ -430,7 +460,11 @@ static void add_modem(struct udev_device *udev_device)
 		ofono_modem_set_string(modem, "Path", devpath);
 		ofono_modem_set_integer(modem, "Registered", 0);
 
-		modem_list = g_slist_prepend(modem_list, modem);
+		info = g_new0(struct modem_info, 1);
+		info->devpath = g_strdup(devpath);
+		info->modem = modem;
+
+		g_hash_table_insert(modem_list, info->devpath, info);
 	}
 
 	curpath = udev_device_get_devpath(udev_device);
@@ -439,58 +473,56 @@ static void add_modem(struct udev_device *udev_device)
 
 	DBG("%s (%s)", curpath, driver);
 
-	g_hash_table_insert(devpath_list, g_strdup(curpath), g_strdup(devpath));
+	if (g_hash_table_lookup(devpath_list, curpath) == NULL) {
+		char *path = g_strdup(curpath);
+
+		info->devices = g_slist_prepend(info->devices, path);
+		g_hash_table_insert(devpath_list, g_strdup(path), info);
+	}
 
 	if (g_strcmp0(driver, "mbm") == 0)
-		add_mbm(modem, udev_device);
+		add_mbm(info->modem, udev_device);
 	else if (g_strcmp0(driver, "hso") == 0)
-		add_hso(modem, udev_device);
+		add_hso(info->modem, udev_device);
 	else if (g_strcmp0(driver, "zte") == 0)
-		add_zte(modem, udev_device);
+		add_zte(info->modem, udev_device);
 	else if (g_strcmp0(driver, "huawei") == 0)
-		add_huawei(modem, udev_device);
+		add_huawei(info->modem, udev_device);
 	else if (g_strcmp0(driver, "novatel") == 0)
-		add_novatel(modem, udev_device);
+		add_novatel(info->modem, udev_device);
 	else if (g_strcmp0(driver, "nokia") == 0)
-		add_nokia(modem, udev_device);
-}
+		add_nokia(info->modem, udev_device);
 
-static gboolean devpath_remove(gpointer key, gpointer value, gpointer user_data)
-{
-	const char *path = value;
-	const char *devpath = user_data;
+	if (info->registered == TRUE)
+		return;
 
-	return g_str_equal(path, devpath);
+	/* Another interface came in, wait for the rest of the burst */
+	if (info->settle_source > 0)
+		g_source_remove(info->settle_source);
+
+	info->settle_source = g_timeout_add(MODEM_SETTLE_TIMEOUT,
+						modem_settled, info);
 }
 
 static void remove_modem(struct udev_device *udev_device)
 {
-	struct ofono_modem *modem;
+	struct modem_info *info;
 	const char *curpath = udev_device_get_devpath(udev_device);
-	char *devpath, *remove;
+	GSList *list;
 
 	if (curpath == NULL)
 		return;
 
 	DBG("%s", curpath);
 
-	devpath = g_hash_table_lookup(devpath_list, curpath);
-	if (!devpath)
-		return;
-
-	modem = find_modem(devpath);
-	if (modem == NULL)
+	info = g_hash_table_lookup(devpath_list, curpath);
+	if (info == NULL)
 		return;
 
-	modem_list = g_slist_remove(modem_list, modem);
-
-	ofono_modem_remove(modem);
+	for (list = info->devices; list; list = list->next)
+		g_hash_table_remove(devpath_list, list->data);
 
-	remove = g_strdup(devpath);
-
-	g_hash_table_foreach_remove(devpath_list, devpath_remove, remove);
-
-	g_free(remove);
+	g_hash_table_remove(modem_list, info->devpath);
 }
 
 static void enumerate_devices(struct udev *context)
@@ -595,8 +627,11 @@ static void udev_start(void)
 
 static int udev_init(void)
 {
+	modem_list = g_hash_table_new_full(g_str_hash, g_str_equal,
+						NULL, modem_info_free);
+
 	devpath_list = g_hash_table_new_full(g_str_hash, g_str_equal,
-						g_free, g_free);
+						g_free, NULL);
 	if (!devpath_list) {
 		ofono_error("Failed to create udev path list");
 		return -ENOMEM;
@@ -606,6 +641,7 @@ static int udev_init(void)
 	if (udev_ctx == NULL) {
 		ofono_error("Failed to create udev context");
 		g_hash_table_destroy(devpath_list);
+		g_hash_table_destroy(modem_list);
 		return -EIO;
 	}
 
@@ -613,6 +649,7 @@ static int udev_init(void)
 	if (udev_mon == NULL) {
 		ofono_error("Failed to create udev monitor");
 		g_hash_table_destroy(devpath_list);
+		g_hash_table_destroy(modem_list);
 		udev_unref(udev_ctx);
 		udev_ctx = NULL;
 		return -EIO;
@@ -630,23 +667,15 @@ static int udev_init(void)
 
 static void udev_exit(void)
 {
-	GSList *list;
-
 	if (udev_watch > 0)
 		g_source_remove(udev_watch);
 
-	for (list = modem_list; list; list = list->next) {
-		struct ofono_modem *modem = list->data;
-
-		ofono_modem_remove(modem);
-	}
-
-	g_slist_free(modem_list);
-	modem_list = NULL;
-
 	g_hash_table_destroy(devpath_list);
 	devpath_list = NULL;
 
+	g_hash_table_destroy(modem_list);
+	modem_list = NULL;
+
 	if (udev_ctx == NULL)
 		return;
 
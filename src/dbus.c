@@ -23,6 +23,7 @@
 #include <config.h>
 #endif
 
+#include <stdio.h>
 #include <glib.h>
 #include <gdbus.h>
 
@@ -245,6 +246,281 @@ int ofono_dbus_signal_dict_property_changed(DBusConnection *conn,
 	return g_dbus_send_message(conn, signal);
 }
 
+union batch_value {
+	dbus_bool_t b;
+	unsigned char y;
+	dbus_int16_t n;
+	dbus_uint16_t q;
+	dbus_int32_t i;
+	dbus_uint32_t u;
+	char *s;
+};
+
+struct batch_property {
+	char *name;
+	int type;
+	gboolean pending;
+	gboolean emitted;
+	union batch_value value;
+	union batch_value last;
+};
+
+struct ofono_dbus_batch {
+	char *path;
+	char *interface;
+	unsigned int window;
+	guint source;
+	GSList *properties;
+	unsigned int emitted;
+	unsigned int suppressed;
+};
+
+static GSList *batch_list;
+
+static gboolean batch_value_set(int type, union batch_value *dst,
+					const void *value)
+{
+	switch (type) {
+	case DBUS_TYPE_BOOLEAN:
+		dst->b = *(const dbus_bool_t *) value;
+		return TRUE;
+	case DBUS_TYPE_BYTE:
+		dst->y = *(const unsigned char *) value;
+		return TRUE;
+	case DBUS_TYPE_INT16:
+		dst->n = *(const dbus_int16_t *) value;
+		return TRUE;
+	case DBUS_TYPE_UINT16:
+		dst->q = *(const dbus_uint16_t *) value;
+		return TRUE;
+	case DBUS_TYPE_INT32:
+		dst->i = *(const dbus_int32_t *) value;
+		return TRUE;
+	case DBUS_TYPE_UINT32:
+		dst->u = *(const dbus_uint32_t *) value;
+		return TRUE;
+	case DBUS_TYPE_STRING:
+	case DBUS_TYPE_OBJECT_PATH:
+		g_free(dst->s);
+		dst->s = g_strdup(*(const char **) value);
+		return TRUE;
+	}
+
+	return FALSE;
+}
+
+static void batch_value_copy(int type, union batch_value *dst,
+				const union batch_value *src)
+{
+	if (type == DBUS_TYPE_STRING || type == DBUS_TYPE_OBJECT_PATH) {
+		g_free(dst->s);
+		dst->s = g_strdup(src->s);
+		return;
+	}
+
+	*dst = *src;
+}
+
+static gboolean batch_value_equal(int type, const union batch_value *a,
+					const union batch_value *b)
+{
+	switch (type) {
+	case DBUS_TYPE_BOOLEAN:
+		return !a->b == !b->b;
+	case DBUS_TYPE_BYTE:
+		return a->y == b->y;
+	case DBUS_TYPE_INT16:
+		return a->n == b->n;
+	case DBUS_TYPE_UINT16:
+		return a->q == b->q;
+	case DBUS_TYPE_INT32:
+		return a->i == b->i;
+	case DBUS_TYPE_UINT32:
+		return a->u == b->u;
+	case DBUS_TYPE_STRING:
+	case DBUS_TYPE_OBJECT_PATH:
+		return g_strcmp0(a->s, b->s) == 0;
+	}
+
+	return FALSE;
+}
+
+static void batch_property_free(gpointer data)
+{
+	struct batch_property *prop = data;
+
+	if (prop->type == DBUS_TYPE_STRING ||
+			prop->type == DBUS_TYPE_OBJECT_PATH) {
+		g_free(prop->value.s);
+		g_free(prop->last.s);
+	}
+
+	g_free(prop->name);
+	g_free(prop);
+}
+
+static struct batch_property *batch_find_property(
+					struct ofono_dbus_batch *batch,
+					const char *name)
+{
+	GSList *l;
+
+	for (l = batch->properties; l; l = l->next) {
+		struct batch_property *prop = l->data;
+
+		if (g_str_equal(prop->name, name))
+			return prop;
+	}
+
+	return NULL;
+}
+
+static gboolean batch_flush_cb(gpointer user_data)
+{
+	struct ofono_dbus_batch *batch = user_data;
+
+	batch->source = 0;
+	__ofono_dbus_batch_flush(batch);
+
+	return FALSE;
+}
+
+/*
+ * Creates a PropertyChanged batcher for one interface on one object.
+ * Changes queued through __ofono_dbus_batch_property_changed are held
+ * until the main loop goes idle, or for window milliseconds if non-zero,
+ * so that a burst of updates only signals the final value of each
+ * property.  Properties whose final value matches the last one signalled
+ * are dropped entirely.  A flush signals the properties in the order they
+ * were first queued on the batch.
+ */
+struct ofono_dbus_batch *__ofono_dbus_batch_new(const char *path,
+						const char *interface,
+						unsigned int window)
+{
+	struct ofono_dbus_batch *batch;
+
+	batch = g_new0(struct ofono_dbus_batch, 1);
+
+	batch->path = g_strdup(path);
+	batch->interface = g_strdup(interface);
+	batch->window = window;
+
+	batch_list = g_slist_prepend(batch_list, batch);
+
+	return batch;
+}
+
+void __ofono_dbus_batch_property_changed(struct ofono_dbus_batch *batch,
+						const char *name,
+						int type, void *value)
+{
+	struct batch_property *prop;
+
+	prop = batch_find_property(batch, name);
+
+	if (prop == NULL) {
+		prop = g_new0(struct batch_property, 1);
+		prop->name = g_strdup(name);
+		prop->type = type;
+
+		batch->properties = g_slist_append(batch->properties, prop);
+	} else if (prop->type != type) {
+		ofono_error("Property %s.%s changed type", batch->interface,
+				name);
+		return;
+	}
+
+	if (batch_value_set(type, &prop->value, value) == FALSE) {
+		ofono_error("Unsupported type for property %s.%s",
+				batch->interface, name);
+		return;
+	}
+
+	if (prop->pending == TRUE)
+		batch->suppressed += 1;
+
+	prop->pending = TRUE;
+
+	if (batch->source > 0)
+		return;
+
+	if (batch->window > 0)
+		batch->source = g_timeout_add(batch->window,
+						batch_flush_cb, batch);
+	else
+		batch->source = g_idle_add(batch_flush_cb, batch);
+}
+
+/*
+ * Tells the batch that the property went away without a signal, so that
+ * the next value queued is signalled even if it matches the last one.
+ */
+void __ofono_dbus_batch_property_forget(struct ofono_dbus_batch *batch,
+						const char *name)
+{
+	struct batch_property *prop;
+
+	prop = batch_find_property(batch, name);
+	if (prop == NULL)
+		return;
+
+	prop->pending = FALSE;
+	prop->emitted = FALSE;
+}
+
+void __ofono_dbus_batch_flush(struct ofono_dbus_batch *batch)
+{
+	DBusConnection *conn = ofono_dbus_get_connection();
+	GSList *l;
+
+	if (batch->source > 0) {
+		g_source_remove(batch->source);
+		batch->source = 0;
+	}
+
+	for (l = batch->properties; l; l = l->next) {
+		struct batch_property *prop = l->data;
+
+		if (prop->pending == FALSE)
+			continue;
+
+		prop->pending = FALSE;
+
+		if (prop->emitted == TRUE && batch_value_equal(prop->type,
+						&prop->value, &prop->last)) {
+			batch->suppressed += 1;
+			continue;
+		}
+
+		batch_value_copy(prop->type, &prop->last, &prop->value);
+		prop->emitted = TRUE;
+
+		ofono_dbus_signal_property_changed(conn, batch->path,
+							batch->interface,
+							prop->name, prop->type,
+							&prop->value);
+		batch->emitted += 1;
+	}
+}
+
+void __ofono_dbus_batch_free(struct ofono_dbus_batch *batch)
+{
+	if (batch == NULL)
+		return;
+
+	__ofono_dbus_batch_flush(batch);
+
+	batch_list = g_slist_remove(batch_list, batch);
+
+	g_slist_foreach(batch->properties, (GFunc) batch_property_free, NULL);
+	g_slist_free(batch->properties);
+
+	g_free(batch->interface);
+	g_free(batch->path);
+	g_free(batch);
+}
+
 DBusMessage *__ofono_error_invalid_args(DBusMessage *msg)
 {
 	return g_dbus_create_error(msg, DBUS_GSM_ERROR_INTERFACE
@@ -409,9 +685,25 @@ static void dbus_gsm_set_connection(DBusConnection *conn)
 	g_connection = conn;
 }
 
+static void batch_trace_dump(FILE *out, void *user_data)
+{
+	GSList *l;
+
+	fprintf(out, "PropertyChanged batches: path interface "
+			"emitted suppressed\n");
+
+	for (l = batch_list; l; l = l->next) {
+		struct ofono_dbus_batch *batch = l->data;
+
+		fprintf(out, "%s %s %u %u\n", batch->path, batch->interface,
+				batch->emitted, batch->suppressed);
+	}
+}
+
 int __ofono_dbus_init(DBusConnection *conn)
 {
 	dbus_gsm_set_connection(conn);
+	ofono_trace_dump_register(batch_trace_dump, NULL);
 
 	return 0;
 }
@@ -420,6 +712,8 @@ void __ofono_dbus_cleanup(void)
 {
 	DBusConnection *conn = ofono_dbus_get_connection();
 
+	ofono_trace_dump_unregister(batch_trace_dump);
+
 	if (!conn || !dbus_connection_get_is_connected(conn))
 		return;
 
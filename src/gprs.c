@@ -23,6 +23,7 @@
 #include <config.h>
 #endif
 
+#include <stdint.h>
 #include <string.h>
 #include <stdio.h>
 #include <errno.h>
@@ -39,6 +40,7 @@
 #include "common.h"
 #include "storage.h"
 #include "idmap.h"
+#include "rtnl.h"
 
 #define GPRS_FLAG_ATTACHING 0x1
 #define GPRS_FLAG_RECHECK 0x2
@@ -48,10 +50,17 @@
 #define MAX_CONTEXT_NAME_LENGTH 127
 #define MAX_CONTEXTS 256
 #define SUSPEND_TIMEOUT 8
+#define GPRS_SIGNAL_WINDOW 0
+#define STATISTICS_INTERVAL 2
 
 static GSList *g_drivers = NULL;
 static GSList *g_context_drivers = NULL;
 
+/* Contexts with an interface, the counters of all come from one dump */
+static GSList *g_stats_contexts = NULL;
+static struct rtnl *g_stats_rtnl = NULL;
+static guint g_stats_source = 0;
+
 enum gprs_context_type {
 	GPRS_CONTEXT_TYPE_INTERNET = 0,
 	GPRS_CONTEXT_TYPE_MMS,
@@ -79,7 +88,10 @@ struct ofono_gprs {
 	GKeyFile *settings;
 	char *imsi;
 	DBusMessage *pending;
-	struct ofono_gprs_context *context_driver;
+	unsigned int deactivating;		/* Outstanding DeactivateAll */
+	ofono_bool_t deactivate_failed;
+	struct ofono_dbus_batch *batch;
+	GSList *context_drivers;
 	const struct ofono_gprs_driver *driver;
 	void *driver_data;
 	struct ofono_atom *atom;
@@ -87,7 +99,9 @@ struct ofono_gprs {
 
 struct ofono_gprs_context {
 	struct ofono_gprs *gprs;
+	ofono_bool_t inuse;
 	DBusMessage *pending;
+	ofono_gprs_context_cb_t deactivate_cb;	/* Of gprs->pending */
 	const struct ofono_gprs_context_driver *driver;
 	void *driver_data;
 	struct ofono_atom *atom;
@@ -111,7 +125,13 @@ struct pri_context {
 	char *key;
 	struct context_settings *settings;
 	struct ofono_gprs_primary_context context;
+	struct ofono_gprs_context *context_driver;
 	struct ofono_gprs *gprs;
+	struct rtnl_link_counters stats;	/* Since the activation */
+	struct rtnl_link_counters stats_last;	/* Of the interface */
+	ofono_bool_t stats_sampled;
+	uint64_t stats_notified;		/* Bytes at the last signal */
+	unsigned int stats_threshold;
 };
 
 static void gprs_netreg_update(struct ofono_gprs *gprs);
@@ -178,6 +198,72 @@ static void gprs_cid_release(struct ofono_gprs *gprs, unsigned int id)
 	idmap_put(gprs->cid_map, id);
 }
 
+/*
+ * Every active context needs a cid and an instance of the context
+ * driver of its own, such as another DLC or network interface.
+ */
+static gboolean assign_context(struct pri_context *ctx)
+{
+	struct ofono_gprs *gprs = ctx->gprs;
+	GSList *l;
+
+	if (gprs->cid_map == NULL)
+		return FALSE;
+
+	for (l = gprs->context_drivers; l; l = l->next) {
+		struct ofono_gprs_context *gc = l->data;
+
+		if (gc->inuse == TRUE)
+			continue;
+
+		if (gc->driver == NULL ||
+				gc->driver->activate_primary == NULL ||
+				gc->driver->deactivate_primary == NULL)
+			continue;
+
+		ctx->context.cid = gprs_cid_alloc(gprs);
+		if (ctx->context.cid > idmap_get_max(gprs->cid_map)) {
+			ctx->context.cid = 0;
+			return FALSE;
+		}
+
+		gc->inuse = TRUE;
+		ctx->context_driver = gc;
+
+		return TRUE;
+	}
+
+	return FALSE;
+}
+
+/*
+ * Requests still outstanding on the instance fail here, before it is
+ * taken away; the driver callbacks then find no instance and ignore a
+ * late reply.
+ */
+static void release_context(struct pri_context *ctx)
+{
+	struct ofono_gprs_context *gc = ctx->context_driver;
+	struct ofono_error failure = { .type = OFONO_ERROR_TYPE_FAILURE };
+
+	if (gc == NULL)
+		return;
+
+	if (gc->pending)
+		__ofono_dbus_pending_reply(&gc->pending,
+					__ofono_error_failed(gc->pending));
+
+	/* Clears itself and accounts for the DeactivateAll/RemoveContext */
+	if (gc->deactivate_cb)
+		gc->deactivate_cb(&failure, ctx);
+
+	gprs_cid_release(ctx->gprs, ctx->context.cid);
+	ctx->context.cid = 0;
+
+	gc->inuse = FALSE;
+	ctx->context_driver = NULL;
+}
+
 static struct pri_context *gprs_context_by_path(struct ofono_gprs *gprs,
 						const char *ctx_path)
 {
@@ -336,6 +422,204 @@ done:
 	close(sk);
 }
 
+static void pri_append_statistics(struct pri_context *ctx,
+					DBusMessageIter *iter)
+{
+	DBusMessageIter dict;
+	dbus_uint64_t value;
+
+	dbus_message_iter_open_container(iter, DBUS_TYPE_ARRAY,
+					OFONO_PROPERTIES_ARRAY_SIGNATURE,
+					&dict);
+
+	value = ctx->stats.rx_bytes;
+	ofono_dbus_dict_append(&dict, "RxBytes", DBUS_TYPE_UINT64, &value);
+
+	value = ctx->stats.tx_bytes;
+	ofono_dbus_dict_append(&dict, "TxBytes", DBUS_TYPE_UINT64, &value);
+
+	value = ctx->stats.rx_packets;
+	ofono_dbus_dict_append(&dict, "RxPackets", DBUS_TYPE_UINT64, &value);
+
+	value = ctx->stats.tx_packets;
+	ofono_dbus_dict_append(&dict, "TxPackets", DBUS_TYPE_UINT64, &value);
+
+	dbus_message_iter_close_container(iter, &dict);
+}
+
+static void pri_signal_statistics(struct pri_context *ctx)
+{
+	DBusConnection *conn = ofono_dbus_get_connection();
+	DBusMessage *signal;
+	DBusMessageIter iter;
+
+	signal = dbus_message_new_signal(ctx->path,
+					OFONO_CONNECTION_CONTEXT_INTERFACE,
+					"StatisticsChanged");
+	if (!signal)
+		return;
+
+	dbus_message_iter_init_append(signal, &iter);
+
+	pri_append_statistics(ctx, &iter);
+
+	g_dbus_send_message(conn, signal);
+}
+
+static uint64_t stats_delta(uint64_t now, uint64_t last)
+{
+	/* The interface has been recreated, its counters start over */
+	if (now < last)
+		return now;
+
+	return now - last;
+}
+
+static void stats_link_cb(const char *ifname,
+				const struct rtnl_link_counters *counters,
+				void *user_data)
+{
+	GSList *l;
+
+	for (l = g_stats_contexts; l; l = l->next) {
+		struct pri_context *ctx = l->data;
+
+		if (!g_str_equal(ctx->settings->interface, ifname))
+			continue;
+
+		/* The first sample is the baseline */
+		if (ctx->stats_sampled) {
+			ctx->stats.rx_packets += stats_delta(
+						counters->rx_packets,
+						ctx->stats_last.rx_packets);
+			ctx->stats.tx_packets += stats_delta(
+						counters->tx_packets,
+						ctx->stats_last.tx_packets);
+			ctx->stats.rx_bytes += stats_delta(counters->rx_bytes,
+						ctx->stats_last.rx_bytes);
+			ctx->stats.tx_bytes += stats_delta(counters->tx_bytes,
+						ctx->stats_last.tx_bytes);
+		}
+
+		ctx->stats_last = *counters;
+		ctx->stats_sampled = TRUE;
+
+		return;
+	}
+}
+
+static void stats_check_threshold(struct pri_context *ctx)
+{
+	uint64_t total;
+
+	if (ctx->stats_threshold == 0)
+		return;
+
+	total = ctx->stats.rx_bytes + ctx->stats.tx_bytes;
+
+	if (total - ctx->stats_notified < ctx->stats_threshold)
+		return;
+
+	ctx->stats_notified = total;
+	pri_signal_statistics(ctx);
+}
+
+static void stats_sample(void)
+{
+	GSList *l;
+	int err;
+
+	if (g_stats_contexts == NULL)
+		return;
+
+	if (g_stats_rtnl == NULL) {
+		g_stats_rtnl = rtnl_open();
+
+		if (g_stats_rtnl == NULL) {
+			ofono_error("Unable to open rtnetlink socket");
+			return;
+		}
+	}
+
+	err = rtnl_dump_links(g_stats_rtnl, stats_link_cb, NULL);
+	if (err < 0) {
+		ofono_error("Link statistics dump failed: %s (%d)",
+				strerror(-err), -err);
+
+		/* Replies to the failed dump may still be queued */
+		rtnl_close(g_stats_rtnl);
+		g_stats_rtnl = NULL;
+		return;
+	}
+
+	for (l = g_stats_contexts; l; l = l->next)
+		stats_check_threshold(l->data);
+}
+
+static gboolean stats_timeout(gpointer user_data)
+{
+	stats_sample();
+
+	return TRUE;
+}
+
+/* Nothing is sampled in the background unless a threshold asks for it */
+static void stats_timer_update(void)
+{
+	gboolean needed = FALSE;
+	GSList *l;
+
+	for (l = g_stats_contexts; l; l = l->next) {
+		struct pri_context *ctx = l->data;
+
+		if (ctx->stats_threshold > 0)
+			needed = TRUE;
+	}
+
+	if (needed == TRUE && g_stats_source == 0)
+		g_stats_source = g_timeout_add_seconds(STATISTICS_INTERVAL,
+							stats_timeout, NULL);
+	else if (needed == FALSE && g_stats_source > 0) {
+		g_source_remove(g_stats_source);
+		g_stats_source = 0;
+	}
+}
+
+static void pri_stats_start(struct pri_context *ctx)
+{
+	memset(&ctx->stats, 0, sizeof(ctx->stats));
+	memset(&ctx->stats_last, 0, sizeof(ctx->stats_last));
+	ctx->stats_sampled = FALSE;
+	ctx->stats_notified = 0;
+
+	g_stats_contexts = g_slist_prepend(g_stats_contexts, ctx);
+
+	stats_sample();
+	stats_timer_update();
+}
+
+/*
+ * With final, the counters are brought up to date one last time and
+ * stay readable until the next activation.
+ */
+static void pri_stats_stop(struct pri_context *ctx, ofono_bool_t final)
+{
+	if (g_slist_find(g_stats_contexts, ctx) == NULL)
+		return;
+
+	if (final)
+		stats_sample();
+
+	g_stats_contexts = g_slist_remove(g_stats_contexts, ctx);
+	stats_timer_update();
+
+	if (g_stats_contexts != NULL)
+		return;
+
+	rtnl_close(g_stats_rtnl);
+	g_stats_rtnl = NULL;
+}
+
 static void pri_reset_context_settings(struct pri_context *ctx)
 {
 	char *interface;
@@ -343,6 +627,8 @@ static void pri_reset_context_settings(struct pri_context *ctx)
 	if (ctx->settings == NULL)
 		return;
 
+	pri_stats_stop(ctx, TRUE);
+
 	interface = ctx->settings->interface;
 	ctx->settings->interface = NULL;
 
@@ -362,8 +648,10 @@ static void pri_update_context_settings(struct pri_context *ctx,
 					const char *ip, const char *netmask,
 					const char *gateway, const char **dns)
 {
-	if (ctx->settings)
+	if (ctx->settings) {
+		pri_stats_stop(ctx, FALSE);
 		context_settings_free(ctx->settings);
+	}
 
 	ctx->settings = g_new0(struct context_settings, 1);
 
@@ -374,6 +662,8 @@ static void pri_update_context_settings(struct pri_context *ctx,
 	ctx->settings->gateway = g_strdup(gateway);
 	ctx->settings->dns = g_strdupv((char **)dns);
 
+	pri_stats_start(ctx);
+
 	pri_ifupdown(interface, TRUE);
 
 	pri_context_signal_settings(ctx);
@@ -410,6 +700,9 @@ static void append_context_properties(struct pri_context *ctx,
 				&strvalue);
 
 	context_settings_append_dict(ctx->settings, dict);
+
+	ofono_dbus_dict_append(dict, "StatisticsThreshold", DBUS_TYPE_UINT32,
+				&ctx->stats_threshold);
 }
 
 static DBusMessage *pri_get_properties(DBusConnection *conn,
@@ -435,6 +728,28 @@ static DBusMessage *pri_get_properties(DBusConnection *conn,
 	return reply;
 }
 
+static DBusMessage *pri_get_statistics(DBusConnection *conn,
+					DBusMessage *msg, void *data)
+{
+	struct pri_context *ctx = data;
+	DBusMessage *reply;
+	DBusMessageIter iter;
+
+	/* A dump brings the counters of all active contexts up to date */
+	if (g_slist_find(g_stats_contexts, ctx))
+		stats_sample();
+
+	reply = dbus_message_new_method_return(msg);
+	if (!reply)
+		return NULL;
+
+	dbus_message_iter_init_append(reply, &iter);
+
+	pri_append_statistics(ctx, &iter);
+
+	return reply;
+}
+
 static void pri_activate_callback(const struct ofono_error *error,
 					const char *interface,
 					ofono_bool_t static_ip,
@@ -443,20 +758,23 @@ static void pri_activate_callback(const struct ofono_error *error,
 					void *data)
 {
 	struct pri_context *ctx = data;
-	struct ofono_gprs_context *gc = ctx->gprs->context_driver;
+	struct ofono_gprs_context *gc = ctx->context_driver;
 	DBusConnection *conn = ofono_dbus_get_connection();
 	dbus_bool_t value;
 
 	DBG("%p %s", ctx, interface);
 
+	/* The instance was removed, the request has been answered */
+	if (gc == NULL)
+		return;
+
 	if (error->type != OFONO_ERROR_TYPE_NO_ERROR) {
 		DBG("Activating context failed with error: %s",
 				telephony_error_to_str(error));
 		__ofono_dbus_pending_reply(&gc->pending,
 					__ofono_error_failed(gc->pending));
 
-		gprs_cid_release(ctx->gprs, ctx->context.cid);
-		ctx->context.cid = 0;
+		release_context(ctx);
 
 		return;
 	}
@@ -481,10 +799,13 @@ static void pri_activate_callback(const struct ofono_error *error,
 static void pri_deactivate_callback(const struct ofono_error *error, void *data)
 {
 	struct pri_context *ctx = data;
-	struct ofono_gprs_context *gc = ctx->gprs->context_driver;
+	struct ofono_gprs_context *gc = ctx->context_driver;
 	DBusConnection *conn = ofono_dbus_get_connection();
 	dbus_bool_t value;
 
+	if (gc == NULL)
+		return;
+
 	if (error->type != OFONO_ERROR_TYPE_NO_ERROR) {
 		DBG("Deactivating context failed with error: %s",
 				telephony_error_to_str(error));
@@ -493,13 +814,12 @@ static void pri_deactivate_callback(const struct ofono_error *error, void *data)
 		return;
 	}
 
-	gprs_cid_release(ctx->gprs, ctx->context.cid);
-	ctx->context.cid = 0;
-
 	ctx->active = FALSE;
 	__ofono_dbus_pending_reply(&gc->pending,
 				dbus_message_new_method_return(gc->pending));
 
+	release_context(ctx);
+
 	pri_reset_context_settings(ctx);
 
 	value = ctx->active;
@@ -686,6 +1006,38 @@ static DBusMessage *pri_set_name(struct pri_context *ctx, DBusConnection *conn,
 	return NULL;
 }
 
+static DBusMessage *pri_set_threshold(struct pri_context *ctx,
+					DBusConnection *conn,
+					DBusMessage *msg, unsigned int threshold)
+{
+	GKeyFile *settings = ctx->gprs->settings;
+
+	if (ctx->stats_threshold == threshold)
+		return dbus_message_new_method_return(msg);
+
+	ctx->stats_threshold = threshold;
+
+	/* Count towards the new threshold from now on */
+	ctx->stats_notified = ctx->stats.rx_bytes + ctx->stats.tx_bytes;
+
+	if (settings) {
+		g_key_file_set_integer(settings, ctx->key,
+					"StatisticsThreshold", threshold);
+		storage_sync(ctx->gprs->imsi, SETTINGS_STORE, settings);
+	}
+
+	g_dbus_send_reply(conn, msg, DBUS_TYPE_INVALID);
+
+	ofono_dbus_signal_property_changed(conn, ctx->path,
+					OFONO_CONNECTION_CONTEXT_INTERFACE,
+					"StatisticsThreshold",
+					DBUS_TYPE_UINT32, &threshold);
+
+	stats_timer_update();
+
+	return NULL;
+}
+
 static DBusMessage *pri_set_property(DBusConnection *conn,
 					DBusMessage *msg, void *data)
 {
@@ -695,6 +1047,7 @@ static DBusMessage *pri_set_property(DBusConnection *conn,
 	const char *property;
 	dbus_bool_t value;
 	const char *str;
+	dbus_uint32_t threshold;
 
 	if (!dbus_message_iter_init(msg, &iter))
 		return __ofono_error_invalid_args(msg);
@@ -711,14 +1064,16 @@ static DBusMessage *pri_set_property(DBusConnection *conn,
 	dbus_message_iter_recurse(&iter, &var);
 
 	if (g_str_equal(property, "Active")) {
-		struct ofono_gprs_context *gc = ctx->gprs->context_driver;
+		struct ofono_gprs_context *gc;
 
-		if (gc == NULL || gc->driver->activate_primary == NULL ||
-				gc->driver->deactivate_primary == NULL ||
+		if (ctx->gprs->context_drivers == NULL ||
 				ctx->gprs->cid_map == NULL)
 			return __ofono_error_not_implemented(msg);
 
-		if (gc->pending)
+		if (ctx->context_driver && ctx->context_driver->pending)
+			return __ofono_error_busy(msg);
+
+		if (ctx->gprs->deactivating)
 			return __ofono_error_busy(msg);
 
 		if (dbus_message_iter_get_arg_type(&var) != DBUS_TYPE_BOOLEAN)
@@ -735,24 +1090,11 @@ static DBusMessage *pri_set_property(DBusConnection *conn,
 		if (ctx->gprs->flags & GPRS_FLAG_ATTACHING)
 			return __ofono_error_attach_in_progress(msg);
 
-		if (value) {
-			ctx->context.cid = gprs_cid_alloc(ctx->gprs);
-
-			if (ctx->context.cid == 0)
-				return __ofono_error_failed(msg);
-
-			if (ctx->context.cid !=
-					idmap_get_min(ctx->gprs->cid_map)) {
-				ofono_error("Multiple active contexts are"
-						" not yet supported");
-
-				gprs_cid_release(ctx->gprs, ctx->context.cid);
-				ctx->context.cid = 0;
-
-				return __ofono_error_failed(msg);
-			}
-		}
+		/* All instances of the context driver are taken */
+		if (value && assign_context(ctx) == FALSE)
+			return __ofono_error_failed(msg);
 
+		gc = ctx->context_driver;
 		gc->pending = dbus_message_ref(msg);
 
 		if (value)
@@ -765,6 +1107,19 @@ static DBusMessage *pri_set_property(DBusConnection *conn,
 		return NULL;
 	}
 
+	if (g_str_equal(property, "StatisticsThreshold")) {
+		if (dbus_message_iter_get_arg_type(&var) != DBUS_TYPE_UINT32)
+			return __ofono_error_invalid_args(msg);
+
+		dbus_message_iter_get_basic(&var, &threshold);
+
+		/* It has to fit the integer it is stored as */
+		if (threshold > G_MAXINT)
+			return __ofono_error_invalid_args(msg);
+
+		return pri_set_threshold(ctx, conn, msg, threshold);
+	}
+
 	/* All other properties are read-only when context is active */
 	if (ctx->active == TRUE)
 		return __ofono_error_in_use(msg);
@@ -820,11 +1175,13 @@ static GDBusMethodTable context_methods[] = {
 	{ "GetProperties",	"",	"a{sv}",	pri_get_properties },
 	{ "SetProperty",	"sv",	"",		pri_set_property,
 							G_DBUS_METHOD_FLAG_ASYNC },
+	{ "GetStatistics",	"",	"a{sv}",	pri_get_statistics },
 	{ }
 };
 
 static GDBusSignalTable context_signals[] = {
 	{ "PropertyChanged",	"sv" },
+	{ "StatisticsChanged",	"a{sv}" },
 	{ }
 };
 
@@ -849,6 +1206,7 @@ static void pri_context_destroy(gpointer userdata)
 	struct pri_context *ctx = userdata;
 
 	if (ctx->settings) {
+		pri_stats_stop(ctx, FALSE);
 		context_settings_free(ctx->settings);
 		ctx->settings = NULL;
 	}
@@ -900,8 +1258,6 @@ static gboolean context_dbus_unregister(struct pri_context *ctx)
 static void update_suspended_property(struct ofono_gprs *gprs,
 				ofono_bool_t suspended)
 {
-	DBusConnection *conn = ofono_dbus_get_connection();
-	const char *path = __ofono_atom_get_path(gprs->atom);
 	dbus_bool_t value = suspended;
 
 	if (gprs->suspend_timeout) {
@@ -918,9 +1274,8 @@ static void update_suspended_property(struct ofono_gprs *gprs,
 	gprs->suspended = suspended;
 
 	if (gprs->attached)
-		ofono_dbus_signal_property_changed(conn, path,
-					OFONO_CONNECTION_MANAGER_INTERFACE,
-					"Suspended", DBUS_TYPE_BOOLEAN, &value);
+		__ofono_dbus_batch_property_changed(gprs->batch, "Suspended",
+						DBUS_TYPE_BOOLEAN, &value);
 }
 
 static gboolean suspend_timeout(gpointer data)
@@ -960,7 +1315,6 @@ void ofono_gprs_resume_notify(struct ofono_gprs *gprs)
 static void gprs_attached_update(struct ofono_gprs *gprs)
 {
 	DBusConnection *conn = ofono_dbus_get_connection();
-	const char *path;
 	ofono_bool_t attached;
 	dbus_bool_t value;
 
@@ -983,8 +1337,7 @@ static void gprs_attached_update(struct ofono_gprs *gprs)
 			if (ctx->active == FALSE)
 				continue;
 
-			gprs_cid_release(gprs, ctx->context.cid);
-			ctx->context.cid = 0;
+			release_context(ctx);
 
 			ctx->active = FALSE;
 			pri_reset_context_settings(ctx);
@@ -996,11 +1349,9 @@ static void gprs_attached_update(struct ofono_gprs *gprs)
 		}
 	}
 
-	path = __ofono_atom_get_path(gprs->atom);
 	value = attached;
-	ofono_dbus_signal_property_changed(conn, path,
-				OFONO_CONNECTION_MANAGER_INTERFACE,
-				"Attached", DBUS_TYPE_BOOLEAN, &value);
+	__ofono_dbus_batch_property_changed(gprs->batch, "Attached",
+						DBUS_TYPE_BOOLEAN, &value);
 }
 
 static void registration_status_cb(const struct ofono_error *error,
@@ -1222,6 +1573,8 @@ static void write_context_settings(struct ofono_gprs *gprs,
 				gprs_context_type_to_string(context->type));
 	g_key_file_set_string(gprs->settings, context->key, "Protocol",
 				gprs_proto_to_string(context->context.proto));
+	g_key_file_set_integer(gprs->settings, context->key,
+				"StatisticsThreshold", context->stats_threshold);
 }
 
 static struct pri_context *add_context(struct ofono_gprs *gprs,
@@ -1326,10 +1679,17 @@ static void gprs_deactivate_for_remove(const struct ofono_error *error,
 {
 	struct pri_context *ctx = data;
 	struct ofono_gprs *gprs = ctx->gprs;
+	struct ofono_gprs_context *gc = ctx->context_driver;
 	DBusConnection *conn;
 	char *path;
 	const char *atompath;
 
+	/* Already answered when the instance was released */
+	if (gc == NULL || gc->deactivate_cb != gprs_deactivate_for_remove)
+		return;
+
+	gc->deactivate_cb = NULL;
+
 	if (error->type != OFONO_ERROR_TYPE_NO_ERROR) {
 		DBG("Removing context failed with error: %s",
 				telephony_error_to_str(error));
@@ -1339,8 +1699,7 @@ static void gprs_deactivate_for_remove(const struct ofono_error *error,
 		return;
 	}
 
-	gprs_cid_release(gprs, ctx->context.cid);
-	ctx->context.cid = 0;
+	release_context(ctx);
 
 	if (gprs->settings) {
 		g_key_file_remove_group(gprs->settings, ctx->key, NULL);
@@ -1383,10 +1742,14 @@ static DBusMessage *gprs_remove_context(DBusConnection *conn,
 	if (!ctx)
 		return __ofono_error_not_found(msg);
 
+	if (ctx->context_driver && ctx->context_driver->pending)
+		return __ofono_error_busy(msg);
+
 	if (ctx->active) {
-		struct ofono_gprs_context *gc = gprs->context_driver;
+		struct ofono_gprs_context *gc = ctx->context_driver;
 
 		gprs->pending = dbus_message_ref(msg);
+		gc->deactivate_cb = gprs_deactivate_for_remove;
 		gc->driver->deactivate_primary(gc, ctx->context.cid,
 					gprs_deactivate_for_remove, ctx);
 		return NULL;
@@ -1411,10 +1774,55 @@ static DBusMessage *gprs_remove_context(DBusConnection *conn,
 	return NULL;
 }
 
+static void gprs_deactivate_next(const struct ofono_error *error, void *data)
+{
+	struct pri_context *ctx = data;
+	struct ofono_gprs *gprs = ctx->gprs;
+	struct ofono_gprs_context *gc = ctx->context_driver;
+	DBusConnection *conn = ofono_dbus_get_connection();
+	dbus_bool_t value;
+
+	/* Already answered when the instance was released */
+	if (gc == NULL || gc->deactivate_cb != gprs_deactivate_next)
+		return;
+
+	gc->deactivate_cb = NULL;
+
+	if (error->type != OFONO_ERROR_TYPE_NO_ERROR) {
+		DBG("Deactivating %s failed with error: %s", ctx->path,
+				telephony_error_to_str(error));
+		gprs->deactivate_failed = TRUE;
+	} else {
+		release_context(ctx);
+
+		ctx->active = FALSE;
+		pri_reset_context_settings(ctx);
+
+		value = FALSE;
+		ofono_dbus_signal_property_changed(conn, ctx->path,
+					OFONO_CONNECTION_CONTEXT_INTERFACE,
+					"Active", DBUS_TYPE_BOOLEAN, &value);
+	}
+
+	gprs->deactivating -= 1;
+
+	if (gprs->deactivating > 0)
+		return;
+
+	if (gprs->deactivate_failed)
+		__ofono_dbus_pending_reply(&gprs->pending,
+					__ofono_error_failed(gprs->pending));
+	else
+		__ofono_dbus_pending_reply(&gprs->pending,
+				dbus_message_new_method_return(gprs->pending));
+}
+
 static DBusMessage *gprs_deactivate_all(DBusConnection *conn,
 					DBusMessage *msg, void *data)
 {
 	struct ofono_gprs *gprs = data;
+	struct pri_context *ctx;
+	GSList *l;
 
 	if (gprs->pending)
 		return __ofono_error_busy(msg);
@@ -1422,7 +1830,50 @@ static DBusMessage *gprs_deactivate_all(DBusConnection *conn,
 	if (!dbus_message_get_args(msg, NULL, DBUS_TYPE_INVALID))
 		return __ofono_error_invalid_args(msg);
 
-	return __ofono_error_not_implemented(msg);
+	for (l = gprs->contexts; l; l = l->next) {
+		ctx = l->data;
+
+		if (ctx->context_driver && ctx->context_driver->pending)
+			return __ofono_error_busy(msg);
+	}
+
+	/*
+	 * All of them are counted before the first request goes out, a
+	 * driver failing synchronously must not make the last callback
+	 * reply early
+	 */
+	for (l = gprs->contexts; l; l = l->next) {
+		ctx = l->data;
+
+		if (ctx->active)
+			gprs->deactivating += 1;
+	}
+
+	if (gprs->deactivating == 0)
+		return dbus_message_new_method_return(msg);
+
+	gprs->pending = dbus_message_ref(msg);
+	gprs->deactivate_failed = FALSE;
+
+	/*
+	 * Every context has a driver instance of its own, so they are all
+	 * torn down at once instead of one after the other
+	 */
+	for (l = gprs->contexts; l; l = l->next) {
+		struct ofono_gprs_context *gc;
+
+		ctx = l->data;
+
+		if (ctx->active == FALSE)
+			continue;
+
+		gc = ctx->context_driver;
+		gc->deactivate_cb = gprs_deactivate_next;
+		gc->driver->deactivate_primary(gc, ctx->context.cid,
+						gprs_deactivate_next, ctx);
+	}
+
+	return NULL;
 }
 
 static DBusMessage *gprs_get_contexts(DBusConnection *conn,
@@ -1556,17 +2007,46 @@ void ofono_gprs_set_cid_range(struct ofono_gprs *gprs,
 static void gprs_context_unregister(struct ofono_atom *atom)
 {
 	struct ofono_gprs_context *gc = __ofono_atom_get_data(atom);
+	DBusConnection *conn = ofono_dbus_get_connection();
+	dbus_bool_t value = FALSE;
+	GSList *l;
+
+	if (gc->gprs == NULL)
+		return;
+
+	/*
+	 * The context using this instance, if any, goes down with it.  The
+	 * driver cancels its requests on removal, release_context fails
+	 * any that are still pending.
+	 */
+	for (l = gc->gprs->contexts; l; l = l->next) {
+		struct pri_context *ctx = l->data;
+
+		if (ctx->context_driver != gc)
+			continue;
 
-	if (gc->gprs)
-		gc->gprs->context_driver = NULL;
+		release_context(ctx);
 
+		if (ctx->active == FALSE)
+			continue;
+
+		ctx->active = FALSE;
+		pri_reset_context_settings(ctx);
+
+		ofono_dbus_signal_property_changed(conn, ctx->path,
+					OFONO_CONNECTION_CONTEXT_INTERFACE,
+					"Active", DBUS_TYPE_BOOLEAN, &value);
+	}
+
+	gc->gprs->context_drivers = g_slist_remove(gc->gprs->context_drivers,
+							gc);
 	gc->gprs = NULL;
 }
 
 void ofono_gprs_add_context(struct ofono_gprs *gprs,
 				struct ofono_gprs_context *gc)
 {
-	gprs->context_driver = gc;
+	gprs->context_drivers = g_slist_append(gprs->context_drivers, gc);
 	gc->gprs = gprs;
 
 	__ofono_atom_register(gc->atom, gprs_context_unregister);
@@ -1586,11 +2066,10 @@ void ofono_gprs_context_deactivated(struct ofono_gprs_context *gc,
 		if (ctx->active == FALSE)
 			continue;
 
-		if (ctx->context.cid != cid)
+		if (ctx->context_driver != gc || ctx->context.cid != cid)
 			continue;
 
-		gprs_cid_release(ctx->gprs, ctx->context.cid);
-		ctx->context.cid = 0;
+		release_context(ctx);
 
 		ctx->active = FALSE;
 		pri_reset_context_settings(ctx);
@@ -1751,6 +2230,8 @@ static void gprs_unregister(struct ofono_atom *atom)
 		gprs->netreg = NULL;
 	}
 
+	__ofono_dbus_batch_flush(gprs->batch);
+
 	ofono_modem_remove_interface(modem,
 					OFONO_CONNECTION_MANAGER_INTERFACE);
 	g_dbus_unregister_interface(conn, path,
@@ -1760,6 +2241,7 @@ static void gprs_unregister(struct ofono_atom *atom)
 static void gprs_remove(struct ofono_atom *atom)
 {
 	struct ofono_gprs *gprs = __ofono_atom_get_data(atom);
+	GSList *l;
 
 	DBG("atom: %p", atom);
 
@@ -1774,14 +2256,20 @@ static void gprs_remove(struct ofono_atom *atom)
 		gprs->pid_map = NULL;
 	}
 
-	if (gprs->context_driver) {
-		gprs->context_driver->gprs = NULL;
-		gprs->context_driver = NULL;
+	for (l = gprs->context_drivers; l; l = l->next) {
+		struct ofono_gprs_context *gc = l->data;
+
+		gc->gprs = NULL;
 	}
 
+	g_slist_free(gprs->context_drivers);
+	gprs->context_drivers = NULL;
+
 	if (gprs->driver && gprs->driver->remove)
 		gprs->driver->remove(gprs);
 
+	__ofono_dbus_batch_free(gprs->batch);
+
 	g_free(gprs);
 }
 
@@ -1803,6 +2291,10 @@ struct ofono_gprs *ofono_gprs_create(struct ofono_modem *modem,
 	gprs->atom = __ofono_modem_add_atom(modem, OFONO_ATOM_TYPE_GPRS,
 						gprs_remove, gprs);
 
+	gprs->batch = __ofono_dbus_batch_new(__ofono_atom_get_path(gprs->atom),
+					OFONO_CONNECTION_MANAGER_INTERFACE,
+					GPRS_SIGNAL_WINDOW);
+
 	for (l = g_drivers; l; l = l->next) {
 		const struct ofono_gprs_driver *drv = l->data;
 
@@ -1857,6 +2349,7 @@ static gboolean load_context(struct ofono_gprs *gprs, const char *group)
 	enum gprs_context_type type;
 	enum ofono_gprs_proto proto;
 	unsigned int id;
+	int threshold;
 
 	if (sscanf(group, "context%d", &id) != 1) {
 		if (sscanf(group, "primarycontext%d", &id) != 1)
@@ -1928,6 +2421,11 @@ static gboolean load_context(struct ofono_gprs *gprs, const char *group)
 	strcpy(context->context.apn, apn);
 	context->context.proto = proto;
 
+	/* Stored as an integer, missing or negative means no threshold */
+	threshold = g_key_file_get_integer(gprs->settings, group,
+						"StatisticsThreshold", NULL);
+	context->stats_threshold = threshold > 0 ? threshold : 0;
+
 	if (context_dbus_register(context) == FALSE)
 		goto error;
 
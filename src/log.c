@@ -25,6 +25,7 @@
 
 #define _GNU_SOURCE
 #include <stdarg.h>
+#include <string.h>
 #include <syslog.h>
 #include <stdlib.h>
 #include <execinfo.h>
@@ -153,48 +154,143 @@ static void signal_setup(sighandler_t handler)
 extern struct ofono_debug_desc __start___debug[];
 extern struct ofono_debug_desc __stop___debug[];
 
-static gchar **enabled = NULL;
+struct debug_section {
+	struct ofono_debug_desc *start;
+	struct ofono_debug_desc *stop;
+};
+
+/*
+ * The daemon's own section and those of external plugins, so that a
+ * new pattern can be applied to every descriptor there is
+ */
+static GSList *sections = NULL;
+
+static GPatternSpec **enabled = NULL;
 
 static ofono_bool_t is_enabled(struct ofono_debug_desc *desc)
 {
+	guint name_len = desc->name ? strlen(desc->name) : 0;
+	guint file_len = desc->file ? strlen(desc->file) : 0;
 	int i;
 
 	if (enabled == NULL)
 		return FALSE;
 
 	for (i = 0; enabled[i] != NULL; i++) {
-		if (desc->name != NULL && g_pattern_match_simple(enabled[i],
-							desc->name) == TRUE)
+		if (desc->name != NULL && g_pattern_match(enabled[i],
+					name_len, desc->name, NULL) == TRUE)
 			return TRUE;
-		if (desc->file != NULL && g_pattern_match_simple(enabled[i],
-							desc->file) == TRUE)
+		if (desc->file != NULL && g_pattern_match(enabled[i],
+					file_len, desc->file, NULL) == TRUE)
 			return TRUE;
 	}
 
 	return FALSE;
 }
 
-int __ofono_log_init(const char *debug, ofono_bool_t detach)
+static void free_patterns(void)
 {
-	int option = LOG_NDELAY | LOG_PID;
-	struct ofono_debug_desc *desc;
-	const char *name = NULL, *file = NULL;
+	int i;
+
+	if (enabled == NULL)
+		return;
+
+	for (i = 0; enabled[i] != NULL; i++)
+		g_pattern_spec_free(enabled[i]);
+
+	g_free(enabled);
+	enabled = NULL;
+}
 
-	if (debug != NULL)
-		enabled = g_strsplit_set(debug, ":, ", 0);
+/* Patterns are compiled once here rather than for every descriptor */
+static void compile_patterns(const char *debug)
+{
+	gchar **patterns;
+	int i, n = 0;
+
+	free_patterns();
+
+	if (debug == NULL)
+		return;
+
+	patterns = g_strsplit_set(debug, ":, ", 0);
+	enabled = g_new0(GPatternSpec *, g_strv_length(patterns) + 1);
 
-	for (desc = __start___debug; desc < __stop___debug; desc++) {
-		if (file != NULL || name != NULL) {
-			if (g_strcmp0(desc->file, file) == 0) {
-				if (desc->name == NULL)
-					desc->name = name;
-			} else
-				file = NULL;
-		}
+	for (i = 0; patterns[i] != NULL; i++) {
+		if (*patterns[i] == '\0')
+			continue;
 
+		enabled[n++] = g_pattern_spec_new(patterns[i]);
+	}
+
+	g_strfreev(patterns);
+}
+
+static void update_section(struct debug_section *section)
+{
+	struct ofono_debug_desc *desc;
+
+	for (desc = section->start; desc < section->stop; desc++) {
 		if (is_enabled(desc) == TRUE)
 			desc->flags |= OFONO_DEBUG_FLAG_PRINT;
+		else
+			desc->flags &= ~OFONO_DEBUG_FLAG_PRINT;
+	}
+}
+
+void __ofono_log_enable(struct ofono_debug_desc *start,
+					struct ofono_debug_desc *stop)
+{
+	struct debug_section *section;
+
+	if (start == NULL || stop == NULL || start >= stop)
+		return;
+
+	section = g_new0(struct debug_section, 1);
+	section->start = start;
+	section->stop = stop;
+
+	sections = g_slist_append(sections, section);
+
+	update_section(section);
+}
+
+void __ofono_log_disable(struct ofono_debug_desc *start,
+					struct ofono_debug_desc *stop)
+{
+	GSList *l;
+
+	for (l = sections; l; l = l->next) {
+		struct debug_section *section = l->data;
+
+		if (section->start != start || section->stop != stop)
+			continue;
+
+		sections = g_slist_remove(sections, section);
+		g_free(section);
+		return;
 	}
+}
+
+void __ofono_log_set_debug(const char *debug)
+{
+	GSList *l;
+
+	compile_patterns(debug);
+
+	for (l = sections; l; l = l->next)
+		update_section(l->data);
+
+	syslog(LOG_INFO, "Debug set to \"%s\"", debug ? debug : "");
+}
+
+int __ofono_log_init(const char *debug, ofono_bool_t detach)
+{
+	int option = LOG_NDELAY | LOG_PID;
+
+	compile_patterns(debug);
+
+	__ofono_log_enable(__start___debug, __stop___debug);
 
 	if (detach == FALSE)
 		option |= LOG_PERROR;
@@ -216,5 +312,9 @@ void __ofono_log_cleanup(void)
 
 	signal_setup(SIG_DFL);
 
-	g_strfreev(enabled);
+	g_slist_foreach(sections, (GFunc) g_free, NULL);
+	g_slist_free(sections);
+	sections = NULL;
+
+	free_patterns();
 }
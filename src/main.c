@@ -78,6 +78,9 @@ static gboolean signal_cb(GIOChannel *channel, GIOCondition cond, gpointer data)
 
 		terminated++;
 		break;
+	case SIGUSR1:
+		__ofono_trace_dump();
+		break;
 	default:
 		break;
 	}
@@ -143,6 +146,7 @@ int main(int argc, char **argv)
 	sigemptyset(&mask);
 	sigaddset(&mask, SIGTERM);
 	sigaddset(&mask, SIGINT);
+	sigaddset(&mask, SIGUSR1);
 
 	if (sigprocmask(SIG_BLOCK, &mask, NULL) < 0) {
 		perror("Can't set signal mask");
@@ -205,6 +209,7 @@ int main(int argc, char **argv)
 #endif
 
 	__ofono_log_init(option_debug, option_detach);
+	__ofono_trace_init();
 
 	dbus_error_init(&error);
 
@@ -246,6 +251,7 @@ cleanup:
 	g_source_remove(signal_source);
 	g_main_loop_unref(event_loop);
 
+	__ofono_trace_cleanup();
 	__ofono_log_cleanup();
 
 	return 0;
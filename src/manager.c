@@ -77,14 +77,257 @@ static DBusMessage *manager_get_modems(DBusConnection *conn,
 	return reply;
 }
 
+static DBusMessage *manager_get_managed_objects(DBusConnection *conn,
+						DBusMessage *msg, void *data)
+{
+	DBusMessage *reply;
+	DBusMessageIter iter;
+	DBusMessageIter array;
+
+	reply = dbus_message_new_method_return(msg);
+	if (reply == NULL)
+		return NULL;
+
+	dbus_message_iter_init_append(reply, &iter);
+
+	dbus_message_iter_open_container(&iter, DBUS_TYPE_ARRAY,
+					DBUS_DICT_ENTRY_BEGIN_CHAR_AS_STRING
+					DBUS_TYPE_OBJECT_PATH_AS_STRING
+					DBUS_TYPE_ARRAY_AS_STRING
+					DBUS_DICT_ENTRY_BEGIN_CHAR_AS_STRING
+					DBUS_TYPE_STRING_AS_STRING
+					DBUS_TYPE_ARRAY_AS_STRING
+					DBUS_DICT_ENTRY_BEGIN_CHAR_AS_STRING
+					DBUS_TYPE_STRING_AS_STRING
+					DBUS_TYPE_VARIANT_AS_STRING
+					DBUS_DICT_ENTRY_END_CHAR_AS_STRING
+					DBUS_DICT_ENTRY_END_CHAR_AS_STRING
+					DBUS_DICT_ENTRY_END_CHAR_AS_STRING,
+					&array);
+	g_dbus_append_objects(conn, OFONO_MANAGER_PATH, &array);
+	dbus_message_iter_close_container(&iter, &array);
+
+	return reply;
+}
+
+/*
+ * Changes to the object tree are collected per path and signalled from
+ * an idle callback.  An atom registers its interface before it has
+ * finished setting itself up, so this gives InterfacesAdded complete
+ * properties and turns the dozens of registrations of a modem coming
+ * up into a single signal.
+ */
+struct object_change {
+	char *path;
+	GSList *added;
+	GSList *removed;
+};
+
+static GSList *change_list;
+static guint change_source;
+
+static struct object_change *object_change_get(const char *path)
+{
+	struct object_change *change;
+	GSList *l;
+
+	for (l = change_list; l; l = l->next) {
+		change = l->data;
+
+		if (g_str_equal(change->path, path))
+			return change;
+	}
+
+	change = g_new0(struct object_change, 1);
+	change->path = g_strdup(path);
+
+	change_list = g_slist_append(change_list, change);
+
+	return change;
+}
+
+static void object_change_free(struct object_change *change)
+{
+	g_slist_foreach(change->added, (GFunc) g_free, NULL);
+	g_slist_free(change->added);
+	g_slist_foreach(change->removed, (GFunc) g_free, NULL);
+	g_slist_free(change->removed);
+	g_free(change->path);
+	g_free(change);
+}
+
+static void emit_interfaces_removed(DBusConnection *conn,
+					struct object_change *change)
+{
+	DBusMessage *signal;
+	DBusMessageIter iter, array;
+	GSList *l;
+
+	signal = dbus_message_new_signal(OFONO_MANAGER_PATH,
+						OFONO_MANAGER_INTERFACE,
+						"InterfacesRemoved");
+	if (signal == NULL)
+		return;
+
+	dbus_message_iter_init_append(signal, &iter);
+	dbus_message_iter_append_basic(&iter, DBUS_TYPE_OBJECT_PATH,
+					&change->path);
+	dbus_message_iter_open_container(&iter, DBUS_TYPE_ARRAY,
+					DBUS_TYPE_STRING_AS_STRING, &array);
+
+	for (l = change->removed; l; l = l->next)
+		dbus_message_iter_append_basic(&array, DBUS_TYPE_STRING,
+						&l->data);
+
+	dbus_message_iter_close_container(&iter, &array);
+
+	g_dbus_send_message(conn, signal);
+}
+
+static void emit_interfaces_added(DBusConnection *conn,
+					struct object_change *change)
+{
+	DBusMessage *signal;
+	DBusMessageIter iter, array;
+	gboolean found = FALSE;
+	GSList *l;
+
+	signal = dbus_message_new_signal(OFONO_MANAGER_PATH,
+						OFONO_MANAGER_INTERFACE,
+						"InterfacesAdded");
+	if (signal == NULL)
+		return;
+
+	dbus_message_iter_init_append(signal, &iter);
+	dbus_message_iter_append_basic(&iter, DBUS_TYPE_OBJECT_PATH,
+					&change->path);
+	dbus_message_iter_open_container(&iter, DBUS_TYPE_ARRAY,
+					DBUS_DICT_ENTRY_BEGIN_CHAR_AS_STRING
+					DBUS_TYPE_STRING_AS_STRING
+					DBUS_TYPE_ARRAY_AS_STRING
+					DBUS_DICT_ENTRY_BEGIN_CHAR_AS_STRING
+					DBUS_TYPE_STRING_AS_STRING
+					DBUS_TYPE_VARIANT_AS_STRING
+					DBUS_DICT_ENTRY_END_CHAR_AS_STRING
+					DBUS_DICT_ENTRY_END_CHAR_AS_STRING,
+					&array);
+
+	for (l = change->added; l; l = l->next) {
+		if (g_dbus_append_interface(conn, change->path, l->data,
+						&array) == TRUE)
+			found = TRUE;
+	}
+
+	dbus_message_iter_close_container(&iter, &array);
+
+	if (found == FALSE) {
+		dbus_message_unref(signal);
+		return;
+	}
+
+	g_dbus_send_message(conn, signal);
+}
+
+static gboolean flush_object_changes(gpointer user_data)
+{
+	DBusConnection *conn = ofono_dbus_get_connection();
+	GSList *l;
+
+	change_source = 0;
+
+	for (l = change_list; l; l = l->next) {
+		struct object_change *change = l->data;
+
+		if (change->removed)
+			emit_interfaces_removed(conn, change);
+
+		if (change->added)
+			emit_interfaces_added(conn, change);
+
+		object_change_free(change);
+	}
+
+	g_slist_free(change_list);
+	change_list = NULL;
+
+	return FALSE;
+}
+
+static GSList *remove_name(GSList *list, const char *name, gboolean *found)
+{
+	GSList *l;
+
+	*found = FALSE;
+
+	for (l = list; l; l = l->next) {
+		if (!g_str_equal(l->data, name))
+			continue;
+
+		*found = TRUE;
+		g_free(l->data);
+
+		return g_slist_delete_link(list, l);
+	}
+
+	return list;
+}
+
+static void interface_changed(DBusConnection *conn, const char *path,
+				const char *interface, gboolean registered,
+				void *user_data)
+{
+	struct object_change *change;
+	gboolean found;
+
+	/* The manager itself is not part of the tree it describes */
+	if (g_str_equal(path, OFONO_MANAGER_PATH))
+		return;
+
+	change = object_change_get(path);
+
+	if (registered == TRUE) {
+		change->added = g_slist_append(change->added,
+						g_strdup(interface));
+	} else {
+		/* Nobody was told about it yet, so nobody is told now */
+		change->added = remove_name(change->added, interface, &found);
+
+		if (found == FALSE)
+			change->removed = g_slist_append(change->removed,
+							g_strdup(interface));
+	}
+
+	if (change_source == 0)
+		change_source = g_idle_add(flush_object_changes, NULL);
+}
+
+static DBusMessage *manager_set_debug(DBusConnection *conn,
+					DBusMessage *msg, void *data)
+{
+	const char *debug;
+
+	if (dbus_message_get_args(msg, NULL, DBUS_TYPE_STRING, &debug,
+					DBUS_TYPE_INVALID) == FALSE)
+		return __ofono_error_invalid_args(msg);
+
+	__ofono_log_set_debug(*debug ? debug : NULL);
+
+	return dbus_message_new_method_return(msg);
+}
+
 static GDBusMethodTable manager_methods[] = {
 	{ "GetModems",          "",    "a(oa{sv})",  manager_get_modems },
+	{ "GetManagedObjects",  "",    "a{oa{sa{sv}}}",
+						manager_get_managed_objects },
+	{ "SetDebug",           "s",   "",           manager_set_debug },
 	{ }
 };
 
 static GDBusSignalTable manager_signals[] = {
 	{ "ModemAdded",        "oa{sv}" },
 	{ "ModemRemoved",      "o" },
+	{ "InterfacesAdded",   "oa{sa{sv}}" },
+	{ "InterfacesRemoved", "oas" },
 	{ }
 };
 
@@ -101,6 +344,8 @@ int __ofono_manager_init()
 	if (ret == FALSE)
 		return -1;
 
+	g_dbus_set_interface_function(interface_changed, NULL);
+
 	return 0;
 }
 
@@ -108,6 +353,17 @@ void __ofono_manager_cleanup()
 {
 	DBusConnection *conn = ofono_dbus_get_connection();
 
+	g_dbus_set_interface_function(NULL, NULL);
+
+	if (change_source) {
+		g_source_remove(change_source);
+		change_source = 0;
+	}
+
+	g_slist_foreach(change_list, (GFunc) object_change_free, NULL);
+	g_slist_free(change_list);
+	change_list = NULL;
+
 	g_dbus_unregister_interface(conn, OFONO_MANAGER_PATH,
 					OFONO_MANAGER_INTERFACE);
 }
@@ -56,6 +56,25 @@ enum modem_state {
 	MODEM_STATE_ONLINE,
 };
 
+/* Steps of the bring-up, timed from the request to power up */
+enum modem_milestone {
+	MODEM_MILESTONE_ENABLE,
+	MODEM_MILESTONE_POWERED,
+	MODEM_MILESTONE_DEVINFO,
+	MODEM_MILESTONE_SIM_INSERTED,
+	MODEM_MILESTONE_READY,
+	MODEM_MILESTONE_ONLINE,
+};
+
+static const char *milestone_names[] = {
+	[MODEM_MILESTONE_ENABLE] = "enable",
+	[MODEM_MILESTONE_POWERED] = "powered",
+	[MODEM_MILESTONE_DEVINFO] = "devinfo",
+	[MODEM_MILESTONE_SIM_INSERTED] = "sim inserted",
+	[MODEM_MILESTONE_READY] = "ready",
+	[MODEM_MILESTONE_ONLINE] = "online",
+};
+
 struct ofono_modem {
 	char			*path;
 	enum modem_state	modem_state;
@@ -69,6 +88,7 @@ struct ofono_modem {
 	ofono_bool_t		powered;
 	ofono_bool_t		powered_pending;
 	guint			timeout;
+	GTimer			*timeline;
 	ofono_bool_t		online;
 	GHashTable		*properties;
 	struct ofono_sim	*sim;
@@ -85,6 +105,7 @@ struct ofono_devinfo {
 	char *model;
 	char *revision;
 	char *serial;
+	int pending;
 	const struct ofono_devinfo_driver *driver;
 	void *driver_data;
 	struct ofono_atom *atom;
@@ -223,6 +244,9 @@ void __ofono_atom_register(struct ofono_atom *atom,
 
 	atom->unregister = unregister;
 
+	ofono_trace(OFONO_TRACE_ATOM_REGISTER, atom->type, 0,
+			atom->modem->path);
+
 	call_watches(atom, OFONO_ATOM_WATCH_CONDITION_REGISTERED);
 }
 
@@ -231,6 +255,9 @@ void __ofono_atom_unregister(struct ofono_atom *atom)
 	if (atom->unregister == NULL)
 		return;
 
+	ofono_trace(OFONO_TRACE_ATOM_UNREGISTER, atom->type, 0,
+			atom->modem->path);
+
 	call_watches(atom, OFONO_ATOM_WATCH_CONDITION_UNREGISTERED);
 
 	atom->unregister(atom);
@@ -358,6 +385,32 @@ static void flush_atoms(struct ofono_modem *modem, enum modem_state new_state)
 	}
 }
 
+static void modem_milestone(struct ofono_modem *modem,
+				enum modem_milestone milestone)
+{
+	unsigned int ms;
+
+	if (milestone == MODEM_MILESTONE_ENABLE) {
+		if (modem->timeline == NULL)
+			modem->timeline = g_timer_new();
+
+		g_timer_start(modem->timeline);
+	}
+
+	if (modem->timeline == NULL)
+		return;
+
+	ms = g_timer_elapsed(modem->timeline, NULL) * 1000;
+
+	DBG("%s: %s after %u ms", modem->path,
+			milestone_names[milestone], ms);
+
+	ofono_trace(OFONO_TRACE_MODEM_MILESTONE, milestone, ms, modem->path);
+
+	if (milestone == MODEM_MILESTONE_READY)
+		ofono_info("%s: ready %u ms after power up", modem->path, ms);
+}
+
 static void modem_change_state(struct ofono_modem *modem,
 				enum modem_state new_state)
 {
@@ -387,12 +440,18 @@ static void modem_change_state(struct ofono_modem *modem,
 		break;
 
 	case MODEM_STATE_PRE_SIM:
-		if (old_state < MODEM_STATE_PRE_SIM && driver->pre_sim)
-			driver->pre_sim(modem);
+		if (old_state < MODEM_STATE_PRE_SIM) {
+			modem_milestone(modem, MODEM_MILESTONE_POWERED);
+
+			if (driver->pre_sim)
+				driver->pre_sim(modem);
+		}
 		break;
 
 	case MODEM_STATE_OFFLINE:
 		if (old_state < MODEM_STATE_OFFLINE) {
+			modem_milestone(modem, MODEM_MILESTONE_READY);
+
 			if (driver->post_sim)
 				driver->post_sim(modem);
 			__ofono_history_probe_drivers(modem);
@@ -401,6 +460,8 @@ static void modem_change_state(struct ofono_modem *modem,
 		break;
 
 	case MODEM_STATE_ONLINE:
+		modem_milestone(modem, MODEM_MILESTONE_ONLINE);
+
 		if (driver->post_online)
 			driver->post_online(modem);
 		break;
@@ -416,6 +477,7 @@ static void sim_state_watch(enum ofono_sim_state new_state, void *user)
 		modem_change_state(modem, MODEM_STATE_PRE_SIM);
 		break;
 	case OFONO_SIM_STATE_INSERTED:
+		modem_milestone(modem, MODEM_MILESTONE_SIM_INSERTED);
 		break;
 	case OFONO_SIM_STATE_READY:
 		modem_change_state(modem, MODEM_STATE_OFFLINE);
@@ -609,6 +671,8 @@ static int set_powered(struct ofono_modem *modem, ofono_bool_t powered)
 		return -EINVAL;
 
 	if (powered == TRUE) {
+		modem_milestone(modem, MODEM_MILESTONE_ENABLE);
+
 		if (driver->enable)
 			err = driver->enable(modem);
 	} else {
@@ -920,6 +984,17 @@ void ofono_modem_remove_interface(struct ofono_modem *modem,
 	modem->interface_update = g_idle_add(trigger_interface_update, modem);
 }
 
+static void devinfo_query_done(struct ofono_devinfo *info)
+{
+	info->pending -= 1;
+
+	if (info->pending > 0)
+		return;
+
+	modem_milestone(__ofono_atom_get_modem(info->atom),
+				MODEM_MILESTONE_DEVINFO);
+}
+
 static void query_serial_cb(const struct ofono_error *error,
 				const char *serial, void *user)
 {
@@ -928,7 +1003,7 @@ static void query_serial_cb(const struct ofono_error *error,
 	const char *path = __ofono_atom_get_path(info->atom);
 
 	if (error->type != OFONO_ERROR_TYPE_NO_ERROR)
-		return;
+		goto out;
 
 	info->serial = g_strdup(serial);
 
@@ -936,14 +1011,9 @@ static void query_serial_cb(const struct ofono_error *error,
 						OFONO_MODEM_INTERFACE,
 						"Serial", DBUS_TYPE_STRING,
 						&info->serial);
-}
-
-static void query_serial(struct ofono_devinfo *info)
-{
-	if (!info->driver->query_serial)
-		return;
 
-	info->driver->query_serial(info, query_serial_cb, info);
+out:
+	devinfo_query_done(info);
 }
 
 static void query_revision_cb(const struct ofono_error *error,
@@ -964,17 +1034,7 @@ static void query_revision_cb(const struct ofono_error *error,
 						&info->revision);
 
 out:
-	query_serial(info);
-}
-
-static void query_revision(struct ofono_devinfo *info)
-{
-	if (!info->driver->query_revision) {
-		query_serial(info);
-		return;
-	}
-
-	info->driver->query_revision(info, query_revision_cb, info);
+	devinfo_query_done(info);
 }
 
 static void query_model_cb(const struct ofono_error *error,
@@ -995,17 +1055,7 @@ static void query_model_cb(const struct ofono_error *error,
 						&info->model);
 
 out:
-	query_revision(info);
-}
-
-static void query_model(struct ofono_devinfo *info)
-{
-	if (!info->driver->query_model) {
-		/* If model is not supported, don't bother querying revision */
-		query_serial(info);
-	}
-
-	info->driver->query_model(info, query_model_cb, info);
+	devinfo_query_done(info);
 }
 
 static void query_manufacturer_cb(const struct ofono_error *error,
@@ -1026,21 +1076,52 @@ static void query_manufacturer_cb(const struct ofono_error *error,
 						&info->manufacturer);
 
 out:
-	query_model(info);
+	devinfo_query_done(info);
 }
 
-static gboolean query_manufacturer(gpointer user)
+/*
+ * None of the queries depend on another, so they are all sent at once
+ * and the driver is free to answer them in any order.
+ */
+static void query_devinfo(struct ofono_devinfo *info)
 {
-	struct ofono_devinfo *info = user;
+	const struct ofono_devinfo_driver *driver = info->driver;
+	gboolean revision;
 
-	if (!info->driver->query_manufacturer) {
-		query_model(info);
-		return FALSE;
-	}
+	if (driver == NULL)
+		return;
 
-	info->driver->query_manufacturer(info, query_manufacturer_cb, info);
+	/* If model is not supported, don't bother querying revision */
+	revision = driver->query_model && driver->query_revision;
 
-	return FALSE;
+	/* Count first, the callbacks may be called right away */
+	info->pending = 1;
+
+	if (driver->query_manufacturer)
+		info->pending += 1;
+
+	if (driver->query_model)
+		info->pending += 1;
+
+	if (revision)
+		info->pending += 1;
+
+	if (driver->query_serial)
+		info->pending += 1;
+
+	if (driver->query_manufacturer)
+		driver->query_manufacturer(info, query_manufacturer_cb, info);
+
+	if (driver->query_model)
+		driver->query_model(info, query_model_cb, info);
+
+	if (revision)
+		driver->query_revision(info, query_revision_cb, info);
+
+	if (driver->query_serial)
+		driver->query_serial(info, query_serial_cb, info);
+
+	devinfo_query_done(info);
 }
 
 int ofono_devinfo_driver_register(const struct ofono_devinfo_driver *d)
@@ -1115,7 +1196,7 @@ struct ofono_devinfo *ofono_devinfo_create(struct ofono_modem *modem,
 
 void ofono_devinfo_register(struct ofono_devinfo *info)
 {
-	query_manufacturer(info);
+	query_devinfo(info);
 }
 
 void ofono_devinfo_remove(struct ofono_devinfo *info)
@@ -1453,6 +1534,11 @@ static void modem_unregister(struct ofono_modem *modem)
 		modem->timeout = 0;
 	}
 
+	if (modem->timeline) {
+		g_timer_destroy(modem->timeline);
+		modem->timeline = NULL;
+	}
+
 	if (modem->pending) {
 		dbus_message_unref(modem->pending);
 		modem->pending = NULL;
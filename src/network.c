@@ -36,9 +36,13 @@
 #include "simutil.h"
 #include "util.h"
 #include "storage.h"
+#include "strength.h"
 
 #define NETWORK_REGISTRATION_FLAG_HOME_SHOW_PLMN 0x1
 #define NETWORK_REGISTRATION_FLAG_ROAMING_SHOW_SPN 0x2
+#define NETWORK_REGISTRATION_FLAG_REQUESTING_OPINFO 0x4
+#define NETWORK_REGISTRATION_FLAG_RECHECK_OPINFO 0x8
+#define NETWORK_REGISTRATION_FLAG_OPINFO_STALE 0x10
 
 enum network_registration_mode {
 	NETWORK_REGISTRATION_MODE_AUTO = 0,
@@ -47,10 +51,17 @@ enum network_registration_mode {
 	NETWORK_REGISTRATION_MODE_MANUAL_AUTO = 4
 };
 
+/*
+ * Window in milliseconds over which registration PropertyChanged signals
+ * are coalesced, 0 means until the main loop goes idle
+ */
+#define NETREG_SIGNAL_WINDOW 0
+
 #define SETTINGS_STORE "netreg"
 #define SETTINGS_GROUP "Settings"
 
 static GSList *g_drivers = NULL;
+static GSList *g_netregs = NULL;
 
 /* 27.007 Section 7.3 <stat> */
 enum operator_status {
@@ -73,6 +84,7 @@ struct ofono_netreg {
 	int flags;
 	DBusMessage *pending;
 	int signal_strength;
+	struct strength_filter *strength;
 	char *spname;
 	struct sim_spdi *spdi;
 	struct sim_eons *eons;
@@ -80,6 +92,9 @@ struct ofono_netreg {
 	GKeyFile *settings;
 	char *imsi;
 	struct ofono_watchlist *status_watches;
+	struct ofono_dbus_batch *batch;
+	unsigned int opinfo_queries;
+	unsigned int opinfo_queries_avoided;
 	const struct ofono_netreg_driver *driver;
 	void *driver_data;
 	struct ofono_atom *atom;
@@ -208,6 +223,8 @@ static void register_callback(const struct ofono_error *error, void *data)
 	netreg->pending = NULL;
 
 out:
+	netreg->flags |= NETWORK_REGISTRATION_FLAG_OPINFO_STALE;
+
 	if (netreg->driver->registration_status)
 		netreg->driver->registration_status(netreg,
 					registration_status_callback, netreg);
@@ -217,6 +234,8 @@ static void init_register(const struct ofono_error *error, void *data)
 {
 	struct ofono_netreg *netreg = data;
 
+	netreg->flags |= NETWORK_REGISTRATION_FLAG_OPINFO_STALE;
+
 	if (netreg->driver->registration_status)
 		netreg->driver->registration_status(netreg,
 					registration_status_callback, netreg);
@@ -422,14 +441,10 @@ static void set_network_operator_name(struct network_operator_data *opd,
 		return;
 
 	if (opd == netreg->current_operator) {
-		const char *path = __ofono_atom_get_path(netreg->atom);
-
 		operator = get_operator_display_name(netreg);
 
-		ofono_dbus_signal_property_changed(conn, path,
-					OFONO_NETWORK_REGISTRATION_INTERFACE,
-					"Name", DBUS_TYPE_STRING,
-					&operator);
+		__ofono_dbus_batch_property_changed(netreg->batch, "Name",
+						DBUS_TYPE_STRING, &operator);
 	}
 
 	/* Don't emit when only operator name is reported */
@@ -477,14 +492,12 @@ static void set_network_operator_eons_info(struct network_operator_data *opd,
 					"Name", DBUS_TYPE_STRING, &newname);
 
 		if (opd == netreg->current_operator) {
-			const char *npath = __ofono_atom_get_path(netreg->atom);
 			const char *operator =
 				get_operator_display_name(netreg);
 
-			ofono_dbus_signal_property_changed(conn, npath,
-					OFONO_NETWORK_REGISTRATION_INTERFACE,
-					"Name", DBUS_TYPE_STRING,
-					&operator);
+			__ofono_dbus_batch_property_changed(netreg->batch,
+						"Name", DBUS_TYPE_STRING,
+						&operator);
 		}
 	}
 
@@ -1027,21 +1040,15 @@ static GDBusSignalTable network_registration_signals[] = {
 static void set_registration_status(struct ofono_netreg *netreg, int status)
 {
 	const char *str_status = registration_status_to_string(status);
-	const char *path = __ofono_atom_get_path(netreg->atom);
-	DBusConnection *conn = ofono_dbus_get_connection();
 
 	netreg->status = status;
 
-	ofono_dbus_signal_property_changed(conn, path,
-					OFONO_NETWORK_REGISTRATION_INTERFACE,
-					"Status", DBUS_TYPE_STRING,
-					&str_status);
+	__ofono_dbus_batch_property_changed(netreg->batch, "Status",
+						DBUS_TYPE_STRING, &str_status);
 }
 
 static void set_registration_location(struct ofono_netreg *netreg, int lac)
 {
-	DBusConnection *conn = ofono_dbus_get_connection();
-	const char *path = __ofono_atom_get_path(netreg->atom);
 	dbus_uint16_t dbus_lac = lac;
 
 	if (lac > 0xffff)
@@ -1049,53 +1056,49 @@ static void set_registration_location(struct ofono_netreg *netreg, int lac)
 
 	netreg->location = lac;
 
-	if (netreg->location == -1)
+	if (netreg->location == -1) {
+		__ofono_dbus_batch_property_forget(netreg->batch,
+							"LocationAreaCode");
 		return;
+	}
 
-	ofono_dbus_signal_property_changed(conn, path,
-					OFONO_NETWORK_REGISTRATION_INTERFACE,
-					"LocationAreaCode",
-					DBUS_TYPE_UINT16, &dbus_lac);
+	__ofono_dbus_batch_property_changed(netreg->batch, "LocationAreaCode",
+						DBUS_TYPE_UINT16, &dbus_lac);
 }
 
 static void set_registration_cellid(struct ofono_netreg *netreg, int ci)
 {
-	DBusConnection *conn = ofono_dbus_get_connection();
-	const char *path = __ofono_atom_get_path(netreg->atom);
 	dbus_uint32_t dbus_ci = ci;
 
 	netreg->cellid = ci;
 
-	if (netreg->cellid == -1)
+	if (netreg->cellid == -1) {
+		__ofono_dbus_batch_property_forget(netreg->batch, "CellId");
 		return;
+	}
 
-	ofono_dbus_signal_property_changed(conn, path,
-					OFONO_NETWORK_REGISTRATION_INTERFACE,
-					"CellId", DBUS_TYPE_UINT32, &dbus_ci);
+	__ofono_dbus_batch_property_changed(netreg->batch, "CellId",
+						DBUS_TYPE_UINT32, &dbus_ci);
 }
 
 static void set_registration_technology(struct ofono_netreg *netreg, int tech)
 {
 	const char *tech_str = registration_tech_to_string(tech);
-	DBusConnection *conn = ofono_dbus_get_connection();
-	const char *path = __ofono_atom_get_path(netreg->atom);
 
 	netreg->technology = tech;
 
-	if (netreg->technology == -1)
+	if (netreg->technology == -1) {
+		__ofono_dbus_batch_property_forget(netreg->batch, "Technology");
 		return;
+	}
 
-	ofono_dbus_signal_property_changed(conn, path,
-					OFONO_NETWORK_REGISTRATION_INTERFACE,
-					"Technology", DBUS_TYPE_STRING,
-					&tech_str);
+	__ofono_dbus_batch_property_changed(netreg->batch, "Technology",
+						DBUS_TYPE_STRING, &tech_str);
 }
 
 void __ofono_netreg_set_base_station_name(struct ofono_netreg *netreg,
 						const char *name)
 {
-	DBusConnection *conn = ofono_dbus_get_connection();
-	const char *path = __ofono_atom_get_path(netreg->atom);
 	const char *base_station = name ? name : "";
 
 	/* Cell ID changed, but we don't have a cell name, nothing to do */
@@ -1116,10 +1119,8 @@ void __ofono_netreg_set_base_station_name(struct ofono_netreg *netreg,
 		netreg->base_station = g_strdup(name);
 	}
 
-	ofono_dbus_signal_property_changed(conn, path,
-					OFONO_NETWORK_REGISTRATION_INTERFACE,
-					"BaseStation", DBUS_TYPE_STRING,
-					&base_station);
+	__ofono_dbus_batch_property_changed(netreg->batch, "BaseStation",
+					DBUS_TYPE_STRING, &base_station);
 }
 
 unsigned int __ofono_netreg_add_status_watch(struct ofono_netreg *netreg,
@@ -1185,13 +1186,10 @@ static void reset_available(struct network_operator_data *old,
 		set_network_operator_status(old, OPERATOR_STATUS_AVAILABLE);
 }
 
-static void current_operator_callback(const struct ofono_error *error,
-				const struct ofono_network_operator *current,
-				void *data)
+static void update_current_operator(struct ofono_netreg *netreg,
+				const struct ofono_error *error,
+				const struct ofono_network_operator *current)
 {
-	DBusConnection *conn = ofono_dbus_get_connection();
-	struct ofono_netreg *netreg = data;
-	const char *path = __ofono_atom_get_path(netreg->atom);
 	GSList *op = NULL;
 	const char *operator;
 
@@ -1208,9 +1206,12 @@ static void current_operator_callback(const struct ofono_error *error,
 
 	if (error->type != OFONO_ERROR_TYPE_NO_ERROR) {
 		DBG("Error during current operator");
+		netreg->flags |= NETWORK_REGISTRATION_FLAG_OPINFO_STALE;
 		return;
 	}
 
+	netreg->flags &= ~NETWORK_REGISTRATION_FLAG_OPINFO_STALE;
+
 	if (!netreg->current_operator && !current)
 		return;
 
@@ -1264,65 +1265,144 @@ static void current_operator_callback(const struct ofono_error *error,
 emit:
 	operator = get_operator_display_name(netreg);
 
-	ofono_dbus_signal_property_changed(conn, path,
-					OFONO_NETWORK_REGISTRATION_INTERFACE,
-					"Name", DBUS_TYPE_STRING,
-					&operator);
+	__ofono_dbus_batch_property_changed(netreg->batch, "Name",
+						DBUS_TYPE_STRING, &operator);
 
 	if (netreg->current_operator) {
 		if (netreg->current_operator->mcc[0] != '\0') {
 			const char *mcc = netreg->current_operator->mcc;
-			ofono_dbus_signal_property_changed(conn, path,
-					OFONO_NETWORK_REGISTRATION_INTERFACE,
-					"MobileCountryCode",
-					DBUS_TYPE_STRING, &mcc);
+			__ofono_dbus_batch_property_changed(netreg->batch,
+						"MobileCountryCode",
+						DBUS_TYPE_STRING, &mcc);
 		}
 
 		if (netreg->current_operator->mnc[0] != '\0') {
 			const char *mnc = netreg->current_operator->mnc;
-			ofono_dbus_signal_property_changed(conn, path,
-					OFONO_NETWORK_REGISTRATION_INTERFACE,
-					"MobileNetworkCode",
-					DBUS_TYPE_STRING, &mnc);
+			__ofono_dbus_batch_property_changed(netreg->batch,
+						"MobileNetworkCode",
+						DBUS_TYPE_STRING, &mnc);
 		}
 	}
 
 	notify_status_watches(netreg);
 }
 
+static inline gboolean is_registered(int status)
+{
+	return status == NETWORK_REGISTRATION_STATUS_REGISTERED ||
+		status == NETWORK_REGISTRATION_STATUS_ROAMING;
+}
+
+static void query_current_operator(struct ofono_netreg *netreg);
+
+static void current_operator_callback(const struct ofono_error *error,
+				const struct ofono_network_operator *current,
+				void *data)
+{
+	struct ofono_netreg *netreg = data;
+
+	netreg->flags &= ~NETWORK_REGISTRATION_FLAG_REQUESTING_OPINFO;
+
+	update_current_operator(netreg, error, current);
+
+	if (!(netreg->flags & NETWORK_REGISTRATION_FLAG_RECHECK_OPINFO))
+		return;
+
+	netreg->flags &= ~NETWORK_REGISTRATION_FLAG_RECHECK_OPINFO;
+
+	if (is_registered(netreg->status))
+		query_current_operator(netreg);
+}
+
+static void query_current_operator(struct ofono_netreg *netreg)
+{
+	if (netreg->driver->current_operator == NULL)
+		return;
+
+	/* Let the query in flight finish, then ask again */
+	if (netreg->flags & NETWORK_REGISTRATION_FLAG_REQUESTING_OPINFO) {
+		netreg->flags |= NETWORK_REGISTRATION_FLAG_RECHECK_OPINFO;
+		return;
+	}
+
+	netreg->flags |= NETWORK_REGISTRATION_FLAG_REQUESTING_OPINFO;
+	netreg->opinfo_queries += 1;
+
+	netreg->driver->current_operator(netreg, current_operator_callback,
+						netreg);
+}
+
+/*
+ * The operator can only have changed if the registration status did,
+ * if we moved to a different location area on a different access
+ * technology, or if the last query failed or a registration request
+ * completed since.  Plain cell changes within the same PLMN are by far
+ * the most common update and do not warrant another round of +COPS
+ * queries.
+ */
+static gboolean current_operator_needs_update(struct ofono_netreg *netreg,
+						int old_status,
+						gboolean lac_changed,
+						gboolean tech_changed)
+{
+	if (netreg->current_operator == NULL)
+		return TRUE;
+
+	if (netreg->flags & NETWORK_REGISTRATION_FLAG_OPINFO_STALE)
+		return TRUE;
+
+	if (old_status != netreg->status)
+		return TRUE;
+
+	return lac_changed && tech_changed;
+}
+
 void ofono_netreg_status_notify(struct ofono_netreg *netreg, int status,
 			int lac, int ci, int tech)
 {
+	int old_status;
+	gboolean lac_changed;
+	gboolean tech_changed;
+
 	if (!netreg)
 		return;
 
+	old_status = netreg->status;
+	lac_changed = netreg->location != lac;
+	tech_changed = netreg->technology != tech;
+
 	if (netreg->status != status)
 		set_registration_status(netreg, status);
 
-	if (netreg->location != lac)
+	if (lac_changed)
 		set_registration_location(netreg, lac);
 
 	if (netreg->cellid != ci)
 		set_registration_cellid(netreg, ci);
 
-	if (netreg->technology != tech)
+	if (tech_changed)
 		set_registration_technology(netreg, tech);
 
-	if (netreg->status == NETWORK_REGISTRATION_STATUS_REGISTERED ||
-		netreg->status == NETWORK_REGISTRATION_STATUS_ROAMING) {
-		if (netreg->driver->current_operator)
-			netreg->driver->current_operator(netreg,
-					current_operator_callback, netreg);
+	if (is_registered(netreg->status)) {
+		if (current_operator_needs_update(netreg, old_status,
+						lac_changed, tech_changed))
+			query_current_operator(netreg);
+		else
+			netreg->opinfo_queries_avoided += 1;
 	} else {
 		struct ofono_error error;
 
 		error.type = OFONO_ERROR_TYPE_NO_ERROR;
 		error.error = 0;
 
-		current_operator_callback(&error, NULL, netreg);
+		netreg->flags &= ~NETWORK_REGISTRATION_FLAG_RECHECK_OPINFO;
+
+		update_current_operator(netreg, &error, NULL);
 		__ofono_netreg_set_base_station_name(netreg, NULL);
 
 		netreg->signal_strength = -1;
+		strength_filter_reset(netreg->strength);
+		__ofono_dbus_batch_property_forget(netreg->batch, "Strength");
 	}
 
 	notify_status_watches(netreg);
@@ -1385,13 +1465,19 @@ static void init_registration_status(const struct ofono_error *error,
 	}
 }
 
-void ofono_netreg_strength_notify(struct ofono_netreg *netreg, int strength)
+static void strength_report(int strength, void *user_data)
 {
-	DBusConnection *conn = ofono_dbus_get_connection();
+	struct ofono_netreg *netreg = user_data;
+	dbus_uint16_t value = strength;
 
-	if (netreg->signal_strength == strength)
-		return;
+	netreg->signal_strength = strength;
+
+	__ofono_dbus_batch_property_changed(netreg->batch, "Strength",
+						DBUS_TYPE_UINT16, &value);
+}
 
+void ofono_netreg_strength_notify(struct ofono_netreg *netreg, int strength)
+{
 	/* Theoretically we can get signal strength even when not registered
 	 * to any network.  However, what do we do with it in that case?
 	 */
@@ -1399,17 +1485,12 @@ void ofono_netreg_strength_notify(struct ofono_netreg *netreg, int strength)
 		netreg->status != NETWORK_REGISTRATION_STATUS_ROAMING)
 		return;
 
-	netreg->signal_strength = strength;
-
-	if (strength != -1) {
-		const char *path = __ofono_atom_get_path(netreg->atom);
-		dbus_uint16_t strength = netreg->signal_strength;
-
-		ofono_dbus_signal_property_changed(conn, path,
-					OFONO_NETWORK_REGISTRATION_INTERFACE,
-					"Strength", DBUS_TYPE_UINT16,
-					&strength);
+	if (strength == -1) {
+		netreg->signal_strength = -1;
+		__ofono_dbus_batch_property_forget(netreg->batch, "Strength");
 	}
+
+	strength_filter_update(netreg->strength, strength);
 }
 
 static void sim_opl_read_cb(int ok, int length, int record,
@@ -1500,8 +1581,6 @@ static void sim_spdi_read_cb(int ok, int length, int record,
 		return;
 
 	if (netreg->status == NETWORK_REGISTRATION_STATUS_ROAMING) {
-		DBusConnection *conn = ofono_dbus_get_connection();
-		const char *path = __ofono_atom_get_path(netreg->atom);
 		const char *operator;
 
 		if (!sim_spdi_lookup(netreg->spdi,
@@ -1510,10 +1589,8 @@ static void sim_spdi_read_cb(int ok, int length, int record,
 
 		operator = get_operator_display_name(netreg);
 
-		ofono_dbus_signal_property_changed(conn, path,
-					OFONO_NETWORK_REGISTRATION_INTERFACE,
-					"Name", DBUS_TYPE_STRING,
-					&operator);
+		__ofono_dbus_batch_property_changed(netreg->batch, "Name",
+						DBUS_TYPE_STRING, &operator);
 	}
 }
 
@@ -1569,16 +1646,12 @@ static void sim_spn_read_cb(int ok, int length, int record,
 		netreg->flags |= NETWORK_REGISTRATION_FLAG_ROAMING_SHOW_SPN;
 
 	if (netreg->current_operator) {
-		DBusConnection *conn = ofono_dbus_get_connection();
-		const char *path = __ofono_atom_get_path(netreg->atom);
 		const char *operator;
 
 		operator = get_operator_display_name(netreg);
 
-		ofono_dbus_signal_property_changed(conn, path,
-					OFONO_NETWORK_REGISTRATION_INTERFACE,
-					"Name", DBUS_TYPE_STRING,
-					&operator);
+		__ofono_dbus_batch_property_changed(netreg->batch, "Name",
+						DBUS_TYPE_STRING, &operator);
 	}
 }
 
@@ -1666,6 +1739,11 @@ static void netreg_unregister(struct ofono_atom *atom)
 	__ofono_watchlist_free(netreg->status_watches);
 	netreg->status_watches = NULL;
 
+	strength_filter_reset(netreg->strength);
+
+
+	__ofono_dbus_batch_flush(netreg->batch);
+
 	for (l = netreg->operator_list; l; l = l->next) {
 		struct network_operator_data *opd = l->data;
 
@@ -1698,6 +1776,30 @@ static void netreg_unregister(struct ofono_atom *atom)
 					OFONO_NETWORK_REGISTRATION_INTERFACE);
 }
 
+static void netreg_trace_dump(FILE *out, void *user_data)
+{
+	GSList *l;
+
+	fprintf(out, "Signal strength updates: path reported suppressed\n");
+
+	for (l = g_netregs; l; l = l->next) {
+		struct ofono_netreg *netreg = l->data;
+
+		fprintf(out, "%s %u %u\n", __ofono_atom_get_path(netreg->atom),
+			strength_filter_get_reported(netreg->strength),
+			strength_filter_get_suppressed(netreg->strength));
+	}
+
+	fprintf(out, "\nCurrent operator queries: path issued avoided\n");
+
+	for (l = g_netregs; l; l = l->next) {
+		struct ofono_netreg *netreg = l->data;
+
+		fprintf(out, "%s %u %u\n", __ofono_atom_get_path(netreg->atom),
+			netreg->opinfo_queries, netreg->opinfo_queries_avoided);
+	}
+}
+
 static void netreg_remove(struct ofono_atom *atom)
 {
 	struct ofono_netreg *netreg = __ofono_atom_get_data(atom);
@@ -1719,6 +1821,14 @@ static void netreg_remove(struct ofono_atom *atom)
 	if (netreg->spname)
 		g_free(netreg->spname);
 
+	__ofono_dbus_batch_free(netreg->batch);
+
+	strength_filter_free(netreg->strength);
+
+	g_netregs = g_slist_remove(g_netregs, netreg);
+	if (g_netregs == NULL)
+		ofono_trace_dump_unregister(netreg_trace_dump);
+
 	g_free(netreg);
 }
 
@@ -1728,6 +1838,7 @@ struct ofono_netreg *ofono_netreg_create(struct ofono_modem *modem,
 					void *data)
 {
 	struct ofono_netreg *netreg;
+	const char *path;
 	GSList *l;
 
 	if (driver == NULL)
@@ -1744,9 +1855,25 @@ struct ofono_netreg *ofono_netreg_create(struct ofono_modem *modem,
 	netreg->technology = -1;
 	netreg->signal_strength = -1;
 
+	netreg->strength = strength_filter_new(strength_report, netreg);
+	if (netreg->strength == NULL) {
+		g_free(netreg);
+		return NULL;
+	}
+
 	netreg->atom = __ofono_modem_add_atom(modem, OFONO_ATOM_TYPE_NETREG,
 						netreg_remove, netreg);
 
+	path = __ofono_atom_get_path(netreg->atom);
+	netreg->batch = __ofono_dbus_batch_new(path,
+					OFONO_NETWORK_REGISTRATION_INTERFACE,
+					NETREG_SIGNAL_WINDOW);
+
+	if (g_netregs == NULL)
+		ofono_trace_dump_register(netreg_trace_dump, NULL);
+
+	g_netregs = g_slist_prepend(g_netregs, netreg);
+
 	for (l = g_drivers; l; l = l->next) {
 		const struct ofono_netreg_driver *drv = l->data;
 
@@ -1763,6 +1890,33 @@ struct ofono_netreg *ofono_netreg_create(struct ofono_modem *modem,
 	return netreg;
 }
 
+static void netreg_load_strength_policy(struct ofono_netreg *netreg,
+					struct ofono_modem *modem)
+{
+	int min_delta;
+	int min_interval;
+	int average;
+
+	/* Unset or 0 means no filtering, every change is reported */
+	min_delta = ofono_modem_get_integer(modem, "StrengthMinDelta");
+	if (min_delta < 0)
+		min_delta = 0;
+
+	min_interval = ofono_modem_get_integer(modem, "StrengthMinInterval");
+	if (min_interval < 0)
+		min_interval = 0;
+
+	average = ofono_modem_get_integer(modem, "StrengthAverage");
+	if (average < 1)
+		average = 1;
+
+	DBG("min delta %d, min interval %ds, average over %d",
+		min_delta, min_interval, average);
+
+	strength_filter_set_policy(netreg->strength, min_delta,
+					min_interval * 1000, average);
+}
+
 static void netreg_load_settings(struct ofono_netreg *netreg)
 {
 	const char *imsi;
@@ -1810,6 +1964,8 @@ void ofono_netreg_register(struct ofono_netreg *netreg)
 
 	netreg->status_watches = __ofono_watchlist_new(g_free);
 
+	netreg_load_strength_policy(netreg, modem);
+
 	ofono_modem_add_interface(modem, OFONO_NETWORK_REGISTRATION_INTERFACE);
 
 	if (netreg->driver->registration_status)
@@ -36,6 +36,15 @@ void __ofono_modem_shutdown();
 
 int __ofono_log_init(const char *debug, ofono_bool_t detach);
 void __ofono_log_cleanup(void);
+void __ofono_log_enable(struct ofono_debug_desc *start,
+					struct ofono_debug_desc *stop);
+void __ofono_log_disable(struct ofono_debug_desc *start,
+					struct ofono_debug_desc *stop);
+void __ofono_log_set_debug(const char *debug);
+
+void __ofono_trace_init(void);
+void __ofono_trace_cleanup(void);
+void __ofono_trace_dump(void);
 
 #include <ofono/dbus.h>
 
@@ -62,6 +71,19 @@ void __ofono_dbus_pending_reply(DBusMessage **msg, DBusMessage *reply);
 
 gboolean __ofono_dbus_valid_object_path(const char *path);
 
+struct ofono_dbus_batch;
+
+struct ofono_dbus_batch *__ofono_dbus_batch_new(const char *path,
+						const char *interface,
+						unsigned int window);
+void __ofono_dbus_batch_property_changed(struct ofono_dbus_batch *batch,
+						const char *name,
+						int type, void *value);
+void __ofono_dbus_batch_property_forget(struct ofono_dbus_batch *batch,
+						const char *name);
+void __ofono_dbus_batch_flush(struct ofono_dbus_batch *batch);
+void __ofono_dbus_batch_free(struct ofono_dbus_batch *batch);
+
 struct ofono_watchlist_item {
 	unsigned int id;
 	void *notify;
@@ -214,6 +236,7 @@ enum ofono_sms_submit_flag {
 	OFONO_SMS_SUBMIT_FLAG_REQUEST_SR =	0x1,
 	OFONO_SMS_SUBMIT_FLAG_RECORD_HISTORY =	0x2,
 	OFONO_SMS_SUBMIT_FLAG_RETRY =		0x4,
+	OFONO_SMS_SUBMIT_FLAG_PERSIST =		0x8,
 };
 
 typedef void (*ofono_sms_txq_submit_cb_t)(gboolean ok, void *data);
@@ -224,10 +247,15 @@ unsigned int __ofono_sms_txq_submit(struct ofono_sms *sms, GSList *list,
 					void *data, ofono_destroy_func destroy);
 
 #include <ofono/sim.h>
+
+void __ofono_sim_touch(struct ofono_sim *sim);
+unsigned int __ofono_sim_get_idle_time(struct ofono_sim *sim);
+
 #include <ofono/stk.h>
 
 struct cbs;
 void __ofono_cbs_sim_download(struct ofono_stk *stk, const struct cbs *msg);
+ofono_bool_t __ofono_stk_session_active(struct ofono_stk *stk);
 
 #include <ofono/ssn.h>
 
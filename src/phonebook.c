@@ -29,6 +29,10 @@
 #include <stdlib.h>
 #include <ctype.h>
 #include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <time.h>
 
 #include <glib.h>
 #include <gdbus.h>
@@ -42,6 +46,9 @@
 
 #define PHONEBOOK_FLAG_CACHED 0x1
 
+/* Amount of vCard data collected before it is written to a stream */
+#define STREAM_CHUNK_SIZE 4096
+
 static GSList *g_drivers = NULL;
 
 enum phonebook_number_type {
@@ -58,6 +65,10 @@ struct ofono_phonebook {
 	int flags;
 	GString *vcards; /* entries with vcard 3.0 format */
 	GSList *merge_list; /* cache the entries that may need a merge */
+	GHashTable *merge_table; /* merge_list entries keyed by their text */
+	int stream_fd; /* client descriptor of ImportStream, or -1 */
+	guint stream_watch;
+	gboolean stream_error;
 	const struct ofono_phonebook_driver *driver;
 	void *driver_data;
 	struct ofono_atom *atom;
@@ -248,6 +259,7 @@ static void print_merged_entry(struct phonebook_person *person, GString *vcards)
 	vcard_printf_begin(vcards);
 	vcard_printf_text(vcards, person->text);
 
+	person->number_list = g_slist_reverse(person->number_list);
 	g_slist_foreach(person->number_list, (GFunc)print_number, vcards);
 
 	vcard_printf_group(vcards, person->group);
@@ -286,6 +298,154 @@ static DBusMessage *generate_export_entries_reply(struct ofono_phonebook *pb,
 	return reply;
 }
 
+static void stream_close(struct ofono_phonebook *pb)
+{
+	if (pb->stream_watch > 0) {
+		g_source_remove(pb->stream_watch);
+		pb->stream_watch = 0;
+	}
+
+	if (pb->stream_fd >= 0) {
+		close(pb->stream_fd);
+		pb->stream_fd = -1;
+	}
+}
+
+static void stream_finish(struct ofono_phonebook *pb)
+{
+	DBusMessage *reply;
+
+	stream_close(pb);
+	g_string_set_size(pb->vcards, 0);
+
+	if (pb->stream_error)
+		reply = __ofono_error_failed(pb->pending);
+	else
+		reply = dbus_message_new_method_return(pb->pending);
+
+	__ofono_dbus_pending_reply(&pb->pending, reply);
+}
+
+static gboolean stream_write(struct ofono_phonebook *pb);
+
+/*
+ * The client can close its end of the stream at any time, and SIGPIPE
+ * would take the daemon down.  Keep it blocked around the write and
+ * discard the one raised, the write fails with EPIPE instead.
+ */
+static ssize_t stream_write_nosignal(int fd, const void *buf, size_t len)
+{
+	struct timespec zero = { 0, 0 };
+	sigset_t set, old;
+	ssize_t written;
+	int err;
+
+	sigemptyset(&set);
+	sigaddset(&set, SIGPIPE);
+	sigprocmask(SIG_BLOCK, &set, &old);
+
+	written = write(fd, buf, len);
+	err = errno;
+
+	if (written < 0 && err == EPIPE && !sigismember(&old, SIGPIPE)) {
+		while (sigtimedwait(&set, NULL, &zero) < 0 && errno == EINTR)
+			;
+	}
+
+	sigprocmask(SIG_SETMASK, &old, NULL);
+	errno = err;
+
+	return written;
+}
+
+static gboolean stream_can_write(GIOChannel *io, GIOCondition cond,
+					gpointer user_data)
+{
+	struct ofono_phonebook *pb = user_data;
+
+	if (cond & (G_IO_ERR | G_IO_HUP | G_IO_NVAL)) {
+		ofono_error("Phonebook stream closed by the client");
+		pb->stream_error = TRUE;
+	} else if (stream_write(pb) == TRUE)
+		return TRUE;
+
+	pb->stream_watch = 0;
+	g_string_set_size(pb->vcards, 0);
+
+	/* Otherwise the driver is still exporting the next storage */
+	if (storage_support[pb->storage_index] == NULL)
+		stream_finish(pb);
+
+	return FALSE;
+}
+
+/*
+ * Writes out as much of the buffered vCards as the client accepts.
+ * Returns TRUE if some of it is left and the writable watch is needed.
+ */
+static gboolean stream_write(struct ofono_phonebook *pb)
+{
+	GString *buf = pb->vcards;
+	ssize_t written;
+
+	while (buf->len > 0 && pb->stream_error == FALSE) {
+		written = stream_write_nosignal(pb->stream_fd, buf->str,
+							buf->len);
+
+		if (written < 0 && errno == EINTR)
+			continue;
+
+		if (written < 0 && errno == EAGAIN)
+			return TRUE;
+
+		if (written < 0) {
+			ofono_error("Phonebook stream write failed: %s",
+					strerror(errno));
+			pb->stream_error = TRUE;
+			break;
+		}
+
+		g_string_erase(buf, 0, written);
+	}
+
+	g_string_set_size(buf, 0);
+
+	return FALSE;
+}
+
+/*
+ * With ImportStream the vCards are handed to the client as they come,
+ * so that only about a chunk of them is ever kept here.  The merged
+ * entries are the exception, they are only complete once the storage
+ * is fully read.
+ */
+static void stream_flush(struct ofono_phonebook *pb, gboolean last)
+{
+	GIOChannel *io;
+
+	if (pb->stream_fd < 0)
+		return;
+
+	if (pb->stream_watch > 0)
+		return;
+
+	if (last == FALSE && pb->vcards->len < STREAM_CHUNK_SIZE)
+		return;
+
+	if (stream_write(pb) == FALSE) {
+		if (last)
+			stream_finish(pb);
+
+		return;
+	}
+
+	io = g_io_channel_unix_new(pb->stream_fd);
+	pb->stream_watch = g_io_add_watch(io, G_IO_OUT | G_IO_ERR |
+						G_IO_HUP | G_IO_NVAL,
+						stream_can_write, pb);
+	g_io_channel_unref(io);
+}
+
 static gboolean need_merge(const char *text)
 {
 	int len;
@@ -340,7 +500,7 @@ static void merge_field_number(GSList **l, const char *number, int type, char c)
 		break;
 	}
 	pn->category = category;
-	*l = g_slist_append(*l, pn);
+	*l = g_slist_prepend(*l, pn);
 }
 
 void ofono_phonebook_entry(struct ofono_phonebook *phonebook, int index,
@@ -363,23 +523,21 @@ void ofono_phonebook_entry(struct ofono_phonebook *phonebook, int index,
 	 * are deemed as entries of one person.
 	 */
 	if (need_merge(text)) {
-		GSList *l;
 		size_t len_text = strlen(text) - 2;
 		struct phonebook_person *person;
+		char *name = g_strndup(text, len_text);
 
-		for (l = phonebook->merge_list; l; l = l->next) {
-			person = l->data;
-			if (!strncmp(text, person->text, len_text) &&
-					(strlen(person->text) == len_text))
-				break;
-		}
+		person = g_hash_table_lookup(phonebook->merge_table, name);
 
-		if (!l) {
+		if (person == NULL) {
 			person = g_new0(struct phonebook_person, 1);
 			phonebook->merge_list =
 				g_slist_prepend(phonebook->merge_list, person);
-			person->text = g_strndup(text, len_text);
-		}
+			person->text = name;
+			g_hash_table_insert(phonebook->merge_table,
+						person->text, person);
+		} else
+			g_free(name);
 
 		merge_field_number(&(person->number_list), number, type,
 					text[len_text + 1]);
@@ -407,22 +565,29 @@ void ofono_phonebook_entry(struct ofono_phonebook *phonebook, int index,
 	vcard_printf_email(phonebook->vcards, email);
 	vcard_printf_sip_uri(phonebook->vcards, sip_uri);
 	vcard_printf_end(phonebook->vcards);
+
+	stream_flush(phonebook, FALSE);
 }
 
 static void export_phonebook_cb(const struct ofono_error *error, void *data)
 {
 	struct ofono_phonebook *phonebook = data;
+	GSList *l;
 
 	if (error->type != OFONO_ERROR_TYPE_NO_ERROR)
 		ofono_error("export_entries_one_storage_cb with %s failed",
 				storage_support[phonebook->storage_index]);
 
 	/* convert the collected entries that are already merged to vcard */
+	g_hash_table_remove_all(phonebook->merge_table);
 	phonebook->merge_list = g_slist_reverse(phonebook->merge_list);
-	g_slist_foreach(phonebook->merge_list, (GFunc)print_merged_entry,
-				phonebook->vcards);
-	g_slist_foreach(phonebook->merge_list, (GFunc)destroy_merged_entry,
-				NULL);
+
+	for (l = phonebook->merge_list; l; l = l->next) {
+		print_merged_entry(l->data, phonebook->vcards);
+		destroy_merged_entry(l->data);
+		stream_flush(phonebook, FALSE);
+	}
+
 	g_slist_free(phonebook->merge_list);
 	phonebook->merge_list = NULL;
 
@@ -442,6 +607,11 @@ static void export_phonebook(struct ofono_phonebook *phonebook)
 		return;
 	}
 
+	if (phonebook->stream_fd >= 0) {
+		stream_flush(phonebook, TRUE);
+		return;
+	}
+
 	reply = generate_export_entries_reply(phonebook, phonebook->pending);
 
 	if (!reply) {
@@ -480,9 +650,47 @@ static DBusMessage *import_entries(DBusConnection *conn, DBusMessage *msg,
 	return NULL;
 }
 
+#ifdef DBUS_TYPE_UNIX_FD
+static DBusMessage *import_stream(DBusConnection *conn, DBusMessage *msg,
+					void *data)
+{
+	struct ofono_phonebook *phonebook = data;
+	int fd;
+
+	if (phonebook->pending)
+		return __ofono_error_busy(msg);
+
+	if (dbus_message_get_args(msg, NULL, DBUS_TYPE_UNIX_FD, &fd,
+					DBUS_TYPE_INVALID) == FALSE)
+		return __ofono_error_invalid_args(msg);
+
+	if (fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK) < 0) {
+		close(fd);
+		return __ofono_error_invalid_args(msg);
+	}
+
+	/* The buffer now only holds the part not yet written to fd */
+	phonebook->flags &= ~PHONEBOOK_FLAG_CACHED;
+	g_string_set_size(phonebook->vcards, 0);
+	phonebook->storage_index = 0;
+
+	phonebook->stream_fd = fd;
+	phonebook->stream_error = FALSE;
+
+	phonebook->pending = dbus_message_ref(msg);
+	export_phonebook(phonebook);
+
+	return NULL;
+}
+#endif
+
 static GDBusMethodTable phonebook_methods[] = {
 	{ "Import",	"",	"s",	import_entries,
 					G_DBUS_METHOD_FLAG_ASYNC },
+#ifdef DBUS_TYPE_UNIX_FD
+	{ "ImportStream", "h",	"",	import_stream,
+					G_DBUS_METHOD_FLAG_ASYNC },
+#endif
 	{ }
 };
 
@@ -532,6 +740,17 @@ static void phonebook_remove(struct ofono_atom *atom)
 	if (pb->driver && pb->driver->remove)
 		pb->driver->remove(pb);
 
+	stream_close(pb);
+
+	/* An export still running will never complete now */
+	if (pb->pending) {
+		DBusMessage *reply = __ofono_error_failed(pb->pending);
+		__ofono_dbus_pending_reply(&pb->pending, reply);
+	}
+
+	g_slist_foreach(pb->merge_list, (GFunc)destroy_merged_entry, NULL);
+	g_slist_free(pb->merge_list);
+	g_hash_table_destroy(pb->merge_table);
 	g_string_free(pb->vcards, TRUE);
 	g_free(pb);
 }
@@ -552,6 +771,8 @@ struct ofono_phonebook *ofono_phonebook_create(struct ofono_modem *modem,
 		return NULL;
 
 	pb->vcards = g_string_new(NULL);
+	pb->merge_table = g_hash_table_new(g_str_hash, g_str_equal);
+	pb->stream_fd = -1;
 	pb->atom = __ofono_modem_add_atom(modem, OFONO_ATOM_TYPE_PHONEBOOK,
 						phonebook_remove, pb);
 
@@ -35,6 +35,8 @@ struct ofono_plugin {
 	void *handle;
 	gboolean active;
 	struct ofono_plugin_desc *desc;
+	struct ofono_debug_desc *debug_start;
+	struct ofono_debug_desc *debug_stop;
 };
 
 static gint compare_priority(gconstpointer a, gconstpointer b)
@@ -66,6 +68,14 @@ static gboolean add_plugin(void *handle, struct ofono_plugin_desc *desc)
 	plugin->active = FALSE;
 	plugin->desc = desc;
 
+	/* External plugins carry their own section of DBG descriptors */
+	if (handle != NULL) {
+		plugin->debug_start = dlsym(handle, "__start___debug");
+		plugin->debug_stop = dlsym(handle, "__stop___debug");
+
+		__ofono_log_enable(plugin->debug_start, plugin->debug_stop);
+	}
+
 	plugins = g_slist_insert_sorted(plugins, plugin, compare_priority);
 
 	return TRUE;
@@ -175,8 +185,11 @@ void __ofono_plugin_cleanup(void)
 		if (plugin->active == TRUE && plugin->desc->exit)
 			plugin->desc->exit();
 
-		if (plugin->handle)
+		if (plugin->handle) {
+			__ofono_log_disable(plugin->debug_start,
+						plugin->debug_stop);
 			dlclose(plugin->handle);
+		}
 
 		g_free(plugin);
 	}
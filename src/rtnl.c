@@ -0,0 +1,230 @@
+/*
+ *
+ *  oFono - Open Source Telephony
+ *
+ *  Copyright (C) 2008-2010  Intel Corporation. All rights reserved.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+
+#include <glib.h>
+
+#include "rtnl.h"
+
+#define RTNL_BUFFER_SIZE 16384
+
+struct rtnl {
+	int fd;
+	uint32_t seq;
+};
+
+struct rtnl *rtnl_open(void)
+{
+	struct rtnl *rtnl;
+	struct sockaddr_nl addr;
+	int fd;
+
+	fd = socket(PF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC, NETLINK_ROUTE);
+	if (fd < 0)
+		return NULL;
+
+	memset(&addr, 0, sizeof(addr));
+	addr.nl_family = AF_NETLINK;
+
+	if (bind(fd, (struct sockaddr *) &addr, sizeof(addr)) < 0) {
+		close(fd);
+		return NULL;
+	}
+
+	rtnl = g_try_new0(struct rtnl, 1);
+	if (rtnl == NULL) {
+		close(fd);
+		return NULL;
+	}
+
+	rtnl->fd = fd;
+
+	return rtnl;
+}
+
+void rtnl_close(struct rtnl *rtnl)
+{
+	if (rtnl == NULL)
+		return;
+
+	close(rtnl->fd);
+	g_free(rtnl);
+}
+
+static void parse_link(struct nlmsghdr *hdr, rtnl_link_func_t func,
+			void *user_data)
+{
+	struct ifinfomsg *msg = NLMSG_DATA(hdr);
+	struct rtnl_link_counters counters;
+	struct rtattr *attr;
+	const char *ifname = NULL;
+	gboolean found = FALSE;
+	int len;
+
+	if (hdr->nlmsg_len < NLMSG_LENGTH(sizeof(*msg)))
+		return;
+
+	len = IFLA_PAYLOAD(hdr);
+
+	for (attr = IFLA_RTA(msg); RTA_OK(attr, len);
+					attr = RTA_NEXT(attr, len)) {
+		switch (attr->rta_type) {
+		case IFLA_IFNAME:
+			if (RTA_PAYLOAD(attr) == 0 ||
+					memchr(RTA_DATA(attr), '\0',
+						RTA_PAYLOAD(attr)) == NULL)
+				break;
+
+			ifname = RTA_DATA(attr);
+			break;
+		case IFLA_STATS64:
+		{
+			struct rtnl_link_stats64 stats;
+
+			if (RTA_PAYLOAD(attr) < sizeof(stats))
+				break;
+
+			memcpy(&stats, RTA_DATA(attr), sizeof(stats));
+
+			counters.rx_packets = stats.rx_packets;
+			counters.tx_packets = stats.tx_packets;
+			counters.rx_bytes = stats.rx_bytes;
+			counters.tx_bytes = stats.tx_bytes;
+			found = TRUE;
+			break;
+		}
+		case IFLA_STATS:
+		{
+			struct rtnl_link_stats stats;
+
+			/* The 64 bit counters win if both are present */
+			if (found == TRUE || RTA_PAYLOAD(attr) < sizeof(stats))
+				break;
+
+			memcpy(&stats, RTA_DATA(attr), sizeof(stats));
+
+			counters.rx_packets = stats.rx_packets;
+			counters.tx_packets = stats.tx_packets;
+			counters.rx_bytes = stats.rx_bytes;
+			counters.tx_bytes = stats.tx_bytes;
+			found = TRUE;
+			break;
+		}
+		}
+	}
+
+	if (ifname == NULL || found == FALSE)
+		return;
+
+	func(ifname, &counters, user_data);
+}
+
+int rtnl_parse_links(const void *buf, size_t len, uint32_t seq,
+			rtnl_link_func_t func, void *user_data)
+{
+	struct nlmsghdr *hdr;
+
+	for (hdr = (struct nlmsghdr *) buf; NLMSG_OK(hdr, len);
+					hdr = NLMSG_NEXT(hdr, len)) {
+		if (hdr->nlmsg_seq != seq)
+			continue;
+
+		switch (hdr->nlmsg_type) {
+		case NLMSG_DONE:
+			return 1;
+		case NLMSG_ERROR:
+		{
+			struct nlmsgerr *err = NLMSG_DATA(hdr);
+
+			if (hdr->nlmsg_len < NLMSG_LENGTH(sizeof(*err)))
+				return -EIO;
+
+			return err->error < 0 ? err->error : -EIO;
+		}
+		case RTM_NEWLINK:
+			parse_link(hdr, func, user_data);
+			break;
+		}
+	}
+
+	return 0;
+}
+
+int rtnl_dump_links(struct rtnl *rtnl, rtnl_link_func_t func,
+			void *user_data)
+{
+	struct {
+		struct nlmsghdr hdr;
+		struct ifinfomsg msg;
+	} req;
+	uint8_t buf[RTNL_BUFFER_SIZE];
+	int err = 0;
+
+	if (rtnl == NULL)
+		return -EINVAL;
+
+	memset(&req, 0, sizeof(req));
+	req.hdr.nlmsg_len = sizeof(req);
+	req.hdr.nlmsg_type = RTM_GETLINK;
+	req.hdr.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+	req.hdr.nlmsg_seq = ++rtnl->seq;
+	req.msg.ifi_family = AF_UNSPEC;
+
+	if (send(rtnl->fd, &req, sizeof(req), 0) < 0)
+		return -errno;
+
+	/* The kernel answers a dump straight away, a few buffers at most */
+	do {
+		struct sockaddr_nl addr;
+		socklen_t addrlen = sizeof(addr);
+		ssize_t len;
+
+		len = recvfrom(rtnl->fd, buf, sizeof(buf), 0,
+				(struct sockaddr *) &addr, &addrlen);
+		if (len < 0) {
+			if (errno == EINTR)
+				continue;
+
+			return -errno;
+		}
+
+		if (len == 0)
+			return -EIO;
+
+		/* Only trust the kernel */
+		if (addr.nl_pid != 0)
+			continue;
+
+		err = rtnl_parse_links(buf, len, rtnl->seq, func, user_data);
+	} while (err == 0);
+
+	return err < 0 ? err : 0;
+}
@@ -0,0 +1,52 @@
+/*
+ *
+ *  oFono - Open Source Telephony
+ *
+ *  Copyright (C) 2008-2010  Intel Corporation. All rights reserved.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#include <stdint.h>
+
+struct rtnl;
+
+struct rtnl_link_counters {
+	uint64_t rx_packets;
+	uint64_t tx_packets;
+	uint64_t rx_bytes;
+	uint64_t tx_bytes;
+};
+
+typedef void (*rtnl_link_func_t)(const char *ifname,
+				const struct rtnl_link_counters *counters,
+				void *user_data);
+
+struct rtnl *rtnl_open(void);
+void rtnl_close(struct rtnl *rtnl);
+
+/*
+ * Requests the counters of all network interfaces in one dump and calls
+ * func for each of them.  Returns 0 or a negative errno.
+ */
+int rtnl_dump_links(struct rtnl *rtnl, rtnl_link_func_t func,
+			void *user_data);
+
+/*
+ * Parses one buffer of a link dump.  Returns 1 once the dump is done,
+ * 0 if more is to come and a negative errno on error.
+ */
+int rtnl_parse_links(const void *buf, size_t len, uint32_t seq,
+			rtnl_link_func_t func, void *user_data);
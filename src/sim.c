@@ -73,6 +73,8 @@ struct ofono_sim {
 	unsigned char efsst_length;
 
 	char *imsi;
+	char *pending_imsi;
+	unsigned char after_pin_pending;
 
 	GSList *own_numbers;
 	GSList *new_numbers;
@@ -89,6 +91,7 @@ struct ofono_sim {
 	struct ofono_watchlist *state_watches;
 
 	struct sim_fs *simfs;
+	GTimer *access_timer;
 
 	DBusMessage *pending;
 	const struct ofono_sim_driver *driver;
@@ -1004,20 +1007,11 @@ static void sim_ready(enum ofono_sim_state new_state, void *user)
 			sim_efimg_read_cb, sim);
 }
 
-static void sim_imsi_cb(const struct ofono_error *error, const char *imsi,
-		void *data)
+static void sim_imsi_obtained(struct ofono_sim *sim)
 {
-	struct ofono_sim *sim = data;
 	DBusConnection *conn = ofono_dbus_get_connection();
 	const char *path = __ofono_atom_get_path(sim->atom);
 
-	if (error->type != OFONO_ERROR_TYPE_NO_ERROR) {
-		ofono_error("Unable to read IMSI, emergency calls only");
-		return;
-	}
-
-	sim->imsi = g_strdup(imsi);
-
 	ofono_dbus_signal_property_changed(conn, path,
 						OFONO_SIM_MANAGER_INTERFACE,
 						"SubscriberIdentity",
@@ -1049,11 +1043,46 @@ static void sim_imsi_cb(const struct ofono_error *error, const char *imsi,
 	sim_set_ready(sim);
 }
 
+/*
+ * The IMSI is read alongside the service tables, but only published
+ * once those and EFad are in: the MNC length comes from EFad, and the
+ * file cache must not be keyed by the IMSI before the phase is known.
+ */
+static void sim_after_pin_done(struct ofono_sim *sim)
+{
+	sim->after_pin_pending -= 1;
+
+	if (sim->after_pin_pending > 0)
+		return;
+
+	if (sim->pending_imsi == NULL)
+		return;
+
+	sim->imsi = sim->pending_imsi;
+	sim->pending_imsi = NULL;
+
+	sim_imsi_obtained(sim);
+}
+
+static void sim_imsi_cb(const struct ofono_error *error, const char *imsi,
+		void *data)
+{
+	struct ofono_sim *sim = data;
+
+	if (error->type != OFONO_ERROR_TYPE_NO_ERROR)
+		ofono_error("Unable to read IMSI, emergency calls only");
+	else
+		sim->pending_imsi = g_strdup(imsi);
+
+	sim_after_pin_done(sim);
+}
+
 static void sim_retrieve_imsi(struct ofono_sim *sim)
 {
 	if (!sim->driver->read_imsi) {
 		ofono_error("IMSI retrieval not implemented,"
 				" only emergency calls will be available");
+		sim_after_pin_done(sim);
 		return;
 	}
 
@@ -1078,7 +1107,7 @@ static void sim_efsst_read_cb(int ok, int length, int record,
 	sim->efsst_length = length;
 
 out:
-	sim_retrieve_imsi(sim);
+	sim_after_pin_done(sim);
 }
 
 static void sim_efest_read_cb(int ok, int length, int record,
@@ -1099,7 +1128,7 @@ static void sim_efest_read_cb(int ok, int length, int record,
 	sim->efest_length = length;
 
 out:
-	sim_retrieve_imsi(sim);
+	sim_after_pin_done(sim);
 }
 
 static void sim_efust_read_cb(int ok, int length, int record,
@@ -1126,7 +1155,7 @@ static void sim_efust_read_cb(int ok, int length, int record,
 	return;
 
 out:
-	sim_retrieve_imsi(sim);
+	sim_after_pin_done(sim);
 }
 
 static void sim_cphs_information_read_cb(int ok, int length, int record,
@@ -1180,10 +1209,23 @@ static void sim_efphase_read_cb(int ok, int length, int record,
 		sim->phase = OFONO_SIM_PHASE_3G;
 	else
 		sim->phase = data[0];
+
+	/* Which service table there is depends on the phase */
+	if (sim->phase >= OFONO_SIM_PHASE_3G)
+		ofono_sim_read(sim, SIM_EFUST_FILEID,
+				OFONO_SIM_FILE_STRUCTURE_TRANSPARENT,
+				sim_efust_read_cb, sim);
+	else
+		ofono_sim_read(sim, SIM_EFSST_FILEID,
+				OFONO_SIM_FILE_STRUCTURE_TRANSPARENT,
+				sim_efsst_read_cb, sim);
 }
 
 static void sim_initialize_after_pin(struct ofono_sim *sim)
 {
+	/* The service tables and the IMSI */
+	sim->after_pin_pending = 2;
+
 	ofono_sim_read(sim, SIM_EFPHASE_FILEID,
 			OFONO_SIM_FILE_STRUCTURE_TRANSPARENT,
 			sim_efphase_read_cb, sim);
@@ -1200,15 +1242,8 @@ static void sim_initialize_after_pin(struct ofono_sim *sim)
 			OFONO_SIM_FILE_STRUCTURE_TRANSPARENT,
 			sim_cphs_information_read_cb, sim);
 
-	/* Also retrieve the GSM service table */
-	if (sim->phase >= OFONO_SIM_PHASE_3G)
-		ofono_sim_read(sim, SIM_EFUST_FILEID,
-				OFONO_SIM_FILE_STRUCTURE_TRANSPARENT,
-				sim_efust_read_cb, sim);
-	else
-		ofono_sim_read(sim, SIM_EFSST_FILEID,
-				OFONO_SIM_FILE_STRUCTURE_TRANSPARENT,
-				sim_efsst_read_cb, sim);
+	/* Does not go through the file system, so it need not wait */
+	sim_retrieve_imsi(sim);
 }
 
 static void sim_pin_query_cb(const struct ofono_error *error,
@@ -1437,8 +1472,6 @@ skip_efpl:
 						"PreferredLanguages",
 						DBUS_TYPE_STRING,
 						&sim->language_prefs);
-
-	sim_pin_check(sim);
 }
 
 static void sim_iccid_read_cb(int ok, int length, int record,
@@ -1511,6 +1544,9 @@ static void sim_initialize(struct ofono_sim *sim)
 	ofono_sim_read(sim, SIM_EFPL_FILEID,
 			OFONO_SIM_FILE_STRUCTURE_TRANSPARENT,
 			sim_efpl_read_cb, sim);
+
+	/* The languages are not needed for the PIN check, don't wait */
+	sim_pin_check(sim);
 }
 
 int ofono_sim_read_bytes(struct ofono_sim *sim, int id,
@@ -1610,6 +1646,9 @@ static void sim_free_state(struct ofono_sim *sim)
 		sim->imsi = NULL;
 	}
 
+	g_free(sim->pending_imsi);
+	sim->pending_imsi = NULL;
+
 	if (sim->own_numbers) {
 		g_slist_foreach(sim->own_numbers, (GFunc)g_free, NULL);
 		g_slist_free(sim->own_numbers);
@@ -1797,9 +1836,29 @@ static void sim_remove(struct ofono_atom *atom)
 
 	sim_free_state(sim);
 
+	if (sim->access_timer)
+		g_timer_destroy(sim->access_timer);
+
 	g_free(sim);
 }
 
+void __ofono_sim_touch(struct ofono_sim *sim)
+{
+	if (sim->access_timer == NULL)
+		sim->access_timer = g_timer_new();
+	else
+		g_timer_start(sim->access_timer);
+}
+
+/* Seconds since a command last went to the card, or G_MAXUINT if never */
+unsigned int __ofono_sim_get_idle_time(struct ofono_sim *sim)
+{
+	if (sim->access_timer == NULL)
+		return G_MAXUINT;
+
+	return g_timer_elapsed(sim->access_timer, NULL);
+}
+
 struct ofono_sim *ofono_sim_create(struct ofono_modem *modem,
 					unsigned int vendor,
 					const char *driver,
@@ -320,6 +320,7 @@ static gboolean sim_fs_op_read_block(gpointer user_data)
 	}
 
 	read_bytes = MIN(op->length - op->current * 256, 256);
+	__ofono_sim_touch(fs->sim);
 	fs->driver->read_file_transparent(fs->sim, op->id,
 						op->current * 256,
 						read_bytes,
@@ -393,6 +394,8 @@ static gboolean sim_fs_op_read_record(gpointer user)
 		return FALSE;
 	}
 
+	__ofono_sim_touch(fs->sim);
+
 	switch (op->structure) {
 	case OFONO_SIM_FILE_STRUCTURE_FIXED:
 		if (!driver->read_file_linear) {
@@ -601,8 +604,11 @@ static gboolean sim_fs_op_next(gpointer user_data)
 		if (sim_fs_op_check_cached(fs))
 			return FALSE;
 
+		__ofono_sim_touch(fs->sim);
 		driver->read_file_info(fs->sim, op->id, sim_fs_op_info_cb, fs);
 	} else {
+		__ofono_sim_touch(fs->sim);
+
 		switch (op->structure) {
 		case OFONO_SIM_FILE_STRUCTURE_TRANSPARENT:
 			driver->write_file_transparent(fs->sim, op->id, 0,
@@ -46,6 +46,9 @@
 
 #define TXQ_MAX_RETRIES 4
 
+/* How long changes to the transmit queue are collected before a sync */
+#define TXQ_BACKUP_SYNC_DELAY 100
+
 static gboolean tx_next(gpointer user_data);
 
 static GSList *g_drivers = NULL;
@@ -59,6 +62,11 @@ struct ofono_sms {
 	guint ref;
 	GQueue *txq;
 	gint tx_source;
+	GSList *tx_submits;
+	unsigned int tx_in_flight;
+	unsigned int tx_max_in_flight;
+	struct sms_txq_backup *txq_backup;
+	guint txq_sync_source;
 	struct ofono_message_waiting *mw;
 	unsigned int mw_watch;
 	struct ofono_sim *sim;
@@ -72,19 +80,29 @@ struct ofono_sms {
 	struct status_report_assembly *sr_assembly;
 };
 
+enum pending_pdu_state {
+	PENDING_PDU_QUEUED = 0,
+	PENDING_PDU_SUBMITTING,
+	PENDING_PDU_SUBMITTED,
+};
+
 struct pending_pdu {
 	unsigned char pdu[176];
 	int tpdu_len;
 	int pdu_len;
+	enum pending_pdu_state state;
+	unsigned int retry;		/* Failed attempts of this PDU */
 };
 
 struct tx_queue_entry {
 	struct pending_pdu *pdus;
 	unsigned char num_pdus;
-	unsigned char cur_pdu;
+	unsigned char cur_pdu; /* first PDU not handed to the driver yet */
+	unsigned char num_submitted;
+	unsigned char in_flight;
+	gboolean failed;
 	struct sms_address receiver;
 	unsigned int msg_id;
-	unsigned int retry;
 	unsigned int flags;
 	ofono_sms_txq_submit_cb_t cb;
 	void *data;
@@ -426,35 +444,129 @@ static void tx_queue_entry_destroy_foreach(gpointer _entry, gpointer unused)
 	tx_queue_entry_destroy(_entry);
 }
 
-static void tx_finished(const struct ofono_error *error, int mr, void *data)
+/* One PDU the driver is currently submitting */
+struct tx_submit {
+	struct ofono_sms *sms;
+	struct tx_queue_entry *entry;
+	unsigned char pdu;
+};
+
+static void tx_schedule(struct ofono_sms *sms)
+{
+	/* Either already scheduled or waiting to retry */
+	if (sms->tx_source)
+		return;
+
+	if (g_queue_peek_head(sms->txq) == NULL)
+		return;
+
+	sms->tx_source = g_timeout_add(0, tx_next, sms);
+}
+
+static gboolean txq_backup_sync(gpointer user_data)
+{
+	struct ofono_sms *sms = user_data;
+
+	sms->txq_sync_source = 0;
+
+	if (sms_txq_backup_sync(sms->txq_backup) == FALSE)
+		ofono_error("Unable to store the SMS transmit queue");
+
+	return FALSE;
+}
+
+static void txq_backup_schedule_sync(struct ofono_sms *sms)
+{
+	if (sms->txq_sync_source)
+		return;
+
+	sms->txq_sync_source = g_timeout_add(TXQ_BACKUP_SYNC_DELAY,
+						txq_backup_sync, sms);
+}
+
+static void tx_entry_finished(struct ofono_sms *sms,
+				struct tx_queue_entry *entry, gboolean ok)
 {
-	struct ofono_sms *sms = data;
 	struct ofono_modem *modem = __ofono_atom_get_modem(sms->atom);
-	struct tx_queue_entry *entry = g_queue_peek_head(sms->txq);
+
+	g_queue_remove(sms->txq, entry);
+
+	if (entry->flags & OFONO_SMS_SUBMIT_FLAG_PERSIST) {
+		sms_txq_backup_remove(sms->txq_backup, entry->msg_id);
+		txq_backup_schedule_sync(sms);
+	}
+
+	if (entry->cb)
+		entry->cb(ok, entry->data);
+
+	if (entry->flags & OFONO_SMS_SUBMIT_FLAG_RECORD_HISTORY) {
+		enum ofono_history_sms_status hs;
+
+		if (ok)
+			hs = OFONO_HISTORY_SMS_STATUS_SUBMITTED;
+		else
+			hs = OFONO_HISTORY_SMS_STATUS_SUBMIT_FAILED;
+
+		__ofono_history_sms_send_status(modem, entry->msg_id,
+						time(NULL), hs);
+	}
+
+	tx_queue_entry_destroy(entry);
+}
+
+static void tx_finished(const struct ofono_error *error, int mr, void *data)
+{
+	struct tx_submit *submit = data;
+	struct ofono_sms *sms = submit->sms;
+	struct tx_queue_entry *entry = submit->entry;
+	struct pending_pdu *pdu = &entry->pdus[submit->pdu];
 	gboolean ok = error->type == OFONO_ERROR_TYPE_NO_ERROR;
 
-	DBG("tx_finished");
+	DBG("tx_finished: %p pdu %u", entry, submit->pdu);
+
+	sms->tx_submits = g_slist_remove(sms->tx_submits, submit);
+	sms->tx_in_flight -= 1;
+	entry->in_flight -= 1;
+
+	/* The rest of a message that failed is not of interest anymore */
+	if (entry->failed)
+		goto out;
 
 	if (ok == FALSE) {
-		if (!(entry->flags & OFONO_SMS_SUBMIT_FLAG_RETRY))
-			goto next_q;
+		if (!(entry->flags & OFONO_SMS_SUBMIT_FLAG_RETRY)) {
+			entry->failed = TRUE;
+			goto out;
+		}
 
-		entry->retry += 1;
+		pdu->retry += 1;
 
-		if (entry->retry < TXQ_MAX_RETRIES) {
+		if (pdu->retry < TXQ_MAX_RETRIES) {
 			DBG("Sending failed, retry in %d secs",
-					entry->retry * 5);
-			sms->tx_source = g_timeout_add_seconds(entry->retry * 5,
+					pdu->retry * 5);
+
+			pdu->state = PENDING_PDU_QUEUED;
+			entry->cur_pdu = MIN(entry->cur_pdu, submit->pdu);
+
+			/*
+			 * Nothing new is submitted until the retry, the PDUs
+			 * still in flight are allowed to complete
+			 */
+			if (sms->tx_source)
+				g_source_remove(sms->tx_source);
+
+			sms->tx_source = g_timeout_add_seconds(pdu->retry * 5,
 								tx_next, sms);
+			g_free(submit);
 			return;
 		}
 
 		DBG("Max retries reached, giving up");
-		goto next_q;
+		entry->failed = TRUE;
+		goto out;
 	}
 
-	entry->cur_pdu += 1;
-	entry->retry = 0;
+	pdu->state = PENDING_PDU_SUBMITTED;
+	entry->num_submitted += 1;
 
 	if (entry->flags & OFONO_SMS_SUBMIT_FLAG_REQUEST_SR)
 		status_report_assembly_add_fragment(sms->sr_assembly,
@@ -463,60 +575,86 @@ static void tx_finished(const struct ofono_error *error, int mr, void *data)
 							mr, time(NULL),
 							entry->num_pdus);
 
-	if (entry->cur_pdu < entry->num_pdus) {
-		sms->tx_source = g_timeout_add(0, tx_next, sms);
-		return;
-	}
+out:
+	g_free(submit);
 
-next_q:
-	entry = g_queue_pop_head(sms->txq);
+	if (entry->failed && entry->in_flight == 0)
+		tx_entry_finished(sms, entry, FALSE);
+	else if (entry->num_submitted == entry->num_pdus)
+		tx_entry_finished(sms, entry, TRUE);
 
-	if (entry->cb)
-		entry->cb(ok, entry->data);
+	tx_schedule(sms);
+}
 
-	if (entry->flags & OFONO_SMS_SUBMIT_FLAG_RECORD_HISTORY) {
-		enum ofono_history_sms_status hs;
+/*
+ * Hands the next queued PDU to the driver.  Returns FALSE if there is
+ * none, either because everything is submitted or because the entries
+ * left are failed ones still waiting for their PDUs in flight.
+ */
+static gboolean tx_submit_next(struct ofono_sms *sms)
+{
+	struct tx_queue_entry *entry = NULL;
+	struct tx_submit *submit;
+	struct pending_pdu *pdu;
+	int send_mms;
+	GList *l;
 
-		if (ok)
-			hs = OFONO_HISTORY_SMS_STATUS_SUBMITTED;
-		else
-			hs = OFONO_HISTORY_SMS_STATUS_SUBMIT_FAILED;
+	for (l = sms->txq->head; l; l = l->next) {
+		entry = l->data;
 
-		__ofono_history_sms_send_status(modem, entry->msg_id,
-						time(NULL), hs);
+		if (entry->failed == FALSE && entry->cur_pdu < entry->num_pdus)
+			break;
 	}
 
-	tx_queue_entry_destroy(entry);
+	if (l == NULL)
+		return FALSE;
 
-	if (g_queue_peek_head(sms->txq)) {
-		DBG("Scheduling next");
-		sms->tx_source = g_timeout_add(0, tx_next, sms);
-	}
+	submit = g_new0(struct tx_submit, 1);
+	submit->sms = sms;
+	submit->entry = entry;
+	submit->pdu = entry->cur_pdu;
+
+	pdu = &entry->pdus[entry->cur_pdu];
+	pdu->state = PENDING_PDU_SUBMITTING;
+
+	while (entry->cur_pdu < entry->num_pdus &&
+			entry->pdus[entry->cur_pdu].state != PENDING_PDU_QUEUED)
+		entry->cur_pdu += 1;
+
+	/*
+	 * Keep the link up for good while other messages are queued behind
+	 * this one, for the rest of a concatenated message mode 1 is enough
+	 */
+	if (l->next != NULL)
+		send_mms = 2;
+	else if (entry->cur_pdu < entry->num_pdus)
+		send_mms = 1;
+	else
+		send_mms = 0;
+
+	sms->tx_submits = g_slist_prepend(sms->tx_submits, submit);
+	sms->tx_in_flight += 1;
+	entry->in_flight += 1;
+
+	sms->driver->submit(sms, pdu->pdu, pdu->pdu_len, pdu->tpdu_len,
+				send_mms, tx_finished, submit);
+
+	return TRUE;
 }
 
 static gboolean tx_next(gpointer user_data)
 {
 	struct ofono_sms *sms = user_data;
-	int send_mms = 0;
-	struct tx_queue_entry *entry = g_queue_peek_head(sms->txq);
-	struct pending_pdu *pdu = &entry->pdus[entry->cur_pdu];
-	struct ofono_error error;
-
-	error.type = OFONO_ERROR_TYPE_NO_ERROR;
 
-	DBG("tx_next: %p", entry);
+	DBG("tx_next: %u in flight", sms->tx_in_flight);
 
 	sms->tx_source = 0;
 
-	if (!entry)
-		return FALSE;
-
-	if (g_queue_get_length(sms->txq) > 1
-			|| (entry->num_pdus - entry->cur_pdu) > 1)
-		send_mms = 1;
-
-	sms->driver->submit(sms, pdu->pdu, pdu->pdu_len, pdu->tpdu_len,
-				send_mms, tx_finished, sms);
+	/* A submit that fails right away may have scheduled a retry */
+	while (sms->tx_in_flight < sms->tx_max_in_flight &&
+			sms->tx_source == 0)
+		if (tx_submit_next(sms) == FALSE)
+			break;
 
 	return FALSE;
 }
@@ -566,6 +704,27 @@ static struct tx_queue_entry *tx_queue_entry_new(GSList *msg_list)
 	return entry;
 }
 
+static struct tx_queue_entry *txq_push(struct ofono_sms *sms, GSList *list,
+						unsigned int msg_id,
+						unsigned int flags)
+{
+	struct tx_queue_entry *entry = tx_queue_entry_new(list);
+
+	if (flags & OFONO_SMS_SUBMIT_FLAG_REQUEST_SR) {
+		struct sms *head = list->data;
+
+		memcpy(&entry->receiver, &head->submit.daddr,
+				sizeof(entry->receiver));
+	}
+
+	entry->msg_id = msg_id;
+	entry->flags = flags;
+
+	g_queue_push_tail(sms->txq, entry);
+
+	return entry;
+}
+
 static void send_message_cb(gboolean ok, void *data)
 {
 	DBusConnection *conn = ofono_dbus_get_connection();
@@ -639,6 +798,7 @@ static DBusMessage *sms_send_message(DBusConnection *conn, DBusMessage *msg,
 
 	flags = OFONO_SMS_SUBMIT_FLAG_RECORD_HISTORY;
 	flags |= OFONO_SMS_SUBMIT_FLAG_RETRY;
+	flags |= OFONO_SMS_SUBMIT_FLAG_PERSIST;
 	if (sms->use_delivery_reports)
 		flags |= OFONO_SMS_SUBMIT_FLAG_REQUEST_SR;
 
@@ -1131,6 +1291,24 @@ static void sms_remove(struct ofono_atom *atom)
 		sms->assembly = NULL;
 	}
 
+	if (sms->tx_submits) {
+		g_slist_foreach(sms->tx_submits, (GFunc)g_free, NULL);
+		g_slist_free(sms->tx_submits);
+		sms->tx_submits = NULL;
+		sms->tx_in_flight = 0;
+	}
+
+	if (sms->txq_sync_source) {
+		g_source_remove(sms->txq_sync_source);
+		sms->txq_sync_source = 0;
+	}
+
+	/* Whatever is still queued is sent again on the next start */
+	if (sms->txq_backup) {
+		sms_txq_backup_free(sms->txq_backup);
+		sms->txq_backup = NULL;
+	}
+
 	if (sms->txq) {
 		g_queue_foreach(sms->txq, tx_queue_entry_destroy_foreach, NULL);
 		g_queue_free(sms->txq);
@@ -1193,6 +1371,7 @@ struct ofono_sms *ofono_sms_create(struct ofono_modem *modem,
 	sms->sca.type = 129;
 	sms->ref = 1;
 	sms->txq = g_queue_new();
+	sms->tx_max_in_flight = 1;
 	sms->atom = __ofono_modem_add_atom(modem, OFONO_ATOM_TYPE_SMS,
 						sms_remove, sms);
 
@@ -1254,6 +1433,23 @@ static void sms_load_settings(struct ofono_sms *sms, const char *imsi)
 		sms->bearer = 3; /* Default to CS then PS */
 }
 
+/* Requeue a submission that was still pending when oFono was stopped */
+static void txq_restore(unsigned int msg_id, unsigned int flags,
+			GSList *msg_list, void *user_data)
+{
+	struct ofono_sms *sms = user_data;
+
+	DBG("Restoring message %u with %u PDUs", msg_id,
+			g_slist_length(msg_list));
+
+	txq_push(sms, msg_list, msg_id, flags);
+
+	if (msg_id >= sms->next_msg_id)
+		sms->next_msg_id = msg_id + 1;
+
+	tx_schedule(sms);
+}
+
 static void bearer_init_callback(const struct ofono_error *error, void *data)
 {
 	if (error->type != OFONO_ERROR_TYPE_NO_ERROR)
@@ -1313,6 +1509,9 @@ void ofono_sms_register(struct ofono_sms *sms)
 		sms->sr_assembly = status_report_assembly_new(imsi);
 
 		sms_load_settings(sms, imsi);
+
+		sms->txq_backup = sms_txq_backup_new(imsi);
+		sms_txq_backup_load(sms->txq_backup, txq_restore, sms);
 	} else {
 		sms->assembly = sms_assembly_new(NULL);
 		sms->sr_assembly = status_report_assembly_new(NULL);
@@ -1341,30 +1540,38 @@ void *ofono_sms_get_data(struct ofono_sms *sms)
 	return sms->driver_data;
 }
 
+void ofono_sms_set_max_in_flight(struct ofono_sms *sms, unsigned int count)
+{
+	if (count == 0)
+		count = 1;
+
+	sms->tx_max_in_flight = count;
+}
+
 unsigned int __ofono_sms_txq_submit(struct ofono_sms *sms, GSList *list,
 					unsigned int flags,
 					ofono_sms_txq_submit_cb_t cb,
 					void *data, ofono_destroy_func destroy)
 {
-	struct tx_queue_entry *entry = tx_queue_entry_new(list);
-
-	if (flags & OFONO_SMS_SUBMIT_FLAG_REQUEST_SR) {
-		struct sms *head = list->data;
+	struct tx_queue_entry *entry;
 
-		memcpy(&entry->receiver, &head->submit.daddr,
-				sizeof(entry->receiver));
-	}
+	if (sms->txq_backup == NULL)
+		flags &= ~OFONO_SMS_SUBMIT_FLAG_PERSIST;
 
-	entry->msg_id = sms->next_msg_id++;
-	entry->flags = flags;
+	entry = txq_push(sms, list, sms->next_msg_id++, flags);
 	entry->cb = cb;
 	entry->data = data;
 	entry->destroy = destroy;
 
-	g_queue_push_tail(sms->txq, entry);
+	if (flags & OFONO_SMS_SUBMIT_FLAG_PERSIST) {
+		if (sms_txq_backup_add(sms->txq_backup, entry->msg_id,
+					flags, list) == FALSE)
+			entry->flags &= ~OFONO_SMS_SUBMIT_FLAG_PERSIST;
+		else
+			txq_backup_schedule_sync(sms);
+	}
 
-	if (g_queue_get_length(sms->txq) == 1)
-		sms->tx_source = g_timeout_add(0, tx_next, sms);
+	tx_schedule(sms);
 
 	return entry->msg_id;
 }
@@ -30,6 +30,7 @@
 #include <dirent.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <errno.h>
 #include <unistd.h>
 
 #include <glib.h>
@@ -48,6 +49,8 @@
 #define SMS_SR_BACKUP_PATH STORAGEDIR "/%s/sms_sr"
 #define SMS_SR_BACKUP_PATH_FILE SMS_SR_BACKUP_PATH "/%s-%u"
 
+#define SMS_TXQ_BACKUP_PATH STORAGEDIR "/%s/sms_txq"
+
 #define SMS_ADDR_FMT "%24[0-9A-F]"
 
 static GSList *sms_assembly_add_fragment_backup(struct sms_assembly *assembly,
@@ -3010,6 +3013,317 @@ void status_report_assembly_expire(struct status_report_assembly *assembly,
 	}
 }
 
+enum txq_record_type {
+	TXQ_RECORD_ADD = 1,
+	TXQ_RECORD_REMOVE = 2,
+};
+
+/*
+ * The transmit queue journal is a sequence of these records.  An add
+ * record is followed by num_pdus PDUs, each stored as its length, its
+ * TPDU length and the PDU itself.
+ */
+struct txq_record {
+	guint8 type;
+	guint8 num_pdus;
+	guint8 reserved[2];
+	guint32 msg_id;
+	guint32 flags;
+};
+
+struct sms_txq_backup *sms_txq_backup_new(const char *imsi)
+{
+	struct sms_txq_backup *backup = g_new0(struct sms_txq_backup, 1);
+
+	backup->imsi = imsi;
+	backup->fd = -1;
+	backup->pending = g_byte_array_new();
+
+	return backup;
+}
+
+void sms_txq_backup_free(struct sms_txq_backup *backup)
+{
+	sms_txq_backup_sync(backup);
+
+	if (backup->fd >= 0)
+		close(backup->fd);
+
+	g_byte_array_free(backup->pending, TRUE);
+	g_free(backup);
+}
+
+static gboolean txq_backup_open(struct sms_txq_backup *backup)
+{
+	char *path;
+
+	if (backup->fd >= 0)
+		return TRUE;
+
+	path = g_strdup_printf(SMS_TXQ_BACKUP_PATH, backup->imsi);
+
+	if (create_dirs(path, SMS_BACKUP_MODE | S_IXUSR) == 0)
+		backup->fd = TFR(open(path, O_WRONLY | O_APPEND | O_CREAT,
+					SMS_BACKUP_MODE));
+
+	g_free(path);
+
+	return backup->fd >= 0;
+}
+
+/*
+ * Copies the header of the record at the start of @buf into @record and
+ * returns the length of the whole record, or 0 if what is left is only
+ * a partly written record.  Records are packed back to back, so their
+ * headers are not aligned.
+ */
+static size_t txq_record_read(const unsigned char *buf, size_t len,
+				struct txq_record *record)
+{
+	size_t off = sizeof(struct txq_record);
+	unsigned int i;
+
+	if (len < off)
+		return 0;
+
+	memcpy(record, buf, sizeof(struct txq_record));
+
+	for (i = 0; i < record->num_pdus; i++) {
+		if (len < off + 2)
+			return 0;
+
+		off += 2 + buf[off];
+
+		if (len < off)
+			return 0;
+	}
+
+	return off;
+}
+
+static GSList *txq_record_decode(const unsigned char *buf,
+					const struct txq_record *record)
+{
+	size_t off = sizeof(struct txq_record);
+	GSList *msg_list = NULL;
+	struct sms sms;
+	unsigned int i;
+
+	for (i = 0; i < record->num_pdus; i++) {
+		int pdu_len = buf[off];
+		int tpdu_len = buf[off + 1];
+
+		if (sms_decode(buf + off + 2, pdu_len, TRUE,
+					tpdu_len, &sms) == FALSE)
+			goto error;
+
+		msg_list = g_slist_prepend(msg_list, g_memdup(&sms,
+							sizeof(sms)));
+		off += 2 + pdu_len;
+	}
+
+	return g_slist_reverse(msg_list);
+
+error:
+	g_slist_foreach(msg_list, (GFunc)g_free, NULL);
+	g_slist_free(msg_list);
+
+	return NULL;
+}
+
+/*
+ * Replays the journal, calling @func for every submission that was not
+ * removed, in the order they were queued.  The journal is then
+ * rewritten to contain just these.
+ */
+void sms_txq_backup_load(struct sms_txq_backup *backup,
+				sms_txq_backup_func_t func, void *user_data)
+{
+	struct txq_record record;
+	GHashTable *removed;
+	GByteArray *live;
+	char *path;
+	gchar *contents;
+	gsize len;
+	size_t off;
+	size_t record_len;
+
+	if (backup->imsi == NULL)
+		return;
+
+	path = g_strdup_printf(SMS_TXQ_BACKUP_PATH, backup->imsi);
+
+	if (g_file_get_contents(path, &contents, &len, NULL) == FALSE) {
+		g_free(path);
+		return;
+	}
+
+	g_free(path);
+
+	removed = g_hash_table_new(g_direct_hash, g_direct_equal);
+
+	for (off = 0; off < len; off += record_len) {
+		record_len = txq_record_read((unsigned char *) contents + off,
+						len - off, &record);
+		if (record_len == 0)
+			break;
+
+		if (record.type == TXQ_RECORD_REMOVE)
+			g_hash_table_insert(removed,
+					GUINT_TO_POINTER(record.msg_id),
+					GUINT_TO_POINTER(TRUE));
+	}
+
+	live = g_byte_array_new();
+
+	for (off = 0; off < len; off += record_len) {
+		GSList *msg_list;
+
+		record_len = txq_record_read((unsigned char *) contents + off,
+						len - off, &record);
+		if (record_len == 0)
+			break;
+
+		if (record.type != TXQ_RECORD_ADD)
+			continue;
+
+		if (g_hash_table_lookup(removed,
+					GUINT_TO_POINTER(record.msg_id)))
+			continue;
+
+		msg_list = txq_record_decode((unsigned char *) contents + off,
+						&record);
+
+		if (msg_list == NULL)
+			continue;
+
+		g_byte_array_append(live, (guint8 *) contents + off,
+					record_len);
+		backup->live += 1;
+
+		func(record.msg_id, record.flags, msg_list, user_data);
+
+		g_slist_foreach(msg_list, (GFunc)g_free, NULL);
+		g_slist_free(msg_list);
+	}
+
+	write_file(live->data, live->len, SMS_BACKUP_MODE,
+			SMS_TXQ_BACKUP_PATH, backup->imsi);
+
+	g_byte_array_free(live, TRUE);
+	g_hash_table_destroy(removed);
+	g_free(contents);
+}
+
+/*
+ * Records are only collected here, they reach the disk with the next
+ * sms_txq_backup_sync() so that queueing many messages in a row costs a
+ * single write and fdatasync.
+ */
+gboolean sms_txq_backup_add(struct sms_txq_backup *backup,
+				unsigned int msg_id, unsigned int flags,
+				GSList *msg_list)
+{
+	struct txq_record record;
+	unsigned char pdu[176];
+	unsigned char lens[2];
+	int pdu_len;
+	int tpdu_len;
+	guint start;
+	GSList *l;
+
+	if (backup->imsi == NULL)
+		return FALSE;
+
+	memset(&record, 0, sizeof(record));
+	record.type = TXQ_RECORD_ADD;
+	record.num_pdus = g_slist_length(msg_list);
+	record.msg_id = msg_id;
+	record.flags = flags;
+
+	start = backup->pending->len;
+	g_byte_array_append(backup->pending, (guint8 *) &record,
+				sizeof(record));
+
+	for (l = msg_list; l; l = l->next) {
+		if (sms_encode(l->data, &pdu_len, &tpdu_len, pdu) == FALSE) {
+			g_byte_array_set_size(backup->pending, start);
+			return FALSE;
+		}
+
+		lens[0] = pdu_len;
+		lens[1] = tpdu_len;
+		g_byte_array_append(backup->pending, lens, 2);
+		g_byte_array_append(backup->pending, pdu, pdu_len);
+	}
+
+	backup->live += 1;
+
+	return TRUE;
+}
+
+void sms_txq_backup_remove(struct sms_txq_backup *backup,
+				unsigned int msg_id)
+{
+	struct txq_record record;
+
+	if (backup->imsi == NULL)
+		return;
+
+	memset(&record, 0, sizeof(record));
+	record.type = TXQ_RECORD_REMOVE;
+	record.msg_id = msg_id;
+
+	g_byte_array_append(backup->pending, (guint8 *) &record,
+				sizeof(record));
+
+	backup->live -= 1;
+}
+
+gboolean sms_txq_backup_sync(struct sms_txq_backup *backup)
+{
+	ssize_t written;
+	off_t end;
+
+	if (backup->pending->len == 0)
+		return TRUE;
+
+	if (txq_backup_open(backup) == FALSE)
+		return FALSE;
+
+	/* Everything queued is gone, no need to keep any of its history */
+	if (backup->live == 0) {
+		if (TFR(ftruncate(backup->fd, 0)) < 0)
+			return FALSE;
+
+		g_byte_array_set_size(backup->pending, 0);
+
+		return TFR(fsync(backup->fd)) == 0;
+	}
+
+	end = lseek(backup->fd, 0, SEEK_END);
+	if (end < 0)
+		return FALSE;
+
+	written = TFR(write(backup->fd, backup->pending->data,
+				backup->pending->len));
+
+	if (written == (ssize_t) backup->pending->len) {
+		g_byte_array_set_size(backup->pending, 0);
+
+		return TFR(fdatasync(backup->fd)) == 0;
+	}
+
+	/*
+	 * Cut off the part of the records that made it, they stay pending
+	 * and the next sync appends them whole.
+	 */
+	if (written > 0)
+		TFR(ftruncate(backup->fd, end));
+
+	return FALSE;
+}
+
 static inline GSList *sms_list_append(GSList *l, const struct sms *in)
 {
 	struct sms *sms;
@@ -377,6 +377,16 @@ struct status_report_assembly {
 	GHashTable *assembly_table;
 };
 
+struct sms_txq_backup {
+	const char *imsi;
+	int fd;
+	GByteArray *pending;
+	unsigned int live;
+};
+
+typedef void (*sms_txq_backup_func_t)(unsigned int msg_id, unsigned int flags,
+					GSList *msg_list, void *user_data);
+
 struct cbs {
 	enum cbs_geo_scope gs;			/* 2 bits */
 	guint16 message_code;			/* 10 bits */
@@ -515,6 +525,17 @@ void status_report_assembly_add_fragment(struct status_report_assembly
 void status_report_assembly_expire(struct status_report_assembly *assembly,
 					time_t before);
 
+struct sms_txq_backup *sms_txq_backup_new(const char *imsi);
+void sms_txq_backup_free(struct sms_txq_backup *backup);
+void sms_txq_backup_load(struct sms_txq_backup *backup,
+				sms_txq_backup_func_t func, void *user_data);
+gboolean sms_txq_backup_add(struct sms_txq_backup *backup,
+				unsigned int msg_id, unsigned int flags,
+				GSList *msg_list);
+void sms_txq_backup_remove(struct sms_txq_backup *backup,
+				unsigned int msg_id);
+gboolean sms_txq_backup_sync(struct sms_txq_backup *backup);
+
 GSList *sms_text_prepare(const char *utf8, guint16 ref,
 				gboolean use_16bit, int *ref_offset,
 				gboolean use_delivery_reports);
@@ -254,6 +254,21 @@ void __ofono_cbs_sim_download(struct ofono_stk *stk, const struct cbs *msg)
 		stk_cbs_download_cb(stk, FALSE, NULL, -1);
 }
 
+/*
+ * A command being handled, an agent session or envelopes waiting for
+ * the card all mean the SIM Toolkit is in use.
+ */
+ofono_bool_t __ofono_stk_session_active(struct ofono_stk *stk)
+{
+	if (stk->pending_cmd || stk->session_agent)
+		return TRUE;
+
+	if (stk->envelope_q && !g_queue_is_empty(stk->envelope_q))
+		return TRUE;
+
+	return FALSE;
+}
+
 static struct stk_menu *stk_menu_create(const char *title,
 		const struct stk_text_attribute *title_attr, GSList *items,
 		const struct stk_item_text_attribute_list *item_attrs,
@@ -26,6 +26,7 @@
 #include <string.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <stddef.h>
 
 #include <glib.h>
 
@@ -40,6 +41,7 @@ enum stk_data_object_flag {
 	DATAOBJ_FLAG_MINIMUM =		2,
 	DATAOBJ_FLAG_CR =		4,
 	DATAOBJ_FLAG_LIST =		8,
+	DATAOBJ_FLAG_INDIRECT =		16,
 };
 
 struct stk_file_iter {
@@ -74,6 +76,120 @@ struct gsm_sms_tpdu {
 	unsigned char tpdu[184];
 };
 
+/*
+ * Everything a parsed proactive command points to is carved out of one
+ * arena owned by the command, so stk_command_free() releases it all at
+ * once.  The first block is sized from the PDU length and also holds the
+ * struct stk_command itself; further blocks are only chained on when the
+ * estimate turns out to be too small.
+ */
+struct stk_arena {
+	struct stk_arena *next;
+	gsize size;
+	gsize used;
+};
+
+/* No data object decodes to more than this many bytes per encoded byte */
+#define STK_ARENA_PDU_FACTOR 16
+
+#define STK_ARENA_HEADER_SIZE \
+	((sizeof(struct stk_arena) + G_MEM_ALIGN - 1) & ~(G_MEM_ALIGN - 1))
+
+/* Parsing is not reentrant, handlers allocate from the command in flight */
+static struct stk_arena *parse_arena;
+
+static struct stk_arena *stk_arena_new(gsize size)
+{
+	struct stk_arena *arena;
+
+	arena = g_try_malloc(STK_ARENA_HEADER_SIZE + size);
+	if (arena == NULL)
+		return NULL;
+
+	arena->next = NULL;
+	arena->size = size;
+	arena->used = 0;
+
+	return arena;
+}
+
+static void *stk_arena_alloc(struct stk_arena *arena, gsize size)
+{
+	struct stk_arena *block;
+	unsigned char *mem;
+
+	size = (size + G_MEM_ALIGN - 1) & ~(G_MEM_ALIGN - 1);
+
+	for (block = arena; block; block = block->next)
+		if (block->size - block->used >= size)
+			break;
+
+	if (block == NULL) {
+		block = stk_arena_new(MAX(size, arena->size));
+		if (block == NULL)
+			return NULL;
+
+		block->next = arena->next;
+		arena->next = block;
+	}
+
+	mem = (unsigned char *) block + STK_ARENA_HEADER_SIZE + block->used;
+	block->used += size;
+
+	memset(mem, 0, size);
+
+	return mem;
+}
+
+static void stk_arena_free(struct stk_arena *arena)
+{
+	while (arena) {
+		struct stk_arena *next = arena->next;
+
+		g_free(arena);
+		arena = next;
+	}
+}
+
+static void *arena_memdup(const void *mem, gsize size)
+{
+	void *dup = stk_arena_alloc(parse_arena, size);
+
+	if (dup == NULL)
+		return NULL;
+
+	memcpy(dup, mem, size);
+
+	return dup;
+}
+
+/* Moves a string returned by the conversion helpers into the arena */
+static char *arena_adopt_string(char *str)
+{
+	char *dup;
+
+	if (str == NULL)
+		return NULL;
+
+	dup = arena_memdup(str, strlen(str) + 1);
+	g_free(str);
+
+	return dup;
+}
+
+static GSList *arena_slist_prepend(GSList *list, void *data)
+{
+	GSList *node = stk_arena_alloc(parse_arena, sizeof(GSList));
+
+	if (node == NULL)
+		return list;
+
+	node->data = data;
+	node->next = list;
+
+	return node;
+}
+
 static char *decode_text(unsigned char dcs, int len, const unsigned char *data)
 {
 	char *utf8;
@@ -106,7 +222,7 @@ static char *decode_text(unsigned char dcs, int len, const unsigned char *data)
 		utf8 = NULL;
 	}
 
-	return utf8;
+	return arena_adopt_string(utf8);
 }
 
 /* For data object only to indicate its existence */
@@ -148,7 +264,7 @@ static gboolean parse_dataobj_common_text(struct comprehension_tlv_iter *iter,
 
 	data = comprehension_tlv_iter_get_data(iter);
 
-	*text = g_try_malloc(len + 1);
+	*text = stk_arena_alloc(parse_arena, len + 1);
 	if (*text == NULL)
 		return FALSE;
 
@@ -172,7 +288,7 @@ static gboolean parse_dataobj_common_byte_array(
 	data = comprehension_tlv_iter_get_data(iter);
 	array->len = len;
 
-	array->array = g_try_malloc(len);
+	array->array = stk_arena_alloc(parse_arena, len);
 	if (array->array == NULL)
 		return FALSE;
 
@@ -276,7 +392,7 @@ static gboolean parse_dataobj_address(struct comprehension_tlv_iter *iter,
 
 	data = comprehension_tlv_iter_get_data(iter);
 
-	number = g_try_malloc(len * 2 - 1);
+	number = stk_arena_alloc(parse_arena, len * 2 - 1);
 	if (number == NULL)
 		return FALSE;
 
@@ -298,12 +414,12 @@ static gboolean parse_dataobj_alpha_id(struct comprehension_tlv_iter *iter,
 
 	len = comprehension_tlv_iter_get_length(iter);
 	if (len == 0) {
-		*alpha_id = g_try_malloc0(1);
+		*alpha_id = stk_arena_alloc(parse_arena, 1);
 		return TRUE;
 	}
 
 	data = comprehension_tlv_iter_get_data(iter);
-	utf8 = sim_string_to_utf8(data, len);
+	utf8 = arena_adopt_string(sim_string_to_utf8(data, len));
 
 	if (utf8 == NULL)
 		return FALSE;
@@ -428,7 +544,7 @@ static gboolean parse_dataobj_item(struct comprehension_tlv_iter *iter,
 	if (data[0] == 0)
 		return FALSE;
 
-	utf8 = sim_string_to_utf8(data + 1, len - 1);
+	utf8 = arena_adopt_string(sim_string_to_utf8(data + 1, len - 1));
 
 	if (utf8 == NULL)
 		return FALSE;
@@ -494,7 +610,7 @@ static gboolean parse_dataobj_result(struct comprehension_tlv_iter *iter,
 				(data[0] == 0x3c) || (data[0] == 0x3d)))
 		return FALSE;
 
-	additional = g_try_malloc(len - 1);
+	additional = stk_arena_alloc(parse_arena, len - 1);
 	if (additional == NULL)
 		return FALSE;
 
@@ -541,7 +657,7 @@ static gboolean parse_dataobj_ss(struct comprehension_tlv_iter *iter,
 
 	data = comprehension_tlv_iter_get_data(iter);
 
-	s = g_try_malloc(len * 2 - 1);
+	s = stk_arena_alloc(parse_arena, len * 2 - 1);
 	if (s == NULL)
 		return FALSE;
 
@@ -624,25 +740,20 @@ static gboolean parse_dataobj_file_list(struct comprehension_tlv_iter *iter,
 	stk_file_iter_init(&sf_iter, data + 1, len - 1);
 
 	while (stk_file_iter_next(&sf_iter)) {
-		sf = g_try_new0(struct stk_file, 1);
+		sf = stk_arena_alloc(parse_arena, sizeof(struct stk_file));
 		if (sf == NULL)
-			goto error;
+			return FALSE;
 
 		sf->len = sf_iter.len;
 		memcpy(sf->file, sf_iter.file, sf_iter.len);
-		*fl = g_slist_prepend(*fl, sf);
+		*fl = arena_slist_prepend(*fl, sf);
 	}
 
 	if (sf_iter.pos != sf_iter.max)
-		goto error;
+		return FALSE;
 
 	*fl = g_slist_reverse(*fl);
 	return TRUE;
-
-error:
-	g_slist_foreach(*fl, (GFunc)g_free, NULL);
-	g_slist_free(*fl);
-	return FALSE;
 }
 
 /* Defined in TS 102.223 Section 8.19 */
@@ -1119,7 +1230,7 @@ static gboolean parse_dataobj_dtmf_string(struct comprehension_tlv_iter *iter,
 
 	data = comprehension_tlv_iter_get_data(iter);
 
-	*dtmf = g_try_malloc(len * 2 + 1);
+	*dtmf = stk_arena_alloc(parse_arena, len * 2 + 1);
 	if (*dtmf == NULL)
 		return FALSE;
 
@@ -1431,7 +1542,7 @@ static gboolean parse_dataobj_service_record(
 	sr->serv_id = data[1];
 	sr->len = len - 2;
 
-	sr->serv_rec = g_try_malloc(sr->len);
+	sr->serv_rec = stk_arena_alloc(parse_arena, sr->len);
 	if (sr->serv_rec == NULL)
 		return FALSE;
 
@@ -1461,7 +1572,7 @@ static gboolean parse_dataobj_device_filter(struct comprehension_tlv_iter *iter,
 	df->tech_id = data[0];
 	df->len = len - 1;
 
-	df->dev_filter = g_try_malloc(df->len);
+	df->dev_filter = stk_arena_alloc(parse_arena, df->len);
 	if (df->dev_filter == NULL)
 		return FALSE;
 
@@ -1491,7 +1602,7 @@ static gboolean parse_dataobj_service_search(
 	ss->tech_id = data[0];
 	ss->len = len - 1;
 
-	ss->ser_search = g_try_malloc(ss->len);
+	ss->ser_search = stk_arena_alloc(parse_arena, ss->len);
 	if (ss->ser_search == NULL)
 		return FALSE;
 
@@ -1521,7 +1632,7 @@ static gboolean parse_dataobj_attribute_info(
 	ai->tech_id = data[0];
 	ai->len = len - 1;
 
-	ai->attr_info = g_try_malloc(ai->len);
+	ai->attr_info = stk_arena_alloc(parse_arena, ai->len);
 	if (ai->attr_info == NULL)
 		return FALSE;
 
@@ -2005,198 +2116,133 @@ static gboolean parse_dataobj_broadcast_network_info(
 	return TRUE;
 }
 
+/* Indexed by simple TLV tag, which are all below 0x80 */
+static const dataobj_handler dataobj_handlers[0x80] = {
+	[STK_DATA_OBJECT_TYPE_ADDRESS] = parse_dataobj_address,
+	[STK_DATA_OBJECT_TYPE_ALPHA_ID] = parse_dataobj_alpha_id,
+	[STK_DATA_OBJECT_TYPE_SUBADDRESS] = parse_dataobj_subaddress,
+	[STK_DATA_OBJECT_TYPE_CCP] = parse_dataobj_ccp,
+	[STK_DATA_OBJECT_TYPE_CBS_PAGE] = parse_dataobj_cbs_page,
+	[STK_DATA_OBJECT_TYPE_DURATION] = parse_dataobj_duration,
+	[STK_DATA_OBJECT_TYPE_ITEM] = parse_dataobj_item,
+	[STK_DATA_OBJECT_TYPE_ITEM_ID] = parse_dataobj_item_id,
+	[STK_DATA_OBJECT_TYPE_RESPONSE_LENGTH] = parse_dataobj_response_len,
+	[STK_DATA_OBJECT_TYPE_RESULT] = parse_dataobj_result,
+	[STK_DATA_OBJECT_TYPE_GSM_SMS_TPDU] = parse_dataobj_gsm_sms_tpdu,
+	[STK_DATA_OBJECT_TYPE_SS_STRING] = parse_dataobj_ss,
+	[STK_DATA_OBJECT_TYPE_TEXT] = parse_dataobj_text,
+	[STK_DATA_OBJECT_TYPE_TONE] = parse_dataobj_tone,
+	[STK_DATA_OBJECT_TYPE_USSD_STRING] = parse_dataobj_ussd,
+	[STK_DATA_OBJECT_TYPE_FILE_LIST] = parse_dataobj_file_list,
+	[STK_DATA_OBJECT_TYPE_LOCATION_INFO] = parse_dataobj_location_info,
+	[STK_DATA_OBJECT_TYPE_IMEI] = parse_dataobj_imei,
+	[STK_DATA_OBJECT_TYPE_HELP_REQUEST] = parse_dataobj_help_request,
+	[STK_DATA_OBJECT_TYPE_NETWORK_MEASUREMENT_RESULTS] =
+		parse_dataobj_network_measurement_results,
+	[STK_DATA_OBJECT_TYPE_DEFAULT_TEXT] = parse_dataobj_default_text,
+	[STK_DATA_OBJECT_TYPE_ITEMS_NEXT_ACTION_INDICATOR] =
+		parse_dataobj_items_next_action_indicator,
+	[STK_DATA_OBJECT_TYPE_EVENT_LIST] = parse_dataobj_event_list,
+	[STK_DATA_OBJECT_TYPE_CAUSE] = parse_dataobj_cause,
+	[STK_DATA_OBJECT_TYPE_LOCATION_STATUS] = parse_dataobj_location_status,
+	[STK_DATA_OBJECT_TYPE_TRANSACTION_ID] = parse_dataobj_transaction_id,
+	[STK_DATA_OBJECT_TYPE_BCCH_CHANNEL_LIST] =
+		parse_dataobj_bcch_channel_list,
+	[STK_DATA_OBJECT_TYPE_CALL_CONTROL_REQUESTED_ACTION] =
+		parse_dataobj_call_control_requested_action,
+	[STK_DATA_OBJECT_TYPE_ICON_ID] = parse_dataobj_icon_id,
+	[STK_DATA_OBJECT_TYPE_ITEM_ICON_ID_LIST] =
+		parse_dataobj_item_icon_id_list,
+	[STK_DATA_OBJECT_TYPE_CARD_READER_STATUS] =
+		parse_dataobj_card_reader_status,
+	[STK_DATA_OBJECT_TYPE_CARD_ATR] = parse_dataobj_card_atr,
+	[STK_DATA_OBJECT_TYPE_C_APDU] = parse_dataobj_c_apdu,
+	[STK_DATA_OBJECT_TYPE_R_APDU] = parse_dataobj_r_apdu,
+	[STK_DATA_OBJECT_TYPE_TIMER_ID] = parse_dataobj_timer_id,
+	[STK_DATA_OBJECT_TYPE_TIMER_VALUE] = parse_dataobj_timer_value,
+	[STK_DATA_OBJECT_TYPE_DATETIME_TIMEZONE] =
+		parse_dataobj_datetime_timezone,
+	[STK_DATA_OBJECT_TYPE_AT_COMMAND] = parse_dataobj_at_command,
+	[STK_DATA_OBJECT_TYPE_AT_RESPONSE] = parse_dataobj_at_response,
+	[STK_DATA_OBJECT_TYPE_BC_REPEAT_INDICATOR] =
+		parse_dataobj_bc_repeat_indicator,
+	[STK_DATA_OBJECT_TYPE_IMMEDIATE_RESPONSE] = parse_dataobj_imm_resp,
+	[STK_DATA_OBJECT_TYPE_DTMF_STRING] = parse_dataobj_dtmf_string,
+	[STK_DATA_OBJECT_TYPE_LANGUAGE] = parse_dataobj_language,
+	[STK_DATA_OBJECT_TYPE_BROWSER_ID] = parse_dataobj_browser_id,
+	[STK_DATA_OBJECT_TYPE_TIMING_ADVANCE] = parse_dataobj_timing_advance,
+	[STK_DATA_OBJECT_TYPE_URL] = parse_dataobj_url,
+	[STK_DATA_OBJECT_TYPE_BEARER] = parse_dataobj_bearer,
+	[STK_DATA_OBJECT_TYPE_PROVISIONING_FILE_REF] =
+		parse_dataobj_provisioning_file_reference,
+	[STK_DATA_OBJECT_TYPE_BROWSER_TERMINATION_CAUSE] =
+		parse_dataobj_browser_termination_cause,
+	[STK_DATA_OBJECT_TYPE_BEARER_DESCRIPTION] =
+		parse_dataobj_bearer_description,
+	[STK_DATA_OBJECT_TYPE_CHANNEL_DATA] = parse_dataobj_channel_data,
+	[STK_DATA_OBJECT_TYPE_CHANNEL_DATA_LENGTH] =
+		parse_dataobj_channel_data_length,
+	[STK_DATA_OBJECT_TYPE_BUFFER_SIZE] = parse_dataobj_buffer_size,
+	[STK_DATA_OBJECT_TYPE_CHANNEL_STATUS] = parse_dataobj_channel_status,
+	[STK_DATA_OBJECT_TYPE_CARD_READER_ID] = parse_dataobj_card_reader_id,
+	[STK_DATA_OBJECT_TYPE_OTHER_ADDRESS] = parse_dataobj_other_address,
+	[STK_DATA_OBJECT_TYPE_UICC_TE_INTERFACE] =
+		parse_dataobj_uicc_te_interface,
+	[STK_DATA_OBJECT_TYPE_AID] = parse_dataobj_aid,
+	[STK_DATA_OBJECT_TYPE_ACCESS_TECHNOLOGY] =
+		parse_dataobj_access_technology,
+	[STK_DATA_OBJECT_TYPE_DISPLAY_PARAMETERS] =
+		parse_dataobj_display_parameters,
+	[STK_DATA_OBJECT_TYPE_SERVICE_RECORD] = parse_dataobj_service_record,
+	[STK_DATA_OBJECT_TYPE_DEVICE_FILTER] = parse_dataobj_device_filter,
+	[STK_DATA_OBJECT_TYPE_SERVICE_SEARCH] = parse_dataobj_service_search,
+	[STK_DATA_OBJECT_TYPE_ATTRIBUTE_INFO] = parse_dataobj_attribute_info,
+	[STK_DATA_OBJECT_TYPE_SERVICE_AVAILABILITY] =
+		parse_dataobj_service_availability,
+	[STK_DATA_OBJECT_TYPE_REMOTE_ENTITY_ADDRESS] =
+		parse_dataobj_remote_entity_address,
+	[STK_DATA_OBJECT_TYPE_ESN] = parse_dataobj_esn,
+	[STK_DATA_OBJECT_TYPE_NETWORK_ACCESS_NAME] =
+		parse_dataobj_network_access_name,
+	[STK_DATA_OBJECT_TYPE_CDMA_SMS_TPDU] = parse_dataobj_cdma_sms_tpdu,
+	[STK_DATA_OBJECT_TYPE_TEXT_ATTRIBUTE] = parse_dataobj_text_attr,
+	[STK_DATA_OBJECT_TYPE_PDP_ACTIVATION_PARAMETER] =
+		parse_dataobj_pdp_act_par,
+	[STK_DATA_OBJECT_TYPE_ITEM_TEXT_ATTRIBUTE_LIST] =
+		parse_dataobj_item_text_attribute_list,
+	[STK_DATA_OBJECT_TYPE_UTRAN_MEASUREMENT_QUALIFIER] =
+		parse_dataobj_utran_meas_qualifier,
+	[STK_DATA_OBJECT_TYPE_IMEISV] = parse_dataobj_imeisv,
+	[STK_DATA_OBJECT_TYPE_NETWORK_SEARCH_MODE] =
+		parse_dataobj_network_search_mode,
+	[STK_DATA_OBJECT_TYPE_BATTERY_STATE] = parse_dataobj_battery_state,
+	[STK_DATA_OBJECT_TYPE_BROWSING_STATUS] = parse_dataobj_browsing_status,
+	[STK_DATA_OBJECT_TYPE_FRAME_LAYOUT] = parse_dataobj_frame_layout,
+	[STK_DATA_OBJECT_TYPE_FRAMES_INFO] = parse_dataobj_frames_info,
+	[STK_DATA_OBJECT_TYPE_FRAME_ID] = parse_dataobj_frame_id,
+	[STK_DATA_OBJECT_TYPE_MEID] = parse_dataobj_meid,
+	[STK_DATA_OBJECT_TYPE_MMS_REFERENCE] = parse_dataobj_mms_reference,
+	[STK_DATA_OBJECT_TYPE_MMS_ID] = parse_dataobj_mms_id,
+	[STK_DATA_OBJECT_TYPE_MMS_TRANSFER_STATUS] =
+		parse_dataobj_mms_transfer_status,
+	[STK_DATA_OBJECT_TYPE_MMS_CONTENT_ID] = parse_dataobj_mms_content_id,
+	[STK_DATA_OBJECT_TYPE_MMS_NOTIFICATION] =
+		parse_dataobj_mms_notification,
+	[STK_DATA_OBJECT_TYPE_LAST_ENVELOPE] = parse_dataobj_last_envelope,
+	[STK_DATA_OBJECT_TYPE_REGISTRY_APPLICATION_DATA] =
+		parse_dataobj_registry_application_data,
+	[STK_DATA_OBJECT_TYPE_ACTIVATE_DESCRIPTOR] =
+		parse_dataobj_activate_descriptor,
+	[STK_DATA_OBJECT_TYPE_BROADCAST_NETWORK_INFO] =
+		parse_dataobj_broadcast_network_info,
+};
+
 static dataobj_handler handler_for_type(enum stk_data_object_type type)
 {
-	switch (type) {
-	case STK_DATA_OBJECT_TYPE_ADDRESS:
-		return parse_dataobj_address;
-	case STK_DATA_OBJECT_TYPE_ALPHA_ID:
-		return parse_dataobj_alpha_id;
-	case STK_DATA_OBJECT_TYPE_SUBADDRESS:
-		return parse_dataobj_subaddress;
-	case STK_DATA_OBJECT_TYPE_CCP:
-		return parse_dataobj_ccp;
-	case STK_DATA_OBJECT_TYPE_CBS_PAGE:
-		return parse_dataobj_cbs_page;
-	case STK_DATA_OBJECT_TYPE_DURATION:
-		return parse_dataobj_duration;
-	case STK_DATA_OBJECT_TYPE_ITEM:
-		return parse_dataobj_item;
-	case STK_DATA_OBJECT_TYPE_ITEM_ID:
-		return parse_dataobj_item_id;
-	case STK_DATA_OBJECT_TYPE_RESPONSE_LENGTH:
-		return parse_dataobj_response_len;
-	case STK_DATA_OBJECT_TYPE_RESULT:
-		return parse_dataobj_result;
-	case STK_DATA_OBJECT_TYPE_GSM_SMS_TPDU:
-		return parse_dataobj_gsm_sms_tpdu;
-	case STK_DATA_OBJECT_TYPE_SS_STRING:
-		return parse_dataobj_ss;
-	case STK_DATA_OBJECT_TYPE_TEXT:
-		return parse_dataobj_text;
-	case STK_DATA_OBJECT_TYPE_TONE:
-		return parse_dataobj_tone;
-	case STK_DATA_OBJECT_TYPE_USSD_STRING:
-		return parse_dataobj_ussd;
-	case STK_DATA_OBJECT_TYPE_FILE_LIST:
-		return parse_dataobj_file_list;
-	case STK_DATA_OBJECT_TYPE_LOCATION_INFO:
-		return parse_dataobj_location_info;
-	case STK_DATA_OBJECT_TYPE_IMEI:
-		return parse_dataobj_imei;
-	case STK_DATA_OBJECT_TYPE_HELP_REQUEST:
-		return parse_dataobj_help_request;
-	case STK_DATA_OBJECT_TYPE_NETWORK_MEASUREMENT_RESULTS:
-		return parse_dataobj_network_measurement_results;
-	case STK_DATA_OBJECT_TYPE_DEFAULT_TEXT:
-		return parse_dataobj_default_text;
-	case STK_DATA_OBJECT_TYPE_ITEMS_NEXT_ACTION_INDICATOR:
-		return parse_dataobj_items_next_action_indicator;
-	case STK_DATA_OBJECT_TYPE_EVENT_LIST:
-		return parse_dataobj_event_list;
-	case STK_DATA_OBJECT_TYPE_CAUSE:
-		return parse_dataobj_cause;
-	case STK_DATA_OBJECT_TYPE_LOCATION_STATUS:
-		return parse_dataobj_location_status;
-	case STK_DATA_OBJECT_TYPE_TRANSACTION_ID:
-		return parse_dataobj_transaction_id;
-	case STK_DATA_OBJECT_TYPE_BCCH_CHANNEL_LIST:
-		return parse_dataobj_bcch_channel_list;
-	case STK_DATA_OBJECT_TYPE_CALL_CONTROL_REQUESTED_ACTION:
-		return parse_dataobj_call_control_requested_action;
-	case STK_DATA_OBJECT_TYPE_ICON_ID:
-		return parse_dataobj_icon_id;
-	case STK_DATA_OBJECT_TYPE_ITEM_ICON_ID_LIST:
-		return parse_dataobj_item_icon_id_list;
-	case STK_DATA_OBJECT_TYPE_CARD_READER_STATUS:
-		return parse_dataobj_card_reader_status;
-	case STK_DATA_OBJECT_TYPE_CARD_ATR:
-		return parse_dataobj_card_atr;
-	case STK_DATA_OBJECT_TYPE_C_APDU:
-		return parse_dataobj_c_apdu;
-	case STK_DATA_OBJECT_TYPE_R_APDU:
-		return parse_dataobj_r_apdu;
-	case STK_DATA_OBJECT_TYPE_TIMER_ID:
-		return parse_dataobj_timer_id;
-	case STK_DATA_OBJECT_TYPE_TIMER_VALUE:
-		return parse_dataobj_timer_value;
-	case STK_DATA_OBJECT_TYPE_DATETIME_TIMEZONE:
-		return parse_dataobj_datetime_timezone;
-	case STK_DATA_OBJECT_TYPE_AT_COMMAND:
-		return parse_dataobj_at_command;
-	case STK_DATA_OBJECT_TYPE_AT_RESPONSE:
-		return parse_dataobj_at_response;
-	case STK_DATA_OBJECT_TYPE_BC_REPEAT_INDICATOR:
-		return parse_dataobj_bc_repeat_indicator;
-	case STK_DATA_OBJECT_TYPE_IMMEDIATE_RESPONSE:
-		return parse_dataobj_imm_resp;
-	case STK_DATA_OBJECT_TYPE_DTMF_STRING:
-		return parse_dataobj_dtmf_string;
-	case STK_DATA_OBJECT_TYPE_LANGUAGE:
-		return parse_dataobj_language;
-	case STK_DATA_OBJECT_TYPE_BROWSER_ID:
-		return parse_dataobj_browser_id;
-	case STK_DATA_OBJECT_TYPE_TIMING_ADVANCE:
-		return parse_dataobj_timing_advance;
-	case STK_DATA_OBJECT_TYPE_URL:
-		return parse_dataobj_url;
-	case STK_DATA_OBJECT_TYPE_BEARER:
-		return parse_dataobj_bearer;
-	case STK_DATA_OBJECT_TYPE_PROVISIONING_FILE_REF:
-		return parse_dataobj_provisioning_file_reference;
-	case STK_DATA_OBJECT_TYPE_BROWSER_TERMINATION_CAUSE:
-		return parse_dataobj_browser_termination_cause;
-	case STK_DATA_OBJECT_TYPE_BEARER_DESCRIPTION:
-		return parse_dataobj_bearer_description;
-	case STK_DATA_OBJECT_TYPE_CHANNEL_DATA:
-		return parse_dataobj_channel_data;
-	case STK_DATA_OBJECT_TYPE_CHANNEL_DATA_LENGTH:
-		return parse_dataobj_channel_data_length;
-	case STK_DATA_OBJECT_TYPE_BUFFER_SIZE:
-		return parse_dataobj_buffer_size;
-	case STK_DATA_OBJECT_TYPE_CHANNEL_STATUS:
-		return parse_dataobj_channel_status;
-	case STK_DATA_OBJECT_TYPE_CARD_READER_ID:
-		return parse_dataobj_card_reader_id;
-	case STK_DATA_OBJECT_TYPE_OTHER_ADDRESS:
-		return parse_dataobj_other_address;
-	case STK_DATA_OBJECT_TYPE_UICC_TE_INTERFACE:
-		return parse_dataobj_uicc_te_interface;
-	case STK_DATA_OBJECT_TYPE_AID:
-		return parse_dataobj_aid;
-	case STK_DATA_OBJECT_TYPE_ACCESS_TECHNOLOGY:
-		return parse_dataobj_access_technology;
-	case STK_DATA_OBJECT_TYPE_DISPLAY_PARAMETERS:
-		return parse_dataobj_display_parameters;
-	case STK_DATA_OBJECT_TYPE_SERVICE_RECORD:
-		return parse_dataobj_service_record;
-	case STK_DATA_OBJECT_TYPE_DEVICE_FILTER:
-		return parse_dataobj_device_filter;
-	case STK_DATA_OBJECT_TYPE_SERVICE_SEARCH:
-		return parse_dataobj_service_search;
-	case STK_DATA_OBJECT_TYPE_ATTRIBUTE_INFO:
-		return parse_dataobj_attribute_info;
-	case STK_DATA_OBJECT_TYPE_SERVICE_AVAILABILITY:
-		return parse_dataobj_service_availability;
-	case STK_DATA_OBJECT_TYPE_REMOTE_ENTITY_ADDRESS:
-		return parse_dataobj_remote_entity_address;
-	case STK_DATA_OBJECT_TYPE_ESN:
-		return parse_dataobj_esn;
-	case STK_DATA_OBJECT_TYPE_NETWORK_ACCESS_NAME:
-		return parse_dataobj_network_access_name;
-	case STK_DATA_OBJECT_TYPE_CDMA_SMS_TPDU:
-		return parse_dataobj_cdma_sms_tpdu;
-	case STK_DATA_OBJECT_TYPE_TEXT_ATTRIBUTE:
-		return parse_dataobj_text_attr;
-	case STK_DATA_OBJECT_TYPE_PDP_ACTIVATION_PARAMETER:
-		return parse_dataobj_pdp_act_par;
-	case STK_DATA_OBJECT_TYPE_ITEM_TEXT_ATTRIBUTE_LIST:
-		return parse_dataobj_item_text_attribute_list;
-	case STK_DATA_OBJECT_TYPE_UTRAN_MEASUREMENT_QUALIFIER:
-		return parse_dataobj_utran_meas_qualifier;
-	case STK_DATA_OBJECT_TYPE_IMEISV:
-		return parse_dataobj_imeisv;
-	case STK_DATA_OBJECT_TYPE_NETWORK_SEARCH_MODE:
-		return parse_dataobj_network_search_mode;
-	case STK_DATA_OBJECT_TYPE_BATTERY_STATE:
-		return parse_dataobj_battery_state;
-	case STK_DATA_OBJECT_TYPE_BROWSING_STATUS:
-		return parse_dataobj_browsing_status;
-	case STK_DATA_OBJECT_TYPE_FRAME_LAYOUT:
-		return parse_dataobj_frame_layout;
-	case STK_DATA_OBJECT_TYPE_FRAMES_INFO:
-		return parse_dataobj_frames_info;
-	case STK_DATA_OBJECT_TYPE_FRAME_ID:
-		return parse_dataobj_frame_id;
-	case STK_DATA_OBJECT_TYPE_MEID:
-		return parse_dataobj_meid;
-	case STK_DATA_OBJECT_TYPE_MMS_REFERENCE:
-		return parse_dataobj_mms_reference;
-	case STK_DATA_OBJECT_TYPE_MMS_ID:
-		return parse_dataobj_mms_id;
-	case STK_DATA_OBJECT_TYPE_MMS_TRANSFER_STATUS:
-		return parse_dataobj_mms_transfer_status;
-	case STK_DATA_OBJECT_TYPE_MMS_CONTENT_ID:
-		return parse_dataobj_mms_content_id;
-	case STK_DATA_OBJECT_TYPE_MMS_NOTIFICATION:
-		return parse_dataobj_mms_notification;
-	case STK_DATA_OBJECT_TYPE_LAST_ENVELOPE:
-		return parse_dataobj_last_envelope;
-	case STK_DATA_OBJECT_TYPE_REGISTRY_APPLICATION_DATA:
-		return parse_dataobj_registry_application_data;
-	case STK_DATA_OBJECT_TYPE_ACTIVATE_DESCRIPTOR:
-		return parse_dataobj_activate_descriptor;
-	case STK_DATA_OBJECT_TYPE_BROADCAST_NETWORK_INFO:
-		return parse_dataobj_broadcast_network_info;
-	default:
+	if ((unsigned int) type >= G_N_ELEMENTS(dataobj_handlers))
 		return NULL;
-	}
-}
 
-static void destroy_stk_item(struct stk_item *item)
-{
-	g_free(item->text);
-	g_free(item);
+	return dataobj_handlers[type];
 }
 
 static gboolean parse_item_list(struct comprehension_tlv_iter *iter,
@@ -2221,8 +2267,8 @@ static gboolean parse_item_list(struct comprehension_tlv_iter *iter,
 				continue;
 			}
 
-			list = g_slist_prepend(list,
-						g_memdup(&item, sizeof(item)));
+			list = arena_slist_prepend(list,
+					arena_memdup(&item, sizeof(item)));
 		}
 	} while (comprehension_tlv_iter_next(iter) == TRUE &&
 			comprehension_tlv_iter_get_tag(iter) == tag);
@@ -2237,8 +2283,6 @@ static gboolean parse_item_list(struct comprehension_tlv_iter *iter,
 	if (count == 1)
 		return TRUE;
 
-	g_slist_foreach(list, (GFunc)destroy_stk_item, NULL);
-	g_slist_free(list);
 	return FALSE;
 
 }
@@ -2258,8 +2302,8 @@ static gboolean parse_provisioning_list(struct comprehension_tlv_iter *iter,
 
 		if (parse_dataobj_provisioning_file_reference(iter, &file)
 									== TRUE)
-			list = g_slist_prepend(list,
-						g_memdup(&file, sizeof(file)));
+			list = arena_slist_prepend(list,
+					arena_memdup(&file, sizeof(file)));
 	} while (comprehension_tlv_iter_next(iter) == TRUE &&
 			comprehension_tlv_iter_get_tag(iter) == tag);
 
@@ -2281,59 +2325,58 @@ static dataobj_handler list_handler_for_type(enum stk_data_object_type type)
 	}
 }
 
-struct dataobj_handler_entry {
+/*
+ * One data object a command may carry, in the order they have to come.
+ * The parsed value goes offset bytes into the structure being filled in,
+ * usually the struct stk_command itself, so that the expected objects of
+ * each command can be a const table.  Tables end with an entry of type
+ * STK_DATA_OBJECT_TYPE_INVALID.
+ */
+struct dataobj_desc {
 	enum stk_data_object_type type;
 	int flags;
-	void *data;
+	size_t offset;
 };
 
-static enum stk_command_parse_result parse_dataobj(
+#define DATAOBJ_OFFSET(field) offsetof(struct stk_command, field)
+
+/* No command expects more than this many different data objects */
+#define DATAOBJ_MAX_ENTRIES 16
+
+/*
+ * Matches the TLVs against the table.  The value of entry i is stored at
+ * data[i] if data is given, at offset bytes into base otherwise.
+ */
+static enum stk_command_parse_result parse_dataobj_desc(
 					struct comprehension_tlv_iter *iter,
-					enum stk_data_object_type type, ...)
+					const struct dataobj_desc *desc,
+					void *base, void * const *data)
 {
-	GSList *entries = NULL;
-	GSList *l;
-	va_list args;
+	unsigned int l = 0;
 	gboolean minimum_set = TRUE;
 	gboolean parse_error = FALSE;
 
-	va_start(args, type);
-
-	while (type != STK_DATA_OBJECT_TYPE_INVALID) {
-		struct dataobj_handler_entry *entry;
-
-		entry = g_new0(struct dataobj_handler_entry, 1);
-
-		entry->type = type;
-		entry->flags = va_arg(args, int);
-		entry->data = va_arg(args, void *);
-
-		type = va_arg(args, enum stk_data_object_type);
-		entries = g_slist_prepend(entries, entry);
-	}
-
-	entries = g_slist_reverse(entries);
-
-	l = entries;
 	while (comprehension_tlv_iter_next(iter) == TRUE) {
 		dataobj_handler handler;
-		struct dataobj_handler_entry *entry;
-		GSList *l2;
-
-		for (l2 = l; l2; l2 = l2->next) {
-			entry = l2->data;
-
-			if (comprehension_tlv_iter_get_tag(iter) == entry->type)
+		const struct dataobj_desc *entry;
+		unsigned short tag = comprehension_tlv_iter_get_tag(iter);
+		unsigned int l2;
+		void *dst;
+
+		for (l2 = l; desc[l2].type != STK_DATA_OBJECT_TYPE_INVALID;
+				l2++) {
+			if (tag == desc[l2].type)
 				break;
 
 			/* Can't skip over mandatory objects */
-			if (entry->flags & DATAOBJ_FLAG_MANDATORY) {
-				l2 = NULL;
+			if (desc[l2].flags & DATAOBJ_FLAG_MANDATORY)
 				break;
-			}
 		}
 
-		if (!l2) {
+		entry = &desc[l2];
+
+		if (entry->type == STK_DATA_OBJECT_TYPE_INVALID ||
+				tag != entry->type) {
 			if (comprehension_tlv_get_cr(iter) == TRUE)
 				parse_error = TRUE;
 
@@ -2345,22 +2388,22 @@ static enum stk_command_parse_result parse_dataobj(
 		else
 			handler = handler_for_type(entry->type);
 
-		if (handler(iter, entry->data) == FALSE)
+		if (data)
+			dst = data[l2];
+		else
+			dst = (char *) base + entry->offset;
+
+		if (handler(iter, dst) == FALSE)
 			parse_error = TRUE;
 
-		l = l2->next;
+		l = l2 + 1;
 	}
 
-	for (; l; l = l->next) {
-		struct dataobj_handler_entry *entry = l->data;
-
-		if (entry->flags & DATAOBJ_FLAG_MANDATORY)
+	for (; desc[l].type != STK_DATA_OBJECT_TYPE_INVALID; l++) {
+		if (desc[l].flags & DATAOBJ_FLAG_MANDATORY)
 			minimum_set = FALSE;
 	}
 
-	g_slist_foreach(entries, (GFunc)g_free, NULL);
-	g_slist_free(entries);
-
 	if (minimum_set == FALSE)
 		return STK_PARSE_RESULT_MISSING_VALUE;
 	if (parse_error == TRUE)
@@ -2369,109 +2412,139 @@ static enum stk_command_parse_result parse_dataobj(
 	return STK_PARSE_RESULT_OK;
 }
 
-static void destroy_display_text(struct stk_command *command)
+static enum stk_command_parse_result parse_dataobj_table(
+					struct comprehension_tlv_iter *iter,
+					struct stk_command *command,
+					const struct dataobj_desc *desc)
+{
+	return parse_dataobj_desc(iter, desc, command, NULL);
+}
+
+/*
+ * For the odd command which parses some objects into temporaries: takes
+ * type, flags and destination triplets, ending with
+ * STK_DATA_OBJECT_TYPE_INVALID.
+ */
+static enum stk_command_parse_result parse_dataobj(
+					struct comprehension_tlv_iter *iter,
+					enum stk_data_object_type type, ...)
 {
-	g_free(command->display_text.text);
+	struct dataobj_desc desc[DATAOBJ_MAX_ENTRIES + 1];
+	void *data[DATAOBJ_MAX_ENTRIES];
+	unsigned int n = 0;
+	va_list args;
+
+	va_start(args, type);
+
+	while (type != STK_DATA_OBJECT_TYPE_INVALID) {
+		if (n == DATAOBJ_MAX_ENTRIES) {
+			va_end(args);
+			return STK_PARSE_RESULT_DATA_NOT_UNDERSTOOD;
+		}
+
+		desc[n].type = type;
+		desc[n].flags = va_arg(args, int);
+		desc[n].offset = 0;
+		data[n] = va_arg(args, void *);
+		n += 1;
+
+		type = va_arg(args, enum stk_data_object_type);
+	}
+
+	va_end(args);
+
+	desc[n].type = STK_DATA_OBJECT_TYPE_INVALID;
+
+	return parse_dataobj_desc(iter, desc, NULL, data);
 }
 
+static const struct dataobj_desc display_text_dataobjs[] = {
+	{ STK_DATA_OBJECT_TYPE_TEXT,
+		DATAOBJ_FLAG_MANDATORY | DATAOBJ_FLAG_MINIMUM,
+		DATAOBJ_OFFSET(display_text.text) },
+	{ STK_DATA_OBJECT_TYPE_ICON_ID, 0,
+		DATAOBJ_OFFSET(display_text.icon_id) },
+	{ STK_DATA_OBJECT_TYPE_IMMEDIATE_RESPONSE, 0,
+		DATAOBJ_OFFSET(display_text.immediate_response) },
+	{ STK_DATA_OBJECT_TYPE_DURATION, 0,
+		DATAOBJ_OFFSET(display_text.duration) },
+	{ STK_DATA_OBJECT_TYPE_TEXT_ATTRIBUTE, 0,
+		DATAOBJ_OFFSET(display_text.text_attr) },
+	{ STK_DATA_OBJECT_TYPE_FRAME_ID, 0,
+		DATAOBJ_OFFSET(display_text.frame_id) },
+	{ STK_DATA_OBJECT_TYPE_INVALID }
+};
+
 static enum stk_command_parse_result parse_display_text(
 					struct stk_command *command,
 					struct comprehension_tlv_iter *iter)
 {
-	struct stk_command_display_text *obj = &command->display_text;
-
 	if (command->src != STK_DEVICE_IDENTITY_TYPE_UICC)
 		return STK_PARSE_RESULT_DATA_NOT_UNDERSTOOD;
 
 	if (command->dst != STK_DEVICE_IDENTITY_TYPE_DISPLAY)
 		return STK_PARSE_RESULT_DATA_NOT_UNDERSTOOD;
 
-	command->destructor = destroy_display_text;
-
-	return parse_dataobj(iter, STK_DATA_OBJECT_TYPE_TEXT,
-				DATAOBJ_FLAG_MANDATORY | DATAOBJ_FLAG_MINIMUM,
-				&obj->text,
-				STK_DATA_OBJECT_TYPE_ICON_ID, 0,
-				&obj->icon_id,
-				STK_DATA_OBJECT_TYPE_IMMEDIATE_RESPONSE, 0,
-				&obj->immediate_response,
-				STK_DATA_OBJECT_TYPE_DURATION, 0,
-				&obj->duration,
-				STK_DATA_OBJECT_TYPE_TEXT_ATTRIBUTE, 0,
-				&obj->text_attr,
-				STK_DATA_OBJECT_TYPE_FRAME_ID, 0,
-				&obj->frame_id,
-				STK_DATA_OBJECT_TYPE_INVALID);
-}
-
-static void destroy_get_inkey(struct stk_command *command)
-{
-	g_free(command->get_inkey.text);
-}
+	return parse_dataobj_table(iter, command, display_text_dataobjs);
+}
+
+static const struct dataobj_desc get_inkey_dataobjs[] = {
+	{ STK_DATA_OBJECT_TYPE_TEXT,
+		DATAOBJ_FLAG_MANDATORY | DATAOBJ_FLAG_MINIMUM,
+		DATAOBJ_OFFSET(get_inkey.text) },
+	{ STK_DATA_OBJECT_TYPE_ICON_ID, 0,
+		DATAOBJ_OFFSET(get_inkey.icon_id) },
+	{ STK_DATA_OBJECT_TYPE_DURATION, 0,
+		DATAOBJ_OFFSET(get_inkey.duration) },
+	{ STK_DATA_OBJECT_TYPE_TEXT_ATTRIBUTE, 0,
+		DATAOBJ_OFFSET(get_inkey.text_attr) },
+	{ STK_DATA_OBJECT_TYPE_FRAME_ID, 0,
+		DATAOBJ_OFFSET(get_inkey.frame_id) },
+	{ STK_DATA_OBJECT_TYPE_INVALID }
+};
 
 static enum stk_command_parse_result parse_get_inkey(
 					struct stk_command *command,
 					struct comprehension_tlv_iter *iter)
 {
-	struct stk_command_get_inkey *obj = &command->get_inkey;
-
 	if (command->src != STK_DEVICE_IDENTITY_TYPE_UICC)
 		return STK_PARSE_RESULT_DATA_NOT_UNDERSTOOD;
 
 	if (command->dst != STK_DEVICE_IDENTITY_TYPE_TERMINAL)
 		return STK_PARSE_RESULT_DATA_NOT_UNDERSTOOD;
 
-	command->destructor = destroy_get_inkey;
-
-	return parse_dataobj(iter, STK_DATA_OBJECT_TYPE_TEXT,
-				DATAOBJ_FLAG_MANDATORY | DATAOBJ_FLAG_MINIMUM,
-				&obj->text,
-				STK_DATA_OBJECT_TYPE_ICON_ID, 0,
-				&obj->icon_id,
-				STK_DATA_OBJECT_TYPE_DURATION, 0,
-				&obj->duration,
-				STK_DATA_OBJECT_TYPE_TEXT_ATTRIBUTE, 0,
-				&obj->text_attr,
-				STK_DATA_OBJECT_TYPE_FRAME_ID, 0,
-				&obj->frame_id,
-				STK_DATA_OBJECT_TYPE_INVALID);
-}
-
-static void destroy_get_input(struct stk_command *command)
-{
-	g_free(command->get_input.text);
-	g_free(command->get_input.default_text);
-}
+	return parse_dataobj_table(iter, command, get_inkey_dataobjs);
+}
+
+static const struct dataobj_desc get_input_dataobjs[] = {
+	{ STK_DATA_OBJECT_TYPE_TEXT,
+		DATAOBJ_FLAG_MANDATORY | DATAOBJ_FLAG_MINIMUM,
+		DATAOBJ_OFFSET(get_input.text) },
+	{ STK_DATA_OBJECT_TYPE_RESPONSE_LENGTH,
+		DATAOBJ_FLAG_MANDATORY | DATAOBJ_FLAG_MINIMUM,
+		DATAOBJ_OFFSET(get_input.resp_len) },
+	{ STK_DATA_OBJECT_TYPE_DEFAULT_TEXT, 0,
+		DATAOBJ_OFFSET(get_input.default_text) },
+	{ STK_DATA_OBJECT_TYPE_ICON_ID, 0,
+		DATAOBJ_OFFSET(get_input.icon_id) },
+	{ STK_DATA_OBJECT_TYPE_TEXT_ATTRIBUTE, 0,
+		DATAOBJ_OFFSET(get_input.text_attr) },
+	{ STK_DATA_OBJECT_TYPE_FRAME_ID, 0,
+		DATAOBJ_OFFSET(get_input.frame_id) },
+	{ STK_DATA_OBJECT_TYPE_INVALID }
+};
 
 static enum stk_command_parse_result parse_get_input(
 					struct stk_command *command,
 					struct comprehension_tlv_iter *iter)
 {
-	struct stk_command_get_input *obj = &command->get_input;
-
 	if (command->src != STK_DEVICE_IDENTITY_TYPE_UICC)
 		return STK_PARSE_RESULT_DATA_NOT_UNDERSTOOD;
 
 	if (command->dst != STK_DEVICE_IDENTITY_TYPE_TERMINAL)
 		return STK_PARSE_RESULT_DATA_NOT_UNDERSTOOD;
 
-	command->destructor = destroy_get_input;
-
-	return parse_dataobj(iter, STK_DATA_OBJECT_TYPE_TEXT,
-				DATAOBJ_FLAG_MANDATORY | DATAOBJ_FLAG_MINIMUM,
-				&obj->text,
-				STK_DATA_OBJECT_TYPE_RESPONSE_LENGTH,
-				DATAOBJ_FLAG_MANDATORY | DATAOBJ_FLAG_MINIMUM,
-				&obj->resp_len,
-				STK_DATA_OBJECT_TYPE_DEFAULT_TEXT, 0,
-				&obj->default_text,
-				STK_DATA_OBJECT_TYPE_ICON_ID, 0,
-				&obj->icon_id,
-				STK_DATA_OBJECT_TYPE_TEXT_ATTRIBUTE, 0,
-				&obj->text_attr,
-				STK_DATA_OBJECT_TYPE_FRAME_ID, 0,
-				&obj->frame_id,
-				STK_DATA_OBJECT_TYPE_INVALID);
+	return parse_dataobj_table(iter, command, get_input_dataobjs);
 }
 
 static enum stk_command_parse_result parse_more_time(
@@ -2487,107 +2560,112 @@ static enum stk_command_parse_result parse_more_time(
 	return STK_PARSE_RESULT_OK;
 }
 
-static void destroy_play_tone(struct stk_command *command)
-{
-	g_free(command->play_tone.alpha_id);
-}
+static const struct dataobj_desc play_tone_dataobjs[] = {
+	{ STK_DATA_OBJECT_TYPE_ALPHA_ID, 0,
+		DATAOBJ_OFFSET(play_tone.alpha_id) },
+	{ STK_DATA_OBJECT_TYPE_TONE, 0,
+		DATAOBJ_OFFSET(play_tone.tone) },
+	{ STK_DATA_OBJECT_TYPE_DURATION, 0,
+		DATAOBJ_OFFSET(play_tone.duration) },
+	{ STK_DATA_OBJECT_TYPE_ICON_ID, 0,
+		DATAOBJ_OFFSET(play_tone.icon_id) },
+	{ STK_DATA_OBJECT_TYPE_TEXT_ATTRIBUTE, 0,
+		DATAOBJ_OFFSET(play_tone.text_attr) },
+	{ STK_DATA_OBJECT_TYPE_FRAME_ID, 0,
+		DATAOBJ_OFFSET(play_tone.frame_id) },
+	{ STK_DATA_OBJECT_TYPE_INVALID }
+};
 
 static enum stk_command_parse_result parse_play_tone(
 					struct stk_command *command,
 					struct comprehension_tlv_iter *iter)
 {
-	struct stk_command_play_tone *obj = &command->play_tone;
-
 	if (command->src != STK_DEVICE_IDENTITY_TYPE_UICC)
 		return STK_PARSE_RESULT_DATA_NOT_UNDERSTOOD;
 
 	if (command->dst != STK_DEVICE_IDENTITY_TYPE_EARPIECE)
 		return STK_PARSE_RESULT_DATA_NOT_UNDERSTOOD;
 
-	command->destructor = destroy_play_tone;
-
-	return parse_dataobj(iter, STK_DATA_OBJECT_TYPE_ALPHA_ID, 0,
-				&obj->alpha_id,
-				STK_DATA_OBJECT_TYPE_TONE, 0,
-				&obj->tone,
-				STK_DATA_OBJECT_TYPE_DURATION, 0,
-				&obj->duration,
-				STK_DATA_OBJECT_TYPE_ICON_ID, 0,
-				&obj->icon_id,
-				STK_DATA_OBJECT_TYPE_TEXT_ATTRIBUTE, 0,
-				&obj->text_attr,
-				STK_DATA_OBJECT_TYPE_FRAME_ID, 0,
-				&obj->frame_id,
-				STK_DATA_OBJECT_TYPE_INVALID);
+	return parse_dataobj_table(iter, command, play_tone_dataobjs);
 }
 
+static const struct dataobj_desc poll_interval_dataobjs[] = {
+	{ STK_DATA_OBJECT_TYPE_DURATION,
+		DATAOBJ_FLAG_MANDATORY | DATAOBJ_FLAG_MINIMUM,
+		DATAOBJ_OFFSET(poll_interval.duration) },
+	{ STK_DATA_OBJECT_TYPE_INVALID }
+};
+
 static enum stk_command_parse_result parse_poll_interval(
 					struct stk_command *command,
 					struct comprehension_tlv_iter *iter)
 {
-	struct stk_command_poll_interval *obj = &command->poll_interval;
-
 	if (command->src != STK_DEVICE_IDENTITY_TYPE_UICC)
 		return STK_PARSE_RESULT_DATA_NOT_UNDERSTOOD;
 
 	if (command->dst != STK_DEVICE_IDENTITY_TYPE_TERMINAL)
 		return STK_PARSE_RESULT_DATA_NOT_UNDERSTOOD;
 
-	return parse_dataobj(iter, STK_DATA_OBJECT_TYPE_DURATION,
-				DATAOBJ_FLAG_MANDATORY | DATAOBJ_FLAG_MINIMUM,
-				&obj->duration,
-				STK_DATA_OBJECT_TYPE_INVALID);
-}
-
-static void destroy_setup_menu(struct stk_command *command)
-{
-	g_free(command->setup_menu.alpha_id);
-	g_slist_foreach(command->setup_menu.items,
-				(GFunc)destroy_stk_item, NULL);
-	g_slist_free(command->setup_menu.items);
-}
+	return parse_dataobj_table(iter, command, poll_interval_dataobjs);
+}
+
+static const struct dataobj_desc setup_menu_dataobjs[] = {
+	{ STK_DATA_OBJECT_TYPE_ALPHA_ID,
+		DATAOBJ_FLAG_MANDATORY | DATAOBJ_FLAG_MINIMUM,
+		DATAOBJ_OFFSET(setup_menu.alpha_id) },
+	{ STK_DATA_OBJECT_TYPE_ITEM,
+		DATAOBJ_FLAG_MANDATORY | DATAOBJ_FLAG_MINIMUM |
+		DATAOBJ_FLAG_LIST,
+		DATAOBJ_OFFSET(setup_menu.items) },
+	{ STK_DATA_OBJECT_TYPE_ITEMS_NEXT_ACTION_INDICATOR, 0,
+		DATAOBJ_OFFSET(setup_menu.next_act) },
+	{ STK_DATA_OBJECT_TYPE_ICON_ID, 0,
+		DATAOBJ_OFFSET(setup_menu.icon_id) },
+	{ STK_DATA_OBJECT_TYPE_ITEM_ICON_ID_LIST, 0,
+		DATAOBJ_OFFSET(setup_menu.item_icon_id_list) },
+	{ STK_DATA_OBJECT_TYPE_TEXT_ATTRIBUTE, 0,
+		DATAOBJ_OFFSET(setup_menu.text_attr) },
+	{ STK_DATA_OBJECT_TYPE_ITEM_TEXT_ATTRIBUTE_LIST, 0,
+		DATAOBJ_OFFSET(setup_menu.item_text_attr_list) },
+	{ STK_DATA_OBJECT_TYPE_INVALID }
+};
 
 static enum stk_command_parse_result parse_setup_menu(
 					struct stk_command *command,
 					struct comprehension_tlv_iter *iter)
 {
-	struct stk_command_setup_menu *obj = &command->setup_menu;
-
 	if (command->src != STK_DEVICE_IDENTITY_TYPE_UICC)
 		return STK_PARSE_RESULT_DATA_NOT_UNDERSTOOD;
 
 	if (command->dst != STK_DEVICE_IDENTITY_TYPE_TERMINAL)
 		return STK_PARSE_RESULT_DATA_NOT_UNDERSTOOD;
 
-	command->destructor = destroy_setup_menu;
-
-	return parse_dataobj(iter,
-			STK_DATA_OBJECT_TYPE_ALPHA_ID,
-			DATAOBJ_FLAG_MANDATORY | DATAOBJ_FLAG_MINIMUM,
-			&obj->alpha_id,
-			STK_DATA_OBJECT_TYPE_ITEM,
-			DATAOBJ_FLAG_MANDATORY | DATAOBJ_FLAG_MINIMUM |
-			DATAOBJ_FLAG_LIST, &obj->items,
-			STK_DATA_OBJECT_TYPE_ITEMS_NEXT_ACTION_INDICATOR, 0,
-			&obj->next_act,
-			STK_DATA_OBJECT_TYPE_ICON_ID, 0,
-			&obj->icon_id,
-			STK_DATA_OBJECT_TYPE_ITEM_ICON_ID_LIST, 0,
-			&obj->item_icon_id_list,
-			STK_DATA_OBJECT_TYPE_TEXT_ATTRIBUTE, 0,
-			&obj->text_attr,
-			STK_DATA_OBJECT_TYPE_ITEM_TEXT_ATTRIBUTE_LIST, 0,
-			&obj->item_text_attr_list,
-			STK_DATA_OBJECT_TYPE_INVALID);
-}
-
-static void destroy_select_item(struct stk_command *command)
-{
-	g_free(command->select_item.alpha_id);
-	g_slist_foreach(command->select_item.items,
-				(GFunc)destroy_stk_item, NULL);
-	g_slist_free(command->select_item.items);
-}
+	return parse_dataobj_table(iter, command, setup_menu_dataobjs);
+}
+
+static const struct dataobj_desc select_item_dataobjs[] = {
+	{ STK_DATA_OBJECT_TYPE_ALPHA_ID, 0,
+		DATAOBJ_OFFSET(select_item.alpha_id) },
+	{ STK_DATA_OBJECT_TYPE_ITEM,
+		DATAOBJ_FLAG_MANDATORY | DATAOBJ_FLAG_MINIMUM |
+		DATAOBJ_FLAG_LIST,
+		DATAOBJ_OFFSET(select_item.items) },
+	{ STK_DATA_OBJECT_TYPE_ITEMS_NEXT_ACTION_INDICATOR, 0,
+		DATAOBJ_OFFSET(select_item.next_act) },
+	{ STK_DATA_OBJECT_TYPE_ITEM_ID, 0,
+		DATAOBJ_OFFSET(select_item.item_id) },
+	{ STK_DATA_OBJECT_TYPE_ICON_ID, 0,
+		DATAOBJ_OFFSET(select_item.icon_id) },
+	{ STK_DATA_OBJECT_TYPE_ITEM_ICON_ID_LIST, 0,
+		DATAOBJ_OFFSET(select_item.item_icon_id_list) },
+	{ STK_DATA_OBJECT_TYPE_TEXT_ATTRIBUTE, 0,
+		DATAOBJ_OFFSET(select_item.text_attr) },
+	{ STK_DATA_OBJECT_TYPE_ITEM_TEXT_ATTRIBUTE_LIST, 0,
+		DATAOBJ_OFFSET(select_item.item_text_attr_list) },
+	{ STK_DATA_OBJECT_TYPE_FRAME_ID, 0,
+		DATAOBJ_OFFSET(select_item.frame_id) },
+	{ STK_DATA_OBJECT_TYPE_INVALID }
+};
 
 static enum stk_command_parse_result parse_select_item(
 					struct stk_command *command,
@@ -2602,29 +2680,7 @@ static enum stk_command_parse_result parse_select_item(
 	if (command->dst != STK_DEVICE_IDENTITY_TYPE_TERMINAL)
 		return STK_PARSE_RESULT_DATA_NOT_UNDERSTOOD;
 
-	status = parse_dataobj(iter,
-			STK_DATA_OBJECT_TYPE_ALPHA_ID, 0,
-			&obj->alpha_id,
-			STK_DATA_OBJECT_TYPE_ITEM,
-			DATAOBJ_FLAG_MANDATORY | DATAOBJ_FLAG_MINIMUM |
-			DATAOBJ_FLAG_LIST, &obj->items,
-			STK_DATA_OBJECT_TYPE_ITEMS_NEXT_ACTION_INDICATOR, 0,
-			&obj->next_act,
-			STK_DATA_OBJECT_TYPE_ITEM_ID, 0,
-			&obj->item_id,
-			STK_DATA_OBJECT_TYPE_ICON_ID, 0,
-			&obj->icon_id,
-			STK_DATA_OBJECT_TYPE_ITEM_ICON_ID_LIST, 0,
-			&obj->item_icon_id_list,
-			STK_DATA_OBJECT_TYPE_TEXT_ATTRIBUTE, 0,
-			&obj->text_attr,
-			STK_DATA_OBJECT_TYPE_ITEM_TEXT_ATTRIBUTE_LIST, 0,
-			&obj->item_text_attr_list,
-			STK_DATA_OBJECT_TYPE_FRAME_ID, 0,
-			&obj->frame_id,
-			STK_DATA_OBJECT_TYPE_INVALID);
-
-	command->destructor = destroy_select_item;
+	status = parse_dataobj_table(iter, command, select_item_dataobjs);
 
 	if (status == STK_PARSE_RESULT_OK && obj->items == NULL)
 		status = STK_PARSE_RESULT_DATA_NOT_UNDERSTOOD;
@@ -2632,12 +2688,6 @@ static enum stk_command_parse_result parse_select_item(
 	return status;
 }
 
-static void destroy_send_sms(struct stk_command *command)
-{
-	g_free(command->send_sms.alpha_id);
-	g_free(command->send_sms.cdma_sms.array);
-}
-
 static enum stk_command_parse_result parse_send_sms(
 					struct stk_command *command,
 					struct comprehension_tlv_iter *iter)
@@ -2670,8 +2720,6 @@ static enum stk_command_parse_result parse_send_sms(
 				&obj->frame_id,
 				STK_DATA_OBJECT_TYPE_INVALID);
 
-	command->destructor = destroy_send_sms;
-
 	if (status != STK_PARSE_RESULT_OK)
 		goto out;
 
@@ -2727,158 +2775,131 @@ set_addr:
 	obj->gsm_sms.sc_addr.number_type = (sc_address.ton_npi >> 4) & 7;
 
 out:
-	g_free(sc_address.number);
-
 	return status;
 }
 
-static void destroy_send_ss(struct stk_command *command)
-{
-	g_free(command->send_ss.alpha_id);
-	g_free(command->send_ss.ss.ss);
-}
+static const struct dataobj_desc send_ss_dataobjs[] = {
+	{ STK_DATA_OBJECT_TYPE_ALPHA_ID, 0,
+		DATAOBJ_OFFSET(send_ss.alpha_id) },
+	{ STK_DATA_OBJECT_TYPE_SS_STRING,
+		DATAOBJ_FLAG_MANDATORY | DATAOBJ_FLAG_MINIMUM,
+		DATAOBJ_OFFSET(send_ss.ss) },
+	{ STK_DATA_OBJECT_TYPE_ICON_ID, 0,
+		DATAOBJ_OFFSET(send_ss.icon_id) },
+	{ STK_DATA_OBJECT_TYPE_TEXT_ATTRIBUTE, 0,
+		DATAOBJ_OFFSET(send_ss.text_attr) },
+	{ STK_DATA_OBJECT_TYPE_FRAME_ID, 0,
+		DATAOBJ_OFFSET(send_ss.frame_id) },
+	{ STK_DATA_OBJECT_TYPE_INVALID }
+};
 
 static enum stk_command_parse_result parse_send_ss(struct stk_command *command,
 					struct comprehension_tlv_iter *iter)
 {
-	struct stk_command_send_ss *obj = &command->send_ss;
-
 	if (command->src != STK_DEVICE_IDENTITY_TYPE_UICC)
 		return STK_PARSE_RESULT_DATA_NOT_UNDERSTOOD;
 
 	if (command->dst != STK_DEVICE_IDENTITY_TYPE_NETWORK)
 		return STK_PARSE_RESULT_DATA_NOT_UNDERSTOOD;
 
-	command->destructor = destroy_send_ss;
-
-	return parse_dataobj(iter, STK_DATA_OBJECT_TYPE_ALPHA_ID, 0,
-				&obj->alpha_id,
-				STK_DATA_OBJECT_TYPE_SS_STRING,
-				DATAOBJ_FLAG_MANDATORY | DATAOBJ_FLAG_MINIMUM,
-				&obj->ss,
-				STK_DATA_OBJECT_TYPE_ICON_ID, 0,
-				&obj->icon_id,
-				STK_DATA_OBJECT_TYPE_TEXT_ATTRIBUTE, 0,
-				&obj->text_attr,
-				STK_DATA_OBJECT_TYPE_FRAME_ID, 0,
-				&obj->frame_id,
-				STK_DATA_OBJECT_TYPE_INVALID);
-}
-
-static void destroy_send_ussd(struct stk_command *command)
-{
-	g_free(command->send_ussd.alpha_id);
-}
+	return parse_dataobj_table(iter, command, send_ss_dataobjs);
+}
+
+static const struct dataobj_desc send_ussd_dataobjs[] = {
+	{ STK_DATA_OBJECT_TYPE_ALPHA_ID, 0,
+		DATAOBJ_OFFSET(send_ussd.alpha_id) },
+	{ STK_DATA_OBJECT_TYPE_USSD_STRING,
+		DATAOBJ_FLAG_MANDATORY | DATAOBJ_FLAG_MINIMUM,
+		DATAOBJ_OFFSET(send_ussd.ussd_string) },
+	{ STK_DATA_OBJECT_TYPE_ICON_ID, 0,
+		DATAOBJ_OFFSET(send_ussd.icon_id) },
+	{ STK_DATA_OBJECT_TYPE_TEXT_ATTRIBUTE, 0,
+		DATAOBJ_OFFSET(send_ussd.text_attr) },
+	{ STK_DATA_OBJECT_TYPE_FRAME_ID, 0,
+		DATAOBJ_OFFSET(send_ussd.frame_id) },
+	{ STK_DATA_OBJECT_TYPE_INVALID }
+};
 
 static enum stk_command_parse_result parse_send_ussd(
 					struct stk_command *command,
 					struct comprehension_tlv_iter *iter)
 {
-	struct stk_command_send_ussd *obj = &command->send_ussd;
-
 	if (command->src != STK_DEVICE_IDENTITY_TYPE_UICC)
 		return STK_PARSE_RESULT_DATA_NOT_UNDERSTOOD;
 
 	if (command->dst != STK_DEVICE_IDENTITY_TYPE_NETWORK)
 		return STK_PARSE_RESULT_DATA_NOT_UNDERSTOOD;
 
-	command->destructor = destroy_send_ussd;
-
-	return parse_dataobj(iter, STK_DATA_OBJECT_TYPE_ALPHA_ID, 0,
-				&obj->alpha_id,
-				STK_DATA_OBJECT_TYPE_USSD_STRING,
-				DATAOBJ_FLAG_MANDATORY | DATAOBJ_FLAG_MINIMUM,
-				&obj->ussd_string,
-				STK_DATA_OBJECT_TYPE_ICON_ID, 0,
-				&obj->icon_id,
-				STK_DATA_OBJECT_TYPE_TEXT_ATTRIBUTE, 0,
-				&obj->text_attr,
-				STK_DATA_OBJECT_TYPE_FRAME_ID, 0,
-				&obj->frame_id,
-				STK_DATA_OBJECT_TYPE_INVALID);
-}
-
-static void destroy_setup_call(struct stk_command *command)
-{
-	g_free(command->setup_call.alpha_id_usr_cfm);
-	g_free(command->setup_call.addr.number);
-	g_free(command->setup_call.alpha_id_call_setup);
-}
+	return parse_dataobj_table(iter, command, send_ussd_dataobjs);
+}
+
+static const struct dataobj_desc setup_call_dataobjs[] = {
+	{ STK_DATA_OBJECT_TYPE_ALPHA_ID, 0,
+		DATAOBJ_OFFSET(setup_call.alpha_id_usr_cfm) },
+	{ STK_DATA_OBJECT_TYPE_ADDRESS,
+		DATAOBJ_FLAG_MANDATORY | DATAOBJ_FLAG_MINIMUM,
+		DATAOBJ_OFFSET(setup_call.addr) },
+	{ STK_DATA_OBJECT_TYPE_CCP, 0,
+		DATAOBJ_OFFSET(setup_call.ccp) },
+	{ STK_DATA_OBJECT_TYPE_SUBADDRESS, 0,
+		DATAOBJ_OFFSET(setup_call.subaddr) },
+	{ STK_DATA_OBJECT_TYPE_DURATION, 0,
+		DATAOBJ_OFFSET(setup_call.duration) },
+	{ STK_DATA_OBJECT_TYPE_ICON_ID, 0,
+		DATAOBJ_OFFSET(setup_call.icon_id_usr_cfm) },
+	{ STK_DATA_OBJECT_TYPE_ALPHA_ID, 0,
+		DATAOBJ_OFFSET(setup_call.alpha_id_call_setup) },
+	{ STK_DATA_OBJECT_TYPE_ICON_ID, 0,
+		DATAOBJ_OFFSET(setup_call.icon_id_call_setup) },
+	{ STK_DATA_OBJECT_TYPE_TEXT_ATTRIBUTE, 0,
+		DATAOBJ_OFFSET(setup_call.text_attr_usr_cfm) },
+	{ STK_DATA_OBJECT_TYPE_TEXT_ATTRIBUTE, 0,
+		DATAOBJ_OFFSET(setup_call.text_attr_call_setup) },
+	{ STK_DATA_OBJECT_TYPE_FRAME_ID, 0,
+		DATAOBJ_OFFSET(setup_call.frame_id) },
+	{ STK_DATA_OBJECT_TYPE_INVALID }
+};
 
 static enum stk_command_parse_result parse_setup_call(
 					struct stk_command *command,
 					struct comprehension_tlv_iter *iter)
 {
-	struct stk_command_setup_call *obj = &command->setup_call;
-
 	if (command->src != STK_DEVICE_IDENTITY_TYPE_UICC)
 		return STK_PARSE_RESULT_DATA_NOT_UNDERSTOOD;
 
 	if (command->dst != STK_DEVICE_IDENTITY_TYPE_NETWORK)
 		return STK_PARSE_RESULT_DATA_NOT_UNDERSTOOD;
 
-	command->destructor = destroy_setup_call;
-
-	return parse_dataobj(iter, STK_DATA_OBJECT_TYPE_ALPHA_ID, 0,
-				&obj->alpha_id_usr_cfm,
-				STK_DATA_OBJECT_TYPE_ADDRESS,
-				DATAOBJ_FLAG_MANDATORY | DATAOBJ_FLAG_MINIMUM,
-				&obj->addr,
-				STK_DATA_OBJECT_TYPE_CCP, 0,
-				&obj->ccp,
-				STK_DATA_OBJECT_TYPE_SUBADDRESS, 0,
-				&obj->subaddr,
-				STK_DATA_OBJECT_TYPE_DURATION, 0,
-				&obj->duration,
-				STK_DATA_OBJECT_TYPE_ICON_ID, 0,
-				&obj->icon_id_usr_cfm,
-				STK_DATA_OBJECT_TYPE_ALPHA_ID, 0,
-				&obj->alpha_id_call_setup,
-				STK_DATA_OBJECT_TYPE_ICON_ID, 0,
-				&obj->icon_id_call_setup,
-				STK_DATA_OBJECT_TYPE_TEXT_ATTRIBUTE, 0,
-				&obj->text_attr_usr_cfm,
-				STK_DATA_OBJECT_TYPE_TEXT_ATTRIBUTE, 0,
-				&obj->text_attr_call_setup,
-				STK_DATA_OBJECT_TYPE_FRAME_ID, 0,
-				&obj->frame_id,
-				STK_DATA_OBJECT_TYPE_INVALID);
-}
-
-static void destroy_refresh(struct stk_command *command)
-{
-	g_slist_foreach(command->refresh.file_list, (GFunc)g_free, NULL);
-	g_slist_free(command->refresh.file_list);
-	g_free(command->refresh.alpha_id);
-}
+	return parse_dataobj_table(iter, command, setup_call_dataobjs);
+}
+
+static const struct dataobj_desc refresh_dataobjs[] = {
+	{ STK_DATA_OBJECT_TYPE_FILE_LIST, 0,
+		DATAOBJ_OFFSET(refresh.file_list) },
+	{ STK_DATA_OBJECT_TYPE_AID, 0,
+		DATAOBJ_OFFSET(refresh.aid) },
+	{ STK_DATA_OBJECT_TYPE_ALPHA_ID, 0,
+		DATAOBJ_OFFSET(refresh.alpha_id) },
+	{ STK_DATA_OBJECT_TYPE_ICON_ID, 0,
+		DATAOBJ_OFFSET(refresh.icon_id) },
+	{ STK_DATA_OBJECT_TYPE_TEXT_ATTRIBUTE, 0,
+		DATAOBJ_OFFSET(refresh.text_attr) },
+	{ STK_DATA_OBJECT_TYPE_FRAME_ID, 0,
+		DATAOBJ_OFFSET(refresh.frame_id) },
+	{ STK_DATA_OBJECT_TYPE_INVALID }
+};
 
 static enum stk_command_parse_result parse_refresh(
 					struct stk_command *command,
 					struct comprehension_tlv_iter *iter)
 {
-	struct stk_command_refresh *obj = &command->refresh;
-
 	if (command->src != STK_DEVICE_IDENTITY_TYPE_UICC)
 		return STK_PARSE_RESULT_DATA_NOT_UNDERSTOOD;
 
 	if (command->dst != STK_DEVICE_IDENTITY_TYPE_TERMINAL)
 		return STK_PARSE_RESULT_DATA_NOT_UNDERSTOOD;
 
-	command->destructor = destroy_refresh;
-
-	return parse_dataobj(iter, STK_DATA_OBJECT_TYPE_FILE_LIST, 0,
-				&obj->file_list,
-				STK_DATA_OBJECT_TYPE_AID, 0,
-				&obj->aid,
-				STK_DATA_OBJECT_TYPE_ALPHA_ID, 0,
-				&obj->alpha_id,
-				STK_DATA_OBJECT_TYPE_ICON_ID, 0,
-				&obj->icon_id,
-				STK_DATA_OBJECT_TYPE_TEXT_ATTRIBUTE, 0,
-				&obj->text_attr,
-				STK_DATA_OBJECT_TYPE_FRAME_ID, 0,
-				&obj->frame_id,
-				STK_DATA_OBJECT_TYPE_INVALID);
+	return parse_dataobj_table(iter, command, refresh_dataobjs);
 }
 
 static enum stk_command_parse_result parse_polling_off(
@@ -2907,30 +2928,37 @@ static enum stk_command_parse_result parse_provide_local_info(
 	return STK_PARSE_RESULT_OK;
 }
 
+static const struct dataobj_desc setup_event_list_dataobjs[] = {
+	{ STK_DATA_OBJECT_TYPE_EVENT_LIST,
+		DATAOBJ_FLAG_MANDATORY | DATAOBJ_FLAG_MINIMUM,
+		DATAOBJ_OFFSET(setup_event_list.event_list) },
+	{ STK_DATA_OBJECT_TYPE_INVALID }
+};
+
 static enum stk_command_parse_result parse_setup_event_list(
 					struct stk_command *command,
 					struct comprehension_tlv_iter *iter)
 {
-	struct stk_command_setup_event_list *obj = &command->setup_event_list;
-
 	if (command->src != STK_DEVICE_IDENTITY_TYPE_UICC)
 		return STK_PARSE_RESULT_DATA_NOT_UNDERSTOOD;
 
 	if (command->dst != STK_DEVICE_IDENTITY_TYPE_TERMINAL)
 		return STK_PARSE_RESULT_DATA_NOT_UNDERSTOOD;
 
-	return parse_dataobj(iter, STK_DATA_OBJECT_TYPE_EVENT_LIST,
-				DATAOBJ_FLAG_MANDATORY | DATAOBJ_FLAG_MINIMUM,
-				&obj->event_list,
-				STK_DATA_OBJECT_TYPE_INVALID);
+	return parse_dataobj_table(iter, command, setup_event_list_dataobjs);
 }
 
+static const struct dataobj_desc perform_card_apdu_dataobjs[] = {
+	{ STK_DATA_OBJECT_TYPE_C_APDU,
+		DATAOBJ_FLAG_MANDATORY | DATAOBJ_FLAG_MINIMUM,
+		DATAOBJ_OFFSET(perform_card_apdu.c_apdu) },
+	{ STK_DATA_OBJECT_TYPE_INVALID }
+};
+
 static enum stk_command_parse_result parse_perform_card_apdu(
 					struct stk_command *command,
 					struct comprehension_tlv_iter *iter)
 {
-	struct stk_command_perform_card_apdu *obj = &command->perform_card_apdu;
-
 	if (command->src != STK_DEVICE_IDENTITY_TYPE_UICC)
 		return STK_PARSE_RESULT_DATA_NOT_UNDERSTOOD;
 
@@ -2938,10 +2966,7 @@ static enum stk_command_parse_result parse_perform_card_apdu(
 			(command->dst > STK_DEVICE_IDENTITY_TYPE_CARD_READER_7))
 		return STK_PARSE_RESULT_DATA_NOT_UNDERSTOOD;
 
-	return parse_dataobj(iter, STK_DATA_OBJECT_TYPE_C_APDU,
-				DATAOBJ_FLAG_MANDATORY | DATAOBJ_FLAG_MINIMUM,
-				&obj->c_apdu,
-				STK_DATA_OBJECT_TYPE_INVALID);
+	return parse_dataobj_table(iter, command, perform_card_apdu_dataobjs);
 }
 
 static enum stk_command_parse_result parse_power_off_card(
@@ -2997,13 +3022,29 @@ static enum stk_command_parse_result parse_get_reader_status(
 	return STK_PARSE_RESULT_OK;
 }
 
-static enum stk_command_parse_result parse_timer_mgmt(
-					struct stk_command *command,
+/* The timer value is only mandatory when starting a timer */
+static const struct dataobj_desc timer_start_dataobjs[] = {
+	{ STK_DATA_OBJECT_TYPE_TIMER_ID,
+		DATAOBJ_FLAG_MANDATORY | DATAOBJ_FLAG_MINIMUM,
+		DATAOBJ_OFFSET(timer_mgmt.timer_id) },
+	{ STK_DATA_OBJECT_TYPE_TIMER_VALUE, DATAOBJ_FLAG_MANDATORY,
+		DATAOBJ_OFFSET(timer_mgmt.timer_value) },
+	{ STK_DATA_OBJECT_TYPE_INVALID }
+};
+
+static const struct dataobj_desc timer_mgmt_dataobjs[] = {
+	{ STK_DATA_OBJECT_TYPE_TIMER_ID,
+		DATAOBJ_FLAG_MANDATORY | DATAOBJ_FLAG_MINIMUM,
+		DATAOBJ_OFFSET(timer_mgmt.timer_id) },
+	{ STK_DATA_OBJECT_TYPE_TIMER_VALUE, 0,
+		DATAOBJ_OFFSET(timer_mgmt.timer_value) },
+	{ STK_DATA_OBJECT_TYPE_INVALID }
+};
+
+static enum stk_command_parse_result parse_timer_mgmt(
+					struct stk_command *command,
 					struct comprehension_tlv_iter *iter)
 {
-	struct stk_command_timer_mgmt *obj = &command->timer_mgmt;
-	enum stk_data_object_flag value_flags = 0;
-
 	if (command->src != STK_DEVICE_IDENTITY_TYPE_UICC)
 		return STK_PARSE_RESULT_DATA_NOT_UNDERSTOOD;
 
@@ -3011,235 +3052,203 @@ static enum stk_command_parse_result parse_timer_mgmt(
 		return STK_PARSE_RESULT_DATA_NOT_UNDERSTOOD;
 
 	if ((command->qualifier & 3) == 0) /* Start a timer */
-		value_flags = DATAOBJ_FLAG_MANDATORY;
-
-	return parse_dataobj(iter, STK_DATA_OBJECT_TYPE_TIMER_ID,
-				DATAOBJ_FLAG_MANDATORY | DATAOBJ_FLAG_MINIMUM,
-				&obj->timer_id,
-				STK_DATA_OBJECT_TYPE_TIMER_VALUE, value_flags,
-				&obj->timer_value,
-				STK_DATA_OBJECT_TYPE_INVALID);
-}
-
-static void destroy_setup_idle_mode_text(struct stk_command *command)
-{
-	g_free(command->setup_idle_mode_text.text);
-}
+		return parse_dataobj_table(iter, command,
+						timer_start_dataobjs);
+
+	return parse_dataobj_table(iter, command, timer_mgmt_dataobjs);
+}
+
+static const struct dataobj_desc setup_idle_mode_text_dataobjs[] = {
+	{ STK_DATA_OBJECT_TYPE_TEXT,
+		DATAOBJ_FLAG_MANDATORY | DATAOBJ_FLAG_MINIMUM,
+		DATAOBJ_OFFSET(setup_idle_mode_text.text) },
+	{ STK_DATA_OBJECT_TYPE_ICON_ID, 0,
+		DATAOBJ_OFFSET(setup_idle_mode_text.icon_id) },
+	{ STK_DATA_OBJECT_TYPE_TEXT_ATTRIBUTE, 0,
+		DATAOBJ_OFFSET(setup_idle_mode_text.text_attr) },
+	{ STK_DATA_OBJECT_TYPE_FRAME_ID, 0,
+		DATAOBJ_OFFSET(setup_idle_mode_text.frame_id) },
+	{ STK_DATA_OBJECT_TYPE_INVALID }
+};
 
 static enum stk_command_parse_result parse_setup_idle_mode_text(
 					struct stk_command *command,
 					struct comprehension_tlv_iter *iter)
 {
-	struct stk_command_setup_idle_mode_text *obj =
-					&command->setup_idle_mode_text;
-
 	if (command->src != STK_DEVICE_IDENTITY_TYPE_UICC)
 		return STK_PARSE_RESULT_DATA_NOT_UNDERSTOOD;
 
 	if (command->dst != STK_DEVICE_IDENTITY_TYPE_TERMINAL)
 		return STK_PARSE_RESULT_DATA_NOT_UNDERSTOOD;
 
-	command->destructor = destroy_setup_idle_mode_text;
-
-	return parse_dataobj(iter, STK_DATA_OBJECT_TYPE_TEXT,
-				DATAOBJ_FLAG_MANDATORY | DATAOBJ_FLAG_MINIMUM,
-				&obj->text,
-				STK_DATA_OBJECT_TYPE_ICON_ID, 0,
-				&obj->icon_id,
-				STK_DATA_OBJECT_TYPE_TEXT_ATTRIBUTE, 0,
-				&obj->text_attr,
-				STK_DATA_OBJECT_TYPE_FRAME_ID, 0,
-				&obj->frame_id,
-				STK_DATA_OBJECT_TYPE_INVALID);
-}
-
-static void destroy_run_at_command(struct stk_command *command)
-{
-	g_free(command->run_at_command.alpha_id);
-	g_free(command->run_at_command.at_command);
-}
+	return parse_dataobj_table(iter, command,
+					setup_idle_mode_text_dataobjs);
+}
+
+static const struct dataobj_desc run_at_command_dataobjs[] = {
+	{ STK_DATA_OBJECT_TYPE_ALPHA_ID, 0,
+		DATAOBJ_OFFSET(run_at_command.alpha_id) },
+	{ STK_DATA_OBJECT_TYPE_AT_COMMAND,
+		DATAOBJ_FLAG_MANDATORY | DATAOBJ_FLAG_MINIMUM,
+		DATAOBJ_OFFSET(run_at_command.at_command) },
+	{ STK_DATA_OBJECT_TYPE_ICON_ID, 0,
+		DATAOBJ_OFFSET(run_at_command.icon_id) },
+	{ STK_DATA_OBJECT_TYPE_TEXT_ATTRIBUTE, 0,
+		DATAOBJ_OFFSET(run_at_command.text_attr) },
+	{ STK_DATA_OBJECT_TYPE_FRAME_ID, 0,
+		DATAOBJ_OFFSET(run_at_command.frame_id) },
+	{ STK_DATA_OBJECT_TYPE_INVALID }
+};
 
 static enum stk_command_parse_result parse_run_at_command(
 					struct stk_command *command,
 					struct comprehension_tlv_iter *iter)
 {
-	struct stk_command_run_at_command *obj = &command->run_at_command;
-
 	if (command->src != STK_DEVICE_IDENTITY_TYPE_UICC)
 		return STK_PARSE_RESULT_DATA_NOT_UNDERSTOOD;
 
 	if (command->dst != STK_DEVICE_IDENTITY_TYPE_TERMINAL)
 		return STK_PARSE_RESULT_DATA_NOT_UNDERSTOOD;
 
-	command->destructor = destroy_run_at_command;
-
-	return parse_dataobj(iter, STK_DATA_OBJECT_TYPE_ALPHA_ID, 0,
-				&obj->alpha_id,
-				STK_DATA_OBJECT_TYPE_AT_COMMAND,
-				DATAOBJ_FLAG_MANDATORY | DATAOBJ_FLAG_MINIMUM,
-				&obj->at_command,
-				STK_DATA_OBJECT_TYPE_ICON_ID, 0,
-				&obj->icon_id,
-				STK_DATA_OBJECT_TYPE_TEXT_ATTRIBUTE, 0,
-				&obj->text_attr,
-				STK_DATA_OBJECT_TYPE_FRAME_ID, 0,
-				&obj->frame_id,
-				STK_DATA_OBJECT_TYPE_INVALID);
-}
-
-static void destroy_send_dtmf(struct stk_command *command)
-{
-	g_free(command->send_dtmf.alpha_id);
-	g_free(command->send_dtmf.dtmf);
-}
+	return parse_dataobj_table(iter, command, run_at_command_dataobjs);
+}
+
+static const struct dataobj_desc send_dtmf_dataobjs[] = {
+	{ STK_DATA_OBJECT_TYPE_ALPHA_ID, 0,
+		DATAOBJ_OFFSET(send_dtmf.alpha_id) },
+	{ STK_DATA_OBJECT_TYPE_DTMF_STRING,
+		DATAOBJ_FLAG_MANDATORY | DATAOBJ_FLAG_MINIMUM,
+		DATAOBJ_OFFSET(send_dtmf.dtmf) },
+	{ STK_DATA_OBJECT_TYPE_ICON_ID, 0,
+		DATAOBJ_OFFSET(send_dtmf.icon_id) },
+	{ STK_DATA_OBJECT_TYPE_TEXT_ATTRIBUTE, 0,
+		DATAOBJ_OFFSET(send_dtmf.text_attr) },
+	{ STK_DATA_OBJECT_TYPE_FRAME_ID, 0,
+		DATAOBJ_OFFSET(send_dtmf.frame_id) },
+	{ STK_DATA_OBJECT_TYPE_INVALID }
+};
 
 static enum stk_command_parse_result parse_send_dtmf(
 					struct stk_command *command,
 					struct comprehension_tlv_iter *iter)
 {
-	struct stk_command_send_dtmf *obj = &command->send_dtmf;
-
 	if (command->src != STK_DEVICE_IDENTITY_TYPE_UICC)
 		return STK_PARSE_RESULT_DATA_NOT_UNDERSTOOD;
 
 	if (command->dst != STK_DEVICE_IDENTITY_TYPE_NETWORK)
 		return STK_PARSE_RESULT_DATA_NOT_UNDERSTOOD;
 
-	command->destructor = destroy_send_dtmf;
-
-	return parse_dataobj(iter, STK_DATA_OBJECT_TYPE_ALPHA_ID, 0,
-				&obj->alpha_id,
-				STK_DATA_OBJECT_TYPE_DTMF_STRING,
-				DATAOBJ_FLAG_MANDATORY | DATAOBJ_FLAG_MINIMUM,
-				&obj->dtmf,
-				STK_DATA_OBJECT_TYPE_ICON_ID, 0,
-				&obj->icon_id,
-				STK_DATA_OBJECT_TYPE_TEXT_ATTRIBUTE, 0,
-				&obj->text_attr,
-				STK_DATA_OBJECT_TYPE_FRAME_ID, 0,
-				&obj->frame_id,
-				STK_DATA_OBJECT_TYPE_INVALID);
+	return parse_dataobj_table(iter, command, send_dtmf_dataobjs);
 }
 
+static const struct dataobj_desc language_notification_dataobjs[] = {
+	{ STK_DATA_OBJECT_TYPE_LANGUAGE, 0,
+		DATAOBJ_OFFSET(language_notification.language) },
+	{ STK_DATA_OBJECT_TYPE_INVALID }
+};
+
 static enum stk_command_parse_result parse_language_notification(
 					struct stk_command *command,
 					struct comprehension_tlv_iter *iter)
 {
-	struct stk_command_language_notification *obj =
-					&command->language_notification;
-
 	if (command->src != STK_DEVICE_IDENTITY_TYPE_UICC)
 		return STK_PARSE_RESULT_DATA_NOT_UNDERSTOOD;
 
 	if (command->dst != STK_DEVICE_IDENTITY_TYPE_TERMINAL)
 		return STK_PARSE_RESULT_DATA_NOT_UNDERSTOOD;
 
-	return parse_dataobj(iter, STK_DATA_OBJECT_TYPE_LANGUAGE, 0,
-				&obj->language,
-				STK_DATA_OBJECT_TYPE_INVALID);
-}
-
-static void destroy_launch_browser(struct stk_command *command)
-{
-	g_free(command->launch_browser.url);
-	g_free(command->launch_browser.bearer.array);
-	g_slist_foreach(command->launch_browser.prov_file_refs,
-				(GFunc)g_free, NULL);
-	g_slist_free(command->launch_browser.prov_file_refs);
-	g_free(command->launch_browser.text_gateway_proxy_id);
-	g_free(command->launch_browser.alpha_id);
-	g_free(command->launch_browser.network_name.array);
-	g_free(command->launch_browser.text_usr);
-	g_free(command->launch_browser.text_passwd);
-}
+	return parse_dataobj_table(iter, command,
+					language_notification_dataobjs);
+}
+
+static const struct dataobj_desc launch_browser_dataobjs[] = {
+	{ STK_DATA_OBJECT_TYPE_BROWSER_ID, 0,
+		DATAOBJ_OFFSET(launch_browser.browser_id) },
+	{ STK_DATA_OBJECT_TYPE_URL,
+		DATAOBJ_FLAG_MANDATORY | DATAOBJ_FLAG_MINIMUM,
+		DATAOBJ_OFFSET(launch_browser.url) },
+	{ STK_DATA_OBJECT_TYPE_BEARER, 0,
+		DATAOBJ_OFFSET(launch_browser.bearer) },
+	{ STK_DATA_OBJECT_TYPE_PROVISIONING_FILE_REF, DATAOBJ_FLAG_LIST,
+		DATAOBJ_OFFSET(launch_browser.prov_file_refs) },
+	{ STK_DATA_OBJECT_TYPE_TEXT, 0,
+		DATAOBJ_OFFSET(launch_browser.text_gateway_proxy_id) },
+	{ STK_DATA_OBJECT_TYPE_ALPHA_ID, 0,
+		DATAOBJ_OFFSET(launch_browser.alpha_id) },
+	{ STK_DATA_OBJECT_TYPE_ICON_ID, 0,
+		DATAOBJ_OFFSET(launch_browser.icon_id) },
+	{ STK_DATA_OBJECT_TYPE_TEXT_ATTRIBUTE, 0,
+		DATAOBJ_OFFSET(launch_browser.text_attr) },
+	{ STK_DATA_OBJECT_TYPE_FRAME_ID, 0,
+		DATAOBJ_OFFSET(launch_browser.frame_id) },
+	{ STK_DATA_OBJECT_TYPE_NETWORK_ACCESS_NAME, 0,
+		DATAOBJ_OFFSET(launch_browser.network_name) },
+	{ STK_DATA_OBJECT_TYPE_TEXT, 0,
+		DATAOBJ_OFFSET(launch_browser.text_usr) },
+	{ STK_DATA_OBJECT_TYPE_TEXT, 0,
+		DATAOBJ_OFFSET(launch_browser.text_passwd) },
+	{ STK_DATA_OBJECT_TYPE_INVALID }
+};
 
 static enum stk_command_parse_result parse_launch_browser(
 					struct stk_command *command,
 					struct comprehension_tlv_iter *iter)
 {
-	struct stk_command_launch_browser *obj = &command->launch_browser;
-
 	if (command->src != STK_DEVICE_IDENTITY_TYPE_UICC)
 		return STK_PARSE_RESULT_DATA_NOT_UNDERSTOOD;
 
 	if (command->dst != STK_DEVICE_IDENTITY_TYPE_TERMINAL)
 		return STK_PARSE_RESULT_DATA_NOT_UNDERSTOOD;
 
-	command->destructor = destroy_launch_browser;
-
-	return parse_dataobj(iter,
-				STK_DATA_OBJECT_TYPE_BROWSER_ID, 0,
-				&obj->browser_id,
-				STK_DATA_OBJECT_TYPE_URL,
-				DATAOBJ_FLAG_MANDATORY | DATAOBJ_FLAG_MINIMUM,
-				&obj->url,
-				STK_DATA_OBJECT_TYPE_BEARER, 0,
-				&obj->bearer,
-				STK_DATA_OBJECT_TYPE_PROVISIONING_FILE_REF,
-				DATAOBJ_FLAG_LIST,
-				&obj->prov_file_refs,
-				STK_DATA_OBJECT_TYPE_TEXT, 0,
-				&obj->text_gateway_proxy_id,
-				STK_DATA_OBJECT_TYPE_ALPHA_ID, 0,
-				&obj->alpha_id,
-				STK_DATA_OBJECT_TYPE_ICON_ID, 0,
-				&obj->icon_id,
-				STK_DATA_OBJECT_TYPE_TEXT_ATTRIBUTE, 0,
-				&obj->text_attr,
-				STK_DATA_OBJECT_TYPE_FRAME_ID, 0,
-				&obj->frame_id,
-				STK_DATA_OBJECT_TYPE_NETWORK_ACCESS_NAME, 0,
-				&obj->network_name,
-				STK_DATA_OBJECT_TYPE_TEXT, 0,
-				&obj->text_usr,
-				STK_DATA_OBJECT_TYPE_TEXT, 0,
-				&obj->text_passwd,
-				STK_DATA_OBJECT_TYPE_INVALID);
+	return parse_dataobj_table(iter, command, launch_browser_dataobjs);
 }
 
 /* TODO: parse_open_channel */
 
-static void destroy_close_channel(struct stk_command *command)
-{
-	g_free(command->close_channel.alpha_id);
-}
+static const struct dataobj_desc close_channel_dataobjs[] = {
+	{ STK_DATA_OBJECT_TYPE_ALPHA_ID, 0,
+		DATAOBJ_OFFSET(close_channel.alpha_id) },
+	{ STK_DATA_OBJECT_TYPE_ICON_ID, 0,
+		DATAOBJ_OFFSET(close_channel.icon_id) },
+	{ STK_DATA_OBJECT_TYPE_TEXT_ATTRIBUTE, 0,
+		DATAOBJ_OFFSET(close_channel.text_attr) },
+	{ STK_DATA_OBJECT_TYPE_FRAME_ID, 0,
+		DATAOBJ_OFFSET(close_channel.frame_id) },
+	{ STK_DATA_OBJECT_TYPE_INVALID }
+};
 
 static enum stk_command_parse_result parse_close_channel(
 					struct stk_command *command,
 					struct comprehension_tlv_iter *iter)
 {
-	struct stk_command_close_channel *obj = &command->close_channel;
-
 	if (command->src != STK_DEVICE_IDENTITY_TYPE_UICC)
 		return STK_PARSE_RESULT_DATA_NOT_UNDERSTOOD;
 
 	if (command->dst != STK_DEVICE_IDENTITY_TYPE_TERMINAL)
 		return STK_PARSE_RESULT_DATA_NOT_UNDERSTOOD;
 
-	command->destructor = destroy_close_channel;
-
-	return parse_dataobj(iter, STK_DATA_OBJECT_TYPE_ALPHA_ID, 0,
-				&obj->alpha_id,
-				STK_DATA_OBJECT_TYPE_ICON_ID, 0,
-				&obj->icon_id,
-				STK_DATA_OBJECT_TYPE_TEXT_ATTRIBUTE, 0,
-				&obj->text_attr,
-				STK_DATA_OBJECT_TYPE_FRAME_ID, 0,
-				&obj->frame_id,
-				STK_DATA_OBJECT_TYPE_INVALID);
-}
-
-static void destroy_receive_data(struct stk_command *command)
-{
-	g_free(command->receive_data.alpha_id);
-}
+	return parse_dataobj_table(iter, command, close_channel_dataobjs);
+}
+
+static const struct dataobj_desc receive_data_dataobjs[] = {
+	{ STK_DATA_OBJECT_TYPE_ALPHA_ID, 0,
+		DATAOBJ_OFFSET(receive_data.alpha_id) },
+	{ STK_DATA_OBJECT_TYPE_ICON_ID, 0,
+		DATAOBJ_OFFSET(receive_data.icon_id) },
+	{ STK_DATA_OBJECT_TYPE_CHANNEL_DATA_LENGTH,
+		DATAOBJ_FLAG_MANDATORY | DATAOBJ_FLAG_MINIMUM,
+		DATAOBJ_OFFSET(receive_data.data_len) },
+	{ STK_DATA_OBJECT_TYPE_TEXT_ATTRIBUTE, 0,
+		DATAOBJ_OFFSET(receive_data.text_attr) },
+	{ STK_DATA_OBJECT_TYPE_FRAME_ID, 0,
+		DATAOBJ_OFFSET(receive_data.frame_id) },
+	{ STK_DATA_OBJECT_TYPE_INVALID }
+};
 
 static enum stk_command_parse_result parse_receive_data(
 					struct stk_command *command,
 					struct comprehension_tlv_iter *iter)
 {
-	struct stk_command_receive_data *obj = &command->receive_data;
-
 	if (command->src != STK_DEVICE_IDENTITY_TYPE_UICC)
 		return STK_PARSE_RESULT_DATA_NOT_UNDERSTOOD;
 
@@ -3247,34 +3256,28 @@ static enum stk_command_parse_result parse_receive_data(
 			(command->dst > STK_DEVICE_IDENTITY_TYPE_CHANNEL_7))
 		return STK_PARSE_RESULT_DATA_NOT_UNDERSTOOD;
 
-	command->destructor = destroy_receive_data;
-
-	return parse_dataobj(iter, STK_DATA_OBJECT_TYPE_ALPHA_ID, 0,
-				&obj->alpha_id,
-				STK_DATA_OBJECT_TYPE_ICON_ID, 0,
-				&obj->icon_id,
-				STK_DATA_OBJECT_TYPE_CHANNEL_DATA_LENGTH,
-				DATAOBJ_FLAG_MANDATORY | DATAOBJ_FLAG_MINIMUM,
-				&obj->data_len,
-				STK_DATA_OBJECT_TYPE_TEXT_ATTRIBUTE, 0,
-				&obj->text_attr,
-				STK_DATA_OBJECT_TYPE_FRAME_ID, 0,
-				&obj->frame_id,
-				STK_DATA_OBJECT_TYPE_INVALID);
-}
-
-static void destroy_send_data(struct stk_command *command)
-{
-	g_free(command->send_data.alpha_id);
-	g_free(command->send_data.data.array);
-}
+	return parse_dataobj_table(iter, command, receive_data_dataobjs);
+}
+
+static const struct dataobj_desc send_data_dataobjs[] = {
+	{ STK_DATA_OBJECT_TYPE_ALPHA_ID, 0,
+		DATAOBJ_OFFSET(send_data.alpha_id) },
+	{ STK_DATA_OBJECT_TYPE_ICON_ID, 0,
+		DATAOBJ_OFFSET(send_data.icon_id) },
+	{ STK_DATA_OBJECT_TYPE_CHANNEL_DATA,
+		DATAOBJ_FLAG_MANDATORY | DATAOBJ_FLAG_MINIMUM,
+		DATAOBJ_OFFSET(send_data.data) },
+	{ STK_DATA_OBJECT_TYPE_TEXT_ATTRIBUTE, 0,
+		DATAOBJ_OFFSET(send_data.text_attr) },
+	{ STK_DATA_OBJECT_TYPE_FRAME_ID, 0,
+		DATAOBJ_OFFSET(send_data.frame_id) },
+	{ STK_DATA_OBJECT_TYPE_INVALID }
+};
 
 static enum stk_command_parse_result parse_send_data(
 					struct stk_command *command,
 					struct comprehension_tlv_iter *iter)
 {
-	struct stk_command_send_data *obj = &command->send_data;
-
 	if (command->src != STK_DEVICE_IDENTITY_TYPE_UICC)
 		return STK_PARSE_RESULT_DATA_NOT_UNDERSTOOD;
 
@@ -3282,20 +3285,7 @@ static enum stk_command_parse_result parse_send_data(
 			(command->dst > STK_DEVICE_IDENTITY_TYPE_CHANNEL_7))
 		return STK_PARSE_RESULT_DATA_NOT_UNDERSTOOD;
 
-	command->destructor = destroy_send_data;
-
-	return parse_dataobj(iter, STK_DATA_OBJECT_TYPE_ALPHA_ID, 0,
-				&obj->alpha_id,
-				STK_DATA_OBJECT_TYPE_ICON_ID, 0,
-				&obj->icon_id,
-				STK_DATA_OBJECT_TYPE_CHANNEL_DATA,
-				DATAOBJ_FLAG_MANDATORY | DATAOBJ_FLAG_MINIMUM,
-				&obj->data,
-				STK_DATA_OBJECT_TYPE_TEXT_ATTRIBUTE, 0,
-				&obj->text_attr,
-				STK_DATA_OBJECT_TYPE_FRAME_ID, 0,
-				&obj->frame_id,
-				STK_DATA_OBJECT_TYPE_INVALID);
+	return parse_dataobj_table(iter, command, send_data_dataobjs);
 }
 
 static enum stk_command_parse_result parse_get_channel_status(
@@ -3311,124 +3301,108 @@ static enum stk_command_parse_result parse_get_channel_status(
 	return STK_PARSE_RESULT_OK;
 }
 
-static void destroy_service_search(struct stk_command *command)
-{
-	g_free(command->service_search.alpha_id);
-	g_free(command->service_search.serv_search.ser_search);
-	g_free(command->service_search.dev_filter.dev_filter);
-}
+static const struct dataobj_desc service_search_dataobjs[] = {
+	{ STK_DATA_OBJECT_TYPE_ALPHA_ID, 0,
+		DATAOBJ_OFFSET(service_search.alpha_id) },
+	{ STK_DATA_OBJECT_TYPE_ICON_ID, 0,
+		DATAOBJ_OFFSET(service_search.icon_id) },
+	{ STK_DATA_OBJECT_TYPE_SERVICE_SEARCH,
+		DATAOBJ_FLAG_MANDATORY | DATAOBJ_FLAG_MINIMUM,
+		DATAOBJ_OFFSET(service_search.serv_search) },
+	{ STK_DATA_OBJECT_TYPE_DEVICE_FILTER, 0,
+		DATAOBJ_OFFSET(service_search.dev_filter) },
+	{ STK_DATA_OBJECT_TYPE_TEXT_ATTRIBUTE, 0,
+		DATAOBJ_OFFSET(service_search.text_attr) },
+	{ STK_DATA_OBJECT_TYPE_FRAME_ID, 0,
+		DATAOBJ_OFFSET(service_search.frame_id) },
+	{ STK_DATA_OBJECT_TYPE_INVALID }
+};
 
 static enum stk_command_parse_result parse_service_search(
 					struct stk_command *command,
 					struct comprehension_tlv_iter *iter)
 {
-	struct stk_command_service_search *obj = &command->service_search;
-
 	if (command->src != STK_DEVICE_IDENTITY_TYPE_UICC)
 		return STK_PARSE_RESULT_DATA_NOT_UNDERSTOOD;
 
 	if (command->dst != STK_DEVICE_IDENTITY_TYPE_TERMINAL)
 		return STK_PARSE_RESULT_DATA_NOT_UNDERSTOOD;
 
-	command->destructor = destroy_service_search;
-
-	return parse_dataobj(iter, STK_DATA_OBJECT_TYPE_ALPHA_ID, 0,
-				&obj->alpha_id,
-				STK_DATA_OBJECT_TYPE_ICON_ID, 0,
-				&obj->icon_id,
-				STK_DATA_OBJECT_TYPE_SERVICE_SEARCH,
-				DATAOBJ_FLAG_MANDATORY | DATAOBJ_FLAG_MINIMUM,
-				&obj->serv_search,
-				STK_DATA_OBJECT_TYPE_DEVICE_FILTER, 0,
-				&obj->dev_filter,
-				STK_DATA_OBJECT_TYPE_TEXT_ATTRIBUTE, 0,
-				&obj->text_attr,
-				STK_DATA_OBJECT_TYPE_FRAME_ID, 0,
-				&obj->frame_id,
-				STK_DATA_OBJECT_TYPE_INVALID);
-}
-
-static void destroy_get_service_info(struct stk_command *command)
-{
-	g_free(command->get_service_info.alpha_id);
-	g_free(command->get_service_info.attr_info.attr_info);
-}
+	return parse_dataobj_table(iter, command, service_search_dataobjs);
+}
+
+static const struct dataobj_desc get_service_info_dataobjs[] = {
+	{ STK_DATA_OBJECT_TYPE_ALPHA_ID, 0,
+		DATAOBJ_OFFSET(get_service_info.alpha_id) },
+	{ STK_DATA_OBJECT_TYPE_ICON_ID, 0,
+		DATAOBJ_OFFSET(get_service_info.icon_id) },
+	{ STK_DATA_OBJECT_TYPE_ATTRIBUTE_INFO,
+		DATAOBJ_FLAG_MANDATORY | DATAOBJ_FLAG_MINIMUM,
+		DATAOBJ_OFFSET(get_service_info.attr_info) },
+	{ STK_DATA_OBJECT_TYPE_TEXT_ATTRIBUTE, 0,
+		DATAOBJ_OFFSET(get_service_info.text_attr) },
+	{ STK_DATA_OBJECT_TYPE_FRAME_ID, 0,
+		DATAOBJ_OFFSET(get_service_info.frame_id) },
+	{ STK_DATA_OBJECT_TYPE_INVALID }
+};
 
 static enum stk_command_parse_result parse_get_service_info(
 					struct stk_command *command,
 					struct comprehension_tlv_iter *iter)
 {
-	struct stk_command_get_service_info *obj = &command->get_service_info;
-
 	if (command->src != STK_DEVICE_IDENTITY_TYPE_UICC)
 		return STK_PARSE_RESULT_DATA_NOT_UNDERSTOOD;
 
 	if (command->dst != STK_DEVICE_IDENTITY_TYPE_TERMINAL)
 		return STK_PARSE_RESULT_DATA_NOT_UNDERSTOOD;
 
-	command->destructor = destroy_get_service_info;
-
-	return parse_dataobj(iter, STK_DATA_OBJECT_TYPE_ALPHA_ID, 0,
-				&obj->alpha_id,
-				STK_DATA_OBJECT_TYPE_ICON_ID, 0,
-				&obj->icon_id,
-				STK_DATA_OBJECT_TYPE_ATTRIBUTE_INFO,
-				DATAOBJ_FLAG_MANDATORY | DATAOBJ_FLAG_MINIMUM,
-				&obj->attr_info,
-				STK_DATA_OBJECT_TYPE_TEXT_ATTRIBUTE, 0,
-				&obj->text_attr,
-				STK_DATA_OBJECT_TYPE_FRAME_ID, 0,
-				&obj->frame_id,
-				STK_DATA_OBJECT_TYPE_INVALID);
+	return parse_dataobj_table(iter, command, get_service_info_dataobjs);
 }
 
-static void destroy_declare_service(struct stk_command *command)
-{
-	g_free(command->declare_service.serv_rec.serv_rec);
-}
+static const struct dataobj_desc declare_service_dataobjs[] = {
+	{ STK_DATA_OBJECT_TYPE_SERVICE_RECORD,
+		DATAOBJ_FLAG_MANDATORY | DATAOBJ_FLAG_MINIMUM,
+		DATAOBJ_OFFSET(declare_service.serv_rec) },
+	{ STK_DATA_OBJECT_TYPE_UICC_TE_INTERFACE, 0,
+		DATAOBJ_OFFSET(declare_service.intf) },
+	{ STK_DATA_OBJECT_TYPE_INVALID }
+};
 
 static enum stk_command_parse_result parse_declare_service(
 					struct stk_command *command,
 					struct comprehension_tlv_iter *iter)
 {
-	struct stk_command_declare_service *obj = &command->declare_service;
-
 	if (command->src != STK_DEVICE_IDENTITY_TYPE_UICC)
 		return STK_PARSE_RESULT_DATA_NOT_UNDERSTOOD;
 
 	if (command->dst != STK_DEVICE_IDENTITY_TYPE_TERMINAL)
 		return STK_PARSE_RESULT_DATA_NOT_UNDERSTOOD;
 
-	command->destructor = destroy_declare_service;
-
-	return parse_dataobj(iter, STK_DATA_OBJECT_TYPE_SERVICE_RECORD,
-				DATAOBJ_FLAG_MANDATORY | DATAOBJ_FLAG_MINIMUM,
-				&obj->serv_rec,
-				STK_DATA_OBJECT_TYPE_UICC_TE_INTERFACE, 0,
-				&obj->intf,
-				STK_DATA_OBJECT_TYPE_INVALID);
+	return parse_dataobj_table(iter, command, declare_service_dataobjs);
 }
 
+static const struct dataobj_desc set_frames_dataobjs[] = {
+	{ STK_DATA_OBJECT_TYPE_FRAME_ID,
+		DATAOBJ_FLAG_MANDATORY | DATAOBJ_FLAG_MINIMUM,
+		DATAOBJ_OFFSET(set_frames.frame_id) },
+	{ STK_DATA_OBJECT_TYPE_FRAME_LAYOUT, 0,
+		DATAOBJ_OFFSET(set_frames.frame_layout) },
+	{ STK_DATA_OBJECT_TYPE_FRAME_ID, 0,
+		DATAOBJ_OFFSET(set_frames.frame_id_default) },
+	{ STK_DATA_OBJECT_TYPE_INVALID }
+};
+
 static enum stk_command_parse_result parse_set_frames(
 					struct stk_command *command,
 					struct comprehension_tlv_iter *iter)
 {
-	struct stk_command_set_frames *obj = &command->set_frames;
-
 	if (command->src != STK_DEVICE_IDENTITY_TYPE_UICC)
 		return STK_PARSE_RESULT_DATA_NOT_UNDERSTOOD;
 
 	if (command->dst != STK_DEVICE_IDENTITY_TYPE_TERMINAL)
 		return STK_PARSE_RESULT_DATA_NOT_UNDERSTOOD;
 
-	return parse_dataobj(iter, STK_DATA_OBJECT_TYPE_FRAME_ID,
-				DATAOBJ_FLAG_MANDATORY | DATAOBJ_FLAG_MINIMUM,
-				&obj->frame_id,
-				STK_DATA_OBJECT_TYPE_FRAME_LAYOUT, 0,
-				&obj->frame_layout,
-				STK_DATA_OBJECT_TYPE_FRAME_ID, 0,
-				&obj->frame_id_default,
-				STK_DATA_OBJECT_TYPE_INVALID);
+	return parse_dataobj_table(iter, command, set_frames_dataobjs);
 }
 
 static enum stk_command_parse_result parse_get_frames_status(
@@ -3444,138 +3418,117 @@ static enum stk_command_parse_result parse_get_frames_status(
 	return STK_PARSE_RESULT_OK;
 }
 
-static void destroy_retrieve_mms(struct stk_command *command)
-{
-	g_free(command->retrieve_mms.alpha_id);
-	g_slist_foreach(command->retrieve_mms.mms_rec_files,
-						(GFunc)g_free, NULL);
-	g_slist_free(command->retrieve_mms.mms_rec_files);
-}
+static const struct dataobj_desc retrieve_mms_dataobjs[] = {
+	{ STK_DATA_OBJECT_TYPE_ALPHA_ID, 0,
+		DATAOBJ_OFFSET(retrieve_mms.alpha_id) },
+	{ STK_DATA_OBJECT_TYPE_ICON_ID, 0,
+		DATAOBJ_OFFSET(retrieve_mms.icon_id) },
+	{ STK_DATA_OBJECT_TYPE_MMS_REFERENCE,
+		DATAOBJ_FLAG_MANDATORY | DATAOBJ_FLAG_MINIMUM,
+		DATAOBJ_OFFSET(retrieve_mms.mms_ref) },
+	{ STK_DATA_OBJECT_TYPE_FILE_LIST,
+		DATAOBJ_FLAG_MANDATORY | DATAOBJ_FLAG_MINIMUM,
+		DATAOBJ_OFFSET(retrieve_mms.mms_rec_files) },
+	{ STK_DATA_OBJECT_TYPE_MMS_CONTENT_ID,
+		DATAOBJ_FLAG_MANDATORY | DATAOBJ_FLAG_MINIMUM,
+		DATAOBJ_OFFSET(retrieve_mms.mms_content_id) },
+	{ STK_DATA_OBJECT_TYPE_MMS_ID, 0,
+		DATAOBJ_OFFSET(retrieve_mms.mms_id) },
+	{ STK_DATA_OBJECT_TYPE_TEXT_ATTRIBUTE, 0,
+		DATAOBJ_OFFSET(retrieve_mms.text_attr) },
+	{ STK_DATA_OBJECT_TYPE_FRAME_ID, 0,
+		DATAOBJ_OFFSET(retrieve_mms.frame_id) },
+	{ STK_DATA_OBJECT_TYPE_INVALID }
+};
 
 static enum stk_command_parse_result parse_retrieve_mms(
 					struct stk_command *command,
 					struct comprehension_tlv_iter *iter)
 {
-	struct stk_command_retrieve_mms *obj = &command->retrieve_mms;
-
 	if (command->src != STK_DEVICE_IDENTITY_TYPE_UICC)
 		return STK_PARSE_RESULT_DATA_NOT_UNDERSTOOD;
 
 	if (command->dst != STK_DEVICE_IDENTITY_TYPE_NETWORK)
 		return STK_PARSE_RESULT_DATA_NOT_UNDERSTOOD;
 
-	command->destructor = destroy_retrieve_mms;
-
-	return parse_dataobj(iter, STK_DATA_OBJECT_TYPE_ALPHA_ID, 0,
-				&obj->alpha_id,
-				STK_DATA_OBJECT_TYPE_ICON_ID, 0,
-				&obj->icon_id,
-				STK_DATA_OBJECT_TYPE_MMS_REFERENCE,
-				DATAOBJ_FLAG_MANDATORY | DATAOBJ_FLAG_MINIMUM,
-				&obj->mms_ref,
-				STK_DATA_OBJECT_TYPE_FILE_LIST,
-				DATAOBJ_FLAG_MANDATORY | DATAOBJ_FLAG_MINIMUM,
-				&obj->mms_rec_files,
-				STK_DATA_OBJECT_TYPE_MMS_CONTENT_ID,
-				DATAOBJ_FLAG_MANDATORY | DATAOBJ_FLAG_MINIMUM,
-				&obj->mms_content_id,
-				STK_DATA_OBJECT_TYPE_MMS_ID, 0,
-				&obj->mms_id,
-				STK_DATA_OBJECT_TYPE_TEXT_ATTRIBUTE, 0,
-				&obj->text_attr,
-				STK_DATA_OBJECT_TYPE_FRAME_ID, 0,
-				&obj->frame_id,
-				STK_DATA_OBJECT_TYPE_INVALID);
-}
-
-static void destroy_submit_mms(struct stk_command *command)
-{
-	g_free(command->submit_mms.alpha_id);
-	g_slist_foreach(command->submit_mms.mms_subm_files,
-						(GFunc)g_free, NULL);
-	g_slist_free(command->submit_mms.mms_subm_files);
-}
+	return parse_dataobj_table(iter, command, retrieve_mms_dataobjs);
+}
+
+static const struct dataobj_desc submit_mms_dataobjs[] = {
+	{ STK_DATA_OBJECT_TYPE_ALPHA_ID, 0,
+		DATAOBJ_OFFSET(submit_mms.alpha_id) },
+	{ STK_DATA_OBJECT_TYPE_ICON_ID, 0,
+		DATAOBJ_OFFSET(submit_mms.icon_id) },
+	{ STK_DATA_OBJECT_TYPE_FILE_LIST,
+		DATAOBJ_FLAG_MANDATORY | DATAOBJ_FLAG_MINIMUM,
+		DATAOBJ_OFFSET(submit_mms.mms_subm_files) },
+	{ STK_DATA_OBJECT_TYPE_MMS_ID, 0,
+		DATAOBJ_OFFSET(submit_mms.mms_id) },
+	{ STK_DATA_OBJECT_TYPE_TEXT_ATTRIBUTE, 0,
+		DATAOBJ_OFFSET(submit_mms.text_attr) },
+	{ STK_DATA_OBJECT_TYPE_FRAME_ID, 0,
+		DATAOBJ_OFFSET(submit_mms.frame_id) },
+	{ STK_DATA_OBJECT_TYPE_INVALID }
+};
 
 static enum stk_command_parse_result parse_submit_mms(
 					struct stk_command *command,
 					struct comprehension_tlv_iter *iter)
 {
-	struct stk_command_submit_mms *obj = &command->submit_mms;
-
 	if (command->src != STK_DEVICE_IDENTITY_TYPE_UICC)
 		return STK_PARSE_RESULT_DATA_NOT_UNDERSTOOD;
 
 	if (command->dst != STK_DEVICE_IDENTITY_TYPE_NETWORK)
 		return STK_PARSE_RESULT_DATA_NOT_UNDERSTOOD;
 
-	command->destructor = destroy_submit_mms;
-
-	return parse_dataobj(iter, STK_DATA_OBJECT_TYPE_ALPHA_ID, 0,
-				&obj->alpha_id,
-				STK_DATA_OBJECT_TYPE_ICON_ID, 0,
-				&obj->icon_id,
-				STK_DATA_OBJECT_TYPE_FILE_LIST,
-				DATAOBJ_FLAG_MANDATORY | DATAOBJ_FLAG_MINIMUM,
-				&obj->mms_subm_files,
-				STK_DATA_OBJECT_TYPE_MMS_ID, 0,
-				&obj->mms_id,
-				STK_DATA_OBJECT_TYPE_TEXT_ATTRIBUTE, 0,
-				&obj->text_attr,
-				STK_DATA_OBJECT_TYPE_FRAME_ID, 0,
-				&obj->frame_id,
-				STK_DATA_OBJECT_TYPE_INVALID);
-}
-
-static void destroy_display_mms(struct stk_command *command)
-{
-	g_slist_foreach(command->display_mms.mms_subm_files,
-						(GFunc)g_free, NULL);
-	g_slist_free(command->display_mms.mms_subm_files);
-}
+	return parse_dataobj_table(iter, command, submit_mms_dataobjs);
+}
+
+static const struct dataobj_desc display_mms_dataobjs[] = {
+	{ STK_DATA_OBJECT_TYPE_FILE_LIST,
+		DATAOBJ_FLAG_MANDATORY | DATAOBJ_FLAG_MINIMUM,
+		DATAOBJ_OFFSET(display_mms.mms_subm_files) },
+	{ STK_DATA_OBJECT_TYPE_MMS_ID,
+		DATAOBJ_FLAG_MANDATORY | DATAOBJ_FLAG_MINIMUM,
+		DATAOBJ_OFFSET(display_mms.mms_id) },
+	{ STK_DATA_OBJECT_TYPE_IMMEDIATE_RESPONSE, 0,
+		DATAOBJ_OFFSET(display_mms.imd_resp) },
+	{ STK_DATA_OBJECT_TYPE_FRAME_ID, 0,
+		DATAOBJ_OFFSET(display_mms.frame_id) },
+	{ STK_DATA_OBJECT_TYPE_INVALID }
+};
 
 static enum stk_command_parse_result parse_display_mms(
 					struct stk_command *command,
 					struct comprehension_tlv_iter *iter)
 {
-	struct stk_command_display_mms *obj = &command->display_mms;
-
 	if (command->src != STK_DEVICE_IDENTITY_TYPE_UICC)
 		return STK_PARSE_RESULT_DATA_NOT_UNDERSTOOD;
 
 	if (command->dst != STK_DEVICE_IDENTITY_TYPE_TERMINAL)
 		return STK_PARSE_RESULT_DATA_NOT_UNDERSTOOD;
 
-	command->destructor = destroy_display_mms;
-
-	return parse_dataobj(iter, STK_DATA_OBJECT_TYPE_FILE_LIST,
-				DATAOBJ_FLAG_MANDATORY | DATAOBJ_FLAG_MINIMUM,
-				&obj->mms_subm_files,
-				STK_DATA_OBJECT_TYPE_MMS_ID,
-				DATAOBJ_FLAG_MANDATORY | DATAOBJ_FLAG_MINIMUM,
-				&obj->mms_id,
-				STK_DATA_OBJECT_TYPE_IMMEDIATE_RESPONSE, 0,
-				&obj->imd_resp,
-				STK_DATA_OBJECT_TYPE_FRAME_ID, 0,
-				&obj->frame_id,
-				STK_DATA_OBJECT_TYPE_INVALID);
+	return parse_dataobj_table(iter, command, display_mms_dataobjs);
 }
 
+static const struct dataobj_desc activate_dataobjs[] = {
+	{ STK_DATA_OBJECT_TYPE_ACTIVATE_DESCRIPTOR,
+		DATAOBJ_FLAG_MANDATORY | DATAOBJ_FLAG_MINIMUM,
+		DATAOBJ_OFFSET(activate.actv_desc) },
+	{ STK_DATA_OBJECT_TYPE_INVALID }
+};
+
 static enum stk_command_parse_result parse_activate(
 					struct stk_command *command,
 					struct comprehension_tlv_iter *iter)
 {
-	struct stk_command_activate *obj = &command->activate;
-
 	if (command->src != STK_DEVICE_IDENTITY_TYPE_UICC)
 		return STK_PARSE_RESULT_DATA_NOT_UNDERSTOOD;
 
 	if (command->dst != STK_DEVICE_IDENTITY_TYPE_TERMINAL)
 		return STK_PARSE_RESULT_DATA_NOT_UNDERSTOOD;
 
-	return parse_dataobj(iter, STK_DATA_OBJECT_TYPE_ACTIVATE_DESCRIPTOR,
-				DATAOBJ_FLAG_MANDATORY | DATAOBJ_FLAG_MINIMUM,
-				&obj->actv_desc,
-				STK_DATA_OBJECT_TYPE_INVALID);
+	return parse_dataobj_table(iter, command, activate_dataobjs);
 }
 
 static enum stk_command_parse_result parse_command_body(
@@ -3672,6 +3625,7 @@ struct stk_command *stk_command_new_from_pdu(const unsigned char *pdu,
 	struct ber_tlv_iter ber;
 	struct comprehension_tlv_iter iter;
 	const unsigned char *data;
+	struct stk_arena *arena;
 	struct stk_command *command;
 
 	ber_tlv_iter_init(&ber, pdu, len);
@@ -3701,7 +3655,13 @@ struct stk_command *stk_command_new_from_pdu(const unsigned char *pdu,
 
 	data = comprehension_tlv_iter_get_data(&iter);
 
-	command = g_new0(struct stk_command, 1);
+	arena = stk_arena_new(sizeof(struct stk_command) +
+					len * STK_ARENA_PDU_FACTOR);
+	if (arena == NULL)
+		return NULL;
+
+	command = stk_arena_alloc(arena, sizeof(struct stk_command));
+	command->arena = arena;
 
 	command->number = data[0];
 	command->type = data[1];
@@ -3728,7 +3688,9 @@ struct stk_command *stk_command_new_from_pdu(const unsigned char *pdu,
 	command->src = data[0];
 	command->dst = data[1];
 
+	parse_arena = arena;
 	command->status = parse_command_body(command, &iter);
+	parse_arena = NULL;
 
 out:
 	return command;
@@ -3736,10 +3698,7 @@ out:
 
 void stk_command_free(struct stk_command *command)
 {
-	if (command->destructor)
-		command->destructor(command);
-
-	g_free(command);
+	stk_arena_free(command->arena);
 }
 
 static gboolean stk_tlv_builder_init(struct stk_tlv_builder *iter,
@@ -5194,24 +5153,63 @@ static gboolean build_dataobj(struct stk_tlv_builder *tlv,
 	return TRUE;
 }
 
+/*
+ * Build side counterpart of struct dataobj_desc: the writer is given the
+ * data found offset bytes into the structure being encoded, or the data
+ * pointed to by the field there if DATAOBJ_FLAG_INDIRECT is set.  Offset 0
+ * passes the whole structure.  Tables end with a NULL writer.
+ */
+struct dataobj_writer_desc {
+	dataobj_writer writer;
+	int flags;
+	size_t offset;
+};
+
+#define RESPONSE_OFFSET(field) offsetof(struct stk_response, field)
+#define ENVELOPE_OFFSET(field) offsetof(struct stk_envelope, field)
+#define EVENT_OFFSET(field) ENVELOPE_OFFSET(event_download.field)
+
+static gboolean build_dataobj_table(struct stk_tlv_builder *tlv,
+					const void *base,
+					const struct dataobj_writer_desc *desc)
+{
+	for (; desc->writer; desc++) {
+		const void *data = (const char *) base + desc->offset;
+		gboolean cr = (desc->flags & DATAOBJ_FLAG_CR) ? TRUE : FALSE;
+
+		if (desc->flags & DATAOBJ_FLAG_INDIRECT)
+			data = *(const void * const *) data;
+
+		if (desc->writer(tlv, data, cr) != TRUE)
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+static const struct dataobj_writer_desc modified_call_response_dataobjs[] = {
+	{ build_dataobj_cc_requested_action, DATAOBJ_FLAG_CR,
+		RESPONSE_OFFSET(set_up_call.cc_requested_action) },
+	{ build_dataobj_result, DATAOBJ_FLAG_CR,
+		RESPONSE_OFFSET(set_up_call.modified_result.result) },
+	{ NULL }
+};
+
+static const struct dataobj_writer_desc setup_call_response_dataobjs[] = {
+	{ build_dataobj_cc_requested_action, DATAOBJ_FLAG_CR,
+		RESPONSE_OFFSET(set_up_call.cc_requested_action) },
+	{ NULL }
+};
+
 static gboolean build_setup_call(struct stk_tlv_builder *builder,
 					const struct stk_response *response)
 {
 	if (response->set_up_call.modified_result.cc_modified)
-		return build_dataobj(builder,
-				build_dataobj_cc_requested_action,
-				DATAOBJ_FLAG_CR,
-				&response->set_up_call.cc_requested_action,
-				build_dataobj_result,
-				DATAOBJ_FLAG_CR,
-				&response->set_up_call.modified_result.result,
-				NULL);
+		return build_dataobj_table(builder, response,
+				modified_call_response_dataobjs);
 	else
-		return build_dataobj(builder,
-				build_dataobj_cc_requested_action,
-				DATAOBJ_FLAG_CR,
-				&response->set_up_call.cc_requested_action,
-				NULL);
+		return build_dataobj_table(builder, response,
+				setup_call_response_dataobjs);
 }
 
 static gboolean build_local_info(struct stk_tlv_builder *builder,
@@ -5356,6 +5354,53 @@ static gboolean build_local_info(struct stk_tlv_builder *builder,
 	return FALSE;
 }
 
+static const struct dataobj_writer_desc get_inkey_response_dataobjs[] = {
+	{ build_dataobj_text, DATAOBJ_FLAG_CR,
+		RESPONSE_OFFSET(get_inkey.text) },
+	{ build_dataobj_duration, 0,
+		RESPONSE_OFFSET(get_inkey.duration) },
+	{ NULL }
+};
+
+static const struct dataobj_writer_desc get_input_response_dataobjs[] = {
+	{ build_dataobj_text, DATAOBJ_FLAG_CR,
+		RESPONSE_OFFSET(get_input.text) },
+	{ NULL }
+};
+
+static const struct dataobj_writer_desc poll_interval_response_dataobjs[] = {
+	{ build_dataobj_duration, DATAOBJ_FLAG_CR,
+		RESPONSE_OFFSET(poll_interval.max_interval) },
+	{ NULL }
+};
+
+static const struct dataobj_writer_desc select_item_response_dataobjs[] = {
+	{ build_dataobj_item_id, DATAOBJ_FLAG_CR,
+		RESPONSE_OFFSET(select_item.item_id) },
+	{ NULL }
+};
+
+static const struct dataobj_writer_desc timer_mgmt_response_dataobjs[] = {
+	{ build_dataobj_timer_id, DATAOBJ_FLAG_CR,
+		RESPONSE_OFFSET(timer_mgmt.id) },
+	{ build_dataobj_timer_value, DATAOBJ_FLAG_CR,
+		RESPONSE_OFFSET(timer_mgmt.value) },
+	{ NULL }
+};
+
+static const struct dataobj_writer_desc run_at_command_response_dataobjs[] = {
+	{ build_dataobj_at_response,
+		DATAOBJ_FLAG_CR | DATAOBJ_FLAG_INDIRECT,
+		RESPONSE_OFFSET(run_at_command.at_response) },
+	{ NULL }
+};
+
+static const struct dataobj_writer_desc send_ussd_response_dataobjs[] = {
+	{ build_dataobj_ussd_text, DATAOBJ_FLAG_CR,
+		RESPONSE_OFFSET(send_ussd.text) },
+	{ NULL }
+};
+
 const unsigned char *stk_pdu_from_response(const struct stk_response *response,
 						unsigned int *out_length)
 {
@@ -5417,37 +5462,27 @@ const unsigned char *stk_pdu_from_response(const struct stk_response *response,
 	case STK_COMMAND_TYPE_DISPLAY_TEXT:
 		break;
 	case STK_COMMAND_TYPE_GET_INKEY:
-		ok = build_dataobj(&builder,
-					build_dataobj_text, DATAOBJ_FLAG_CR,
-					&response->get_inkey.text,
-					build_dataobj_duration, 0,
-					&response->get_inkey.duration,
-					NULL);
+		ok = build_dataobj_table(&builder, response,
+					get_inkey_response_dataobjs);
 		break;
 	case STK_COMMAND_TYPE_GET_INPUT:
-		ok = build_dataobj(&builder,
-					build_dataobj_text, DATAOBJ_FLAG_CR,
-					&response->get_input.text,
-					NULL);
+		ok = build_dataobj_table(&builder, response,
+					get_input_response_dataobjs);
 		break;
 	case STK_COMMAND_TYPE_MORE_TIME:
 	case STK_COMMAND_TYPE_SEND_SMS:
 	case STK_COMMAND_TYPE_PLAY_TONE:
 		break;
 	case STK_COMMAND_TYPE_POLL_INTERVAL:
-		ok = build_dataobj(&builder,
-					build_dataobj_duration, DATAOBJ_FLAG_CR,
-					&response->poll_interval.max_interval,
-					NULL);
+		ok = build_dataobj_table(&builder, response,
+					poll_interval_response_dataobjs);
 		break;
 	case STK_COMMAND_TYPE_REFRESH:
 	case STK_COMMAND_TYPE_SETUP_MENU:
 		break;
 	case STK_COMMAND_TYPE_SELECT_ITEM:
-		ok = build_dataobj(&builder,
-					build_dataobj_item_id, DATAOBJ_FLAG_CR,
-					&response->select_item.item_id,
-					NULL);
+		ok = build_dataobj_table(&builder, response,
+					select_item_response_dataobjs);
 		break;
 	case STK_COMMAND_TYPE_SETUP_CALL:
 		ok = build_setup_call(&builder, response);
@@ -5460,34 +5495,22 @@ const unsigned char *stk_pdu_from_response(const struct stk_response *response,
 	case STK_COMMAND_TYPE_SETUP_EVENT_LIST:
 		break;
 	case STK_COMMAND_TYPE_TIMER_MANAGEMENT:
-		ok = build_dataobj(&builder,
-					build_dataobj_timer_id,
-					DATAOBJ_FLAG_CR,
-					&response->timer_mgmt.id,
-					build_dataobj_timer_value,
-					DATAOBJ_FLAG_CR,
-					&response->timer_mgmt.value,
-					NULL);
+		ok = build_dataobj_table(&builder, response,
+					timer_mgmt_response_dataobjs);
 		break;
 	case STK_COMMAND_TYPE_SETUP_IDLE_MODE_TEXT:
 		break;
 	case STK_COMMAND_TYPE_RUN_AT_COMMAND:
-		ok = build_dataobj(&builder,
-					build_dataobj_at_response,
-					DATAOBJ_FLAG_CR,
-					response->run_at_command.at_response,
-					NULL);
+		ok = build_dataobj_table(&builder, response,
+					run_at_command_response_dataobjs);
 		break;
 	case STK_COMMAND_TYPE_SEND_DTMF:
 	case STK_COMMAND_TYPE_LANGUAGE_NOTIFICATION:
 	case STK_COMMAND_TYPE_LAUNCH_BROWSER:
 		break;
 	case STK_COMMAND_TYPE_SEND_USSD:
-		ok = build_dataobj(&builder,
-					build_dataobj_ussd_text,
-					DATAOBJ_FLAG_CR,
-					&response->send_ussd.text,
-					NULL);
+		ok = build_dataobj_table(&builder, response,
+					send_ussd_response_dataobjs);
 		break;
 	default:
 		return NULL;
@@ -5515,6 +5538,22 @@ static gboolean build_envelope_dataobj_device_ids(struct stk_tlv_builder *tlv,
 		stk_tlv_builder_close_container(tlv);
 }
 
+static const struct dataobj_writer_desc call_control_envelope_dataobjs[] = {
+	{ build_dataobj_ccp, 0,
+		ENVELOPE_OFFSET(call_control.ccp1) },
+	{ build_dataobj_subaddress, 0,
+		ENVELOPE_OFFSET(call_control.subaddress) },
+	{ build_dataobj_location_info, 0,
+		ENVELOPE_OFFSET(call_control.location) },
+	{ build_dataobj_ccp, 0,
+		ENVELOPE_OFFSET(call_control.ccp2) },
+	{ build_dataobj_alpha_id, DATAOBJ_FLAG_INDIRECT,
+		ENVELOPE_OFFSET(call_control.alpha_id) },
+	{ build_dataobj_bc_repeat, 0,
+		ENVELOPE_OFFSET(call_control.bc_repeat) },
+	{ NULL }
+};
+
 static gboolean build_envelope_call_control(
 					struct stk_tlv_builder *builder,
 					const struct stk_envelope *envelope)
@@ -5555,42 +5594,103 @@ static gboolean build_envelope_call_control(
 	if (ok != TRUE)
 		return FALSE;
 
-	return build_dataobj(builder,
-				build_dataobj_ccp, 0, &cc->ccp1,
-				build_dataobj_subaddress, 0, &cc->subaddress,
-				build_dataobj_location_info, 0, &cc->location,
-				build_dataobj_ccp, 0, &cc->ccp2,
-				build_dataobj_alpha_id, 0, cc->alpha_id,
-				build_dataobj_bc_repeat, 0, &cc->bc_repeat,
-				NULL);
+	return build_dataobj_table(builder, envelope,
+				call_control_envelope_dataobjs);
 }
 
+static const struct dataobj_writer_desc event_download_envelope_dataobjs[] = {
+	{ build_dataobj_event_type, DATAOBJ_FLAG_CR,
+		EVENT_OFFSET(type) },
+	{ build_envelope_dataobj_device_ids, DATAOBJ_FLAG_CR, 0 },
+	{ NULL }
+};
+
+static const struct dataobj_writer_desc mt_call_event_dataobjs[] = {
+	{ build_dataobj_transaction_id, DATAOBJ_FLAG_CR,
+		EVENT_OFFSET(mt_call.transaction_id) },
+	{ build_dataobj_address, 0,
+		EVENT_OFFSET(mt_call.caller_address) },
+	{ build_dataobj_subaddress, 0,
+		EVENT_OFFSET(mt_call.caller_subaddress) },
+	{ NULL }
+};
+
+static const struct dataobj_writer_desc call_disconnected_event_dataobjs[] = {
+	{ build_dataobj_transaction_ids, DATAOBJ_FLAG_CR,
+		EVENT_OFFSET(call_disconnected.transaction_ids) },
+	{ build_dataobj_cause, 0,
+		EVENT_OFFSET(call_disconnected.cause) },
+	{ NULL }
+};
+
+static const struct dataobj_writer_desc location_status_event_dataobjs[] = {
+	{ build_dataobj_location_status, DATAOBJ_FLAG_CR,
+		EVENT_OFFSET(location_status.state) },
+	{ build_dataobj_location_info, 0,
+		EVENT_OFFSET(location_status.info) },
+	{ NULL }
+};
+
+static const struct dataobj_writer_desc data_available_event_dataobjs[] = {
+	{ build_dataobj_channel_status, DATAOBJ_FLAG_CR,
+		EVENT_OFFSET(data_available.channel_status) },
+	{ build_dataobj_channel_data_length, DATAOBJ_FLAG_CR,
+		EVENT_OFFSET(data_available.channel_data_len) },
+	{ NULL }
+};
+
+static const struct dataobj_writer_desc channel_status_event_dataobjs[] = {
+	{ build_dataobj_channel_status, DATAOBJ_FLAG_CR,
+		EVENT_OFFSET(channel_status.status) },
+	{ build_dataobj_bearer_description, DATAOBJ_FLAG_CR,
+		EVENT_OFFSET(channel_status.bearer_desc) },
+	{ build_dataobj_other_address, DATAOBJ_FLAG_CR,
+		EVENT_OFFSET(channel_status.address) },
+	{ NULL }
+};
+
+static const struct dataobj_writer_desc local_connection_event_dataobjs[] = {
+	{ build_dataobj_service_record, DATAOBJ_FLAG_CR,
+		EVENT_OFFSET(local_connection.service_record) },
+	{ build_dataobj_remote_entity_address, 0,
+		EVENT_OFFSET(local_connection.remote_addr) },
+	{ build_dataobj_uicc_te_interface, 0,
+		EVENT_OFFSET(local_connection.transport_level) },
+	{ build_dataobj_other_address, 0,
+		EVENT_OFFSET(local_connection.transport_addr) },
+	{ NULL }
+};
+
+static const struct dataobj_writer_desc network_rejection_event_dataobjs[] = {
+	{ build_dataobj_location_info, 0,
+		EVENT_OFFSET(network_rejection.location) },
+	{ build_dataobj_routing_area_id, 0,
+		EVENT_OFFSET(network_rejection.rai) },
+	{ build_dataobj_tracking_area_id, 0,
+		EVENT_OFFSET(network_rejection.tai) },
+	{ build_dataobj_access_technology, DATAOBJ_FLAG_CR,
+		EVENT_OFFSET(network_rejection.access_tech) },
+	{ build_dataobj_update_attach_type, DATAOBJ_FLAG_CR,
+		EVENT_OFFSET(network_rejection.update_attach) },
+	{ build_dataobj_rejection_cause_code, DATAOBJ_FLAG_CR,
+		EVENT_OFFSET(network_rejection.cause) },
+	{ NULL }
+};
+
 static gboolean build_envelope_event_download(struct stk_tlv_builder *builder,
 					const struct stk_envelope *envelope)
 {
 	const struct stk_envelope_event_download *evt =
 		&envelope->event_download;
 
-	if (build_dataobj(builder,
-				build_dataobj_event_type, DATAOBJ_FLAG_CR,
-				&evt->type,
-				build_envelope_dataobj_device_ids,
-				DATAOBJ_FLAG_CR,
-				envelope,
-				NULL) == FALSE)
+	if (build_dataobj_table(builder, envelope,
+				event_download_envelope_dataobjs) == FALSE)
 		return FALSE;
 
 	switch (evt->type) {
 	case STK_EVENT_TYPE_MT_CALL:
-		return build_dataobj(builder,
-					build_dataobj_transaction_id,
-					DATAOBJ_FLAG_CR,
-					&evt->mt_call.transaction_id,
-					build_dataobj_address, 0,
-					&evt->mt_call.caller_address,
-					build_dataobj_subaddress, 0,
-					&evt->mt_call.caller_subaddress,
-					NULL);
+		return build_dataobj_table(builder, envelope,
+					mt_call_event_dataobjs);
 	case STK_EVENT_TYPE_CALL_CONNECTED:
 		return build_dataobj(builder,
 					build_dataobj_transaction_id,
@@ -5598,21 +5698,11 @@ static gboolean build_envelope_event_download(struct stk_tlv_builder *builder,
 					&evt->call_connected.transaction_id,
 					NULL);
 	case STK_EVENT_TYPE_CALL_DISCONNECTED:
-		return build_dataobj(builder,
-					build_dataobj_transaction_ids,
-					DATAOBJ_FLAG_CR,
-					&evt->call_disconnected.transaction_ids,
-					build_dataobj_cause, 0,
-					&evt->call_disconnected.cause,
-					NULL);
+		return build_dataobj_table(builder, envelope,
+					call_disconnected_event_dataobjs);
 	case STK_EVENT_TYPE_LOCATION_STATUS:
-		return build_dataobj(builder,
-					build_dataobj_location_status,
-					DATAOBJ_FLAG_CR,
-					&evt->location_status.state,
-					build_dataobj_location_info, 0,
-					&evt->location_status.info,
-					NULL);
+		return build_dataobj_table(builder, envelope,
+					location_status_event_dataobjs);
 	case STK_EVENT_TYPE_USER_ACTIVITY:
 	case STK_EVENT_TYPE_IDLE_SCREEN_AVAILABLE:
 		return TRUE;
@@ -5634,26 +5724,11 @@ static gboolean build_envelope_event_download(struct stk_tlv_builder *builder,
 					&evt->browser_termination.cause,
 					NULL);
 	case STK_EVENT_TYPE_DATA_AVAILABLE:
-		return build_dataobj(builder,
-					build_dataobj_channel_status,
-					DATAOBJ_FLAG_CR,
-					&evt->data_available.channel_status,
-					build_dataobj_channel_data_length,
-					DATAOBJ_FLAG_CR,
-					&evt->data_available.channel_data_len,
-					NULL);
+		return build_dataobj_table(builder, envelope,
+					data_available_event_dataobjs);
 	case STK_EVENT_TYPE_CHANNEL_STATUS:
-		return build_dataobj(builder,
-					build_dataobj_channel_status,
-					DATAOBJ_FLAG_CR,
-					&evt->channel_status.status,
-					build_dataobj_bearer_description,
-					DATAOBJ_FLAG_CR,
-					&evt->channel_status.bearer_desc,
-					build_dataobj_other_address,
-					DATAOBJ_FLAG_CR,
-					&evt->channel_status.address,
-					NULL);
+		return build_dataobj_table(builder, envelope,
+					channel_status_event_dataobjs);
 	case STK_EVENT_TYPE_SINGLE_ACCESS_TECHNOLOGY_CHANGE:
 		return build_dataobj(builder,
 					build_dataobj_access_technology,
@@ -5667,18 +5742,8 @@ static gboolean build_envelope_event_download(struct stk_tlv_builder *builder,
 					&evt->display_params_changed,
 					NULL);
 	case STK_EVENT_TYPE_LOCAL_CONNECTION:
-		return build_dataobj(builder,
-					build_dataobj_service_record,
-					DATAOBJ_FLAG_CR,
-					&evt->local_connection.service_record,
-					build_dataobj_remote_entity_address, 0,
-					&evt->local_connection.remote_addr,
-					build_dataobj_uicc_te_interface, 0,
-					&evt->local_connection.transport_level,
-					build_dataobj_other_address,
-					0,
-					&evt->local_connection.transport_addr,
-					NULL);
+		return build_dataobj_table(builder, envelope,
+					local_connection_event_dataobjs);
 	case STK_EVENT_TYPE_NETWORK_SEARCH_MODE_CHANGE:
 		return build_dataobj(builder,
 					build_dataobj_network_search_mode,
@@ -5704,23 +5769,8 @@ static gboolean build_envelope_event_download(struct stk_tlv_builder *builder,
 					&evt->i_wlan_access_status,
 					NULL);
 	case STK_EVENT_TYPE_NETWORK_REJECTION:
-		return build_dataobj(builder,
-					build_dataobj_location_info, 0,
-					&evt->network_rejection.location,
-					build_dataobj_routing_area_id, 0,
-					&evt->network_rejection.rai,
-					build_dataobj_tracking_area_id, 0,
-					&evt->network_rejection.tai,
-					build_dataobj_access_technology,
-					DATAOBJ_FLAG_CR,
-					&evt->network_rejection.access_tech,
-					build_dataobj_update_attach_type,
-					DATAOBJ_FLAG_CR,
-					&evt->network_rejection.update_attach,
-					build_dataobj_rejection_cause_code,
-					DATAOBJ_FLAG_CR,
-					&evt->network_rejection.cause,
-					NULL);
+		return build_dataobj_table(builder, envelope,
+					network_rejection_event_dataobjs);
 	case STK_EVENT_TYPE_HCI_CONNECTIVITY_EVENT:
 		return TRUE;
 	default:
@@ -5750,6 +5800,78 @@ static gboolean build_envelope_terminal_apps(struct stk_tlv_builder *builder,
 				0, &ta->last, NULL);
 }
 
+static const struct dataobj_writer_desc sms_pp_download_envelope_dataobjs[] = {
+	{ build_envelope_dataobj_device_ids, DATAOBJ_FLAG_CR, 0 },
+	{ build_dataobj_address, 0,
+		ENVELOPE_OFFSET(sms_pp_download.address) },
+	{ build_dataobj_gsm_sms_tpdu, DATAOBJ_FLAG_CR,
+		ENVELOPE_OFFSET(sms_pp_download.message) },
+	{ NULL }
+};
+
+static const struct dataobj_writer_desc cbs_pp_download_envelope_dataobjs[] = {
+	{ build_envelope_dataobj_device_ids, DATAOBJ_FLAG_CR, 0 },
+	{ build_dataobj_cbs_page, DATAOBJ_FLAG_CR,
+		ENVELOPE_OFFSET(cbs_pp_download.page) },
+	{ NULL }
+};
+
+static const struct dataobj_writer_desc menu_selection_envelope_dataobjs[] = {
+	{ build_envelope_dataobj_device_ids, DATAOBJ_FLAG_CR, 0 },
+	{ build_dataobj_item_id, DATAOBJ_FLAG_CR,
+		ENVELOPE_OFFSET(menu_selection.item_id) },
+	{ build_dataobj_help_request, 0,
+		ENVELOPE_OFFSET(menu_selection.help_request) },
+	{ NULL }
+};
+
+static const struct dataobj_writer_desc sms_mo_control_envelope_dataobjs[] = {
+	{ build_envelope_dataobj_device_ids, 0, 0 },
+	{ build_dataobj_address, 0,
+		ENVELOPE_OFFSET(sms_mo_control.sc_address) },
+	{ build_dataobj_address, 0,
+		ENVELOPE_OFFSET(sms_mo_control.dest_address) },
+	{ build_dataobj_location_info, 0,
+		ENVELOPE_OFFSET(sms_mo_control.location) },
+	{ NULL }
+};
+
+static const struct dataobj_writer_desc timer_expiration_envelope_dataobjs[] = {
+	{ build_envelope_dataobj_device_ids, DATAOBJ_FLAG_CR, 0 },
+	{ build_dataobj_timer_id, DATAOBJ_FLAG_CR,
+		ENVELOPE_OFFSET(timer_expiration.id) },
+	{ build_dataobj_timer_value, DATAOBJ_FLAG_CR,
+		ENVELOPE_OFFSET(timer_expiration.value) },
+	{ NULL }
+};
+
+static const struct dataobj_writer_desc ussd_download_envelope_dataobjs[] = {
+	{ build_envelope_dataobj_device_ids, DATAOBJ_FLAG_CR, 0 },
+	{ build_dataobj_ussd_string, DATAOBJ_FLAG_CR,
+		ENVELOPE_OFFSET(ussd_data_download.string) },
+	{ NULL }
+};
+
+static const struct dataobj_writer_desc mms_status_envelope_dataobjs[] = {
+	{ build_envelope_dataobj_device_ids, DATAOBJ_FLAG_CR, 0 },
+	{ build_dataobj_file, DATAOBJ_FLAG_CR,
+		ENVELOPE_OFFSET(mms_status.transfer_file) },
+	{ build_dataobj_mms_id, 0,
+		ENVELOPE_OFFSET(mms_status.id) },
+	{ build_dataobj_mms_transfer_status, 0,
+		ENVELOPE_OFFSET(mms_status.transfer_status) },
+	{ NULL }
+};
+
+static const struct dataobj_writer_desc mms_notification_envelope_dataobjs[] = {
+	{ build_envelope_dataobj_device_ids, DATAOBJ_FLAG_CR, 0 },
+	{ build_dataobj_mms_notification, DATAOBJ_FLAG_CR,
+		ENVELOPE_OFFSET(mms_notification.msg) },
+	{ build_dataobj_last_envelope, 0,
+		ENVELOPE_OFFSET(mms_notification.last) },
+	{ NULL }
+};
+
 const unsigned char *stk_pdu_from_envelope(const struct stk_envelope *envelope,
 						unsigned int *out_length)
 {
@@ -5767,37 +5889,16 @@ const unsigned char *stk_pdu_from_envelope(const struct stk_envelope *envelope,
 
 	switch (envelope->type) {
 	case STK_ENVELOPE_TYPE_SMS_PP_DOWNLOAD:
-		ok = build_dataobj(&builder,
-					build_envelope_dataobj_device_ids,
-					DATAOBJ_FLAG_CR,
-					envelope,
-					build_dataobj_address, 0,
-					&envelope->sms_pp_download.address,
-					build_dataobj_gsm_sms_tpdu,
-					DATAOBJ_FLAG_CR,
-					&envelope->sms_pp_download.message,
-					NULL);
+		ok = build_dataobj_table(&builder, envelope,
+					sms_pp_download_envelope_dataobjs);
 		break;
 	case STK_ENVELOPE_TYPE_CBS_PP_DOWNLOAD:
-		ok = build_dataobj(&builder,
-					build_envelope_dataobj_device_ids,
-					DATAOBJ_FLAG_CR,
-					envelope,
-					build_dataobj_cbs_page,
-					DATAOBJ_FLAG_CR,
-					&envelope->cbs_pp_download.page,
-					NULL);
+		ok = build_dataobj_table(&builder, envelope,
+					cbs_pp_download_envelope_dataobjs);
 		break;
 	case STK_ENVELOPE_TYPE_MENU_SELECTION:
-		ok = build_dataobj(&builder,
-					build_envelope_dataobj_device_ids,
-					DATAOBJ_FLAG_CR,
-					envelope,
-					build_dataobj_item_id, DATAOBJ_FLAG_CR,
-					&envelope->menu_selection.item_id,
-					build_dataobj_help_request, 0,
-					&envelope->menu_selection.help_request,
-					NULL);
+		ok = build_dataobj_table(&builder, envelope,
+					menu_selection_envelope_dataobjs);
 		break;
 	case STK_ENVELOPE_TYPE_CALL_CONTROL:
 		ok = build_envelope_call_control(&builder, envelope);
@@ -5807,67 +5908,27 @@ const unsigned char *stk_pdu_from_envelope(const struct stk_envelope *envelope,
 		 * Comprehension Required according to the specs but not
 		 * enabled in conformance tests in 3GPP 31.124.
 		 */
-		ok = build_dataobj(&builder,
-					build_envelope_dataobj_device_ids, 0,
-					envelope,
-					build_dataobj_address, 0,
-					&envelope->sms_mo_control.sc_address,
-					build_dataobj_address, 0,
-					&envelope->sms_mo_control.dest_address,
-					build_dataobj_location_info, 0,
-					&envelope->sms_mo_control.location,
-					NULL);
+		ok = build_dataobj_table(&builder, envelope,
+					sms_mo_control_envelope_dataobjs);
 		break;
 	case STK_ENVELOPE_TYPE_EVENT_DOWNLOAD:
 		ok = build_envelope_event_download(&builder, envelope);
 		break;
 	case STK_ENVELOPE_TYPE_TIMER_EXPIRATION:
-		ok = build_dataobj(&builder,
-					build_envelope_dataobj_device_ids,
-					DATAOBJ_FLAG_CR,
-					envelope,
-					build_dataobj_timer_id,
-					DATAOBJ_FLAG_CR,
-					&envelope->timer_expiration.id,
-					build_dataobj_timer_value,
-					DATAOBJ_FLAG_CR,
-					&envelope->timer_expiration.value,
-					NULL);
+		ok = build_dataobj_table(&builder, envelope,
+					timer_expiration_envelope_dataobjs);
 		break;
 	case STK_ENVELOPE_TYPE_USSD_DOWNLOAD:
-		ok = build_dataobj(&builder,
-					build_envelope_dataobj_device_ids,
-					DATAOBJ_FLAG_CR,
-					envelope,
-					build_dataobj_ussd_string,
-					DATAOBJ_FLAG_CR,
-					&envelope->ussd_data_download.string,
-					NULL);
+		ok = build_dataobj_table(&builder, envelope,
+					ussd_download_envelope_dataobjs);
 		break;
 	case STK_ENVELOPE_TYPE_MMS_TRANSFER_STATUS:
-		ok = build_dataobj(&builder,
-					build_envelope_dataobj_device_ids,
-					DATAOBJ_FLAG_CR,
-					envelope,
-					build_dataobj_file, DATAOBJ_FLAG_CR,
-					&envelope->mms_status.transfer_file,
-					build_dataobj_mms_id, 0,
-					&envelope->mms_status.id,
-					build_dataobj_mms_transfer_status, 0,
-					&envelope->mms_status.transfer_status,
-					NULL);
+		ok = build_dataobj_table(&builder, envelope,
+					mms_status_envelope_dataobjs);
 		break;
 	case STK_ENVELOPE_TYPE_MMS_NOTIFICATION:
-		ok = build_dataobj(&builder,
-					build_envelope_dataobj_device_ids,
-					DATAOBJ_FLAG_CR,
-					envelope,
-					build_dataobj_mms_notification,
-					DATAOBJ_FLAG_CR,
-					&envelope->mms_notification.msg,
-					build_dataobj_last_envelope, 0,
-					&envelope->mms_notification.last,
-					NULL);
+		ok = build_dataobj_table(&builder, envelope,
+					mms_notification_envelope_dataobjs);
 		break;
 	case STK_ENVELOPE_TYPE_TERMINAL_APP:
 		ok = build_envelope_terminal_apps(&builder, envelope);
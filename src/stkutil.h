@@ -1358,7 +1358,7 @@ struct stk_command {
 		struct stk_command_activate activate;
 	};
 
-	void (*destructor)(struct stk_command *command);
+	struct stk_arena *arena;
 };
 
 /* TERMINAL RESPONSEs defined in TS 102.223 Section 6.8 */
@@ -35,6 +35,20 @@
 
 #include "storage.h"
 
+/* How long changes to a settings file are collected before it is written */
+#define STORAGE_SYNC_DELAY 500
+
+struct storage_file {
+	char *path;
+	GKeyFile *keyfile;
+	char *data; /* contents of the file as last read or written */
+	guint sync_source;
+	gboolean dirty; /* synced changes that did not reach the file yet */
+};
+
+/* Settings files opened with storage_open, keyed by their GKeyFile */
+static GHashTable *storage_files;
+
 int create_dirs(const char *filename, const mode_t mode)
 {
 	struct stat st;
@@ -123,10 +137,18 @@ ssize_t write_file(const unsigned char *buffer, size_t len, mode_t mode,
 	tmp_path = g_strdup_printf("%s.XXXXXX.tmp", path);
 
 	r = -1;
-	if (create_dirs(path, mode | S_IXUSR) != 0)
-		goto error_create_dirs;
 
+	/* Most of the time the directories exist already */
 	fd = TFR(g_mkstemp_full(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, mode));
+	if (fd == -1 && errno == ENOENT) {
+		if (create_dirs(path, mode | S_IXUSR) != 0)
+			goto error_create_dirs;
+
+		memcpy(tmp_path + strlen(path), ".XXXXXX", 7);
+		fd = TFR(g_mkstemp_full(tmp_path, O_WRONLY | O_CREAT | O_TRUNC,
+						mode));
+	}
+
 	if (fd == -1)
 		goto error_mkstemp_full;
 
@@ -142,16 +164,17 @@ ssize_t write_file(const unsigned char *buffer, size_t len, mode_t mode,
 	/*
 	 * Now that the file contents are written, rename to the real
 	 * file name; this way we are uniquely sure that the whole
-	 * thing is there.
+	 * thing is there, and the old contents stay until it is.
 	 */
-	unlink(path);
+	if (rename(tmp_path, path) == 0)
+		goto done;
 
-	/* conserve @r's value from 'write' */
-	if (link(tmp_path, path) == -1)
-		r = -1;
+	/* The contents were written, but never made it to @path */
+	r = -1;
 
 error_write:
 	unlink(tmp_path);
+done:
 error_mkstemp_full:
 error_create_dirs:
 	g_free(tmp_path);
@@ -159,51 +182,125 @@ error_create_dirs:
 	return r;
 }
 
+static char *storage_path(const char *imsi, const char *store)
+{
+	if (imsi)
+		return g_strdup_printf(STORAGEDIR "/%s/%s", imsi, store);
+
+	return g_strdup_printf(STORAGEDIR "/%s", store);
+}
+
+static gboolean storage_write(const char *path, const char *data,
+				gsize length)
+{
+	if (g_file_set_contents(path, data, length, NULL) == TRUE)
+		return TRUE;
+
+	if (create_dirs(path, S_IRUSR | S_IWUSR | S_IXUSR) != 0)
+		return FALSE;
+
+	return g_file_set_contents(path, data, length, NULL);
+}
+
+/*
+ * Writes the file out unless it would not change.  The whole file is
+ * replaced atomically, so a crash leaves either the old or the new
+ * settings behind.
+ */
+static void storage_file_flush(struct storage_file *file)
+{
+	char *data;
+	gsize length = 0;
+
+	if (file->sync_source) {
+		g_source_remove(file->sync_source);
+		file->sync_source = 0;
+	}
+
+	data = g_key_file_to_data(file->keyfile, &length, NULL);
+
+	if (g_strcmp0(data, file->data) == 0) {
+		file->dirty = FALSE;
+		g_free(data);
+		return;
+	}
+
+	/* Stays dirty, storage_close tries once more */
+	if (storage_write(file->path, data, length) == FALSE) {
+		g_free(data);
+		return;
+	}
+
+	file->dirty = FALSE;
+	g_free(file->data);
+	file->data = data;
+}
+
+static gboolean storage_file_sync(gpointer user_data)
+{
+	struct storage_file *file = user_data;
+
+	file->sync_source = 0;
+	storage_file_flush(file);
+
+	return FALSE;
+}
+
 GKeyFile *storage_open(const char *imsi, const char *store)
 {
-	GKeyFile *keyfile;
-	char *path;
+	struct storage_file *file;
+	gsize length;
 
 	if (store == NULL)
 		return NULL;
 
-	if (imsi)
-		path = g_strdup_printf(STORAGEDIR "/%s/%s", imsi, store);
-	else
-		path = g_strdup_printf(STORAGEDIR "/%s", store);
+	file = g_new0(struct storage_file, 1);
+	file->path = storage_path(imsi, store);
+	file->keyfile = g_key_file_new();
 
-	keyfile = g_key_file_new();
+	if (g_file_get_contents(file->path, &file->data, &length, NULL))
+		g_key_file_load_from_data(file->keyfile, file->data, length,
+						0, NULL);
 
-	if (path) {
-		g_key_file_load_from_file(keyfile, path, 0, NULL);
-		g_free(path);
-	}
+	if (storage_files == NULL)
+		storage_files = g_hash_table_new(g_direct_hash,
+							g_direct_equal);
+
+	g_hash_table_insert(storage_files, file->keyfile, file);
 
-	return keyfile;
+	return file->keyfile;
 }
 
+/*
+ * Changes made through storage_sync are written behind, so that a burst
+ * of property changes costs a single write of the file.  They are
+ * flushed at the latest by storage_close.
+ */
 void storage_sync(const char *imsi, const char *store, GKeyFile *keyfile)
 {
+	struct storage_file *file = NULL;
 	char *path;
 	char *data;
 	gsize length = 0;
 
-	if (imsi)
-		path = g_strdup_printf(STORAGEDIR "/%s/%s", imsi, store);
-	else
-		path = g_strdup_printf(STORAGEDIR "/%s", store);
+	if (storage_files)
+		file = g_hash_table_lookup(storage_files, keyfile);
 
-	if (path == NULL)
-		return;
+	if (file) {
+		file->dirty = TRUE;
 
-	if (create_dirs(path, S_IRUSR | S_IWUSR | S_IXUSR) != 0) {
-		g_free(path);
+		if (file->sync_source == 0)
+			file->sync_source = g_timeout_add(STORAGE_SYNC_DELAY,
+							storage_file_sync,
+							file);
 		return;
 	}
 
+	path = storage_path(imsi, store);
+
 	data = g_key_file_to_data(keyfile, &length, NULL);
 
-	g_file_set_contents(path, data, length, NULL);
+	storage_write(path, data, length);
 
 	g_free(data);
 	g_free(path);
@@ -212,8 +309,27 @@ void storage_sync(const char *imsi, const char *store, GKeyFile *keyfile)
 void storage_close(const char *imsi, const char *store, GKeyFile *keyfile,
 			gboolean save)
 {
-	if (save == TRUE)
-		storage_sync(imsi, store, keyfile);
+	struct storage_file *file = NULL;
+
+	if (storage_files)
+		file = g_hash_table_lookup(storage_files, keyfile);
+
+	if (file == NULL) {
+		if (save == TRUE)
+			storage_sync(imsi, store, keyfile);
+
+		g_key_file_free(keyfile);
+		return;
+	}
+
+	/* Changes already handed to storage_sync are never dropped */
+	if (save == TRUE || file->dirty)
+		storage_file_flush(file);
+
+	g_hash_table_remove(storage_files, keyfile);
 
 	g_key_file_free(keyfile);
+	g_free(file->data);
+	g_free(file->path);
+	g_free(file);
 }
@@ -0,0 +1,238 @@
+/*
+ *
+ *  oFono - Open Source Telephony
+ *
+ *  Copyright (C) 2008-2010  Intel Corporation. All rights reserved.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <glib.h>
+
+#include "strength.h"
+
+#define STRENGTH_MAX_SAMPLES 16
+
+struct strength_filter {
+	unsigned int min_delta;
+	unsigned int min_interval;	/* In milliseconds */
+	unsigned int average;
+	int samples[STRENGTH_MAX_SAMPLES];
+	unsigned int nsamples;
+	unsigned int next;
+	int last;			/* Last value reported */
+	int pending;			/* Held back by the interval */
+	guint source;
+	GTimer *timer;
+	unsigned int reported;
+	unsigned int suppressed;
+	strength_report_func_t func;
+	void *user_data;
+};
+
+struct strength_filter *strength_filter_new(strength_report_func_t func,
+						void *user_data)
+{
+	struct strength_filter *filter;
+
+	filter = g_try_new0(struct strength_filter, 1);
+	if (filter == NULL)
+		return NULL;
+
+	filter->average = 1;
+	filter->last = -1;
+	filter->pending = -1;
+	filter->timer = g_timer_new();
+	filter->func = func;
+	filter->user_data = user_data;
+
+	return filter;
+}
+
+void strength_filter_free(struct strength_filter *filter)
+{
+	if (filter == NULL)
+		return;
+
+	strength_filter_reset(filter);
+
+	g_timer_destroy(filter->timer);
+	g_free(filter);
+}
+
+void strength_filter_set_policy(struct strength_filter *filter,
+				unsigned int min_delta,
+				unsigned int min_interval,
+				unsigned int average)
+{
+	if (average == 0)
+		average = 1;
+
+	if (average > STRENGTH_MAX_SAMPLES)
+		average = STRENGTH_MAX_SAMPLES;
+
+	filter->min_delta = min_delta;
+	filter->min_interval = min_interval;
+	filter->average = average;
+
+	/* The samples taken so far may not fit the new window */
+	filter->nsamples = 0;
+	filter->next = 0;
+}
+
+void strength_filter_reset(struct strength_filter *filter)
+{
+	if (filter->source) {
+		g_source_remove(filter->source);
+		filter->source = 0;
+	}
+
+	filter->nsamples = 0;
+	filter->next = 0;
+	filter->last = -1;
+	filter->pending = -1;
+}
+
+static int filter_add(struct strength_filter *filter, int strength)
+{
+	unsigned int i;
+	int sum = 0;
+
+	filter->samples[filter->next] = strength;
+	filter->next = (filter->next + 1) % filter->average;
+
+	if (filter->nsamples < filter->average)
+		filter->nsamples += 1;
+
+	for (i = 0; i < filter->nsamples; i++)
+		sum += filter->samples[i];
+
+	return (sum + filter->nsamples / 2) / filter->nsamples;
+}
+
+static gboolean filter_accept(struct strength_filter *filter, int strength)
+{
+	int delta;
+
+	if (filter->last == -1)
+		return TRUE;
+
+	if (strength == filter->last)
+		return FALSE;
+
+	/* Always let the extremes through, clients care about those */
+	if (strength == 0 || strength == 100)
+		return TRUE;
+
+	delta = strength - filter->last;
+
+	return (unsigned int) ABS(delta) >= filter->min_delta;
+}
+
+static void filter_report(struct strength_filter *filter, int strength)
+{
+	filter->last = strength;
+	filter->pending = -1;
+	filter->reported += 1;
+	g_timer_start(filter->timer);
+
+	filter->func(strength, filter->user_data);
+}
+
+static gboolean interval_expired(gpointer user_data)
+{
+	struct strength_filter *filter = user_data;
+	int strength = filter->pending;
+
+	filter->source = 0;
+	filter->pending = -1;
+
+	if (strength == -1)
+		return FALSE;
+
+	if (filter_accept(filter, strength) == FALSE) {
+		filter->suppressed += 1;
+		return FALSE;
+	}
+
+	filter_report(filter, strength);
+
+	return FALSE;
+}
+
+void strength_filter_update(struct strength_filter *filter, int strength)
+{
+	unsigned int elapsed;
+
+	if (strength == -1) {
+		strength_filter_reset(filter);
+		return;
+	}
+
+	strength = filter_add(filter, strength);
+
+	if (filter_accept(filter, strength) == FALSE) {
+		filter->suppressed += 1;
+
+		/* Anything still held back is stale by now */
+		if (filter->pending != -1) {
+			filter->pending = -1;
+			filter->suppressed += 1;
+		}
+
+		return;
+	}
+
+	elapsed = g_timer_elapsed(filter->timer, NULL) * 1000;
+
+	if (filter->last == -1 || elapsed >= filter->min_interval) {
+		if (filter->source) {
+			g_source_remove(filter->source);
+			filter->source = 0;
+		}
+
+		filter_report(filter, strength);
+		return;
+	}
+
+	/*
+	 * Too soon after the last report, hold on to the value and report
+	 * it once the interval expires, unless something newer comes in.
+	 */
+	if (filter->pending != -1)
+		filter->suppressed += 1;
+
+	filter->pending = strength;
+
+	if (filter->source)
+		return;
+
+	filter->source = g_timeout_add(filter->min_interval - elapsed,
+					interval_expired, filter);
+}
+
+unsigned int strength_filter_get_reported(struct strength_filter *filter)
+{
+	return filter->reported;
+}
+
+unsigned int strength_filter_get_suppressed(struct strength_filter *filter)
+{
+	return filter->suppressed;
+}
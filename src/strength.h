@@ -0,0 +1,49 @@
+/*
+ *
+ *  oFono - Open Source Telephony
+ *
+ *  Copyright (C) 2008-2010  Intel Corporation. All rights reserved.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+struct strength_filter;
+
+typedef void (*strength_report_func_t)(int strength, void *user_data);
+
+/*
+ * Decides which signal strength updates are worth reporting.  By default
+ * every change is reported at once, as before the filter existed.  With
+ * a policy set, values are averaged over the last average samples,
+ * changes smaller than min_delta are dropped and reports are spaced at
+ * least min_interval milliseconds apart.  A value arriving too early is
+ * held back and reported when the interval expires, unless a newer one
+ * replaces it first.  0 and 100 always pass the delta check.
+ */
+struct strength_filter *strength_filter_new(strength_report_func_t func,
+						void *user_data);
+void strength_filter_free(struct strength_filter *filter);
+
+void strength_filter_set_policy(struct strength_filter *filter,
+				unsigned int min_delta,
+				unsigned int min_interval,
+				unsigned int average);
+
+/* -1 means the strength is unknown, which resets the filter */
+void strength_filter_update(struct strength_filter *filter, int strength);
+void strength_filter_reset(struct strength_filter *filter);
+
+unsigned int strength_filter_get_reported(struct strength_filter *filter);
+unsigned int strength_filter_get_suppressed(struct strength_filter *filter);
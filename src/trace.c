@@ -0,0 +1,220 @@
+/*
+ *
+ *  oFono - Open Source Telephony
+ *
+ *  Copyright (C) 2008-2010  Intel Corporation. All rights reserved.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#include <glib.h>
+
+#include "ofono.h"
+
+#include "storage.h"
+
+/* Number of events kept, must be a power of two */
+#define TRACE_RING_SIZE 4096
+
+#define TRACE_TAG_LEN 14
+
+/*
+ * Records are only ever written from the main loop, so there is a single
+ * writer and no locking.  Each one is 32 bytes, the whole ring 128 KiB.
+ */
+struct trace_record {
+	guint64 usec;
+	guint32 id;
+	guint32 value;
+	guint16 event;
+	char tag[TRACE_TAG_LEN];
+};
+
+struct trace_dump {
+	ofono_trace_dump_func func;
+	void *user_data;
+};
+
+static struct trace_record *ring;
+static unsigned int ring_next;
+static GTimer *trace_clock;
+static GSList *dump_list;
+static unsigned int dump_count;
+
+static const char *event_names[] = {
+	[OFONO_TRACE_AT_COMMAND] = "at-command",
+	[OFONO_TRACE_AT_RESPONSE] = "at-response",
+	[OFONO_TRACE_AT_NOTIFY] = "at-notify",
+	[OFONO_TRACE_ATOM_REGISTER] = "atom-register",
+	[OFONO_TRACE_ATOM_UNREGISTER] = "atom-unregister",
+	[OFONO_TRACE_MODEM_MILESTONE] = "modem-milestone",
+};
+
+void ofono_trace(enum ofono_trace_event event, unsigned int id,
+			unsigned int value, const char *tag)
+{
+	struct trace_record *record;
+
+	if (ring == NULL)
+		return;
+
+	record = &ring[ring_next & (TRACE_RING_SIZE - 1)];
+	ring_next += 1;
+
+	record->usec = g_timer_elapsed(trace_clock, NULL) * 1000000;
+	record->id = id;
+	record->value = value;
+	record->event = event;
+
+	if (tag)
+		strncpy(record->tag, tag, TRACE_TAG_LEN);
+	else
+		record->tag[0] = '\0';
+}
+
+void ofono_trace_dump_register(ofono_trace_dump_func func, void *user_data)
+{
+	struct trace_dump *dump;
+
+	if (func == NULL)
+		return;
+
+	dump = g_new0(struct trace_dump, 1);
+	dump->func = func;
+	dump->user_data = user_data;
+
+	dump_list = g_slist_append(dump_list, dump);
+}
+
+void ofono_trace_dump_unregister(ofono_trace_dump_func func)
+{
+	GSList *l;
+
+	for (l = dump_list; l; l = l->next) {
+		struct trace_dump *dump = l->data;
+
+		if (dump->func != func)
+			continue;
+
+		dump_list = g_slist_remove(dump_list, dump);
+		g_free(dump);
+		return;
+	}
+}
+
+static void trace_dump_record(FILE *out, const struct trace_record *record)
+{
+	const char *name = NULL;
+
+	if (record->event < G_N_ELEMENTS(event_names))
+		name = event_names[record->event];
+
+	fprintf(out, "%llu.%06llu %s %u %u %.*s\n",
+			(unsigned long long) record->usec / 1000000,
+			(unsigned long long) record->usec % 1000000,
+			name ? name : "unknown", record->id, record->value,
+			TRACE_TAG_LEN, record->tag);
+}
+
+void __ofono_trace_dump(void)
+{
+	char *path;
+	FILE *out;
+	int fd;
+	unsigned int i;
+	unsigned int first;
+	GSList *l;
+
+	if (ring == NULL)
+		return;
+
+	/*
+	 * We run as root, so never follow or reuse an existing file.  The
+	 * storage directory is only writable by us, unlike the tmp dir.
+	 */
+	path = g_strdup_printf(STORAGEDIR "/trace-%d.%u", (int) getpid(),
+				dump_count++);
+
+	if (create_dirs(path, S_IRUSR | S_IWUSR | S_IXUSR) < 0)
+		goto error;
+
+	fd = TFR(open(path, O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW |
+				O_CLOEXEC, S_IRUSR | S_IWUSR));
+	if (fd < 0)
+		goto error;
+
+	out = fdopen(fd, "w");
+	if (out == NULL) {
+		close(fd);
+		goto error;
+	}
+
+	first = ring_next > TRACE_RING_SIZE ? ring_next - TRACE_RING_SIZE : 0;
+
+	/* Oldest to newest, the ring may have wrapped several times */
+	for (i = first; i != ring_next; i++)
+		trace_dump_record(out, &ring[i & (TRACE_RING_SIZE - 1)]);
+
+	for (l = dump_list; l; l = l->next) {
+		struct trace_dump *dump = l->data;
+
+		fputc('\n', out);
+		dump->func(out, dump->user_data);
+	}
+
+	fclose(out);
+
+	ofono_info("Trace of %u events written to %s",
+			ring_next - first, path);
+
+	g_free(path);
+	return;
+
+error:
+	ofono_error("Unable to write trace to %s: %s (%d)",
+			path, strerror(errno), errno);
+	g_free(path);
+}
+
+void __ofono_trace_init(void)
+{
+	ring = g_new0(struct trace_record, TRACE_RING_SIZE);
+	ring_next = 0;
+	trace_clock = g_timer_new();
+}
+
+void __ofono_trace_cleanup(void)
+{
+	g_slist_foreach(dump_list, (GFunc) g_free, NULL);
+	g_slist_free(dump_list);
+	dump_list = NULL;
+
+	g_timer_destroy(trace_clock);
+	trace_clock = NULL;
+
+	g_free(ring);
+	ring = NULL;
+}
@@ -0,0 +1,193 @@
+/*
+ *
+ *  oFono - Open Source Telephony
+ *
+ *  Copyright (C) 2008-2010  Intel Corporation. All rights reserved.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include <glib.h>
+
+#include "gatchat.h"
+
+#include "fake-modem.h"
+
+struct pending_write {
+	struct fake_modem *modem;
+	char *str;
+	guint source;
+};
+
+static gboolean modem_read(GIOChannel *io, GIOCondition cond,
+				gpointer user_data)
+{
+	struct fake_modem *modem = user_data;
+	char buf[512];
+	ssize_t len;
+
+	if (cond & (G_IO_HUP | G_IO_ERR)) {
+		modem->watch = 0;
+		return FALSE;
+	}
+
+	len = read(modem->fd, buf, sizeof(buf));
+	if (len <= 0) {
+		modem->watch = 0;
+		return FALSE;
+	}
+
+	if (modem->receive)
+		modem->receive(modem, buf, len, modem->user_data);
+	else
+		fake_modem_feed(modem, buf, len);
+
+	return TRUE;
+}
+
+GIOChannel *fake_modem_start(struct fake_modem *modem,
+				fake_modem_command_func command,
+				gpointer user_data)
+{
+	GIOChannel *host;
+	int fds[2];
+
+	g_assert(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+
+	memset(modem, 0, sizeof(*modem));
+	modem->fd = fds[1];
+	modem->terminator = '\r';
+	modem->command = command;
+	modem->user_data = user_data;
+	modem->line = g_string_new(NULL);
+	modem->io = g_io_channel_unix_new(modem->fd);
+	modem->watch = g_io_add_watch(modem->io,
+					G_IO_IN | G_IO_HUP | G_IO_ERR,
+					modem_read, modem);
+
+	host = g_io_channel_unix_new(fds[0]);
+	g_io_channel_set_close_on_unref(host, TRUE);
+
+	return host;
+}
+
+GAtChat *fake_modem_start_chat(struct fake_modem *modem,
+				fake_modem_command_func command,
+				gpointer user_data)
+{
+	GAtSyntax *syntax;
+	GIOChannel *host;
+	GAtChat *chat;
+
+	host = fake_modem_start(modem, command, user_data);
+
+	syntax = g_at_syntax_new_gsmv1();
+	chat = g_at_chat_new(host, syntax);
+	g_at_syntax_unref(syntax);
+	g_io_channel_unref(host);
+
+	g_assert(chat != NULL);
+
+	return chat;
+}
+
+static void pending_write_free(gpointer data, gpointer user_data)
+{
+	struct pending_write *pending = data;
+
+	g_source_remove(pending->source);
+	g_free(pending->str);
+	g_free(pending);
+}
+
+void fake_modem_stop(struct fake_modem *modem)
+{
+	g_slist_foreach(modem->pending, pending_write_free, NULL);
+	g_slist_free(modem->pending);
+	modem->pending = NULL;
+
+	if (modem->watch)
+		g_source_remove(modem->watch);
+
+	g_io_channel_unref(modem->io);
+	close(modem->fd);
+
+	g_string_free(modem->line, TRUE);
+}
+
+/* Splits what the host wrote into command lines */
+void fake_modem_feed(struct fake_modem *modem, const char *data, gsize len)
+{
+	char *end;
+
+	g_string_append_len(modem->line, data, len);
+
+	/* The command function may change the terminator of the next one */
+	while ((end = memchr(modem->line->str, modem->terminator,
+				modem->line->len))) {
+		*end = '\0';
+		modem->command(modem, modem->line->str, modem->user_data);
+		g_string_erase(modem->line, 0, end - modem->line->str + 1);
+	}
+}
+
+void fake_modem_send(struct fake_modem *modem, const char *data, gsize len)
+{
+	g_assert(write(modem->fd, data, len) == (ssize_t) len);
+}
+
+void fake_modem_write(struct fake_modem *modem, const char *str)
+{
+	if (modem->send)
+		modem->send(modem, str, strlen(str), modem->user_data);
+	else
+		fake_modem_send(modem, str, strlen(str));
+}
+
+static gboolean pending_write_cb(gpointer user_data)
+{
+	struct pending_write *pending = user_data;
+	struct fake_modem *modem = pending->modem;
+
+	modem->pending = g_slist_remove(modem->pending, pending);
+
+	fake_modem_write(modem, pending->str);
+
+	g_free(pending->str);
+	g_free(pending);
+
+	return FALSE;
+}
+
+void fake_modem_write_later(struct fake_modem *modem, guint delay,
+				const char *str)
+{
+	struct pending_write *pending;
+
+	pending = g_new0(struct pending_write, 1);
+	pending->modem = modem;
+	pending->str = g_strdup(str);
+	pending->source = g_timeout_add(delay, pending_write_cb, pending);
+
+	modem->pending = g_slist_prepend(modem->pending, pending);
+}
@@ -0,0 +1,64 @@
+/*
+ *
+ *  oFono - Open Source Telephony
+ *
+ *  Copyright (C) 2008-2010  Intel Corporation. All rights reserved.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+/*
+ * The modem end of a socketpair for the unit tests.  Every command line
+ * the host writes is handed to the command function, which answers with
+ * fake_modem_write() or fake_modem_write_later().
+ */
+struct fake_modem;
+
+typedef void (*fake_modem_command_func)(struct fake_modem *modem,
+					const char *command,
+					gpointer user_data);
+
+/* Raw bytes in either direction, for modems that frame what they carry */
+typedef void (*fake_modem_data_func)(struct fake_modem *modem,
+					const char *data, gsize len,
+					gpointer user_data);
+
+struct fake_modem {
+	int fd;
+	GIOChannel *io;
+	guint watch;
+	GString *line;
+	char terminator;		/* Ends a command line, '\r' at start */
+	GSList *pending;		/* Writes yet to be made */
+	fake_modem_command_func command;
+	fake_modem_data_func receive;	/* Replaces the line splitting */
+	fake_modem_data_func send;	/* Replaces the plain write */
+	gpointer user_data;
+};
+
+GIOChannel *fake_modem_start(struct fake_modem *modem,
+				fake_modem_command_func command,
+				gpointer user_data);
+GAtChat *fake_modem_start_chat(struct fake_modem *modem,
+				fake_modem_command_func command,
+				gpointer user_data);
+void fake_modem_stop(struct fake_modem *modem);
+
+void fake_modem_feed(struct fake_modem *modem, const char *data, gsize len);
+
+void fake_modem_send(struct fake_modem *modem, const char *data, gsize len);
+void fake_modem_write(struct fake_modem *modem, const char *str);
+void fake_modem_write_later(struct fake_modem *modem, guint delay,
+				const char *str);
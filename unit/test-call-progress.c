@@ -0,0 +1,421 @@
+/*
+ *
+ *  oFono - Open Source Telephony
+ *
+ *  Copyright (C) 2008-2010  Intel Corporation. All rights reserved.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+
+#include <glib.h>
+
+#include <ofono/types.h>
+#include <ofono/log.h>
+#include <ofono/voicecall.h>
+
+#include "gatchat.h"
+#include "gatresult.h"
+#include "common.h"
+
+#include "drivers/atmodem/atmodem.h"
+#include "drivers/atmodem/vendor.h"
+#include "drivers/atmodem/call-progress.h"
+
+#include "fake-modem.h"
+
+struct parse_test {
+	unsigned int vendor;
+	const char *line;
+	gboolean ok;
+	int id;
+	int status;
+};
+
+static const struct parse_test parse_tests[] = {
+	{ OFONO_VENDOR_HUAWEI, "^ORIG: 1,0", TRUE, 1, CALL_STATUS_DIALING },
+	{ OFONO_VENDOR_HUAWEI, "^CONF: 1", TRUE, 1, CALL_STATUS_ALERTING },
+	{ OFONO_VENDOR_HUAWEI, "^CONN: 2,0", TRUE, 2, CALL_STATUS_ACTIVE },
+	{ OFONO_VENDOR_HUAWEI, "^CEND: 1,12,104,16", TRUE, 1,
+						CALL_STATUS_DISCONNECTED },
+	{ OFONO_VENDOR_HUAWEI, "^CEND:", FALSE, 0, 0 },
+	{ OFONO_VENDOR_GENERIC, "^ORIG: 1,0", FALSE, 0, 0 },
+	{ OFONO_VENDOR_STE, "*ECAV: 1,1,1", FALSE, 0, 0 },
+};
+
+static gboolean parse_line(unsigned int vendor, const char *line,
+				int *id, int *status)
+{
+	GAtResult result;
+	gboolean ret;
+
+	result.lines = g_slist_prepend(NULL, (char *) line);
+	result.final_or_pdu = NULL;
+
+	ret = at_call_progress_parse(&result, vendor, id, status);
+
+	g_slist_free(result.lines);
+
+	return ret;
+}
+
+static void test_parse(void)
+{
+	unsigned int i;
+
+	for (i = 0; i < G_N_ELEMENTS(parse_tests); i++) {
+		const struct parse_test *test = &parse_tests[i];
+		int id = 0;
+		int status = 0;
+		gboolean ok;
+
+		ok = parse_line(test->vendor, test->line, &id, &status);
+
+		if (g_test_verbose())
+			g_print("%s -> %d (%d, %d)\n", test->line, ok,
+					id, status);
+
+		g_assert(ok == test->ok);
+
+		if (!ok)
+			continue;
+
+		g_assert(id == test->id);
+		g_assert(status == test->status);
+	}
+}
+
+static void test_backoff(void)
+{
+	struct at_call_poll poll;
+
+	at_call_poll_init(&poll, FALSE);
+
+	g_assert(at_call_poll_next(&poll, TRUE, TRUE) == POLL_CLCC_INTERVAL);
+	g_assert(at_call_poll_next(&poll, TRUE, FALSE) ==
+						POLL_CLCC_INTERVAL * 2);
+	g_assert(at_call_poll_next(&poll, TRUE, FALSE) ==
+						POLL_CLCC_MAX_INTERVAL);
+	g_assert(at_call_poll_next(&poll, TRUE, FALSE) ==
+						POLL_CLCC_MAX_INTERVAL);
+	g_assert(at_call_poll_next(&poll, TRUE, TRUE) == POLL_CLCC_INTERVAL);
+	g_assert(at_call_poll_next(&poll, FALSE, TRUE) == 0);
+
+	at_call_poll_init(&poll, TRUE);
+
+	g_assert(at_call_poll_next(&poll, TRUE, TRUE) ==
+						POLL_CLCC_FALLBACK_INTERVAL);
+	g_assert(at_call_poll_next(&poll, TRUE, FALSE) ==
+					POLL_CLCC_FALLBACK_INTERVAL * 2);
+	g_assert(at_call_poll_next(&poll, FALSE, FALSE) == 0);
+}
+
+/*
+ * What happens at the network during an outgoing call, in ms after ATD
+ * returned.  clcc is the +CLCC <stat> from then on, or -1 once the call
+ * is gone.  urc is what a modem with call progress indications reports,
+ * generic_urc what any other modem does.
+ */
+struct call_event {
+	unsigned int time;
+	int clcc;
+	const char *urc;
+	const char *generic_urc;
+};
+
+static const struct call_event outgoing_call[] = {
+	{ 0, CALL_STATUS_DIALING, "^ORIG: 1,0", NULL },
+	{ 200, CALL_STATUS_ALERTING, "^CONF: 1", NULL },
+	{ 1100, CALL_STATUS_ACTIVE, "^CONN: 1,0", NULL },
+	{ 2200, -1, "^CEND: 1,5,104,16", "NO CARRIER" },
+};
+
+/* A modem on the other end of a socketpair, playing the network */
+struct test_modem {
+	struct fake_modem fake;
+	unsigned int vendor;
+	GTimer *timer;
+	gboolean dialed;
+	unsigned int clcc_polls;
+	unsigned int clcc_until_active;
+};
+
+struct ofono_voicecall {
+	void *driver_data;
+	int status;
+	gboolean active;
+	gboolean disconnected;
+	struct test_modem *modem;
+};
+
+static const struct ofono_voicecall_driver *driver;
+static GMainLoop *event_loop;
+
+static void modem_dial(struct test_modem *modem)
+{
+	gboolean indications = at_call_progress_prefixes(modem->vendor) != NULL;
+	unsigned int i;
+
+	modem->dialed = TRUE;
+	g_timer_start(modem->timer);
+
+	fake_modem_write(&modem->fake, "\r\nOK\r\n");
+
+	for (i = 0; i < G_N_ELEMENTS(outgoing_call); i++) {
+		const struct call_event *event = &outgoing_call[i];
+		const char *line;
+		char buf[64];
+
+		line = indications ? event->urc : event->generic_urc;
+		if (line == NULL)
+			continue;
+
+		snprintf(buf, sizeof(buf), "\r\n%s\r\n", line);
+		fake_modem_write_later(&modem->fake, event->time, buf);
+	}
+}
+
+static void modem_clcc(struct test_modem *modem)
+{
+	unsigned int now = g_timer_elapsed(modem->timer, NULL) * 1000;
+	int status = -1;
+	unsigned int i;
+	char buf[64];
+
+	/* The driver populates its call list once it is initialized */
+	if (modem->dialed == FALSE) {
+		fake_modem_write(&modem->fake, "\r\nOK\r\n");
+		g_main_loop_quit(event_loop);
+		return;
+	}
+
+	modem->clcc_polls += 1;
+
+	for (i = 0; i < G_N_ELEMENTS(outgoing_call); i++) {
+		if (outgoing_call[i].time <= now)
+			status = outgoing_call[i].clcc;
+	}
+
+	if (status >= 0) {
+		snprintf(buf, sizeof(buf),
+				"\r\n+CLCC: 1,0,%d,0,0,\"123\",129\r\n",
+				status);
+		fake_modem_write(&modem->fake, buf);
+	}
+
+	fake_modem_write(&modem->fake, "\r\nOK\r\n");
+}
+
+static void modem_command(struct fake_modem *fake, const char *command,
+				gpointer user_data)
+{
+	struct test_modem *modem = user_data;
+
+	if (g_str_has_prefix(command, "ATD"))
+		modem_dial(modem);
+	else if (g_str_equal(command, "AT+CLCC"))
+		modem_clcc(modem);
+	else
+		fake_modem_write(fake, "\r\nOK\r\n");
+}
+
+static GAtChat *modem_start(struct test_modem *modem, unsigned int vendor)
+{
+	memset(modem, 0, sizeof(*modem));
+	modem->vendor = vendor;
+	modem->timer = g_timer_new();
+
+	return fake_modem_start_chat(&modem->fake, modem_command, modem);
+}
+
+static void modem_stop(struct test_modem *modem)
+{
+	fake_modem_stop(&modem->fake);
+	g_timer_destroy(modem->timer);
+}
+
+void ofono_debug(const char *format, ...)
+{
+}
+
+void ofono_error(const char *format, ...)
+{
+}
+
+int ofono_voicecall_driver_register(const struct ofono_voicecall_driver *d)
+{
+	driver = d;
+
+	return 0;
+}
+
+void ofono_voicecall_driver_unregister(const struct ofono_voicecall_driver *d)
+{
+	driver = NULL;
+}
+
+void ofono_voicecall_set_data(struct ofono_voicecall *vc, void *data)
+{
+	vc->driver_data = data;
+}
+
+void *ofono_voicecall_get_data(struct ofono_voicecall *vc)
+{
+	return vc->driver_data;
+}
+
+void ofono_voicecall_register(struct ofono_voicecall *vc)
+{
+}
+
+int ofono_voicecall_get_next_callid(struct ofono_voicecall *vc)
+{
+	return 1;
+}
+
+void ofono_voicecall_notify(struct ofono_voicecall *vc,
+				const struct ofono_call *call)
+{
+	if (g_test_verbose())
+		g_print("call %d status %d\n", call->id, call->status);
+
+	g_assert(call->id == 1);
+
+	vc->status = call->status;
+
+	if (call->status != CALL_STATUS_ACTIVE || vc->active)
+		return;
+
+	vc->active = TRUE;
+	vc->modem->clcc_until_active = vc->modem->clcc_polls;
+}
+
+void ofono_voicecall_disconnected(struct ofono_voicecall *vc, int id,
+				enum ofono_disconnect_reason reason,
+				const struct ofono_error *error)
+{
+	if (g_test_verbose())
+		g_print("call %d disconnected\n", id);
+
+	g_assert(id == 1);
+	g_assert(reason == OFONO_DISCONNECT_REASON_REMOTE_HANGUP);
+
+	vc->disconnected = TRUE;
+	g_main_loop_quit(event_loop);
+}
+
+static void dial_cb(const struct ofono_error *error, void *data)
+{
+	g_assert(error->type == OFONO_ERROR_TYPE_NO_ERROR);
+}
+
+static gboolean call_timeout(gpointer user_data)
+{
+	g_assert_not_reached();
+
+	return FALSE;
+}
+
+/* Plays outgoing_call through the atmodem voicecall driver */
+static void run_outgoing_call(struct test_modem *modem, unsigned int vendor)
+{
+	struct ofono_voicecall vc;
+	struct ofono_phone_number ph;
+	GAtChat *chat;
+	guint timeout;
+
+	memset(&vc, 0, sizeof(vc));
+	vc.modem = modem;
+
+	chat = modem_start(modem, vendor);
+
+	at_voicecall_init();
+	g_assert(driver != NULL);
+
+	event_loop = g_main_loop_new(NULL, FALSE);
+	timeout = g_timeout_add_seconds(10, call_timeout, NULL);
+
+	g_assert(driver->probe(&vc, vendor, chat) == 0);
+	g_at_chat_unref(chat);
+
+	g_main_loop_run(event_loop);
+
+	strcpy(ph.number, "123");
+	ph.type = 129;
+
+	driver->dial(&vc, &ph, OFONO_CLIR_OPTION_DEFAULT,
+			OFONO_CUG_OPTION_DEFAULT, dial_cb, NULL);
+
+	g_main_loop_run(event_loop);
+
+	g_source_remove(timeout);
+	g_main_loop_unref(event_loop);
+
+	g_assert(vc.active);
+	g_assert(vc.disconnected);
+
+	if (g_test_verbose())
+		g_print("vendor %u: %u CLCC until active, %u in all\n",
+				vendor, modem->clcc_until_active,
+				modem->clcc_polls);
+
+	driver->remove(&vc);
+	at_voicecall_exit();
+
+	modem_stop(modem);
+}
+
+static void test_clcc_polling(void)
+{
+	struct test_modem modem;
+
+	run_outgoing_call(&modem, OFONO_VENDOR_GENERIC);
+
+	/* Alerting and active are only learned by polling */
+	g_assert(modem.clcc_until_active >= 2);
+
+	/* NO CARRIER is followed by one more CLCC */
+	g_assert(modem.clcc_polls == modem.clcc_until_active + 1);
+}
+
+static void test_clcc_indications(void)
+{
+	struct test_modem modem;
+
+	run_outgoing_call(&modem, OFONO_VENDOR_HUAWEI);
+
+	/* The whole call is followed without a single CLCC */
+	g_assert(modem.clcc_polls == 0);
+}
+
+int main(int argc, char **argv)
+{
+	g_test_init(&argc, &argv, NULL);
+
+	g_test_add_func("/testcallprogress/Parse indications", test_parse);
+	g_test_add_func("/testcallprogress/Poll backoff", test_backoff);
+	g_test_add_func("/testcallprogress/CLCC polling", test_clcc_polling);
+	g_test_add_func("/testcallprogress/CLCC with indications",
+				test_clcc_indications);
+
+	return g_test_run();
+}
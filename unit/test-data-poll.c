@@ -0,0 +1,382 @@
+/*
+ *
+ *  oFono - Open Source Telephony
+ *
+ *  Copyright (C) 2008-2010  Intel Corporation. All rights reserved.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+
+#include <glib.h>
+
+#include <ofono/types.h>
+#include <ofono/log.h>
+#include <ofono/gprs-context.h>
+
+#include "gatchat.h"
+#include "gatresult.h"
+
+#include "drivers/huaweimodem/huaweimodem.h"
+
+#include "fake-modem.h"
+
+/* How long the modem takes to bring the link up after ^NDISDUP */
+#define LINK_UP_TIME 300
+
+/* A Huawei modem on the other end of the fake modem */
+struct test_modem {
+	struct fake_modem fake;
+	GTimer *timer;			/* Started by ^NDISDUP */
+	gboolean dialed;
+	gboolean notifications;		/* Sends ^NDISSTAT */
+	gboolean drop_early;		/* ^DEND before the ^NDISDUP OK */
+	unsigned int dhcp_queries;
+};
+
+struct ofono_gprs_context {
+	void *driver_data;
+	struct ofono_error error;
+	gboolean done;
+	double up_at;
+};
+
+static const struct ofono_gprs_context_driver *driver;
+static GMainLoop *event_loop;
+
+/* Seconds since the link came up, negative while it is still down */
+static double modem_link_age(struct test_modem *modem)
+{
+	if (modem->dialed == FALSE)
+		return -1;
+
+	return g_timer_elapsed(modem->timer, NULL) - LINK_UP_TIME / 1000.0;
+}
+
+static void modem_ndisdup(struct test_modem *modem, const char *cmd)
+{
+	if (g_str_has_suffix(cmd, ",0")) {
+		modem->dialed = FALSE;
+		fake_modem_write(&modem->fake, "\r\nOK\r\n");
+		return;
+	}
+
+	if (modem->drop_early) {
+		fake_modem_write(&modem->fake,
+					"\r\n^DEND:1,0,36\r\n\r\nOK\r\n");
+		return;
+	}
+
+	modem->dialed = TRUE;
+	g_timer_start(modem->timer);
+
+	fake_modem_write(&modem->fake, "\r\nOK\r\n");
+
+	if (modem->notifications)
+		fake_modem_write_later(&modem->fake, LINK_UP_TIME,
+					"\r\n^NDISSTAT:1,,,\"IPV4\"\r\n");
+}
+
+static void modem_dhcp(struct test_modem *modem)
+{
+	modem->dhcp_queries += 1;
+
+	if (modem_link_age(modem) < 0) {
+		fake_modem_write(&modem->fake, "\r\nERROR\r\n");
+		return;
+	}
+
+	fake_modem_write(&modem->fake, "\r\n^DHCP: 0100000a,00ffffff,"
+			"0100000a,0100000a,0800080a,0400080a,7200000,7200000"
+			"\r\n\r\nOK\r\n");
+}
+
+static void modem_command(struct fake_modem *fake, const char *command,
+				gpointer user_data)
+{
+	struct test_modem *modem = user_data;
+
+	if (g_str_has_prefix(command, "AT^NDISDUP="))
+		modem_ndisdup(modem, command);
+	else if (g_str_equal(command, "AT^DHCP?"))
+		modem_dhcp(modem);
+	else
+		fake_modem_write(fake, "\r\nOK\r\n");
+}
+
+static GAtChat *modem_start(struct test_modem *modem)
+{
+	memset(modem, 0, sizeof(*modem));
+	modem->timer = g_timer_new();
+
+	return fake_modem_start_chat(&modem->fake, modem_command, modem);
+}
+
+static void modem_stop(struct test_modem *modem)
+{
+	fake_modem_stop(&modem->fake);
+	g_timer_destroy(modem->timer);
+}
+
+void ofono_debug(const char *format, ...)
+{
+}
+
+void ofono_info(const char *format, ...)
+{
+}
+
+void ofono_error(const char *format, ...)
+{
+}
+
+int ofono_gprs_context_driver_register(
+				const struct ofono_gprs_context_driver *d)
+{
+	driver = d;
+
+	return 0;
+}
+
+void ofono_gprs_context_driver_unregister(
+				const struct ofono_gprs_context_driver *d)
+{
+	driver = NULL;
+}
+
+void ofono_gprs_context_set_data(struct ofono_gprs_context *gc, void *data)
+{
+	gc->driver_data = data;
+}
+
+void *ofono_gprs_context_get_data(struct ofono_gprs_context *gc)
+{
+	return gc->driver_data;
+}
+
+void ofono_gprs_context_deactivated(struct ofono_gprs_context *gc,
+					unsigned int id)
+{
+	g_assert_not_reached();
+}
+
+static struct test_modem *current_modem;
+
+static void activate_cb(const struct ofono_error *error,
+			const char *interface, ofono_bool_t static_ip,
+			const char *address, const char *netmask,
+			const char *gw, const char **dns, void *data)
+{
+	struct ofono_gprs_context *gc = data;
+
+	gc->error = *error;
+	gc->done = TRUE;
+	gc->up_at = modem_link_age(current_modem);
+
+	if (error->type == OFONO_ERROR_TYPE_NO_ERROR)
+		g_assert(g_str_equal(address, "10.0.0.1"));
+
+	g_main_loop_quit(event_loop);
+}
+
+static gboolean quit_loop(gpointer user_data)
+{
+	g_main_loop_quit(event_loop);
+
+	return FALSE;
+}
+
+static gboolean activate_timeout(gpointer user_data)
+{
+	g_assert_not_reached();
+
+	return FALSE;
+}
+
+static void activate(struct ofono_gprs_context *gc)
+{
+	struct ofono_gprs_primary_context ctx;
+	guint timeout;
+
+	memset(&ctx, 0, sizeof(ctx));
+	ctx.cid = 1;
+	strcpy(ctx.apn, "internet");
+
+	gc->done = FALSE;
+
+	timeout = g_timeout_add_seconds(10, activate_timeout, NULL);
+
+	driver->activate_primary(gc, &ctx, activate_cb, gc);
+
+	g_main_loop_run(event_loop);
+
+	g_source_remove(timeout);
+
+	g_assert(gc->done);
+}
+
+static void deactivate_cb(const struct ofono_error *error, void *data)
+{
+	g_assert(error->type == OFONO_ERROR_TYPE_NO_ERROR);
+
+	g_main_loop_quit(event_loop);
+}
+
+/* Brings a context up through the huaweimodem gprs-context driver */
+static void run_activation(struct test_modem *modem,
+				struct ofono_gprs_context *gc)
+{
+	GAtChat *chat;
+
+	memset(gc, 0, sizeof(*gc));
+
+	chat = modem_start(modem);
+	current_modem = modem;
+
+	huawei_gprs_context_init();
+	g_assert(driver != NULL);
+
+	event_loop = g_main_loop_new(NULL, FALSE);
+
+	g_assert(driver->probe(gc, 0, chat) == 0);
+	g_at_chat_unref(chat);
+}
+
+static void stop_activation(struct test_modem *modem,
+				struct ofono_gprs_context *gc)
+{
+	if (gc->error.type == OFONO_ERROR_TYPE_NO_ERROR) {
+		driver->deactivate_primary(gc, 1, deactivate_cb, gc);
+		g_main_loop_run(event_loop);
+	}
+
+	g_main_loop_unref(event_loop);
+
+	driver->remove(gc);
+	huawei_gprs_context_exit();
+
+	modem_stop(modem);
+}
+
+static void test_poll_interval(void)
+{
+	struct at_util_poll poll;
+
+	at_util_poll_init(&poll, FALSE);
+
+	g_assert(at_util_poll_next(&poll) == AT_UTIL_POLL_INTERVAL);
+	g_assert(at_util_poll_next(&poll) == AT_UTIL_POLL_INTERVAL);
+
+	at_util_poll_init(&poll, TRUE);
+
+	g_assert(at_util_poll_next(&poll) == AT_UTIL_POLL_FALLBACK_INTERVAL);
+	g_assert(at_util_poll_next(&poll) ==
+					AT_UTIL_POLL_FALLBACK_INTERVAL * 2);
+	g_assert(at_util_poll_next(&poll) ==
+					AT_UTIL_POLL_FALLBACK_MAX_INTERVAL);
+}
+
+static void test_link_polled(void)
+{
+	struct test_modem modem;
+	struct ofono_gprs_context gc;
+
+	run_activation(&modem, &gc);
+	activate(&gc);
+
+	if (g_test_verbose())
+		g_print("up %.0f ms late, %u ^DHCP queries\n",
+				gc.up_at * 1000, modem.dhcp_queries);
+
+	g_assert(gc.error.type == OFONO_ERROR_TYPE_NO_ERROR);
+
+	/* One query right away, the next one a second later */
+	g_assert(modem.dhcp_queries == 2);
+	g_assert(gc.up_at * 1000 < AT_UTIL_POLL_INTERVAL);
+
+	stop_activation(&modem, &gc);
+}
+
+static void test_link_notified(void)
+{
+	struct test_modem modem;
+	struct ofono_gprs_context gc;
+
+	run_activation(&modem, &gc);
+	modem.notifications = TRUE;
+
+	/* Teaches the driver that the firmware reports the link state */
+	fake_modem_write(&modem.fake, "\r\n^NDISSTAT:0,,,\"IPV4\"\r\n");
+
+	g_timeout_add(50, quit_loop, NULL);
+	g_main_loop_run(event_loop);
+
+	activate(&gc);
+
+	if (g_test_verbose())
+		g_print("up %.0f ms late, %u ^DHCP queries\n",
+				gc.up_at * 1000, modem.dhcp_queries);
+
+	g_assert(gc.error.type == OFONO_ERROR_TYPE_NO_ERROR);
+
+	/* The query made right away, then one on the notification */
+	g_assert(modem.dhcp_queries == 2);
+	g_assert(gc.up_at * 1000 < AT_UTIL_POLL_INTERVAL / 4);
+
+	stop_activation(&modem, &gc);
+}
+
+static void test_link_down_early(void)
+{
+	struct test_modem modem;
+	struct ofono_gprs_context gc;
+
+	run_activation(&modem, &gc);
+	modem.drop_early = TRUE;
+
+	activate(&gc);
+
+	g_assert(gc.error.type == OFONO_ERROR_TYPE_FAILURE);
+	g_assert(modem.dhcp_queries == 0);
+
+	/* The context is free again */
+	modem.drop_early = FALSE;
+	modem.notifications = TRUE;
+
+	activate(&gc);
+
+	g_assert(gc.error.type == OFONO_ERROR_TYPE_NO_ERROR);
+
+	stop_activation(&modem, &gc);
+}
+
+int main(int argc, char **argv)
+{
+	g_test_init(&argc, &argv, NULL);
+
+	g_test_add_func("/testdatapoll/Poll interval", test_poll_interval);
+	g_test_add_func("/testdatapoll/Link polled", test_link_polled);
+	g_test_add_func("/testdatapoll/Link notified", test_link_notified);
+	g_test_add_func("/testdatapoll/Link down early",
+				test_link_down_early);
+
+	return g_test_run();
+}
@@ -0,0 +1,353 @@
+/*
+ *
+ *  oFono - Open Source Telephony
+ *
+ *  Copyright (C) 2008-2010  Intel Corporation. All rights reserved.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <string.h>
+
+#include <glib.h>
+#include <gdbus.h>
+
+#include "ofono.h"
+
+#define TEST_PATH "/phonesim"
+#define TEST_INTERFACE "org.ofono.NetworkRegistration"
+
+struct signal {
+	char *name;
+	int type;
+	dbus_uint32_t u;
+	char *s;
+};
+
+/* Signals sent through the batches, in order */
+static GSList *signals;
+
+gboolean g_dbus_send_message(DBusConnection *connection, DBusMessage *message)
+{
+	DBusMessageIter iter, variant;
+	struct signal *signal;
+	const char *name;
+
+	g_assert(g_str_equal(dbus_message_get_path(message), TEST_PATH));
+	g_assert(g_str_equal(dbus_message_get_interface(message),
+							TEST_INTERFACE));
+	g_assert(g_str_equal(dbus_message_get_member(message),
+							"PropertyChanged"));
+
+	dbus_message_iter_init(message, &iter);
+	dbus_message_iter_get_basic(&iter, &name);
+	dbus_message_iter_next(&iter);
+	dbus_message_iter_recurse(&iter, &variant);
+
+	signal = g_new0(struct signal, 1);
+	signal->name = g_strdup(name);
+	signal->type = dbus_message_iter_get_arg_type(&variant);
+
+	if (signal->type == DBUS_TYPE_STRING) {
+		const char *str;
+
+		dbus_message_iter_get_basic(&variant, &str);
+		signal->s = g_strdup(str);
+	} else {
+		g_assert(signal->type == DBUS_TYPE_UINT32);
+		dbus_message_iter_get_basic(&variant, &signal->u);
+	}
+
+	signals = g_slist_append(signals, signal);
+
+	dbus_message_unref(message);
+
+	return TRUE;
+}
+
+DBusMessage *g_dbus_create_error(DBusMessage *message, const char *name,
+						const char *format, ...)
+{
+	return NULL;
+}
+
+void ofono_debug(const char *format, ...)
+{
+}
+
+void ofono_error(const char *format, ...)
+{
+}
+
+void ofono_trace_dump_register(ofono_trace_dump_func func, void *user_data)
+{
+}
+
+void ofono_trace_dump_unregister(ofono_trace_dump_func func)
+{
+}
+
+static void signals_clear(void)
+{
+	GSList *l;
+
+	for (l = signals; l; l = l->next) {
+		struct signal *signal = l->data;
+
+		g_free(signal->name);
+		g_free(signal->s);
+		g_free(signal);
+	}
+
+	g_slist_free(signals);
+	signals = NULL;
+}
+
+static void check_uint(guint index, const char *name, dbus_uint32_t value)
+{
+	struct signal *signal = g_slist_nth_data(signals, index);
+
+	g_assert(signal != NULL);
+	g_assert(g_str_equal(signal->name, name));
+	g_assert(signal->type == DBUS_TYPE_UINT32);
+	g_assert(signal->u == value);
+}
+
+static void check_string(guint index, const char *name, const char *value)
+{
+	struct signal *signal = g_slist_nth_data(signals, index);
+
+	g_assert(signal != NULL);
+	g_assert(g_str_equal(signal->name, name));
+	g_assert(signal->type == DBUS_TYPE_STRING);
+	g_assert(g_str_equal(signal->s, value));
+}
+
+static void set_uint(struct ofono_dbus_batch *batch, const char *name,
+			dbus_uint32_t value)
+{
+	__ofono_dbus_batch_property_changed(batch, name, DBUS_TYPE_UINT32,
+						&value);
+}
+
+static void set_string(struct ofono_dbus_batch *batch, const char *name,
+			const char *value)
+{
+	__ofono_dbus_batch_property_changed(batch, name, DBUS_TYPE_STRING,
+						&value);
+}
+
+static void run_pending(void)
+{
+	while (g_main_context_iteration(NULL, FALSE))
+		;
+}
+
+static void test_coalesce(void)
+{
+	struct ofono_dbus_batch *batch;
+
+	batch = __ofono_dbus_batch_new(TEST_PATH, TEST_INTERFACE, 0);
+
+	/* Nothing is sent before the main loop goes idle */
+	set_uint(batch, "Strength", 10);
+	set_uint(batch, "Strength", 20);
+	set_uint(batch, "Strength", 30);
+	g_assert(signals == NULL);
+
+	run_pending();
+	g_assert(g_slist_length(signals) == 1);
+	check_uint(0, "Strength", 30);
+	signals_clear();
+
+	/* The value last signalled is not signalled again */
+	set_uint(batch, "Strength", 30);
+	run_pending();
+	g_assert(signals == NULL);
+
+	/* Nor is a change reverted before the flush */
+	set_uint(batch, "Strength", 40);
+	set_uint(batch, "Strength", 30);
+	run_pending();
+	g_assert(signals == NULL);
+
+	set_string(batch, "Name", "Operator");
+	set_string(batch, "Name", "Operator");
+	run_pending();
+	g_assert(g_slist_length(signals) == 1);
+	check_string(0, "Name", "Operator");
+	signals_clear();
+
+	set_string(batch, "Name", "Operator");
+	run_pending();
+	g_assert(signals == NULL);
+
+	__ofono_dbus_batch_free(batch);
+	g_assert(signals == NULL);
+}
+
+static void test_order(void)
+{
+	struct ofono_dbus_batch *batch;
+
+	batch = __ofono_dbus_batch_new(TEST_PATH, TEST_INTERFACE, 0);
+
+	set_string(batch, "Status", "registered");
+	set_uint(batch, "LocationAreaCode", 1);
+	set_uint(batch, "CellId", 2);
+	run_pending();
+
+	g_assert(g_slist_length(signals) == 3);
+	check_string(0, "Status", "registered");
+	check_uint(1, "LocationAreaCode", 1);
+	check_uint(2, "CellId", 2);
+	signals_clear();
+
+	/* The order is that of the first time each property was queued */
+	set_uint(batch, "CellId", 3);
+	set_uint(batch, "LocationAreaCode", 4);
+	set_string(batch, "Status", "roaming");
+	run_pending();
+
+	g_assert(g_slist_length(signals) == 3);
+	check_string(0, "Status", "roaming");
+	check_uint(1, "LocationAreaCode", 4);
+	check_uint(2, "CellId", 3);
+	signals_clear();
+
+	/* Only the properties changed since the last flush are signalled */
+	set_uint(batch, "CellId", 5);
+	set_string(batch, "Status", "searching");
+	run_pending();
+
+	g_assert(g_slist_length(signals) == 2);
+	check_string(0, "Status", "searching");
+	check_uint(1, "CellId", 5);
+	signals_clear();
+
+	__ofono_dbus_batch_free(batch);
+}
+
+static void test_forget(void)
+{
+	struct ofono_dbus_batch *batch;
+
+	batch = __ofono_dbus_batch_new(TEST_PATH, TEST_INTERFACE, 0);
+
+	set_string(batch, "Status", "registered");
+	set_uint(batch, "CellId", 7);
+	run_pending();
+
+	g_assert(g_slist_length(signals) == 2);
+	signals_clear();
+
+	/* Unregistered, the cell goes away without a signal */
+	set_string(batch, "Status", "unregistered");
+	__ofono_dbus_batch_property_forget(batch, "CellId");
+	run_pending();
+
+	g_assert(g_slist_length(signals) == 1);
+	check_string(0, "Status", "unregistered");
+	signals_clear();
+
+	/* Back on the same cell, which has to be signalled again */
+	set_string(batch, "Status", "registered");
+	set_uint(batch, "CellId", 7);
+	run_pending();
+
+	g_assert(g_slist_length(signals) == 2);
+	check_string(0, "Status", "registered");
+	check_uint(1, "CellId", 7);
+	signals_clear();
+
+	/* A change still pending is dropped along with the property */
+	set_uint(batch, "CellId", 8);
+	__ofono_dbus_batch_property_forget(batch, "CellId");
+	__ofono_dbus_batch_property_forget(batch, "Unknown");
+	run_pending();
+	g_assert(signals == NULL);
+
+	__ofono_dbus_batch_free(batch);
+	g_assert(signals == NULL);
+}
+
+static gboolean quit_loop(gpointer user_data)
+{
+	g_main_loop_quit(user_data);
+
+	return FALSE;
+}
+
+static void test_flush(void)
+{
+	struct ofono_dbus_batch *batch;
+	GMainLoop *loop;
+
+	batch = __ofono_dbus_batch_new(TEST_PATH, TEST_INTERFACE, 50);
+
+	/* With a window, idle does not flush */
+	set_uint(batch, "Strength", 10);
+	run_pending();
+	g_assert(signals == NULL);
+
+	/* An explicit flush sends at once and cancels the window */
+	__ofono_dbus_batch_flush(batch);
+	g_assert(g_slist_length(signals) == 1);
+	check_uint(0, "Strength", 10);
+	signals_clear();
+
+	loop = g_main_loop_new(NULL, FALSE);
+	g_timeout_add(100, quit_loop, loop);
+	g_main_loop_run(loop);
+	g_assert(signals == NULL);
+
+	/* Otherwise the window runs out */
+	set_uint(batch, "Strength", 20);
+	set_uint(batch, "Strength", 25);
+
+	g_timeout_add(100, quit_loop, loop);
+	g_main_loop_run(loop);
+	g_assert(g_slist_length(signals) == 1);
+	check_uint(0, "Strength", 25);
+	signals_clear();
+
+	/* Changes still pending are sent when the batch goes away */
+	set_uint(batch, "Strength", 30);
+	__ofono_dbus_batch_free(batch);
+	g_assert(g_slist_length(signals) == 1);
+	check_uint(0, "Strength", 30);
+	signals_clear();
+
+	run_pending();
+	g_assert(signals == NULL);
+
+	g_main_loop_unref(loop);
+}
+
+int main(int argc, char **argv)
+{
+	g_test_init(&argc, &argv, NULL);
+
+	g_test_add_func("/testdbusbatch/Coalesce", test_coalesce);
+	g_test_add_func("/testdbusbatch/Order", test_order);
+	g_test_add_func("/testdbusbatch/Forget", test_forget);
+	g_test_add_func("/testdbusbatch/Flush", test_flush);
+
+	return g_test_run();
+}
@@ -0,0 +1,355 @@
+/*
+ *
+ *  oFono - Open Source Telephony
+ *
+ *  Copyright (C) 2008-2010  Intel Corporation. All rights reserved.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <string.h>
+
+#include <glib.h>
+
+#include "gatchat.h"
+
+#include "fake-modem.h"
+
+/* What the fake modem answers to a command, after how long */
+struct answer {
+	const char *command;
+	const char *response;		/* NULL for never */
+	guint delay;
+};
+
+/* Answers from a table, noting when each command came in */
+struct test_modem {
+	struct fake_modem fake;
+	const struct answer *answers;
+	GSList *received;		/* struct received, in order */
+};
+
+struct received {
+	char *command;
+	gdouble time;
+};
+
+struct result {
+	gboolean done;
+	gboolean ok;
+	char *final;
+	gdouble time;
+};
+
+static GMainLoop *event_loop;
+static GTimer *test_timer;
+static guint outstanding;
+
+static void modem_command(struct fake_modem *fake, const char *command,
+				gpointer user_data)
+{
+	struct test_modem *modem = user_data;
+	const struct answer *answer;
+	struct received *received;
+
+	received = g_new0(struct received, 1);
+	received->command = g_strdup(command);
+	received->time = g_timer_elapsed(test_timer, NULL);
+	modem->received = g_slist_append(modem->received, received);
+
+	for (answer = modem->answers; answer->command; answer++) {
+		if (strcmp(answer->command, command))
+			continue;
+
+		if (answer->response)
+			fake_modem_write_later(fake, answer->delay,
+						answer->response);
+
+		return;
+	}
+
+	g_assert_not_reached();
+}
+
+static GAtChat *modem_start(struct test_modem *modem,
+				const struct answer *answers)
+{
+	memset(modem, 0, sizeof(*modem));
+	modem->answers = answers;
+
+	return fake_modem_start_chat(&modem->fake, modem_command, modem);
+}
+
+static void modem_stop(struct test_modem *modem)
+{
+	GSList *l;
+
+	fake_modem_stop(&modem->fake);
+
+	for (l = modem->received; l; l = l->next) {
+		struct received *received = l->data;
+
+		g_free(received->command);
+		g_free(received);
+	}
+
+	g_slist_free(modem->received);
+}
+
+static gdouble received_at(struct test_modem *modem, const char *command)
+{
+	GSList *l;
+
+	for (l = modem->received; l; l = l->next) {
+		struct received *received = l->data;
+
+		if (g_str_equal(received->command, command))
+			return received->time;
+	}
+
+	g_assert_not_reached();
+
+	return 0;
+}
+
+static void result_cb(gboolean ok, GAtResult *result, gpointer user_data)
+{
+	struct result *res = user_data;
+
+	g_assert(res->done == FALSE);
+
+	res->done = TRUE;
+	res->ok = ok;
+	res->final = g_strdup(g_at_result_final_response(result));
+	res->time = g_timer_elapsed(test_timer, NULL);
+
+	outstanding -= 1;
+
+	if (outstanding == 0)
+		g_main_loop_quit(event_loop);
+}
+
+static gboolean give_up(gpointer user_data)
+{
+	g_assert_not_reached();
+
+	return FALSE;
+}
+
+static void run(guint commands)
+{
+	guint source;
+
+	outstanding = commands;
+
+	source = g_timeout_add_seconds(5, give_up, NULL);
+	g_main_loop_run(event_loop);
+	g_source_remove(source);
+}
+
+/* A slow command ahead does not eat into the deadline of the next one */
+static const struct answer slow_answers[] = {
+	{ "AT+CSLOW", "\r\nOK\r\n", 200 },
+	{ "AT+CNEXT", "\r\nOK\r\n", 200 },
+	{ }
+};
+
+static void test_deadline_from_write(void)
+{
+	struct test_modem modem;
+	struct result slow, next;
+	GAtChat *chat;
+
+	memset(&slow, 0, sizeof(slow));
+	memset(&next, 0, sizeof(next));
+
+	chat = modem_start(&modem, slow_answers);
+	g_timer_start(test_timer);
+
+	g_at_chat_send_with_timeout(chat, "AT+CSLOW", NULL, 300,
+					result_cb, &slow, NULL);
+	g_at_chat_send_with_timeout(chat, "AT+CNEXT", NULL, 300,
+					result_cb, &next, NULL);
+	run(2);
+
+	g_assert(slow.ok == TRUE);
+	g_assert(next.ok == TRUE);
+	g_assert(g_str_equal(next.final, "OK"));
+
+	/* More than its timeout after it was queued */
+	g_assert(next.time > 0.3);
+
+	g_free(slow.final);
+	g_free(next.final);
+
+	g_at_chat_unref(chat);
+	modem_stop(&modem);
+}
+
+/* The ERROR meant for the command that timed out must not end the next */
+static const struct answer late_answers[] = {
+	{ "AT+CLATE", "\r\nERROR\r\n", 200 },
+	{ "AT+CNEXT", "\r\nOK\r\n", 0 },
+	{ }
+};
+
+static void test_late_response(void)
+{
+	struct test_modem modem;
+	struct result late, next;
+	GAtChat *chat;
+
+	memset(&late, 0, sizeof(late));
+	memset(&next, 0, sizeof(next));
+
+	chat = modem_start(&modem, late_answers);
+	g_timer_start(test_timer);
+
+	g_at_chat_send_with_timeout(chat, "AT+CLATE", NULL, 100,
+					result_cb, &late, NULL);
+	g_at_chat_send(chat, "AT+CNEXT", NULL, result_cb, &next, NULL);
+	run(2);
+
+	g_assert(late.ok == FALSE);
+	g_assert(g_str_equal(late.final, G_AT_CHAT_TIMEOUT_RESPONSE));
+	g_assert(late.time >= 0.1 && late.time < 0.2);
+
+	/* Written only after the late ERROR, and answered by its own OK */
+	g_assert(received_at(&modem, "AT+CNEXT") >= 0.2);
+	g_assert(next.ok == TRUE);
+	g_assert(g_str_equal(next.final, "OK"));
+
+	g_free(late.final);
+	g_free(next.final);
+
+	g_at_chat_unref(chat);
+	modem_stop(&modem);
+}
+
+/* Nor may its intermediate lines pass for unsolicited ones */
+static const struct answer late_lines_answers[] = {
+	{ "AT+CREG?", "\r\n+CREG: 0,1\r\n\r\nOK\r\n", 150 },
+	{ "AT+CNEXT", "\r\nOK\r\n", 0 },
+	{ }
+};
+
+static void creg_notify(GAtResult *result, gpointer user_data)
+{
+	guint *notified = user_data;
+
+	*notified += 1;
+}
+
+static void test_late_intermediate(void)
+{
+	const char *creg_prefix[] = { "+CREG:", NULL };
+	struct test_modem modem;
+	struct result late, next;
+	guint notified = 0;
+	GAtChat *chat;
+
+	memset(&late, 0, sizeof(late));
+	memset(&next, 0, sizeof(next));
+
+	chat = modem_start(&modem, late_lines_answers);
+	g_timer_start(test_timer);
+
+	g_at_chat_register(chat, "+CREG:", creg_notify, FALSE,
+				&notified, NULL);
+
+	g_at_chat_send_with_timeout(chat, "AT+CREG?", creg_prefix, 100,
+					result_cb, &late, NULL);
+	g_at_chat_send(chat, "AT+CNEXT", NULL, result_cb, &next, NULL);
+	run(2);
+
+	g_assert(late.ok == FALSE);
+	g_assert(g_str_equal(late.final, G_AT_CHAT_TIMEOUT_RESPONSE));
+
+	/* The late +CREG went with the late OK, not to the notifier */
+	g_assert(notified == 0);
+	g_assert(received_at(&modem, "AT+CNEXT") >= 0.15);
+	g_assert(next.ok == TRUE);
+
+	g_free(late.final);
+	g_free(next.final);
+
+	g_at_chat_unref(chat);
+	modem_stop(&modem);
+}
+
+/* Without any answer, the queue moves on after waiting as long again */
+static const struct answer lost_answers[] = {
+	{ "AT+CLOST", NULL, 0 },
+	{ "AT+CNEXT", "\r\nOK\r\n", 0 },
+	{ }
+};
+
+static void test_no_response(void)
+{
+	struct test_modem modem;
+	struct result lost, next;
+	GAtChat *chat;
+
+	memset(&lost, 0, sizeof(lost));
+	memset(&next, 0, sizeof(next));
+
+	chat = modem_start(&modem, lost_answers);
+	g_timer_start(test_timer);
+
+	g_at_chat_send_with_timeout(chat, "AT+CLOST", NULL, 100,
+					result_cb, &lost, NULL);
+	g_at_chat_send(chat, "AT+CNEXT", NULL, result_cb, &next, NULL);
+	run(2);
+
+	g_assert(lost.ok == FALSE);
+	g_assert(g_str_equal(lost.final, G_AT_CHAT_TIMEOUT_RESPONSE));
+
+	g_assert(received_at(&modem, "AT+CNEXT") >= 0.2);
+	g_assert(next.ok == TRUE);
+
+	g_free(lost.final);
+	g_free(next.final);
+
+	g_at_chat_unref(chat);
+	modem_stop(&modem);
+}
+
+int main(int argc, char **argv)
+{
+	int ret;
+
+	g_test_init(&argc, &argv, NULL);
+
+	event_loop = g_main_loop_new(NULL, FALSE);
+	test_timer = g_timer_new();
+
+	g_test_add_func("/testgatchat/DeadlineFromWrite",
+					test_deadline_from_write);
+	g_test_add_func("/testgatchat/LateResponse", test_late_response);
+	g_test_add_func("/testgatchat/LateIntermediate",
+					test_late_intermediate);
+	g_test_add_func("/testgatchat/NoResponse", test_no_response);
+
+	ret = g_test_run();
+
+	g_timer_destroy(test_timer);
+	g_main_loop_unref(event_loop);
+
+	return ret;
+}
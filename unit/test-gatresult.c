@@ -0,0 +1,196 @@
+/*
+ *
+ *  oFono - Open Source Telephony
+ *
+ *  Copyright (C) 2008-2010  Intel Corporation. All rights reserved.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <string.h>
+
+#include <glib.h>
+
+#include "gatresult.h"
+
+static void iter_init(GAtResultIter *iter, GAtResult *result,
+			const char *line)
+{
+	result->lines = g_slist_prepend(NULL, (char *) line);
+	result->final_or_pdu = NULL;
+
+	g_at_result_iter_init(iter, result);
+}
+
+static void check_slice(GAtResultIter *iter, const char *expected)
+{
+	const char *str;
+	unsigned int len;
+
+	g_assert(g_at_result_iter_next_slice(iter, &str, &len));
+
+	if (g_test_verbose())
+		g_print("slice: '%.*s'\n", len, str);
+
+	g_assert(len == strlen(expected));
+	g_assert(memcmp(str, expected, len) == 0);
+}
+
+static void test_slice_fields(void)
+{
+	GAtResult result;
+	GAtResultIter iter;
+	int number;
+
+	iter_init(&iter, &result, "+CPBR: 1,\"+15551234\",145,\"Alice\",,abc");
+
+	g_assert(g_at_result_iter_next(&iter, "+CPBR:"));
+
+	g_assert(g_at_result_iter_next_number(&iter, &number));
+	g_assert(number == 1);
+
+	check_slice(&iter, "+15551234");
+
+	g_assert(g_at_result_iter_next_number(&iter, &number));
+	g_assert(number == 145);
+
+	check_slice(&iter, "Alice");
+
+	/* Empty unquoted field */
+	check_slice(&iter, "");
+
+	/* Last field, unquoted, runs to the end of the line */
+	check_slice(&iter, "abc");
+
+	/* Nothing left */
+	g_assert(!g_at_result_iter_next_slice(&iter, NULL, NULL));
+
+	g_slist_free(result.lines);
+}
+
+static void test_slice_empty_quoted(void)
+{
+	GAtResult result;
+	GAtResultIter iter;
+
+	iter_init(&iter, &result, "+CPBR: \"\",\"x\"");
+
+	g_assert(g_at_result_iter_next(&iter, "+CPBR:"));
+
+	check_slice(&iter, "");
+
+	/* Last field, quoted */
+	check_slice(&iter, "x");
+
+	g_assert(!g_at_result_iter_next_slice(&iter, NULL, NULL));
+
+	g_slist_free(result.lines);
+}
+
+static void test_slice_unterminated(void)
+{
+	GAtResult result;
+	GAtResultIter iter;
+	const char *str = NULL;
+	unsigned int len = 0;
+
+	iter_init(&iter, &result, "+CPBR: \"abc");
+
+	g_assert(g_at_result_iter_next(&iter, "+CPBR:"));
+
+	g_assert(!g_at_result_iter_next_slice(&iter, &str, &len));
+	g_assert(str == NULL);
+	g_assert(len == 0);
+
+	g_slist_free(result.lines);
+}
+
+static void test_slice_list(void)
+{
+	GAtResult result;
+	GAtResultIter iter;
+	int status;
+
+	iter_init(&iter, &result, "+COPS: (2,\"Long\",\"\",\"24405\",2),"
+					"(1,\"\",\"Short\",24491)");
+
+	g_assert(g_at_result_iter_next(&iter, "+COPS:"));
+
+	g_assert(g_at_result_iter_open_list(&iter));
+	g_assert(g_at_result_iter_next_number(&iter, &status));
+	g_assert(status == 2);
+	check_slice(&iter, "Long");
+	check_slice(&iter, "");
+	check_slice(&iter, "24405");
+	check_slice(&iter, "2");
+
+	/* A slice never runs across the end of a list */
+	g_assert(!g_at_result_iter_next_slice(&iter, NULL, NULL));
+	g_assert(g_at_result_iter_close_list(&iter));
+
+	/* Nor into the next one */
+	g_assert(!g_at_result_iter_next_slice(&iter, NULL, NULL));
+
+	g_assert(g_at_result_iter_open_list(&iter));
+	g_assert(g_at_result_iter_next_number(&iter, &status));
+	g_assert(status == 1);
+	check_slice(&iter, "");
+	check_slice(&iter, "Short");
+
+	/* Unquoted, last in the list */
+	check_slice(&iter, "24491");
+	g_assert(g_at_result_iter_close_list(&iter));
+
+	g_slist_free(result.lines);
+}
+
+static void test_slice_no_copy(void)
+{
+	GAtResult result;
+	GAtResultIter iter;
+	const char *line = "+CPBR: \"Alice\"";
+	const char *str;
+	unsigned int len;
+
+	iter_init(&iter, &result, line);
+
+	g_assert(g_at_result_iter_next(&iter, "+CPBR:"));
+	g_assert(g_at_result_iter_next_slice(&iter, &str, &len));
+
+	/* The slice points into the line itself */
+	g_assert(str == line + strlen("+CPBR: \""));
+	g_assert(len == 5);
+
+	g_slist_free(result.lines);
+}
+
+int main(int argc, char **argv)
+{
+	g_test_init(&argc, &argv, NULL);
+
+	g_test_add_func("/testgatresult/SliceFields", test_slice_fields);
+	g_test_add_func("/testgatresult/SliceEmptyQuoted",
+					test_slice_empty_quoted);
+	g_test_add_func("/testgatresult/SliceUnterminated",
+					test_slice_unterminated);
+	g_test_add_func("/testgatresult/SliceList", test_slice_list);
+	g_test_add_func("/testgatresult/SliceNoCopy", test_slice_no_copy);
+
+	return g_test_run();
+}
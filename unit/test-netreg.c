@@ -0,0 +1,510 @@
+/*
+ *
+ *  oFono - Open Source Telephony
+ *
+ *  Copyright (C) 2008-2010  Intel Corporation. All rights reserved.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include <glib.h>
+#include <gdbus.h>
+
+#include "ofono.h"
+
+#include "gatchat.h"
+#include "gatserver.h"
+#include "simulator.h"
+
+#include "drivers/atmodem/atmodem.h"
+#include "drivers/atmodem/vendor.h"
+
+/*
+ * The current operator caching of src/network.c is run against the
+ * atmodem driver, talking to a simulated modem which replays the
+ * registration changes of a phone on the move.  The rest of the core
+ * is stubbed out below.
+ */
+struct ofono_atom {
+	void *data;
+	void (*destruct)(struct ofono_atom *atom);
+	void (*unregister)(struct ofono_atom *atom);
+};
+
+static char *operator_name;
+
+struct ofono_atom *__ofono_modem_add_atom(struct ofono_modem *modem,
+					enum ofono_atom_type type,
+					void (*destruct)(struct ofono_atom *),
+					void *data)
+{
+	struct ofono_atom *atom = g_new0(struct ofono_atom, 1);
+
+	atom->data = data;
+	atom->destruct = destruct;
+
+	return atom;
+}
+
+void __ofono_atom_free(struct ofono_atom *atom)
+{
+	if (atom->unregister)
+		atom->unregister(atom);
+
+	atom->destruct(atom);
+	g_free(atom);
+}
+
+void *__ofono_atom_get_data(struct ofono_atom *atom)
+{
+	return atom->data;
+}
+
+struct ofono_modem *__ofono_atom_get_modem(struct ofono_atom *atom)
+{
+	return NULL;
+}
+
+const char *__ofono_atom_get_path(struct ofono_atom *atom)
+{
+	return "/test";
+}
+
+void __ofono_atom_register(struct ofono_atom *atom,
+				void (*unregister)(struct ofono_atom *))
+{
+	atom->unregister = unregister;
+}
+
+struct ofono_atom *__ofono_modem_find_atom(struct ofono_modem *modem,
+						enum ofono_atom_type type)
+{
+	return NULL;
+}
+
+void ofono_modem_add_interface(struct ofono_modem *modem,
+				const char *interface)
+{
+}
+
+void ofono_modem_remove_interface(struct ofono_modem *modem,
+					const char *interface)
+{
+}
+
+int ofono_modem_get_integer(struct ofono_modem *modem, const char *key)
+{
+	return 0;
+}
+
+const char *ofono_sim_get_imsi(struct ofono_sim *sim)
+{
+	return NULL;
+}
+
+int ofono_sim_read(struct ofono_sim *sim, int id,
+			enum ofono_sim_file_structure expected_type,
+			ofono_sim_file_read_cb_t cb, void *data)
+{
+	return -1;
+}
+
+void __ofono_nettime_info_received(struct ofono_modem *modem,
+					struct ofono_network_time *info)
+{
+}
+
+struct ofono_dbus_batch *__ofono_dbus_batch_new(const char *path,
+						const char *interface,
+						unsigned int window)
+{
+	return (struct ofono_dbus_batch *) &operator_name;
+}
+
+void __ofono_dbus_batch_property_changed(struct ofono_dbus_batch *batch,
+						const char *name,
+						int type, void *value)
+{
+	if (!g_str_equal(name, "Name"))
+		return;
+
+	g_free(operator_name);
+	operator_name = g_strdup(*(const char **) value);
+}
+
+void __ofono_dbus_batch_property_forget(struct ofono_dbus_batch *batch,
+						const char *name)
+{
+}
+
+void __ofono_dbus_batch_flush(struct ofono_dbus_batch *batch)
+{
+}
+
+void __ofono_dbus_batch_free(struct ofono_dbus_batch *batch)
+{
+}
+
+DBusConnection *ofono_dbus_get_connection()
+{
+	return NULL;
+}
+
+void ofono_dbus_dict_append(DBusMessageIter *dict, const char *key, int type,
+				void *value)
+{
+}
+
+void ofono_dbus_dict_append_array(DBusMessageIter *dict, const char *key,
+					int type, void *val)
+{
+}
+
+int ofono_dbus_signal_property_changed(DBusConnection *conn, const char *path,
+					const char *interface, const char *name,
+					int type, void *value)
+{
+	return 0;
+}
+
+int ofono_dbus_signal_array_property_changed(DBusConnection *conn,
+						const char *path,
+						const char *interface,
+						const char *name, int type,
+						void *value)
+{
+	return 0;
+}
+
+void __ofono_dbus_pending_reply(DBusMessage **msg, DBusMessage *reply)
+{
+}
+
+DBusMessage *__ofono_error_busy(DBusMessage *msg)
+{
+	return NULL;
+}
+
+DBusMessage *__ofono_error_failed(DBusMessage *msg)
+{
+	return NULL;
+}
+
+DBusMessage *__ofono_error_not_implemented(DBusMessage *msg)
+{
+	return NULL;
+}
+
+gboolean g_dbus_register_interface(DBusConnection *connection,
+					const char *path, const char *name,
+					const GDBusMethodTable *methods,
+					const GDBusSignalTable *signals,
+					const GDBusPropertyTable *properties,
+					void *user_data,
+					GDBusDestroyFunction destroy)
+{
+	return TRUE;
+}
+
+gboolean g_dbus_unregister_interface(DBusConnection *connection,
+					const char *path, const char *name)
+{
+	return TRUE;
+}
+
+gboolean g_dbus_send_message(DBusConnection *connection, DBusMessage *message)
+{
+	return FALSE;
+}
+
+void ofono_trace_dump_register(ofono_trace_dump_func func, void *user_data)
+{
+}
+
+void ofono_trace_dump_unregister(ofono_trace_dump_func func)
+{
+}
+
+void ofono_debug(const char *format, ...)
+{
+}
+
+void ofono_info(const char *format, ...)
+{
+}
+
+void ofono_error(const char *format, ...)
+{
+}
+
+/* The chat and the simulated modem talk over a socket pair */
+struct link {
+	GAtChat *chat;
+	GAtServer *server;
+	struct at_simulator *sim;
+	GMainLoop *loop;
+	unsigned int urcs;		/* Replayed before we are done */
+	unsigned int outstanding;	/* Commands not answered yet */
+	unsigned int queries;		/* AT+COPS? sent */
+};
+
+static void link_trace(GAtTraceEvent event, guint chat, const char *prefix,
+			guint usec, gpointer user_data)
+{
+	struct link *link = user_data;
+
+	switch (event) {
+	case G_AT_TRACE_COMMAND:
+		link->outstanding += 1;
+
+		/* Each query is an AT+COPS=3,0 and an AT+COPS? */
+		if (g_str_equal(prefix, "+COPS"))
+			link->queries += 1;
+		break;
+	case G_AT_TRACE_RESPONSE:
+		link->outstanding -= 1;
+		break;
+	default:
+		break;
+	}
+}
+
+static void link_open(struct link *link, const char *script,
+			unsigned int urcs)
+{
+	GKeyFile *keyfile;
+	GIOChannel *io;
+	GAtSyntax *syntax;
+	int sv[2];
+
+	memset(link, 0, sizeof(*link));
+	link->urcs = urcs;
+
+	keyfile = g_key_file_new();
+	g_assert(g_key_file_load_from_data(keyfile, script, strlen(script),
+						G_KEY_FILE_NONE, NULL));
+
+	g_assert(socketpair(AF_UNIX, SOCK_STREAM, 0, sv) == 0);
+
+	io = g_io_channel_unix_new(sv[0]);
+	g_io_channel_set_close_on_unref(io, TRUE);
+	link->server = g_at_server_new(io);
+	g_io_channel_unref(io);
+
+	io = g_io_channel_unix_new(sv[1]);
+	g_io_channel_set_close_on_unref(io, TRUE);
+	syntax = g_at_syntax_new_gsmv1();
+	link->chat = g_at_chat_new(io, syntax);
+	g_at_syntax_unref(syntax);
+	g_io_channel_unref(io);
+
+	link->sim = at_simulator_new(link->server, keyfile, NULL);
+	g_assert(link->sim != NULL);
+	g_key_file_free(keyfile);
+
+	link->loop = g_main_loop_new(NULL, FALSE);
+
+	g_at_chat_set_trace_func(link_trace, link);
+}
+
+static void link_close(struct link *link)
+{
+	g_at_chat_set_trace_func(NULL, NULL);
+
+	at_simulator_free(link->sim);
+	g_at_chat_unref(link->chat);
+	g_at_server_unref(link->server);
+	g_main_loop_unref(link->loop);
+}
+
+static gboolean link_check_done(gpointer user_data)
+{
+	struct link *link = user_data;
+
+	if (at_simulator_get_unsolicited(link->sim) < link->urcs)
+		return TRUE;
+
+	if (link->outstanding > 0)
+		return TRUE;
+
+	g_main_loop_quit(link->loop);
+
+	return FALSE;
+}
+
+static gboolean give_up(gpointer user_data)
+{
+	g_assert_not_reached();
+
+	return FALSE;
+}
+
+/* Registers, replays all the registration changes and settles down */
+static struct ofono_netreg *replay(struct link *link)
+{
+	struct ofono_netreg *netreg;
+	guint source;
+
+	at_netreg_init();
+
+	netreg = ofono_netreg_create(NULL, OFONO_VENDOR_NOKIA, "atmodem",
+					link->chat);
+	g_assert(netreg != NULL);
+
+	source = g_timeout_add(10000, give_up, NULL);
+	g_timeout_add(10, link_check_done, link);
+
+	g_main_loop_run(link->loop);
+	g_source_remove(source);
+
+	return netreg;
+}
+
+static void replay_done(struct ofono_netreg *netreg)
+{
+	ofono_netreg_remove(netreg);
+	at_netreg_exit();
+
+	g_free(operator_name);
+	operator_name = NULL;
+}
+
+#define MODEM_SCRIPT \
+	"[AT+CREG=?]\n" \
+	"Response=+CREG: (0-2)\n" \
+	"[AT+CREG=]\n" \
+	"[AT+CREG?]\n" \
+	"Response=+CREG: 2,1,\"0001\",\"00000001\",0\n" \
+	"[AT+COPS=3,0]\n" \
+	"[AT+CSQ]\n" \
+	"Response=+CSQ: 20,99\n"
+
+static const char cells_script[] = MODEM_SCRIPT
+	"[AT+COPS?]\n"
+	"Response=+COPS: 0,0,\"Simulated\",0\n"
+	"[URC cells]\n"
+	"Line=+CREG: 1,\"0001\",\"00000002\",0\\n"
+	"+CREG: 1,\"0001\",\"00000003\",0\\n"
+	"+CREG: 1,\"0001\",\"00000001\",0\n"
+	"Count=30\n"
+	"After=AT+CSQ\n"
+	"Start=20\n"
+	"Interval=1-5\n";
+
+static void test_cells(void)
+{
+	struct link link;
+	struct ofono_netreg *netreg;
+
+	link_open(&link, cells_script, 30);
+	netreg = replay(&link);
+
+	/* Only the query on registration, none for the cell changes */
+	g_assert(link.queries == 2);
+	g_assert(g_str_equal(operator_name, "Simulated"));
+
+	replay_done(netreg);
+	link_close(&link);
+}
+
+/*
+ * Along the way the phone moves into another location area on the same
+ * access technology, is handed over to UMTS in yet another one, roams,
+ * loses coverage and finds the network again.
+ */
+static const char mobility_script[] = MODEM_SCRIPT
+	"[AT+COPS?]\n"
+	"Response=+COPS: 0,0,\"Simulated\",2\n"
+	"[URC mobility]\n"
+	"Line=+CREG: 1,\"0001\",\"00000002\",0\\n"
+	"+CREG: 1,\"0002\",\"00000010\",0\\n"
+	"+CREG: 1,\"0003\",\"00000020\",2\\n"
+	"+CREG: 1,\"0003\",\"00000021\",2\\n"
+	"+CREG: 5,\"0003\",\"00000021\",2\\n"
+	"+CREG: 0\\n"
+	"+CREG: 5,\"0003\",\"00000021\",2\\n"
+	"+CREG: 5,\"0003\",\"00000022\",2\n"
+	"Count=8\n"
+	"After=AT+CSQ\n"
+	"Start=20\n"
+	"Interval=20\n";
+
+static void test_mobility(void)
+{
+	struct link link;
+	struct ofono_netreg *netreg;
+
+	link_open(&link, mobility_script, 8);
+	netreg = replay(&link);
+
+	if (g_test_verbose())
+		g_print("%u operator queries\n", link.queries / 2);
+
+	/* Registration, handover, roaming and back in coverage */
+	g_assert(link.queries == 4 * 2);
+	g_assert(g_str_equal(operator_name, "Simulated"));
+
+	replay_done(netreg);
+	link_close(&link);
+}
+
+/* The status flaps while the modem takes its time to answer +COPS? */
+static const char in_flight_script[] = MODEM_SCRIPT
+	"[AT+COPS?]\n"
+	"Response=+COPS: 0,0,\"Simulated\",0\n"
+	"Latency=100\n"
+	"[URC flapping]\n"
+	"Line=+CREG: 5,\"0001\",\"00000001\",0\\n"
+	"+CREG: 1,\"0001\",\"00000001\",0\n"
+	"Count=4\n"
+	"After=AT+CSQ\n"
+	"Start=150\n"
+	"Interval=5\n";
+
+static void test_in_flight(void)
+{
+	struct link link;
+	struct ofono_netreg *netreg;
+
+	link_open(&link, in_flight_script, 4);
+	netreg = replay(&link);
+
+	/* Registration, then one more for all the changes in flight */
+	g_assert(link.queries == 3 * 2);
+
+	replay_done(netreg);
+	link_close(&link);
+}
+
+int main(int argc, char **argv)
+{
+	g_test_init(&argc, &argv, NULL);
+
+	g_test_add_func("/testnetreg/Cell changes", test_cells);
+	g_test_add_func("/testnetreg/Mobility replay", test_mobility);
+	g_test_add_func("/testnetreg/Query in flight", test_in_flight);
+
+	return g_test_run();
+}
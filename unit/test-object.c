@@ -0,0 +1,503 @@
+/*
+ *
+ *  oFono - Open Source Telephony
+ *
+ *  Copyright (C) 2008-2010  Intel Corporation. All rights reserved.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+
+#include <glib.h>
+#include <gdbus.h>
+
+/*
+ * The object tree of the connection is kept here instead of in libdbus,
+ * so that interfaces can be registered without a bus.
+ */
+static int fake_connection;
+#define CONNECTION ((DBusConnection *) &fake_connection)
+
+static GHashTable *object_paths;
+static const DBusObjectPathVTable *object_vtable;
+
+dbus_bool_t dbus_connection_register_object_path(DBusConnection *connection,
+					const char *path,
+					const DBusObjectPathVTable *vtable,
+					void *user_data)
+{
+	if (g_hash_table_lookup(object_paths, path))
+		return FALSE;
+
+	g_hash_table_insert(object_paths, g_strdup(path), user_data);
+	object_vtable = vtable;
+
+	return TRUE;
+}
+
+dbus_bool_t dbus_connection_unregister_object_path(DBusConnection *connection,
+							const char *path)
+{
+	void *data = g_hash_table_lookup(object_paths, path);
+
+	g_assert(data != NULL);
+	g_hash_table_remove(object_paths, path);
+
+	object_vtable->unregister_function(connection, data);
+
+	return TRUE;
+}
+
+dbus_bool_t dbus_connection_get_object_path_data(DBusConnection *connection,
+							const char *path,
+							void **data_p)
+{
+	*data_p = g_hash_table_lookup(object_paths, path);
+
+	return TRUE;
+}
+
+dbus_bool_t dbus_connection_list_registered(DBusConnection *connection,
+						const char *parent_path,
+						char ***child_entries)
+{
+	GHashTableIter iter;
+	GPtrArray *children;
+	char *prefix;
+	gpointer key;
+	unsigned int i;
+
+	if (g_str_equal(parent_path, "/"))
+		prefix = g_strdup("/");
+	else
+		prefix = g_strdup_printf("%s/", parent_path);
+
+	children = g_ptr_array_new();
+
+	g_hash_table_iter_init(&iter, object_paths);
+
+	while (g_hash_table_iter_next(&iter, &key, NULL)) {
+		const char *path = key;
+		char *child;
+
+		if (!g_str_has_prefix(path, prefix) ||
+				strlen(path) == strlen(prefix))
+			continue;
+
+		child = g_strdup(path + strlen(prefix));
+		if (strchr(child, '/'))
+			*strchr(child, '/') = '\0';
+
+		for (i = 0; i < children->len; i++)
+			if (g_str_equal(children->pdata[i], child))
+				break;
+
+		if (i < children->len) {
+			g_free(child);
+			continue;
+		}
+
+		g_ptr_array_add(children, child);
+	}
+
+	g_free(prefix);
+
+	/* The caller releases the array with dbus_free_string_array */
+	*child_entries = dbus_new0(char *, children->len + 1);
+
+	for (i = 0; i < children->len; i++) {
+		const char *child = children->pdata[i];
+
+		(*child_entries)[i] = dbus_malloc(strlen(child) + 1);
+		strcpy((*child_entries)[i], child);
+	}
+
+	g_ptr_array_foreach(children, (GFunc) g_free, NULL);
+	g_ptr_array_free(children, TRUE);
+
+	return TRUE;
+}
+
+static void append_variant(DBusMessageIter *dict, const char *key,
+				int type, void *value)
+{
+	DBusMessageIter entry, variant;
+	char sig[2] = { type, '\0' };
+
+	dbus_message_iter_open_container(dict, DBUS_TYPE_DICT_ENTRY,
+							NULL, &entry);
+	dbus_message_iter_append_basic(&entry, DBUS_TYPE_STRING, &key);
+	dbus_message_iter_open_container(&entry, DBUS_TYPE_VARIANT, sig,
+							&variant);
+	dbus_message_iter_append_basic(&variant, type, value);
+	dbus_message_iter_close_container(&entry, &variant);
+	dbus_message_iter_close_container(dict, &entry);
+}
+
+static DBusMessage *modem_get_properties(DBusConnection *conn,
+						DBusMessage *msg, void *data)
+{
+	DBusMessage *reply;
+	DBusMessageIter iter, dict, entry, variant, array;
+	dbus_bool_t powered = TRUE;
+	const char *key = "Interfaces";
+	const char *ifaces[] = { "org.ofono.SimManager",
+					"org.ofono.ConnectionManager" };
+	unsigned int i;
+
+	reply = dbus_message_new_method_return(msg);
+	dbus_message_iter_init_append(reply, &iter);
+	dbus_message_iter_open_container(&iter, DBUS_TYPE_ARRAY, "{sv}",
+								&dict);
+
+	append_variant(&dict, "Powered", DBUS_TYPE_BOOLEAN, &powered);
+	append_variant(&dict, "Name", DBUS_TYPE_STRING, &data);
+
+	dbus_message_iter_open_container(&dict, DBUS_TYPE_DICT_ENTRY,
+							NULL, &entry);
+	dbus_message_iter_append_basic(&entry, DBUS_TYPE_STRING, &key);
+	dbus_message_iter_open_container(&entry, DBUS_TYPE_VARIANT, "as",
+							&variant);
+	dbus_message_iter_open_container(&variant, DBUS_TYPE_ARRAY, "s",
+							&array);
+
+	for (i = 0; i < G_N_ELEMENTS(ifaces); i++)
+		dbus_message_iter_append_basic(&array, DBUS_TYPE_STRING,
+						&ifaces[i]);
+
+	dbus_message_iter_close_container(&variant, &array);
+	dbus_message_iter_close_container(&entry, &variant);
+	dbus_message_iter_close_container(&dict, &entry);
+
+	dbus_message_iter_close_container(&iter, &dict);
+
+	return reply;
+}
+
+static DBusMessage *context_get_properties(DBusConnection *conn,
+						DBusMessage *msg, void *data)
+{
+	DBusMessage *reply;
+	DBusMessageIter iter, dict, entry, variant, settings;
+	const char *key = "Settings";
+	const char *address = "10.0.0.2";
+	dbus_uint16_t mtu = 1400;
+
+	reply = dbus_message_new_method_return(msg);
+	dbus_message_iter_init_append(reply, &iter);
+	dbus_message_iter_open_container(&iter, DBUS_TYPE_ARRAY, "{sv}",
+								&dict);
+
+	dbus_message_iter_open_container(&dict, DBUS_TYPE_DICT_ENTRY,
+							NULL, &entry);
+	dbus_message_iter_append_basic(&entry, DBUS_TYPE_STRING, &key);
+	dbus_message_iter_open_container(&entry, DBUS_TYPE_VARIANT, "a{sv}",
+							&variant);
+	dbus_message_iter_open_container(&variant, DBUS_TYPE_ARRAY, "{sv}",
+							&settings);
+	append_variant(&settings, "Address", DBUS_TYPE_STRING, &address);
+	append_variant(&settings, "Mtu", DBUS_TYPE_UINT16, &mtu);
+	dbus_message_iter_close_container(&variant, &settings);
+	dbus_message_iter_close_container(&entry, &variant);
+	dbus_message_iter_close_container(&dict, &entry);
+
+	dbus_message_iter_close_container(&iter, &dict);
+
+	return reply;
+}
+
+static int async_calls;
+
+static DBusMessage *async_get_properties(DBusConnection *conn,
+						DBusMessage *msg, void *data)
+{
+	async_calls += 1;
+
+	return NULL;
+}
+
+static GDBusMethodTable modem_methods[] = {
+	{ "GetProperties",	"",	"a{sv}",	modem_get_properties },
+	{ }
+};
+
+static GDBusMethodTable context_methods[] = {
+	{ "GetProperties",	"",	"a{sv}",
+						context_get_properties },
+	{ }
+};
+
+static GDBusMethodTable async_methods[] = {
+	{ "GetProperties",	"",	"a{sv}",	async_get_properties,
+						G_DBUS_METHOD_FLAG_ASYNC },
+	{ }
+};
+
+static DBusMessage *snapshot(void)
+{
+	DBusMessage *msg;
+	DBusMessageIter iter, array;
+
+	msg = dbus_message_new(DBUS_MESSAGE_TYPE_METHOD_RETURN);
+	dbus_message_iter_init_append(msg, &iter);
+	dbus_message_iter_open_container(&iter, DBUS_TYPE_ARRAY,
+						"{oa{sa{sv}}}", &array);
+	g_dbus_append_objects(CONNECTION, "/", &array);
+	dbus_message_iter_close_container(&iter, &array);
+
+	return msg;
+}
+
+/* Returns the number of objects and checks what is known of each */
+static unsigned int check_snapshot(DBusMessage *msg)
+{
+	DBusMessageIter iter, objects;
+	unsigned int count = 0;
+
+	g_assert(dbus_message_has_signature(msg, "a{oa{sa{sv}}}"));
+
+	dbus_message_iter_init(msg, &iter);
+	dbus_message_iter_recurse(&iter, &objects);
+
+	while (dbus_message_iter_get_arg_type(&objects) ==
+						DBUS_TYPE_DICT_ENTRY) {
+		DBusMessageIter object, ifaces;
+		const char *path;
+
+		dbus_message_iter_recurse(&objects, &object);
+		dbus_message_iter_get_basic(&object, &path);
+		dbus_message_iter_next(&object);
+		dbus_message_iter_recurse(&object, &ifaces);
+
+		while (dbus_message_iter_get_arg_type(&ifaces) ==
+						DBUS_TYPE_DICT_ENTRY) {
+			DBusMessageIter iface, props;
+			const char *name;
+			int n = 0;
+
+			dbus_message_iter_recurse(&ifaces, &iface);
+			dbus_message_iter_get_basic(&iface, &name);
+			dbus_message_iter_next(&iface);
+			dbus_message_iter_recurse(&iface, &props);
+
+			while (dbus_message_iter_get_arg_type(&props) ==
+							DBUS_TYPE_DICT_ENTRY) {
+				n += 1;
+				dbus_message_iter_next(&props);
+			}
+
+			if (g_test_verbose())
+				g_print("%s %s: %d properties\n",
+						path, name, n);
+
+			g_assert(!g_str_equal(name,
+					DBUS_INTERFACE_INTROSPECTABLE));
+
+			if (g_str_equal(name, "org.ofono.Modem"))
+				g_assert(n == 3);
+			else if (g_str_equal(name,
+					"org.ofono.ConnectionContext"))
+				g_assert(n == 1);
+			else
+				g_assert(n == 0);
+
+			dbus_message_iter_next(&ifaces);
+		}
+
+		count += 1;
+		dbus_message_iter_next(&objects);
+	}
+
+	return count;
+}
+
+static GSList *changes;
+
+static void interface_changed(DBusConnection *conn, const char *path,
+				const char *interface, gboolean registered,
+				void *user_data)
+{
+	char *change = g_strdup_printf("%c%s %s", registered ? '+' : '-',
+						path, interface);
+
+	changes = g_slist_append(changes, change);
+}
+
+static void test_snapshot(void)
+{
+	DBusMessage *msg;
+	DBusMessageIter iter, objects, object, ifaces, iface, props;
+	DBusMessageIter entry, variant, settings;
+	const char *str;
+	dbus_uint16_t mtu;
+
+	g_dbus_set_interface_function(interface_changed, NULL);
+
+	g_assert(g_dbus_register_interface(CONNECTION, "/phonesim",
+					"org.ofono.Modem", modem_methods,
+					NULL, NULL, "phonesim", NULL));
+	g_assert(g_dbus_register_interface(CONNECTION, "/phonesim",
+					"org.ofono.CallForwarding",
+					async_methods, NULL, NULL, NULL, NULL));
+	g_assert(g_dbus_register_interface(CONNECTION,
+					"/phonesim/context1",
+					"org.ofono.ConnectionContext",
+					context_methods, NULL, NULL,
+					NULL, NULL));
+
+	g_assert(g_slist_length(changes) == 3);
+	g_assert(g_str_equal(changes->data, "+/phonesim org.ofono.Modem"));
+
+	msg = snapshot();
+	g_assert(check_snapshot(msg) == 2);
+
+	/* Asynchronous getters would go to the network, they are skipped */
+	g_assert(async_calls == 0);
+
+	/* Nested containers in the properties come through intact */
+	dbus_message_iter_init(msg, &iter);
+	dbus_message_iter_recurse(&iter, &objects);
+
+	do {
+		dbus_message_iter_recurse(&objects, &object);
+		dbus_message_iter_get_basic(&object, &str);
+	} while (!g_str_equal(str, "/phonesim/context1") &&
+				dbus_message_iter_next(&objects));
+
+	g_assert(g_str_equal(str, "/phonesim/context1"));
+
+	dbus_message_iter_next(&object);
+	dbus_message_iter_recurse(&object, &ifaces);
+	dbus_message_iter_recurse(&ifaces, &iface);
+	dbus_message_iter_next(&iface);
+	dbus_message_iter_recurse(&iface, &props);
+	dbus_message_iter_recurse(&props, &entry);
+	dbus_message_iter_get_basic(&entry, &str);
+	g_assert(g_str_equal(str, "Settings"));
+	dbus_message_iter_next(&entry);
+	dbus_message_iter_recurse(&entry, &variant);
+	dbus_message_iter_recurse(&variant, &settings);
+	dbus_message_iter_next(&settings);
+	dbus_message_iter_recurse(&settings, &entry);
+	dbus_message_iter_get_basic(&entry, &str);
+	g_assert(g_str_equal(str, "Mtu"));
+	dbus_message_iter_next(&entry);
+	dbus_message_iter_recurse(&entry, &variant);
+	g_assert(dbus_message_iter_get_arg_type(&variant) ==
+							DBUS_TYPE_UINT16);
+	dbus_message_iter_get_basic(&variant, &mtu);
+	g_assert(mtu == 1400);
+
+	dbus_message_unref(msg);
+
+	g_assert(g_dbus_unregister_interface(CONNECTION, "/phonesim/context1",
+					"org.ofono.ConnectionContext"));
+	g_assert(g_dbus_unregister_interface(CONNECTION, "/phonesim",
+					"org.ofono.CallForwarding"));
+	g_assert(g_dbus_unregister_interface(CONNECTION, "/phonesim",
+					"org.ofono.Modem"));
+
+	g_assert(g_slist_length(changes) == 6);
+	g_assert(g_str_equal(g_slist_last(changes)->data,
+					"-/phonesim org.ofono.Modem"));
+
+	msg = snapshot();
+	g_assert(check_snapshot(msg) == 0);
+	dbus_message_unref(msg);
+
+	g_assert(g_hash_table_size(object_paths) == 0);
+
+	g_dbus_set_interface_function(NULL, NULL);
+
+	g_slist_foreach(changes, (GFunc) g_free, NULL);
+	g_slist_free(changes);
+	changes = NULL;
+}
+
+/*
+ * A client learning the state of many modems makes one call instead of
+ * one GetProperties per interface of every object.
+ */
+static void test_snapshot_many(void)
+{
+	DBusMessage *msg;
+	unsigned int i;
+	char path[32];
+	GTimer *timer;
+
+	for (i = 0; i < 64; i++) {
+		snprintf(path, sizeof(path), "/modem%u", i);
+		g_dbus_register_interface(CONNECTION, path, "org.ofono.Modem",
+						modem_methods, NULL, NULL,
+						"modem", NULL);
+
+		snprintf(path, sizeof(path), "/modem%u/context1", i);
+		g_dbus_register_interface(CONNECTION, path,
+						"org.ofono.ConnectionContext",
+						context_methods, NULL, NULL,
+						NULL, NULL);
+	}
+
+	timer = g_timer_new();
+	msg = snapshot();
+	g_timer_stop(timer);
+
+	g_assert(check_snapshot(msg) == 128);
+
+	if (g_test_verbose())
+		g_print("128 objects in one reply, %.2f ms\n",
+				g_timer_elapsed(timer, NULL) * 1000);
+
+	dbus_message_unref(msg);
+	g_timer_destroy(timer);
+
+	for (i = 0; i < 64; i++) {
+		snprintf(path, sizeof(path), "/modem%u/context1", i);
+		g_dbus_unregister_interface(CONNECTION, path,
+						"org.ofono.ConnectionContext");
+
+		snprintf(path, sizeof(path), "/modem%u", i);
+		g_dbus_unregister_interface(CONNECTION, path,
+						"org.ofono.Modem");
+	}
+
+	g_assert(g_hash_table_size(object_paths) == 0);
+}
+
+int main(int argc, char **argv)
+{
+	int ret;
+
+	g_test_init(&argc, &argv, NULL);
+
+	object_paths = g_hash_table_new_full(g_str_hash, g_str_equal,
+							g_free, NULL);
+
+	g_test_add_func("/testobject/Snapshot", test_snapshot);
+	g_test_add_func("/testobject/Snapshot of many modems",
+				test_snapshot_many);
+
+	ret = g_test_run();
+
+	g_hash_table_destroy(object_paths);
+
+	return ret;
+}
@@ -0,0 +1,508 @@
+/*
+ *
+ *  oFono - Open Source Telephony
+ *
+ *  Copyright (C) 2008-2010  Intel Corporation. All rights reserved.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <glib.h>
+
+#include "gatchat.h"
+#include "gatmux.h"
+#include "gsm0710.h"
+#include "gatcapture.h"
+#include "gatreplay.h"
+
+#include "fake-modem.h"
+
+/*
+ * A session is first run against a fake modem with a capture, then the
+ * capture is replayed and the host must see exactly the same thing.
+ */
+struct exchange {
+	const char *command;
+	const char *prefix;
+	const char *response;
+	guint delay;
+};
+
+static const struct exchange session[] = {
+	{ "ATE0", NULL, "\r\nOK\r\n", 0 },
+	{ "AT+CGMI", "", "\r\nModems Inc\r\n\r\nOK\r\n", 30 },
+	{ "AT+CREG?", "+CREG:",
+		"\r\n+CREG: 0,1\r\n\r\nOK\r\n\r\n+CRING: VOICE\r\n", 10 },
+	{ "AT+COPS?", "+COPS:", "\r\n+COPS: 0,0,\"Test\"\r\n\r\nOK\r\n", 50 },
+	{ "AT+CFUN=7", NULL, "\r\n+CME ERROR: 4\r\n", 0 },
+};
+
+#define SESSION_DELAY 90
+
+/* In mux mode, the modem answers in frames on the DLC it last heard */
+struct test_modem {
+	struct fake_modem fake;
+	GString *frames;
+	guint8 dlc;
+};
+
+static void modem_command(struct fake_modem *fake, const char *command,
+				gpointer user_data)
+{
+	unsigned int i;
+
+	for (i = 0; i < G_N_ELEMENTS(session); i++) {
+		if (strcmp(session[i].command, command))
+			continue;
+
+		fake_modem_write_later(fake, session[i].delay,
+					session[i].response);
+	}
+}
+
+static void modem_mux_receive(struct fake_modem *fake, const char *data,
+				gsize len, gpointer user_data)
+{
+	struct test_modem *modem = user_data;
+	guint8 *frame_data;
+	guint8 dlc, type;
+	int frame_len, nread;
+
+	g_string_append_len(modem->frames, data, len);
+
+	while ((nread = gsm0710_basic_extract_frame(
+				(guint8 *) modem->frames->str,
+				modem->frames->len, &dlc, &type,
+				&frame_data, &frame_len)) > 0) {
+		/* Only the data matters, the DLCs are never refused */
+		if (frame_data && dlc > 0 &&
+				(type & 0xEF) == GSM0710_DATA) {
+			modem->dlc = dlc;
+			fake_modem_feed(fake, (char *) frame_data, frame_len);
+		}
+
+		g_string_erase(modem->frames, 0, nread);
+	}
+}
+
+static void modem_mux_send(struct fake_modem *fake, const char *data,
+				gsize len, gpointer user_data)
+{
+	struct test_modem *modem = user_data;
+	guint8 frame[128];
+	int frame_len;
+
+	frame_len = gsm0710_basic_fill_frame(frame, modem->dlc, GSM0710_DATA,
+						(const guint8 *) data, len);
+
+	fake_modem_send(fake, (const char *) frame, frame_len);
+}
+
+static GIOChannel *modem_start(struct test_modem *modem, gboolean mux)
+{
+	GIOChannel *io;
+
+	io = fake_modem_start(&modem->fake, modem_command, modem);
+
+	modem->frames = g_string_new(NULL);
+	modem->dlc = 0;
+
+	if (mux) {
+		modem->fake.receive = modem_mux_receive;
+		modem->fake.send = modem_mux_send;
+	}
+
+	return io;
+}
+
+static void modem_stop(struct test_modem *modem)
+{
+	fake_modem_stop(&modem->fake);
+	g_string_free(modem->frames, TRUE);
+}
+
+struct host {
+	GMainLoop *loop;
+	GString *transcript;
+	unsigned int answered;
+};
+
+static void host_response(gboolean ok, GAtResult *result, gpointer user_data)
+{
+	struct host *host = user_data;
+	GAtResultIter iter;
+
+	g_at_result_iter_init(&iter, result);
+
+	while (g_at_result_iter_next(&iter, NULL))
+		g_string_append_printf(host->transcript, "%s|",
+					g_at_result_iter_raw_line(&iter));
+
+	g_string_append_printf(host->transcript, "%s\n",
+				g_at_result_final_response(result));
+
+	host->answered += 1;
+
+	if (host->answered == G_N_ELEMENTS(session))
+		g_main_loop_quit(host->loop);
+}
+
+static void host_ring(GAtResult *result, gpointer user_data)
+{
+	struct host *host = user_data;
+
+	g_string_append(host->transcript, "RING\n");
+}
+
+/* Returns the transcript of the session as seen by the host */
+static char *run_session(GAtChat *chat, double *elapsed)
+{
+	struct host host;
+	GTimer *timer;
+	unsigned int i;
+
+	host.loop = g_main_loop_new(NULL, FALSE);
+	host.transcript = g_string_new(NULL);
+	host.answered = 0;
+
+	g_at_chat_register(chat, "+CRING:", host_ring, FALSE, &host, NULL);
+
+	for (i = 0; i < G_N_ELEMENTS(session); i++) {
+		const char *prefixes[] = { session[i].prefix, NULL };
+
+		g_at_chat_send(chat, session[i].command, prefixes,
+				host_response, &host, NULL);
+	}
+
+	timer = g_timer_new();
+	g_main_loop_run(host.loop);
+
+	if (elapsed)
+		*elapsed = g_timer_elapsed(timer, NULL);
+
+	g_timer_destroy(timer);
+	g_main_loop_unref(host.loop);
+
+	g_at_chat_unregister_all(chat);
+
+	return g_string_free(host.transcript, FALSE);
+}
+
+static GAtChat *chat_new(GIOChannel *io)
+{
+	GAtSyntax *syntax;
+	GAtChat *chat;
+
+	syntax = g_at_syntax_new_gsmv1();
+	chat = g_at_chat_new(io, syntax);
+	g_at_syntax_unref(syntax);
+
+	return chat;
+}
+
+static char *capture_file(void)
+{
+	char *filename;
+	int fd;
+
+	fd = g_file_open_tmp("test-replay.XXXXXX", &filename, NULL);
+	g_assert(fd >= 0);
+	close(fd);
+
+	return filename;
+}
+
+struct capture_stats {
+	unsigned int records[2];
+	GString *sent;
+	guint8 channel;
+};
+
+static gboolean count_record(guint64 usec, guint8 channel, gboolean in,
+				const guint8 *data, gsize len,
+				gpointer user_data)
+{
+	struct capture_stats *stats = user_data;
+
+	g_assert(channel < 2);
+	stats->records[channel] += 1;
+
+	if (channel == stats->channel && in == FALSE)
+		g_string_append_len(stats->sent, (const char *) data, len);
+
+	return TRUE;
+}
+
+static void check_capture(const char *filename, guint8 channel,
+				gboolean dlc)
+{
+	struct capture_stats stats;
+	GString *expected;
+	unsigned int i;
+
+	memset(&stats, 0, sizeof(stats));
+	stats.sent = g_string_new(NULL);
+	stats.channel = channel;
+
+	g_assert(g_at_capture_read(filename, count_record, &stats));
+
+	g_assert(stats.records[0] > 0);
+	g_assert(dlc == (stats.records[1] > 0));
+
+	/* What the host sent on the AT channel is the plain commands */
+	expected = g_string_new(NULL);
+
+	for (i = 0; i < G_N_ELEMENTS(session); i++)
+		g_string_append_printf(expected, "%s\r", session[i].command);
+
+	g_assert_cmpstr(stats.sent->str, ==, expected->str);
+
+	g_string_free(expected, TRUE);
+	g_string_free(stats.sent, TRUE);
+}
+
+static void played_cb(gpointer user_data)
+{
+	gboolean *played = user_data;
+
+	*played = TRUE;
+}
+
+static char *replay_chat(const char *filename, guint8 channel,
+				gboolean realtime, double *elapsed)
+{
+	GAtReplay *replay;
+	GAtChat *chat;
+	gboolean played = FALSE;
+	char *transcript;
+
+	replay = g_at_replay_new(filename, channel);
+	g_assert(replay != NULL);
+
+	chat = chat_new(g_at_replay_get_channel(replay));
+	g_at_replay_start(replay, realtime, played_cb, &played);
+
+	transcript = run_session(chat, elapsed);
+
+	g_assert(played);
+	g_assert(g_at_replay_get_mismatches(replay) == 0);
+
+	g_at_chat_unref(chat);
+	g_at_replay_unref(replay);
+
+	return transcript;
+}
+
+static void test_chat(void)
+{
+	struct test_modem modem;
+	GAtCapture *capture;
+	GIOChannel *io;
+	GAtChat *chat;
+	char *filename, *live, *fast, *realtime;
+	double live_time, fast_time, realtime_time;
+
+	filename = capture_file();
+
+	io = modem_start(&modem, FALSE);
+	chat = chat_new(io);
+	g_io_channel_unref(io);
+
+	capture = g_at_capture_new(filename);
+	g_assert(capture != NULL);
+	g_at_io_set_capture(g_at_chat_get_io(chat), capture,
+				G_AT_CAPTURE_CHANNEL_RAW);
+	g_at_capture_unref(capture);
+
+	live = run_session(chat, &live_time);
+
+	g_at_chat_unref(chat);
+	modem_stop(&modem);
+
+	check_capture(filename, G_AT_CAPTURE_CHANNEL_RAW, FALSE);
+
+	fast = replay_chat(filename, G_AT_CAPTURE_CHANNEL_RAW, FALSE,
+				&fast_time);
+	realtime = replay_chat(filename, G_AT_CAPTURE_CHANNEL_RAW, TRUE,
+				&realtime_time);
+
+	if (g_test_verbose()) {
+		g_print("%s", live);
+		g_print("live %.1f ms, fast %.1f ms, realtime %.1f ms\n",
+				live_time * 1000, fast_time * 1000,
+				realtime_time * 1000);
+	}
+
+	g_assert(strstr(live, "Modems Inc|OK\n") != NULL);
+	g_assert(strstr(live, "RING\n") != NULL);
+	g_assert_cmpstr(live, ==, fast);
+	g_assert_cmpstr(live, ==, realtime);
+
+	/* The modem latencies come back only in realtime */
+	g_assert(live_time * 1000 >= SESSION_DELAY);
+	g_assert(realtime_time * 1000 >= SESSION_DELAY - 5);
+	g_assert(fast_time < realtime_time / 2);
+
+	g_free(live);
+	g_free(fast);
+	g_free(realtime);
+
+	unlink(filename);
+	g_free(filename);
+}
+
+static char *mux_session(GIOChannel *io, GAtCapture *capture)
+{
+	GIOChannel *dlc;
+	GAtMux *mux;
+	GAtChat *chat;
+	char *transcript;
+
+	/* As g_at_mux_setup_gsm0710 leaves the channel */
+	g_assert(g_at_util_setup_io(io, G_IO_FLAG_NONBLOCK));
+	g_io_channel_set_buffered(io, FALSE);
+
+	mux = g_at_mux_new_gsm0710_basic(io, 64);
+	g_assert(mux != NULL);
+
+	g_at_mux_set_capture(mux, capture);
+	g_assert(g_at_mux_start(mux));
+
+	dlc = g_at_mux_create_channel(mux);
+	g_assert(dlc != NULL);
+
+	chat = chat_new(dlc);
+	g_io_channel_unref(dlc);
+
+	transcript = run_session(chat, NULL);
+
+	g_at_chat_unref(chat);
+	g_at_mux_shutdown(mux);
+	g_at_mux_unref(mux);
+
+	return transcript;
+}
+
+static void test_mux(void)
+{
+	struct test_modem modem;
+	GAtCapture *capture;
+	GAtReplay *replay;
+	GIOChannel *io;
+	char *filename, *live, *raw, *dlc;
+
+	filename = capture_file();
+
+	io = modem_start(&modem, TRUE);
+	capture = g_at_capture_new(filename);
+	g_assert(capture != NULL);
+
+	live = mux_session(io, capture);
+
+	g_io_channel_unref(io);
+	g_at_capture_unref(capture);
+	modem_stop(&modem);
+
+	/* Both the frames and what they carry on DLC 1 are there */
+	check_capture(filename, 1, TRUE);
+
+	/* The frames fed back into a new multiplexer */
+	replay = g_at_replay_new(filename, G_AT_CAPTURE_CHANNEL_RAW);
+	g_assert(replay != NULL);
+	g_at_replay_start(replay, FALSE, NULL, NULL);
+
+	raw = mux_session(g_at_replay_get_channel(replay), NULL);
+
+	g_assert(g_at_replay_get_mismatches(replay) == 0);
+	g_at_replay_unref(replay);
+
+	/* The DLC alone, straight into a chat */
+	dlc = replay_chat(filename, 1, FALSE, NULL);
+
+	if (g_test_verbose())
+		g_print("%s", live);
+
+	g_assert_cmpstr(live, ==, raw);
+	g_assert_cmpstr(live, ==, dlc);
+
+	g_free(live);
+	g_free(raw);
+	g_free(dlc);
+
+	unlink(filename);
+	g_free(filename);
+}
+
+static gboolean count_only(guint64 usec, guint8 channel, gboolean in,
+				const guint8 *data, gsize len,
+				gpointer user_data)
+{
+	unsigned int *count = user_data;
+
+	*count += 1;
+
+	return TRUE;
+}
+
+static void test_truncated(void)
+{
+	GAtCapture *capture;
+	char *filename;
+	char *contents;
+	gsize len;
+	unsigned int count = 0;
+
+	filename = capture_file();
+
+	capture = g_at_capture_new(filename);
+	g_at_capture_write(capture, 0, FALSE, "AT\r", 3);
+	g_at_capture_write(capture, 0, TRUE, "\r\nOK\r\n", 6);
+	g_at_capture_unref(capture);
+
+	/* A crash in the middle of the last record loses only that one */
+	g_assert(g_file_get_contents(filename, &contents, &len, NULL));
+	g_assert(g_file_set_contents(filename, contents, len - 2, NULL));
+	g_free(contents);
+
+	g_assert(g_at_capture_read(filename, count_only, &count));
+	g_assert(count == 1);
+
+	/* Anything else is refused */
+	g_assert(g_file_set_contents(filename, "AT\r\r\nOK\r\n", -1, NULL));
+	g_assert(g_at_capture_read(filename, count_only, &count) == FALSE);
+	g_assert(g_at_replay_new(filename, 0) == NULL);
+
+	unlink(filename);
+	g_free(filename);
+}
+
+int main(int argc, char **argv)
+{
+	g_test_init(&argc, &argv, NULL);
+
+	g_test_add_func("/testreplay/Chat", test_chat);
+	g_test_add_func("/testreplay/Mux", test_mux);
+	g_test_add_func("/testreplay/Truncated", test_truncated);
+
+	return g_test_run();
+}
@@ -0,0 +1,368 @@
+/*
+ *
+ *  oFono - Open Source Telephony
+ *
+ *  Copyright (C) 2008-2010  Intel Corporation. All rights reserved.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <net/if.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+
+#include <glib.h>
+
+#include "rtnl.h"
+
+#define TEST_SEQ 42
+
+struct link_result {
+	char ifname[IFNAMSIZ];
+	struct rtnl_link_counters counters;
+};
+
+static void collect_link(const char *ifname,
+				const struct rtnl_link_counters *counters,
+				void *user_data)
+{
+	GArray *links = user_data;
+	struct link_result result;
+
+	memset(&result, 0, sizeof(result));
+	g_strlcpy(result.ifname, ifname, sizeof(result.ifname));
+	result.counters = *counters;
+
+	g_array_append_val(links, result);
+}
+
+static struct nlmsghdr *msg_start(GByteArray *buf, uint16_t type,
+					uint32_t seq)
+{
+	struct nlmsghdr hdr;
+	struct ifinfomsg ifi;
+	guint offset = buf->len;
+
+	memset(&hdr, 0, sizeof(hdr));
+	hdr.nlmsg_type = type;
+	hdr.nlmsg_flags = NLM_F_MULTI;
+	hdr.nlmsg_seq = seq;
+	hdr.nlmsg_len = NLMSG_LENGTH(sizeof(ifi));
+
+	memset(&ifi, 0, sizeof(ifi));
+
+	g_byte_array_append(buf, (guint8 *) &hdr, sizeof(hdr));
+	g_byte_array_append(buf, (guint8 *) &ifi, sizeof(ifi));
+
+	return (struct nlmsghdr *) (buf->data + offset);
+}
+
+static void msg_add_attr(GByteArray *buf, guint offset, uint16_t type,
+				const void *data, size_t len)
+{
+	static const guint8 pad[RTA_ALIGNTO];
+	struct nlmsghdr *hdr;
+	struct rtattr attr;
+
+	attr.rta_type = type;
+	attr.rta_len = RTA_LENGTH(len);
+
+	g_byte_array_append(buf, (guint8 *) &attr, sizeof(attr));
+	g_byte_array_append(buf, data, len);
+	g_byte_array_append(buf, pad, RTA_SPACE(len) - RTA_LENGTH(len));
+
+	hdr = (struct nlmsghdr *) (buf->data + offset);
+	hdr->nlmsg_len = buf->len - offset;
+}
+
+static void add_link(GByteArray *buf, uint32_t seq, const char *ifname,
+			const struct rtnl_link_stats *stats,
+			const struct rtnl_link_stats64 *stats64)
+{
+	guint offset = buf->len;
+
+	msg_start(buf, RTM_NEWLINK, seq);
+
+	if (ifname)
+		msg_add_attr(buf, offset, IFLA_IFNAME, ifname,
+				strlen(ifname) + 1);
+
+	if (stats)
+		msg_add_attr(buf, offset, IFLA_STATS, stats, sizeof(*stats));
+
+	if (stats64)
+		msg_add_attr(buf, offset, IFLA_STATS64, stats64,
+				sizeof(*stats64));
+}
+
+static void add_done(GByteArray *buf, uint32_t seq)
+{
+	struct nlmsghdr hdr;
+	int status = 0;
+
+	memset(&hdr, 0, sizeof(hdr));
+	hdr.nlmsg_type = NLMSG_DONE;
+	hdr.nlmsg_flags = NLM_F_MULTI;
+	hdr.nlmsg_seq = seq;
+	hdr.nlmsg_len = NLMSG_LENGTH(sizeof(status));
+
+	g_byte_array_append(buf, (guint8 *) &hdr, sizeof(hdr));
+	g_byte_array_append(buf, (guint8 *) &status, sizeof(status));
+}
+
+static void test_parse(void)
+{
+	GByteArray *buf = g_byte_array_new();
+	GArray *links = g_array_new(FALSE, FALSE, sizeof(struct link_result));
+	struct rtnl_link_stats stats;
+	struct rtnl_link_stats64 stats64;
+	struct link_result *result;
+	int err;
+
+	memset(&stats, 0, sizeof(stats));
+	stats.rx_packets = 1;
+	stats.tx_packets = 2;
+	stats.rx_bytes = 3;
+	stats.tx_bytes = 4;
+
+	memset(&stats64, 0, sizeof(stats64));
+	stats64.rx_packets = 10;
+	stats64.tx_packets = 20;
+	stats64.rx_bytes = G_GUINT64_CONSTANT(5000000000);
+	stats64.tx_bytes = G_GUINT64_CONSTANT(6000000000);
+
+	/* The 64 bit counters win, whatever the order */
+	add_link(buf, TEST_SEQ, "rmnet0", &stats, &stats64);
+	add_link(buf, TEST_SEQ, "ppp0", &stats, NULL);
+
+	/* Replies to other requests are ignored */
+	add_link(buf, TEST_SEQ + 1, "usb0", &stats, NULL);
+
+	/* Links without a name or counters are skipped */
+	add_link(buf, TEST_SEQ, NULL, &stats, NULL);
+	add_link(buf, TEST_SEQ, "wwan0", NULL, NULL);
+
+	err = rtnl_parse_links(buf->data, buf->len, TEST_SEQ,
+				collect_link, links);
+	g_assert(err == 0);
+	g_assert(links->len == 2);
+
+	result = &g_array_index(links, struct link_result, 0);
+	g_assert(g_str_equal(result->ifname, "rmnet0"));
+	g_assert(result->counters.rx_packets == 10);
+	g_assert(result->counters.tx_packets == 20);
+	g_assert(result->counters.rx_bytes == G_GUINT64_CONSTANT(5000000000));
+	g_assert(result->counters.tx_bytes == G_GUINT64_CONSTANT(6000000000));
+
+	result = &g_array_index(links, struct link_result, 1);
+	g_assert(g_str_equal(result->ifname, "ppp0"));
+	g_assert(result->counters.rx_packets == 1);
+	g_assert(result->counters.tx_packets == 2);
+	g_assert(result->counters.rx_bytes == 3);
+	g_assert(result->counters.tx_bytes == 4);
+
+	/* The dump ends with NLMSG_DONE, even in a later buffer */
+	g_byte_array_set_size(buf, 0);
+	g_array_set_size(links, 0);
+
+	add_link(buf, TEST_SEQ, "rmnet1", NULL, &stats64);
+	add_done(buf, TEST_SEQ);
+
+	err = rtnl_parse_links(buf->data, buf->len, TEST_SEQ,
+				collect_link, links);
+	g_assert(err == 1);
+	g_assert(links->len == 1);
+
+	g_array_free(links, TRUE);
+	g_byte_array_free(buf, TRUE);
+}
+
+static void test_malformed(void)
+{
+	GByteArray *buf = g_byte_array_new();
+	GArray *links = g_array_new(FALSE, FALSE, sizeof(struct link_result));
+	struct rtnl_link_stats stats;
+	struct nlmsghdr *hdr;
+	guint offset;
+	char ifname[4] = { 'p', 'p', 'p', '0' };
+	int err;
+
+	memset(&stats, 0, sizeof(stats));
+
+	/* An interface name without its terminator */
+	offset = buf->len;
+	msg_start(buf, RTM_NEWLINK, TEST_SEQ);
+	msg_add_attr(buf, offset, IFLA_IFNAME, ifname, sizeof(ifname));
+	msg_add_attr(buf, offset, IFLA_STATS, &stats, sizeof(stats));
+
+	/* Counters cut short */
+	offset = buf->len;
+	msg_start(buf, RTM_NEWLINK, TEST_SEQ);
+	msg_add_attr(buf, offset, IFLA_IFNAME, "ppp1", 5);
+	msg_add_attr(buf, offset, IFLA_STATS, &stats, sizeof(stats) / 2);
+
+	err = rtnl_parse_links(buf->data, buf->len, TEST_SEQ,
+				collect_link, links);
+	g_assert(err == 0);
+	g_assert(links->len == 0);
+
+	/* A message claiming more than the buffer holds ends the parsing */
+	g_byte_array_set_size(buf, 0);
+
+	offset = buf->len;
+	msg_start(buf, RTM_NEWLINK, TEST_SEQ);
+	msg_add_attr(buf, offset, IFLA_IFNAME, "ppp2", 5);
+	msg_add_attr(buf, offset, IFLA_STATS, &stats, sizeof(stats));
+
+	hdr = (struct nlmsghdr *) buf->data;
+	hdr->nlmsg_len += 64;
+
+	err = rtnl_parse_links(buf->data, buf->len, TEST_SEQ,
+				collect_link, links);
+	g_assert(err == 0);
+	g_assert(links->len == 0);
+
+	g_array_free(links, TRUE);
+	g_byte_array_free(buf, TRUE);
+}
+
+static void test_error(void)
+{
+	struct {
+		struct nlmsghdr hdr;
+		struct nlmsgerr err;
+	} msg;
+	int err;
+
+	memset(&msg, 0, sizeof(msg));
+	msg.hdr.nlmsg_type = NLMSG_ERROR;
+	msg.hdr.nlmsg_seq = TEST_SEQ;
+	msg.hdr.nlmsg_len = sizeof(msg);
+	msg.err.error = -EPERM;
+
+	err = rtnl_parse_links(&msg, sizeof(msg), TEST_SEQ, collect_link,
+				NULL);
+	g_assert(err == -EPERM);
+
+	/* An acknowledgement does not end a dump without an error */
+	msg.err.error = 0;
+
+	err = rtnl_parse_links(&msg, sizeof(msg), TEST_SEQ, collect_link,
+				NULL);
+	g_assert(err == -EIO);
+}
+
+static gboolean find_link(struct rtnl *rtnl, const char *ifname,
+				struct rtnl_link_counters *counters)
+{
+	GArray *links = g_array_new(FALSE, FALSE, sizeof(struct link_result));
+	gboolean found = FALSE;
+	guint i;
+
+	g_assert(rtnl_dump_links(rtnl, collect_link, links) == 0);
+
+	for (i = 0; i < links->len; i++) {
+		struct link_result *result;
+
+		result = &g_array_index(links, struct link_result, i);
+
+		if (!g_str_equal(result->ifname, ifname))
+			continue;
+
+		*counters = result->counters;
+		found = TRUE;
+	}
+
+	g_array_free(links, TRUE);
+
+	return found;
+}
+
+/*
+ * Any interface works, the loopback one is there without privileges.
+ * A dummy or veth one does the same with the packets sent through it.
+ */
+static void test_loopback(void)
+{
+	struct rtnl_link_counters before, after;
+	struct sockaddr_in addr;
+	socklen_t addrlen = sizeof(addr);
+	struct rtnl *rtnl;
+	char data[100];
+	int sk, i;
+
+	rtnl = rtnl_open();
+	if (rtnl == NULL) {
+		g_print("No rtnetlink, skipped...");
+		return;
+	}
+
+	g_assert(find_link(rtnl, "lo", &before) == TRUE);
+
+	sk = socket(PF_INET, SOCK_DGRAM, 0);
+	g_assert(sk >= 0);
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	g_assert(bind(sk, (struct sockaddr *) &addr, sizeof(addr)) == 0);
+	g_assert(getsockname(sk, (struct sockaddr *) &addr, &addrlen) == 0);
+
+	memset(data, 0, sizeof(data));
+
+	for (i = 0; i < 10; i++) {
+		g_assert(sendto(sk, data, sizeof(data), 0,
+				(struct sockaddr *) &addr,
+				sizeof(addr)) == sizeof(data));
+		g_assert(recv(sk, data, sizeof(data), 0) == sizeof(data));
+	}
+
+	close(sk);
+
+	/* Other traffic on the host can only add to it */
+	g_assert(find_link(rtnl, "lo", &after) == TRUE);
+	g_assert(after.rx_packets - before.rx_packets >= 10);
+	g_assert(after.tx_packets - before.tx_packets >= 10);
+	g_assert(after.rx_bytes - before.rx_bytes >= 10 * sizeof(data));
+	g_assert(after.tx_bytes - before.tx_bytes >= 10 * sizeof(data));
+
+	g_assert(find_link(rtnl, "nonexistent0", &after) == FALSE);
+
+	rtnl_close(rtnl);
+}
+
+int main(int argc, char **argv)
+{
+	g_test_init(&argc, &argv, NULL);
+
+	g_test_add_func("/testrtnl/Parse", test_parse);
+	g_test_add_func("/testrtnl/Malformed", test_malformed);
+	g_test_add_func("/testrtnl/Error", test_error);
+	g_test_add_func("/testrtnl/Loopback", test_loopback);
+
+	return g_test_run();
+}
@@ -0,0 +1,444 @@
+/*
+ *
+ *  oFono - Open Source Telephony
+ *
+ *  Copyright (C) 2008-2010  Intel Corporation. All rights reserved.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+
+#include <glib.h>
+
+#include <ofono/types.h>
+#include <ofono/log.h>
+#include <ofono/modem.h>
+#include <ofono/sim.h>
+#include <ofono/stk.h>
+
+#include "gatchat.h"
+#include "ofono.h"
+
+#include "drivers/atmodem/sim-poll.h"
+#include "drivers/atmodem/stk.h"
+
+#include "fake-modem.h"
+
+/* What happens around the card, times in s */
+struct scenario {
+	unsigned int duration;
+	unsigned int requested;		/* POLL INTERVAL asked by the SIM */
+	unsigned int call_start;	/* A call from here ... */
+	unsigned int call_end;		/* ... to here */
+	unsigned int traffic_period;	/* Other commands every that many s */
+	gboolean stk;			/* The SIM Toolkit atom is there */
+	unsigned int proactive_at;	/* A proactive command from here */
+};
+
+struct ofono_atom {
+	enum ofono_atom_type type;
+	void *data;
+	ofono_atom_watch_func watch;
+	void *watch_data;
+};
+
+struct ofono_modem {
+	struct ofono_atom atoms[3];
+	unsigned int requested;
+};
+
+struct ofono_sim {
+	unsigned int last_access;
+};
+
+struct ofono_stk {
+	gboolean fetched;
+	unsigned int fetched_at;
+};
+
+struct ofono_voicecall {
+	const struct scenario *sc;
+};
+
+/* A card behind AT+CSIM on the other end of the fake modem */
+struct test_modem {
+	struct fake_modem fake;
+	const struct scenario *sc;
+	struct ofono_stk *stk;
+	unsigned int status;
+};
+
+static GTimer *sim_clock;
+static GMainLoop *event_loop;
+
+/*
+ * The poller counts in seconds, the test makes every one of them a
+ * millisecond so that hours go by in seconds.
+ */
+static guint scaled_timeout_add(guint interval, GSourceFunc function,
+				gpointer data)
+{
+	return g_timeout_add(interval, function, data);
+}
+
+static unsigned int now(void)
+{
+	return g_timer_elapsed(sim_clock, NULL) * 1000;
+}
+
+static void modem_status(struct test_modem *modem)
+{
+	const struct scenario *sc = modem->sc;
+
+	modem->status += 1;
+
+	if (sc->proactive_at && now() >= sc->proactive_at &&
+			modem->stk->fetched == FALSE)
+		fake_modem_write(&modem->fake,
+				"\r\n+CSIM: 4,\"9110\"\r\n\r\nOK\r\n");
+	else
+		fake_modem_write(&modem->fake,
+				"\r\n+CSIM: 4,\"9000\"\r\n\r\nOK\r\n");
+}
+
+static void modem_command(struct fake_modem *fake, const char *command,
+				gpointer user_data)
+{
+	struct test_modem *modem = user_data;
+
+	if (g_str_equal(command, "AT+CSIM=8,A0F200C0"))
+		modem_status(modem);
+	else
+		fake_modem_write(fake, "\r\nERROR\r\n");
+}
+
+void ofono_debug(const char *format, ...)
+{
+}
+
+struct ofono_atom *__ofono_modem_find_atom(struct ofono_modem *modem,
+						enum ofono_atom_type type)
+{
+	unsigned int i;
+
+	for (i = 0; i < G_N_ELEMENTS(modem->atoms); i++) {
+		if (modem->atoms[i].type == type &&
+				modem->atoms[i].data != NULL)
+			return &modem->atoms[i];
+	}
+
+	return NULL;
+}
+
+void *__ofono_atom_get_data(struct ofono_atom *atom)
+{
+	return atom->data;
+}
+
+gboolean __ofono_atom_get_registered(struct ofono_atom *atom)
+{
+	return TRUE;
+}
+
+unsigned int __ofono_modem_add_atom_watch(struct ofono_modem *modem,
+					enum ofono_atom_type type,
+					ofono_atom_watch_func notify,
+					void *data, ofono_destroy_func destroy)
+{
+	unsigned int i;
+
+	for (i = 0; i < G_N_ELEMENTS(modem->atoms); i++) {
+		if (modem->atoms[i].type != type)
+			continue;
+
+		modem->atoms[i].watch = notify;
+		modem->atoms[i].watch_data = data;
+
+		return i + 1;
+	}
+
+	return 0;
+}
+
+gboolean __ofono_modem_remove_atom_watch(struct ofono_modem *modem,
+						unsigned int id)
+{
+	modem->atoms[id - 1].watch = NULL;
+
+	return TRUE;
+}
+
+int ofono_modem_get_integer(struct ofono_modem *modem, const char *key)
+{
+	return modem->requested;
+}
+
+int ofono_modem_set_integer(struct ofono_modem *modem,
+				const char *key, int value)
+{
+	modem->requested = value;
+
+	return 0;
+}
+
+unsigned int ofono_sim_add_state_watch(struct ofono_sim *sim,
+					ofono_sim_state_event_cb_t cb,
+					void *data, ofono_destroy_func destroy)
+{
+	return 1;
+}
+
+enum ofono_sim_state ofono_sim_get_state(struct ofono_sim *sim)
+{
+	return OFONO_SIM_STATE_READY;
+}
+
+void ofono_sim_inserted_notify(struct ofono_sim *sim, ofono_bool_t inserted)
+{
+	g_assert(inserted == TRUE);
+}
+
+unsigned int __ofono_sim_get_idle_time(struct ofono_sim *sim)
+{
+	return now() - sim->last_access;
+}
+
+ofono_bool_t __ofono_stk_session_active(struct ofono_stk *stk)
+{
+	return FALSE;
+}
+
+ofono_bool_t __ofono_voicecall_is_busy(struct ofono_voicecall *vc,
+					enum ofono_voicecall_interaction type)
+{
+	unsigned int t = now();
+
+	return t >= vc->sc->call_start && t < vc->sc->call_end;
+}
+
+void at_sim_fetch_command(struct ofono_stk *stk, int length)
+{
+	g_assert(length == 0x10);
+
+	if (stk->fetched)
+		return;
+
+	stk->fetched = TRUE;
+	stk->fetched_at = now();
+}
+
+static gboolean sim_traffic(gpointer user_data)
+{
+	struct ofono_sim *sim = user_data;
+
+	sim->last_access = now();
+
+	return TRUE;
+}
+
+static gboolean scenario_end(gpointer user_data)
+{
+	g_main_loop_quit(event_loop);
+
+	return FALSE;
+}
+
+/*
+ * Runs drivers/atmodem/sim-poll.c over the scenario and returns the
+ * number of STATUS commands the card got.
+ */
+static unsigned int run_scenario(const struct scenario *sc,
+					struct ofono_stk *stk)
+{
+	struct test_modem fake;
+	struct ofono_modem modem;
+	struct ofono_sim sim;
+	struct ofono_voicecall vc;
+	struct ofono_atom *sim_atom;
+	GAtChat *chat;
+	guint traffic = 0;
+
+	memset(&fake, 0, sizeof(fake));
+	memset(&modem, 0, sizeof(modem));
+	memset(&sim, 0, sizeof(sim));
+	memset(stk, 0, sizeof(*stk));
+
+	vc.sc = sc;
+	fake.sc = sc;
+	fake.stk = stk;
+
+	modem.requested = sc->requested;
+	modem.atoms[0].type = OFONO_ATOM_TYPE_SIM;
+	modem.atoms[0].data = &sim;
+	modem.atoms[1].type = OFONO_ATOM_TYPE_STK;
+	modem.atoms[1].data = sc->stk ? stk : NULL;
+	modem.atoms[2].type = OFONO_ATOM_TYPE_VOICECALL;
+	modem.atoms[2].data = &vc;
+	sim_atom = &modem.atoms[0];
+
+	chat = fake_modem_start_chat(&fake.fake, modem_command, &fake);
+	event_loop = g_main_loop_new(NULL, FALSE);
+
+	if (sc->traffic_period)
+		traffic = g_timeout_add(sc->traffic_period, sim_traffic, &sim);
+
+	g_timeout_add(sc->duration, scenario_end, NULL);
+
+	g_timer_start(sim_clock);
+
+	atmodem_poll_enable(&modem, chat);
+	g_assert(sim_atom->watch != NULL);
+
+	g_main_loop_run(event_loop);
+
+	sim_atom->watch(sim_atom, OFONO_ATOM_WATCH_CONDITION_UNREGISTERED,
+				sim_atom->watch_data);
+
+	if (traffic)
+		g_source_remove(traffic);
+
+	g_at_chat_unref(chat);
+	g_main_loop_unref(event_loop);
+
+	fake_modem_stop(&fake.fake);
+
+	if (g_test_verbose())
+		g_print("%u s: %u STATUS\n", sc->duration, fake.status);
+
+	return fake.status;
+}
+
+static void test_interval(void)
+{
+	unsigned int interval = 0;
+	unsigned int i;
+
+	interval = sim_poll_next_interval(interval, 0, FALSE);
+	g_assert(interval == SIM_POLL_INTERVAL);
+	interval = sim_poll_next_interval(interval, 0, FALSE);
+	g_assert(interval == SIM_POLL_INTERVAL * 2);
+
+	for (i = 0; i < 10; i++)
+		interval = sim_poll_next_interval(interval, 0, FALSE);
+
+	g_assert(interval == SIM_POLL_IDLE_MAX_INTERVAL);
+
+	/* A call or a proactive session brings it back at once */
+	interval = sim_poll_next_interval(interval, 0, TRUE);
+	g_assert(interval == SIM_POLL_INTERVAL);
+
+	/* What the SIM asks for is what it gets, busy or not */
+	g_assert(sim_poll_next_interval(interval, 5, FALSE) == 5);
+	g_assert(sim_poll_next_interval(interval, 5, TRUE) == 5);
+	g_assert(sim_poll_next_interval(SIM_POLL_IDLE_MAX_INTERVAL, 600,
+						FALSE) == 600);
+}
+
+static void test_idle(void)
+{
+	struct scenario sc = { .duration = 3600, .stk = TRUE };
+	struct ofono_stk stk;
+	unsigned int status;
+
+	status = run_scenario(&sc, &stk);
+
+	/* 30, 60, 120 and 240 s apart, then every 5 min */
+	g_assert(status >= 14 && status <= 16);
+	g_assert(status * 6 < 3600 / SIM_POLL_INTERVAL);
+}
+
+static void test_call(void)
+{
+	struct scenario sc = { .duration = 1800, .call_start = 600,
+				.call_end = 1200, .stk = TRUE };
+	struct ofono_stk stk;
+	unsigned int status;
+
+	status = run_scenario(&sc, &stk);
+
+	/* The 10 min call is covered at the usual pace */
+	g_assert(status >= 600 / SIM_POLL_INTERVAL);
+	g_assert(status < 1800 / SIM_POLL_INTERVAL);
+}
+
+static void test_traffic(void)
+{
+	struct scenario sc = { .duration = 1800, .traffic_period = 20 };
+	struct ofono_stk stk;
+
+	/* Without the SIM Toolkit, other commands are proof enough */
+	g_assert(run_scenario(&sc, &stk) == 1);
+}
+
+static void test_proactive(void)
+{
+	struct scenario sc = { .duration = 1800, .traffic_period = 20,
+				.stk = TRUE, .proactive_at = 900 };
+	struct ofono_stk stk;
+	unsigned int status;
+
+	status = run_scenario(&sc, &stk);
+
+	if (g_test_verbose())
+		g_print("fetched %u s after the card had it\n",
+				stk.fetched_at - sc.proactive_at);
+
+	/* Other commands do not tell about proactive ones, STATUS does */
+	g_assert(status > 1);
+	g_assert(stk.fetched == TRUE);
+	g_assert(stk.fetched_at - sc.proactive_at <=
+					SIM_POLL_IDLE_MAX_INTERVAL + 5);
+}
+
+static void test_requested(void)
+{
+	struct scenario sc = { .duration = 600, .requested = 10 };
+	struct ofono_stk stk;
+	unsigned int status;
+
+	status = run_scenario(&sc, &stk);
+
+	/* Every 10 s from the start, give or take a slow response */
+	g_assert(status >= 55 && status <= 61);
+}
+
+int main(int argc, char **argv)
+{
+	int ret;
+
+	g_test_init(&argc, &argv, NULL);
+
+	sim_clock = g_timer_new();
+	atmodem_poll_set_timeout_func(scaled_timeout_add);
+
+	g_test_add_func("/testsimpoll/Interval", test_interval);
+	g_test_add_func("/testsimpoll/Idle", test_idle);
+	g_test_add_func("/testsimpoll/Call", test_call);
+	g_test_add_func("/testsimpoll/Other traffic", test_traffic);
+	g_test_add_func("/testsimpoll/Proactive command", test_proactive);
+	g_test_add_func("/testsimpoll/Requested interval", test_requested);
+
+	ret = g_test_run();
+
+	g_timer_destroy(sim_clock);
+
+	return ret;
+}
@@ -0,0 +1,404 @@
+/*
+ *
+ *  oFono - Open Source Telephony
+ *
+ *  Copyright (C) 2008-2010  Intel Corporation. All rights reserved.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include <glib.h>
+
+#include "gatchat.h"
+#include "gatserver.h"
+#include "simulator.h"
+
+/* The chat and the simulated modem talk over a socket pair */
+struct link {
+	GAtChat *chat;
+	GAtServer *server;
+	struct at_simulator *sim;
+	GMainLoop *loop;
+};
+
+static const char *none_prefix[] = { NULL };
+static const char *cgmi_prefix[] = { "", NULL };
+static const char *cpas_prefix[] = { "+CPAS:", NULL };
+static const char *cmgl_prefix[] = { "+CMGL:", NULL };
+
+static gboolean link_open(struct link *link, const char *script,
+				GError **error)
+{
+	GKeyFile *keyfile;
+	GIOChannel *io;
+	GAtSyntax *syntax;
+	int sv[2];
+
+	keyfile = g_key_file_new();
+
+	if (!g_key_file_load_from_data(keyfile, script, strlen(script),
+					G_KEY_FILE_NONE, error)) {
+		g_key_file_free(keyfile);
+		return FALSE;
+	}
+
+	g_assert(socketpair(AF_UNIX, SOCK_STREAM, 0, sv) == 0);
+
+	io = g_io_channel_unix_new(sv[0]);
+	g_io_channel_set_close_on_unref(io, TRUE);
+	link->server = g_at_server_new(io);
+	g_io_channel_unref(io);
+
+	io = g_io_channel_unix_new(sv[1]);
+	g_io_channel_set_close_on_unref(io, TRUE);
+	syntax = g_at_syntax_new_gsmv1();
+	link->chat = g_at_chat_new(io, syntax);
+	g_at_syntax_unref(syntax);
+	g_io_channel_unref(io);
+
+	link->sim = at_simulator_new(link->server, keyfile, error);
+	link->loop = g_main_loop_new(NULL, FALSE);
+
+	g_key_file_free(keyfile);
+
+	return link->sim != NULL;
+}
+
+static void link_close(struct link *link)
+{
+	at_simulator_free(link->sim);
+	g_at_chat_unref(link->chat);
+	g_at_server_unref(link->server);
+	g_main_loop_unref(link->loop);
+}
+
+static gboolean give_up(gpointer user_data)
+{
+	g_assert_not_reached();
+
+	return FALSE;
+}
+
+static void link_run(struct link *link)
+{
+	guint source = g_timeout_add(10000, give_up, NULL);
+
+	g_main_loop_run(link->loop);
+	g_source_remove(source);
+}
+
+struct response {
+	struct link *link;
+	GTimer *timer;
+	double elapsed;
+	gboolean ok;
+	char *final;
+	char *line;
+	unsigned int pdus;
+};
+
+static void response_cb(gboolean ok, GAtResult *result, gpointer user_data)
+{
+	struct response *response = user_data;
+	GAtResultIter iter;
+	const char *line;
+
+	response->elapsed = g_timer_elapsed(response->timer, NULL) * 1000;
+	response->ok = ok;
+	response->final = g_strdup(g_at_result_final_response(result));
+
+	g_at_result_iter_init(&iter, result);
+
+	if (g_at_result_iter_next(&iter, NULL)) {
+		line = g_at_result_iter_raw_line(&iter);
+		response->line = g_strdup(line);
+	}
+
+	g_main_loop_quit(response->link->loop);
+}
+
+static void send_and_wait(struct link *link, const char *cmd,
+				const char **prefix, struct response *response)
+{
+	memset(response, 0, sizeof(*response));
+	response->link = link;
+	response->timer = g_timer_new();
+
+	g_at_chat_send(link->chat, cmd, prefix, response_cb, response, NULL);
+	link_run(link);
+
+	g_timer_destroy(response->timer);
+
+	if (g_test_verbose())
+		g_print("%s: %s after %.1f ms\n", cmd, response->final,
+				response->elapsed);
+}
+
+static void response_clear(struct response *response)
+{
+	g_free(response->final);
+	g_free(response->line);
+}
+
+static const char latency_script[] =
+	"[AT+CGMI]\n"
+	"Response=Simulated Modems Inc.\n"
+	"Latency=80\n"
+	"[AT+CGMM]\n"
+	"Response=Model 1\n"
+	"[AT+CPIN?]\n"
+	"Latency=20-40\n"
+	"Result=+CME ERROR: 10\n"
+	"[AT+COPS=?]\n"
+	"Response=+COPS: (2,\"Sim\",\"Sim\",\"00101\",2),,(0-4),(0-2)\n"
+	"Latency=300\n";
+
+static void test_latency(void)
+{
+	struct link link;
+	struct response response;
+
+	g_assert(link_open(&link, latency_script, NULL));
+
+	send_and_wait(&link, "AT+CGMI", cgmi_prefix, &response);
+	g_assert(response.ok);
+	g_assert(g_str_equal(response.line, "Simulated Modems Inc."));
+	g_assert(response.elapsed >= 80);
+	response_clear(&response);
+
+	send_and_wait(&link, "AT+CGMM", cgmi_prefix, &response);
+	g_assert(response.ok);
+	g_assert(response.elapsed < 80);
+	response_clear(&response);
+
+	send_and_wait(&link, "AT+CPIN?", none_prefix, &response);
+	g_assert(response.ok == FALSE);
+	g_assert(g_str_equal(response.final, "+CME ERROR: 10"));
+	g_assert(response.elapsed >= 20);
+	response_clear(&response);
+
+	/* The slow network scan */
+	send_and_wait(&link, "AT+COPS=?", none_prefix, &response);
+	g_assert(response.ok);
+	g_assert(response.elapsed >= 300);
+	response_clear(&response);
+
+	/* Not in the script at all */
+	send_and_wait(&link, "AT+CSQ", none_prefix, &response);
+	g_assert(response.ok == FALSE);
+	g_assert(g_str_equal(response.final, "ERROR"));
+	response_clear(&response);
+
+	g_assert(at_simulator_get_commands(link.sim) == 4);
+
+	link_close(&link);
+}
+
+static const char storm_script[] =
+	"[Simulator]\n"
+	"Seed=7\n"
+	"[AT+CPAS]\n"
+	"Response=+CPAS: 0\n"
+	"Latency=exp:20\n"
+	"[URC signal]\n"
+	"Line=+CSQ: 20,99\\n+CSQ: 10,99\\n+CSQ: 31,99\n"
+	"Count=2000\n"
+	"Start=10\n"
+	"[URC registration]\n"
+	"Line=+CREG: 1\\n+CREG: 2\n"
+	"Count=200\n"
+	"Start=10\n"
+	"Interval=0-2\n";
+
+static unsigned int csq_count;
+static unsigned int creg_count;
+
+static void csq_notify(GAtResult *result, gpointer user_data)
+{
+	csq_count += 1;
+}
+
+static void creg_notify(GAtResult *result, gpointer user_data)
+{
+	creg_count += 1;
+}
+
+static void test_storm(void)
+{
+	struct link link;
+	struct response response;
+	GTimer *timer;
+	unsigned int commands = 0;
+
+	g_assert(link_open(&link, storm_script, NULL));
+
+	g_at_chat_register(link.chat, "+CSQ:", csq_notify, FALSE, NULL, NULL);
+	g_at_chat_register(link.chat, "+CREG:", creg_notify, FALSE,
+								NULL, NULL);
+
+	timer = g_timer_new();
+
+	/* Commands keep going through while the storm rages */
+	while (csq_count < 2000 || creg_count < 200) {
+		send_and_wait(&link, "AT+CPAS", cpas_prefix, &response);
+		g_assert(response.ok);
+		response_clear(&response);
+		commands += 1;
+
+		g_assert(g_timer_elapsed(timer, NULL) < 10);
+	}
+
+	if (g_test_verbose())
+		g_print("%u URCs and %u commands in %.1f ms\n",
+				csq_count + creg_count, commands,
+				g_timer_elapsed(timer, NULL) * 1000);
+
+	g_timer_destroy(timer);
+
+	g_assert(csq_count == 2000);
+	g_assert(creg_count == 200);
+	g_assert(at_simulator_get_unsolicited(link.sim) == 2200);
+
+	link_close(&link);
+}
+
+static const char listing_script[] =
+	"[AT+CNMI=]\n"
+	"[AT+CMGL=4]\n"
+	"Response=+CMGL: 1,1,,24\\n"
+	"07913366003000F1040B913366611568F600003140226181708005C8329BFD06"
+	"\\n+CMGL: 2,1,,24\\n"
+	"07913366003000F1040B913366611568F600003140226181708005C8329BFD06\n"
+	"LineInterval=5-10\n"
+	"[URC new message]\n"
+	"Line=+CMTI: \"SM\",3\n"
+	"After=AT+CNMI=\n"
+	"Count=3\n"
+	"Interval=1\n";
+
+static unsigned int cmti_count;
+
+static void cmti_notify(GAtResult *result, gpointer user_data)
+{
+	cmti_count += 1;
+}
+
+static void cmgl_listing(GAtResult *result, gpointer user_data)
+{
+	struct response *response = user_data;
+	GAtResultIter iter;
+
+	g_at_result_iter_init(&iter, result);
+
+	g_assert(g_at_result_iter_next(&iter, "+CMGL:"));
+	g_assert(g_at_result_pdu(result) != NULL);
+
+	response->pdus += 1;
+}
+
+static gboolean wait_cmti(gpointer user_data)
+{
+	struct link *link = user_data;
+
+	if (cmti_count < 3)
+		return TRUE;
+
+	g_main_loop_quit(link->loop);
+
+	return FALSE;
+}
+
+static void test_listing(void)
+{
+	struct link link;
+	struct response response;
+
+	g_assert(link_open(&link, listing_script, NULL));
+
+	g_at_chat_register(link.chat, "+CMTI:", cmti_notify, FALSE,
+								NULL, NULL);
+
+	memset(&response, 0, sizeof(response));
+	response.link = &link;
+	response.timer = g_timer_new();
+
+	g_at_chat_send_pdu_listing(link.chat, "AT+CMGL=4", cmgl_prefix,
+					cmgl_listing, response_cb,
+					&response, NULL);
+	link_run(&link);
+
+	g_timer_destroy(response.timer);
+
+	g_assert(response.ok);
+	g_assert(response.pdus == 2);
+	g_assert(response.elapsed >= 15);
+	response_clear(&response);
+
+	/* The new message indications follow +CNMI */
+	g_assert(cmti_count == 0);
+
+	send_and_wait(&link, "AT+CNMI=1,1", none_prefix, &response);
+	g_assert(response.ok);
+	response_clear(&response);
+
+	g_timeout_add(5, wait_cmti, &link);
+	link_run(&link);
+
+	g_assert(cmti_count == 3);
+
+	link_close(&link);
+}
+
+static void test_bad_script(void)
+{
+	struct link link;
+	GError *error = NULL;
+
+	g_assert(!link_open(&link, "[AT+CGMI]\nLatency=fast\n", &error));
+	g_assert(error != NULL);
+
+	if (g_test_verbose())
+		g_print("%s\n", error->message);
+
+	g_error_free(error);
+	error = NULL;
+	link_close(&link);
+
+	g_assert(!link_open(&link, "[URC]\nLine=RING\n", &error));
+	g_assert(error != NULL);
+	g_error_free(error);
+	link_close(&link);
+}
+
+int main(int argc, char **argv)
+{
+	g_test_init(&argc, &argv, NULL);
+
+	g_test_add_func("/testsimulator/Latency", test_latency);
+	g_test_add_func("/testsimulator/URC storm", test_storm);
+	g_test_add_func("/testsimulator/PDU listing", test_listing);
+	g_test_add_func("/testsimulator/Bad script", test_bad_script);
+
+	return g_test_run();
+}
@@ -0,0 +1,734 @@
+/*
+ *
+ *  oFono - Open Source Telephony
+ *
+ *  Copyright (C) 2008-2010  Intel Corporation. All rights reserved.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+
+#include <glib.h>
+#include <gdbus.h>
+
+#include "ofono.h"
+
+#include "smsutil.h"
+#include "gatchat.h"
+#include "drivers/atmodem/atmodem.h"
+
+#include "fake-modem.h"
+
+/*
+ * The transmit queue of src/sms.c is run against a fake driver, which
+ * keeps the submits it is handed until a test completes them, and
+ * against the atmodem driver talking to a fake modem.  The rest of the
+ * core is stubbed out below.
+ */
+struct ofono_atom {
+	void *data;
+	void (*destruct)(struct ofono_atom *atom);
+};
+
+static GMainLoop *event_loop;
+static gboolean registered;
+
+struct ofono_atom *__ofono_modem_add_atom(struct ofono_modem *modem,
+					enum ofono_atom_type type,
+					void (*destruct)(struct ofono_atom *),
+					void *data)
+{
+	struct ofono_atom *atom = g_new0(struct ofono_atom, 1);
+
+	atom->data = data;
+	atom->destruct = destruct;
+
+	return atom;
+}
+
+void __ofono_atom_free(struct ofono_atom *atom)
+{
+	atom->destruct(atom);
+	g_free(atom);
+}
+
+void *__ofono_atom_get_data(struct ofono_atom *atom)
+{
+	return atom->data;
+}
+
+struct ofono_modem *__ofono_atom_get_modem(struct ofono_atom *atom)
+{
+	return NULL;
+}
+
+const char *__ofono_atom_get_path(struct ofono_atom *atom)
+{
+	return "/test";
+}
+
+gboolean __ofono_atom_get_registered(struct ofono_atom *atom)
+{
+	return FALSE;
+}
+
+void __ofono_atom_register(struct ofono_atom *atom,
+				void (*unregister)(struct ofono_atom *))
+{
+	registered = TRUE;
+	g_main_loop_quit(event_loop);
+}
+
+unsigned int __ofono_modem_add_atom_watch(struct ofono_modem *modem,
+					enum ofono_atom_type type,
+					ofono_atom_watch_func notify,
+					void *data, ofono_destroy_func destroy)
+{
+	return 1;
+}
+
+gboolean __ofono_modem_remove_atom_watch(struct ofono_modem *modem,
+						unsigned int id)
+{
+	return TRUE;
+}
+
+struct ofono_atom *__ofono_modem_find_atom(struct ofono_modem *modem,
+						enum ofono_atom_type type)
+{
+	return NULL;
+}
+
+void ofono_modem_add_interface(struct ofono_modem *modem,
+				const char *interface)
+{
+}
+
+void ofono_modem_remove_interface(struct ofono_modem *modem,
+					const char *interface)
+{
+}
+
+const char *ofono_sim_get_imsi(struct ofono_sim *sim)
+{
+	return NULL;
+}
+
+void __ofono_message_waiting_mwi(struct ofono_message_waiting *mw,
+				struct sms *sms, gboolean *out_discard)
+{
+}
+
+void __ofono_history_sms_received(struct ofono_modem *modem,
+					unsigned int msg_id, const char *from,
+					const struct tm *remote,
+					const struct tm *local,
+					const char *text)
+{
+}
+
+void __ofono_history_sms_send_pending(struct ofono_modem *modem,
+					unsigned int msg_id, const char *to,
+					time_t when, const char *text)
+{
+}
+
+void __ofono_history_sms_send_status(struct ofono_modem *modem,
+					unsigned int msg_id, time_t when,
+					enum ofono_history_sms_status status)
+{
+}
+
+DBusConnection *ofono_dbus_get_connection()
+{
+	return NULL;
+}
+
+void ofono_dbus_dict_append(DBusMessageIter *dict, const char *key, int type,
+				void *value)
+{
+}
+
+int ofono_dbus_signal_property_changed(DBusConnection *conn, const char *path,
+					const char *interface, const char *name,
+					int type, void *value)
+{
+	return 0;
+}
+
+void __ofono_dbus_pending_reply(DBusMessage **msg, DBusMessage *reply)
+{
+}
+
+DBusMessage *__ofono_error_busy(DBusMessage *msg)
+{
+	return NULL;
+}
+
+DBusMessage *__ofono_error_failed(DBusMessage *msg)
+{
+	return NULL;
+}
+
+DBusMessage *__ofono_error_invalid_args(DBusMessage *msg)
+{
+	return NULL;
+}
+
+DBusMessage *__ofono_error_invalid_format(DBusMessage *msg)
+{
+	return NULL;
+}
+
+DBusMessage *__ofono_error_not_implemented(DBusMessage *msg)
+{
+	return NULL;
+}
+
+gboolean g_dbus_register_interface(DBusConnection *connection,
+					const char *path, const char *name,
+					const GDBusMethodTable *methods,
+					const GDBusSignalTable *signals,
+					const GDBusPropertyTable *properties,
+					void *user_data,
+					GDBusDestroyFunction destroy)
+{
+	return TRUE;
+}
+
+gboolean g_dbus_unregister_interface(DBusConnection *connection,
+					const char *path, const char *name)
+{
+	return TRUE;
+}
+
+gboolean g_dbus_send_message(DBusConnection *connection, DBusMessage *message)
+{
+	return FALSE;
+}
+
+gboolean g_dbus_send_reply(DBusConnection *connection,
+				DBusMessage *message, int type, ...)
+{
+	return FALSE;
+}
+
+void ofono_debug(const char *format, ...)
+{
+}
+
+void ofono_error(const char *format, ...)
+{
+}
+
+void ofono_warn(const char *format, ...)
+{
+}
+
+/* A PDU handed to the fake driver, as it went out */
+struct submit {
+	char to[32];
+	guint8 seq;
+	int mms;
+	ofono_sms_submit_cb_t cb;
+	void *data;
+};
+
+static GSList *submits;		/* all of them, in order */
+static GSList *in_flight;	/* not completed yet, in order */
+static unsigned int fake_depth;
+
+static void fake_submit(struct ofono_sms *sms, unsigned char *pdu,
+			int pdu_len, int tpdu_len, int mms,
+			ofono_sms_submit_cb_t cb, void *data)
+{
+	struct submit *submit = g_new0(struct submit, 1);
+	guint16 ref;
+	guint8 max;
+	struct sms s;
+
+	g_assert(sms_decode(pdu, pdu_len, TRUE, tpdu_len, &s));
+
+	g_strlcpy(submit->to, sms_address_to_string(&s.submit.daddr),
+			sizeof(submit->to));
+
+	if (sms_extract_concatenation(&s, &ref, &max, &submit->seq) == FALSE)
+		submit->seq = 1;
+
+	submit->mms = mms;
+	submit->cb = cb;
+	submit->data = data;
+
+	if (g_test_verbose())
+		g_print("submit %s %u mms %d\n", submit->to, submit->seq, mms);
+
+	submits = g_slist_append(submits, submit);
+	in_flight = g_slist_append(in_flight, submit);
+}
+
+static int fake_probe(struct ofono_sms *sms, unsigned int vendor,
+			void *data)
+{
+	if (fake_depth)
+		ofono_sms_set_max_in_flight(sms, fake_depth);
+
+	return 0;
+}
+
+static void fake_remove(struct ofono_sms *sms)
+{
+}
+
+static struct ofono_sms_driver fake_driver = {
+	.name		= "fake",
+	.probe		= fake_probe,
+	.remove		= fake_remove,
+	.submit		= fake_submit,
+};
+
+/* What became of each queued message, in the order they finished */
+struct message {
+	const char *to;
+	gboolean done;
+	gboolean ok;
+};
+
+static GSList *finished;
+
+static void message_cb(gboolean ok, void *data)
+{
+	struct message *message = data;
+
+	g_assert(message->done == FALSE);
+
+	message->done = TRUE;
+	message->ok = ok;
+
+	finished = g_slist_append(finished, message);
+}
+
+static void queue_message(struct ofono_sms *sms, struct message *message,
+				const char *to, unsigned int parts)
+{
+	char text[153 * 3 + 1];
+	GSList *list, *l;
+	int offset;
+
+	g_assert(parts <= 3);
+
+	/* 153 septets fit in each part of a concatenated message */
+	memset(text, 'a', parts == 1 ? 10 : 153 * parts);
+	text[parts == 1 ? 10 : 153 * parts] = '\0';
+
+	memset(message, 0, sizeof(*message));
+	message->to = to;
+
+	list = sms_text_prepare(text, 0, FALSE, &offset, FALSE);
+	g_assert(g_slist_length(list) == parts);
+
+	for (l = list; l; l = l->next)
+		sms_address_from_string(&((struct sms *) l->data)->submit.daddr,
+						message->to);
+
+	__ofono_sms_txq_submit(sms, list, 0, message_cb, message, NULL);
+
+	g_slist_foreach(list, (GFunc) g_free, NULL);
+	g_slist_free(list);
+}
+
+static void run_pending(void)
+{
+	while (g_main_context_iteration(NULL, FALSE))
+		;
+}
+
+/* Completes the n-th PDU still in flight */
+static void complete(unsigned int n, gboolean ok)
+{
+	struct submit *submit = g_slist_nth_data(in_flight, n);
+	struct ofono_error error;
+
+	g_assert(submit != NULL);
+
+	in_flight = g_slist_remove(in_flight, submit);
+
+	error.type = ok ? OFONO_ERROR_TYPE_NO_ERROR : OFONO_ERROR_TYPE_FAILURE;
+	error.error = 0;
+
+	submit->cb(&error, ok ? 1 : -1, submit->data);
+
+	run_pending();
+}
+
+static void check_submit(unsigned int n, const char *to, guint8 seq,
+				int mms)
+{
+	struct submit *submit = g_slist_nth_data(submits, n);
+
+	g_assert(submit != NULL);
+	g_assert(g_str_equal(submit->to, to));
+	g_assert(submit->seq == seq);
+	g_assert(submit->mms == mms);
+}
+
+static struct ofono_sms *fake_start(unsigned int depth)
+{
+	struct ofono_sms *sms;
+
+	fake_depth = depth;
+	ofono_sms_driver_register(&fake_driver);
+
+	sms = ofono_sms_create(NULL, 0, "fake", NULL);
+	g_assert(sms != NULL);
+
+	return sms;
+}
+
+static void fake_stop(struct ofono_sms *sms)
+{
+	g_assert(in_flight == NULL);
+
+	ofono_sms_remove(sms);
+	ofono_sms_driver_unregister(&fake_driver);
+
+	g_slist_foreach(submits, (GFunc) g_free, NULL);
+	g_slist_free(submits);
+	submits = NULL;
+
+	g_slist_free(finished);
+	finished = NULL;
+}
+
+static void test_default_depth(void)
+{
+	struct ofono_sms *sms = fake_start(0);
+	struct message a, b;
+
+	queue_message(sms, &a, "+15550001", 2);
+	queue_message(sms, &b, "+15550002", 1);
+
+	run_pending();
+
+	/* Without opting in, one PDU at a time */
+	g_assert(g_slist_length(in_flight) == 1);
+	complete(0, TRUE);
+	g_assert(g_slist_length(in_flight) == 1);
+	complete(0, TRUE);
+	g_assert(a.done && a.ok);
+	g_assert(g_slist_length(in_flight) == 1);
+	complete(0, TRUE);
+	g_assert(b.done && b.ok);
+
+	check_submit(0, "+15550001", 1, 2);
+	check_submit(1, "+15550001", 2, 2);
+	check_submit(2, "+15550002", 1, 0);
+
+	fake_stop(sms);
+}
+
+static void test_pipeline_order(void)
+{
+	struct ofono_sms *sms = fake_start(4);
+	struct message a, b;
+
+	queue_message(sms, &a, "+15550001", 3);
+	queue_message(sms, &b, "+15550002", 1);
+
+	run_pending();
+
+	/* Both messages go out at once, in queue order */
+	g_assert(g_slist_length(in_flight) == 4);
+	check_submit(0, "+15550001", 1, 2);
+	check_submit(1, "+15550001", 2, 2);
+	check_submit(2, "+15550001", 3, 2);
+	check_submit(3, "+15550002", 1, 0);
+
+	/* Results may come back in any order */
+	complete(3, TRUE);
+	g_assert(b.done && b.ok);
+	g_assert(a.done == FALSE);
+
+	complete(2, TRUE);
+	complete(0, TRUE);
+	g_assert(a.done == FALSE);
+
+	complete(0, TRUE);
+	g_assert(a.done && a.ok);
+
+	g_assert(g_slist_nth_data(finished, 0) == &b);
+	g_assert(g_slist_nth_data(finished, 1) == &a);
+	g_assert(g_slist_length(submits) == 4);
+
+	fake_stop(sms);
+}
+
+static void test_pipeline_error(void)
+{
+	struct ofono_sms *sms = fake_start(2);
+	struct message a, b;
+
+	queue_message(sms, &a, "+15550001", 3);
+	queue_message(sms, &b, "+15550002", 1);
+
+	run_pending();
+
+	g_assert(g_slist_length(in_flight) == 2);
+	check_submit(0, "+15550001", 1, 2);
+	check_submit(1, "+15550001", 2, 2);
+
+	/* The message fails, but only once its other PDU is back */
+	complete(0, FALSE);
+	g_assert(a.done == FALSE);
+
+	/* The rest of it is dropped, the next message takes the slot */
+	g_assert(g_slist_length(in_flight) == 2);
+	check_submit(2, "+15550002", 1, 0);
+
+	complete(0, TRUE);
+	g_assert(a.done && a.ok == FALSE);
+
+	complete(0, TRUE);
+	g_assert(b.done && b.ok);
+
+	g_assert(g_slist_length(submits) == 3);
+
+	fake_stop(sms);
+}
+
+/*
+ * The fake modem for the atmodem driver.  It answers the initialization
+ * just enough for the driver to register, and takes every AT+CMGS.
+ */
+struct modem {
+	struct fake_modem fake;
+	GSList *commands;	/* CMMS and CMGS, in the order received */
+};
+
+static const struct {
+	const char *command;
+	const char *response;
+} answers[] = {
+	{ "AT+CSMS=?", "+CSMS: (0,1)" },
+	{ "AT+CSMS?", "+CSMS: 1,1,1,1" },
+	{ "AT+CSMS=", "+CSMS: 1,1,1" },
+	{ "AT+CMGF=?", "+CMGF: (0,1)" },
+	{ "AT+CPMS=?", "+CPMS: (\"ME\",\"SM\"),(\"ME\",\"SM\"),"
+						"(\"ME\",\"SM\")" },
+	{ "AT+CPMS=", "+CPMS: 0,10,0,10,0,10" },
+	{ "AT+CNMI=?", "+CNMI: (0,1,2),(0,1,2,3),(0,2),(0,1,2),(0,1)" },
+	{ }
+};
+
+static void modem_command(struct fake_modem *fake, const char *command,
+				gpointer user_data)
+{
+	struct modem *modem = user_data;
+	char buf[256];
+	int i;
+
+	/* The PDU of an AT+CMGS, read up to Ctrl-Z */
+	if (fake->terminator == 26) {
+		fake->terminator = '\r';
+		fake_modem_write(fake, "\r\n+CMGS: 1\r\n\r\nOK\r\n");
+		return;
+	}
+
+	if (g_str_has_prefix(command, "AT+CMGS=")) {
+		modem->commands = g_slist_append(modem->commands,
+						g_strdup("AT+CMGS"));
+		fake->terminator = 26;
+		fake_modem_write(fake, "\r\n> ");
+		return;
+	}
+
+	if (g_str_has_prefix(command, "AT+CMMS="))
+		modem->commands = g_slist_append(modem->commands,
+							g_strdup(command));
+
+	for (i = 0; answers[i].command; i++) {
+		if (!g_str_has_prefix(command, answers[i].command))
+			continue;
+
+		snprintf(buf, sizeof(buf), "\r\n%s\r\n", answers[i].response);
+		fake_modem_write(fake, buf);
+		break;
+	}
+
+	fake_modem_write(fake, "\r\nOK\r\n");
+}
+
+static GAtChat *modem_start(struct modem *modem)
+{
+	memset(modem, 0, sizeof(*modem));
+
+	return fake_modem_start_chat(&modem->fake, modem_command, modem);
+}
+
+static void modem_stop(struct modem *modem)
+{
+	fake_modem_stop(&modem->fake);
+
+	g_slist_foreach(modem->commands, (GFunc) g_free, NULL);
+	g_slist_free(modem->commands);
+}
+
+static gboolean run_timeout(gpointer user_data)
+{
+	g_assert_not_reached();
+
+	return FALSE;
+}
+
+/* Runs until the messages given are done */
+static void run_until_done(struct message *a, struct message *b)
+{
+	guint timeout = g_timeout_add_seconds(5, run_timeout, NULL);
+
+	while (!a->done || (b && !b->done))
+		g_main_context_iteration(NULL, TRUE);
+
+	g_source_remove(timeout);
+}
+
+static void check_commands(struct modem *modem, const char **expected)
+{
+	guint timeout = g_timeout_add_seconds(5, run_timeout, NULL);
+	GSList *l;
+	int i;
+
+	/* Commands queued after the last result may still be on the way */
+	for (i = 0; expected[i]; i++)
+		;
+
+	while (g_slist_length(modem->commands) < (guint) i)
+		g_main_context_iteration(NULL, TRUE);
+
+	g_source_remove(timeout);
+	run_pending();
+
+	l = modem->commands;
+
+	for (i = 0; expected[i]; i++, l = l->next) {
+		g_assert(l != NULL);
+
+		if (g_test_verbose())
+			g_print("%s\n", (char *) l->data);
+
+		g_assert(g_str_equal(l->data, expected[i]));
+	}
+
+	g_assert(l == NULL);
+}
+
+static struct ofono_sms *atmodem_start(struct modem *modem)
+{
+	struct ofono_sms *sms;
+	GAtChat *chat;
+
+	chat = modem_start(modem);
+
+	at_sms_init();
+
+	event_loop = g_main_loop_new(NULL, FALSE);
+	registered = FALSE;
+
+	sms = ofono_sms_create(NULL, 0, "atmodem", chat);
+	g_assert(sms != NULL);
+	g_at_chat_unref(chat);
+
+	g_main_loop_run(event_loop);
+	g_assert(registered);
+
+	/* Let the listing of stored messages finish */
+	run_pending();
+
+	return sms;
+}
+
+static void atmodem_stop(struct ofono_sms *sms, struct modem *modem)
+{
+	ofono_sms_remove(sms);
+	at_sms_exit();
+
+	g_main_loop_unref(event_loop);
+	event_loop = NULL;
+
+	modem_stop(modem);
+
+	g_slist_free(finished);
+	finished = NULL;
+}
+
+static void test_cmms_burst(void)
+{
+	static const char *expected[] = {
+		"AT+CMMS=2", "AT+CMGS", "AT+CMGS", "AT+CMGS", "AT+CMMS=0",
+		NULL
+	};
+	struct modem modem;
+	struct ofono_sms *sms = atmodem_start(&modem);
+	struct message a, b;
+
+	queue_message(sms, &a, "+15550001", 2);
+	queue_message(sms, &b, "+15550002", 1);
+
+	run_until_done(&a, &b);
+	g_assert(a.ok && b.ok);
+
+	/* The link is held over the whole burst, and released after */
+	check_commands(&modem, expected);
+
+	atmodem_stop(sms, &modem);
+}
+
+static void test_cmms_single(void)
+{
+	static const char *expected[] = {
+		"AT+CMMS=1", "AT+CMGS", "AT+CMMS=1", "AT+CMGS", "AT+CMGS",
+		NULL
+	};
+	struct modem modem;
+	struct ofono_sms *sms = atmodem_start(&modem);
+	struct message a;
+
+	queue_message(sms, &a, "+15550001", 3);
+
+	run_until_done(&a, NULL);
+	g_assert(a.ok);
+
+	/* Mode 1 lapses by itself after the last PDU, no reset needed */
+	check_commands(&modem, expected);
+
+	atmodem_stop(sms, &modem);
+}
+
+int main(int argc, char **argv)
+{
+	g_test_init(&argc, &argv, NULL);
+
+	g_test_add_func("/testsmstxq/DefaultDepth", test_default_depth);
+	g_test_add_func("/testsmstxq/PipelineOrder", test_pipeline_order);
+	g_test_add_func("/testsmstxq/PipelineError", test_pipeline_error);
+	g_test_add_func("/testsmstxq/CMMSBurst", test_cmms_burst);
+	g_test_add_func("/testsmstxq/CMMSSingle", test_cmms_single);
+
+	return g_test_run();
+}
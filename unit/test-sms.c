@@ -27,6 +27,9 @@
 #include <unistd.h>
 #include <stdlib.h>
 #include <string.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
 
 #include <glib.h>
 #include <glib/gprintf.h>
@@ -1319,6 +1322,204 @@ static void test_sr_assembly()
 	status_report_assembly_free(sra);
 }
 
+static const char *txq_texts[] = {
+	"This message is long enough to be split into two fragments, since "
+	"a single one only holds 160 characters of the GSM default alphabet "
+	"and this text has a few more than that.",
+	"Short one",
+	"Another short one",
+};
+
+struct txq_loaded {
+	unsigned int msg_id;
+	unsigned int flags;
+	char *text;
+};
+
+static void txq_backup_loaded(unsigned int msg_id, unsigned int flags,
+				GSList *msg_list, void *user_data)
+{
+	GSList **loaded = user_data;
+	struct txq_loaded *entry = g_new0(struct txq_loaded, 1);
+	struct sms *head = msg_list->data;
+
+	g_assert(g_str_equal(sms_address_to_string(&head->submit.daddr),
+				"+491234567"));
+
+	entry->msg_id = msg_id;
+	entry->flags = flags;
+	entry->text = sms_decode_text(msg_list);
+
+	*loaded = g_slist_append(*loaded, entry);
+}
+
+static GSList *txq_backup_reload(const char *imsi)
+{
+	struct sms_txq_backup *backup = sms_txq_backup_new(imsi);
+	GSList *loaded = NULL;
+
+	sms_txq_backup_load(backup, txq_backup_loaded, &loaded);
+	sms_txq_backup_free(backup);
+
+	return loaded;
+}
+
+static void txq_loaded_free(GSList *loaded)
+{
+	GSList *l;
+
+	for (l = loaded; l; l = l->next) {
+		struct txq_loaded *entry = l->data;
+
+		g_free(entry->text);
+		g_free(entry);
+	}
+
+	g_slist_free(loaded);
+}
+
+static void txq_backup_add(struct sms_txq_backup *backup, unsigned int i)
+{
+	GSList *msg_list;
+	GSList *l;
+
+	msg_list = sms_text_prepare(txq_texts[i], i, FALSE, NULL, TRUE);
+	g_assert(msg_list != NULL);
+
+	for (l = msg_list; l; l = l->next) {
+		struct sms *sms = l->data;
+
+		sms_address_from_string(&sms->submit.daddr, "+491234567");
+	}
+
+	g_assert(sms_txq_backup_add(backup, 40 + i, i, msg_list));
+
+	g_slist_foreach(msg_list, (GFunc)g_free, NULL);
+	g_slist_free(msg_list);
+}
+
+static void test_txq_backup()
+{
+	const char *imsi = "1234";
+	char *path = g_strdup_printf(STORAGEDIR "/%s/sms_txq", imsi);
+	struct sms_txq_backup *backup;
+	struct txq_loaded *entry;
+	GSList *loaded;
+	unsigned int i;
+	struct stat st;
+	FILE *f;
+
+	unlink(path);
+
+	backup = sms_txq_backup_new(imsi);
+
+	for (i = 0; i < G_N_ELEMENTS(txq_texts); i++)
+		txq_backup_add(backup, i);
+
+	sms_txq_backup_remove(backup, 41);
+
+	/* Nothing is written until the queue is synced */
+	g_assert(stat(path, &st) < 0 || st.st_size == 0);
+	g_assert(sms_txq_backup_sync(backup));
+	g_assert(stat(path, &st) == 0 && st.st_size > 0);
+
+	sms_txq_backup_free(backup);
+
+	/* A record cut short by a crash is ignored */
+	f = fopen(path, "a");
+	g_assert(f != NULL);
+	fwrite("\x01\x02\x00", 1, 3, f);
+	fclose(f);
+
+	loaded = txq_backup_reload(imsi);
+	g_assert(g_slist_length(loaded) == 2);
+
+	entry = loaded->data;
+	g_assert(entry->msg_id == 40);
+	g_assert(entry->flags == 0);
+	g_assert(g_str_equal(entry->text, txq_texts[0]));
+
+	entry = loaded->next->data;
+	g_assert(entry->msg_id == 42);
+	g_assert(entry->flags == 2);
+	g_assert(g_str_equal(entry->text, txq_texts[2]));
+
+	txq_loaded_free(loaded);
+
+	/* Loading compacted the journal, so it reads back the same */
+	loaded = txq_backup_reload(imsi);
+	g_assert(g_slist_length(loaded) == 2);
+	txq_loaded_free(loaded);
+
+	backup = sms_txq_backup_new(imsi);
+	loaded = NULL;
+	sms_txq_backup_load(backup, txq_backup_loaded, &loaded);
+	txq_loaded_free(loaded);
+
+	sms_txq_backup_remove(backup, 40);
+	sms_txq_backup_remove(backup, 42);
+	g_assert(sms_txq_backup_sync(backup));
+	sms_txq_backup_free(backup);
+
+	/* With the queue empty, nothing is kept around */
+	g_assert(stat(path, &st) == 0 && st.st_size == 0);
+
+	loaded = txq_backup_reload(imsi);
+	g_assert(loaded == NULL);
+
+	unlink(path);
+	g_free(path);
+}
+
+static void test_txq_backup_short_write()
+{
+	const char *imsi = "1234";
+	char *path = g_strdup_printf(STORAGEDIR "/%s/sms_txq", imsi);
+	struct sms_txq_backup *backup;
+	struct rlimit limit;
+	struct rlimit saved;
+	struct stat st;
+	GSList *loaded;
+	off_t size;
+
+	unlink(path);
+
+	backup = sms_txq_backup_new(imsi);
+	txq_backup_add(backup, 1);
+	g_assert(sms_txq_backup_sync(backup));
+
+	g_assert(stat(path, &st) == 0);
+	size = st.st_size;
+
+	/* Let the next write through only partially */
+	txq_backup_add(backup, 0);
+
+	g_assert(getrlimit(RLIMIT_FSIZE, &saved) == 0);
+	signal(SIGXFSZ, SIG_IGN);
+
+	limit = saved;
+	limit.rlim_cur = size + 8;
+	g_assert(setrlimit(RLIMIT_FSIZE, &limit) == 0);
+
+	g_assert(sms_txq_backup_sync(backup) == FALSE);
+
+	g_assert(setrlimit(RLIMIT_FSIZE, &saved) == 0);
+	signal(SIGXFSZ, SIG_DFL);
+
+	/* The torn record is cut off again and written whole later */
+	g_assert(stat(path, &st) == 0 && st.st_size == size);
+
+	g_assert(sms_txq_backup_sync(backup));
+	sms_txq_backup_free(backup);
+
+	loaded = txq_backup_reload(imsi);
+	g_assert(g_slist_length(loaded) == 2);
+	txq_loaded_free(loaded);
+
+	unlink(path);
+	g_free(path);
+}
+
 struct wap_push_data {
 	const char *pdu;
 	int len;
@@ -1451,6 +1652,10 @@ int main(int argc, char **argv)
 
 	g_test_add_func("/testsms/Status Report Assembly", test_sr_assembly);
 
+	g_test_add_func("/testsms/Transmit Queue Backup", test_txq_backup);
+	g_test_add_func("/testsms/Transmit Queue Backup Short Write",
+			test_txq_backup_short_write);
+
 	g_test_add_data_func("/testsms/Test WAP Push 1", &wap_push_1,
 				test_wap_push);
 
@@ -0,0 +1,146 @@
+/*
+ *
+ *  oFono - Open Source Telephony
+ *
+ *  Copyright (C) 2008-2010  Intel Corporation. All rights reserved.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <glib.h>
+
+#include "storage.h"
+
+#define TEST_IMSI "1234"
+#define TEST_STORE "test-storage"
+#define TEST_PATH STORAGEDIR "/" TEST_IMSI "/" TEST_STORE
+
+/* Longer than storage.c collects changes for */
+#define SYNC_WAIT 800
+
+static gboolean quit_loop(gpointer user_data)
+{
+	g_main_loop_quit(user_data);
+
+	return FALSE;
+}
+
+static void run_loop(guint ms)
+{
+	GMainLoop *loop = g_main_loop_new(NULL, FALSE);
+
+	g_timeout_add(ms, quit_loop, loop);
+	g_main_loop_run(loop);
+	g_main_loop_unref(loop);
+}
+
+static int stored_value(const char *key)
+{
+	GKeyFile *keyfile = g_key_file_new();
+	int value = -1;
+
+	if (g_key_file_load_from_file(keyfile, TEST_PATH, 0, NULL))
+		value = g_key_file_get_integer(keyfile, "Settings", key, NULL);
+
+	g_key_file_free(keyfile);
+
+	return value;
+}
+
+static void test_write_behind(void)
+{
+	GKeyFile *keyfile;
+	struct stat before, after;
+
+	unlink(TEST_PATH);
+
+	keyfile = storage_open(TEST_IMSI, TEST_STORE);
+	g_assert(keyfile != NULL);
+
+	g_key_file_set_integer(keyfile, "Settings", "First", 1);
+	storage_sync(TEST_IMSI, TEST_STORE, keyfile);
+	g_key_file_set_integer(keyfile, "Settings", "Second", 2);
+	storage_sync(TEST_IMSI, TEST_STORE, keyfile);
+
+	/* Nothing is written until the burst is over */
+	g_assert(stat(TEST_PATH, &before) < 0);
+
+	run_loop(SYNC_WAIT);
+
+	g_assert(stored_value("First") == 1);
+	g_assert(stored_value("Second") == 2);
+
+	/* Syncing without changes leaves the file alone */
+	g_assert(stat(TEST_PATH, &before) == 0);
+	storage_sync(TEST_IMSI, TEST_STORE, keyfile);
+	run_loop(SYNC_WAIT);
+	g_assert(stat(TEST_PATH, &after) == 0);
+	g_assert(before.st_ino == after.st_ino);
+
+	/* Closing flushes what is still pending */
+	g_key_file_set_integer(keyfile, "Settings", "First", 3);
+	storage_sync(TEST_IMSI, TEST_STORE, keyfile);
+	storage_close(TEST_IMSI, TEST_STORE, keyfile, FALSE);
+
+	g_assert(stored_value("First") == 3);
+
+	unlink(TEST_PATH);
+}
+
+static void test_write_failure(void)
+{
+	GKeyFile *keyfile;
+	struct stat st;
+
+	unlink(TEST_PATH);
+
+	keyfile = storage_open(TEST_IMSI, TEST_STORE);
+	g_assert(keyfile != NULL);
+
+	/* A directory in place of the file makes every write fail */
+	g_assert(create_dirs(TEST_PATH, 0700) == 0);
+	g_assert(mkdir(TEST_PATH, 0700) == 0);
+
+	g_key_file_set_integer(keyfile, "Settings", "First", 1);
+	storage_sync(TEST_IMSI, TEST_STORE, keyfile);
+	run_loop(SYNC_WAIT);
+
+	g_assert(stat(TEST_PATH, &st) == 0 && S_ISDIR(st.st_mode));
+	g_assert(rmdir(TEST_PATH) == 0);
+
+	/* The failed change is not forgotten, closing writes it out */
+	storage_close(TEST_IMSI, TEST_STORE, keyfile, FALSE);
+
+	g_assert(stored_value("First") == 1);
+
+	unlink(TEST_PATH);
+}
+
+int main(int argc, char **argv)
+{
+	g_test_init(&argc, &argv, NULL);
+
+	g_test_add_func("/teststorage/Write behind", test_write_behind);
+	g_test_add_func("/teststorage/Write failure", test_write_failure);
+
+	return g_test_run();
+}
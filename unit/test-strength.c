@@ -0,0 +1,211 @@
+/*
+ *
+ *  oFono - Open Source Telephony
+ *
+ *  Copyright (C) 2008-2010  Intel Corporation. All rights reserved.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <glib.h>
+
+#include "strength.h"
+
+static GArray *reports;
+
+static void report_cb(int strength, void *user_data)
+{
+	g_array_append_val(reports, strength);
+}
+
+static int last_report(void)
+{
+	g_assert(reports->len > 0);
+
+	return g_array_index(reports, int, reports->len - 1);
+}
+
+static void feed(struct strength_filter *filter, const int *values, int n)
+{
+	int i;
+
+	for (i = 0; i < n; i++)
+		strength_filter_update(filter, values[i]);
+}
+
+static gboolean quit_loop(gpointer user_data)
+{
+	g_main_loop_quit(user_data);
+
+	return FALSE;
+}
+
+static void wait_ms(unsigned int ms)
+{
+	GMainLoop *loop = g_main_loop_new(NULL, FALSE);
+
+	g_timeout_add(ms, quit_loop, loop);
+	g_main_loop_run(loop);
+	g_main_loop_unref(loop);
+}
+
+static void test_default(void)
+{
+	struct strength_filter *filter;
+	static const int values[] = { 50, 51, 51, 50, 49 };
+
+	reports = g_array_new(FALSE, FALSE, sizeof(int));
+	filter = strength_filter_new(report_cb, NULL);
+
+	/* Every change goes through, only repeats are dropped */
+	feed(filter, values, G_N_ELEMENTS(values));
+	g_assert(reports->len == 4);
+	g_assert(strength_filter_get_reported(filter) == 4);
+	g_assert(strength_filter_get_suppressed(filter) == 1);
+
+	/* Unknown strength forgets the last report */
+	strength_filter_update(filter, -1);
+	strength_filter_update(filter, 49);
+	g_assert(reports->len == 5);
+	g_assert(last_report() == 49);
+
+	/* An explicit zero policy is the same as none */
+	strength_filter_set_policy(filter, 0, 0, 0);
+	strength_filter_update(filter, 48);
+	strength_filter_update(filter, 47);
+	g_assert(reports->len == 7);
+
+	strength_filter_free(filter);
+	g_array_free(reports, TRUE);
+}
+
+static void test_delta(void)
+{
+	struct strength_filter *filter;
+	static const int values[] = { 50, 52, 54, 46, 55, 59, 98, 100, 96, 0 };
+	static const int expected[] = { 50, 55, 98, 100, 0 };
+	unsigned int i;
+
+	reports = g_array_new(FALSE, FALSE, sizeof(int));
+	filter = strength_filter_new(report_cb, NULL);
+	strength_filter_set_policy(filter, 5, 0, 1);
+
+	/*
+	 * Changes are measured against the last report, not the last
+	 * sample, so a slow drift still gets through.  The extremes
+	 * always do.
+	 */
+	feed(filter, values, G_N_ELEMENTS(values));
+
+	g_assert(reports->len == G_N_ELEMENTS(expected));
+
+	for (i = 0; i < G_N_ELEMENTS(expected); i++)
+		g_assert(g_array_index(reports, int, i) == expected[i]);
+
+	g_assert(strength_filter_get_suppressed(filter) ==
+			G_N_ELEMENTS(values) - G_N_ELEMENTS(expected));
+
+	strength_filter_free(filter);
+	g_array_free(reports, TRUE);
+}
+
+static void test_average(void)
+{
+	struct strength_filter *filter;
+
+	reports = g_array_new(FALSE, FALSE, sizeof(int));
+	filter = strength_filter_new(report_cb, NULL);
+	strength_filter_set_policy(filter, 0, 0, 4);
+
+	strength_filter_update(filter, 40);
+	g_assert(last_report() == 40);
+
+	strength_filter_update(filter, 60);
+	g_assert(last_report() == 50);
+
+	strength_filter_update(filter, 60);
+	g_assert(last_report() == 53);
+
+	strength_filter_update(filter, 60);
+	g_assert(last_report() == 55);
+
+	/* The oldest sample drops out of the window */
+	strength_filter_update(filter, 60);
+	g_assert(last_report() == 60);
+	g_assert(reports->len == 5);
+
+	strength_filter_free(filter);
+	g_array_free(reports, TRUE);
+}
+
+static void test_interval(void)
+{
+	struct strength_filter *filter;
+
+	reports = g_array_new(FALSE, FALSE, sizeof(int));
+	filter = strength_filter_new(report_cb, NULL);
+	strength_filter_set_policy(filter, 0, 100, 1);
+
+	strength_filter_update(filter, 50);
+	g_assert(reports->len == 1);
+
+	/* Held back, and only the newest of them is reported */
+	strength_filter_update(filter, 60);
+	strength_filter_update(filter, 70);
+	g_assert(reports->len == 1);
+
+	wait_ms(150);
+	g_assert(reports->len == 2);
+	g_assert(last_report() == 70);
+	g_assert(strength_filter_get_suppressed(filter) == 1);
+
+	/* A value held back goes stale when the strength comes back */
+	strength_filter_update(filter, 80);
+	strength_filter_update(filter, 70);
+
+	wait_ms(150);
+	g_assert(reports->len == 2);
+
+	/* Once the interval has passed, a change goes out at once */
+	strength_filter_update(filter, 75);
+	g_assert(reports->len == 3);
+	g_assert(last_report() == 75);
+
+	/* Reset drops anything held back */
+	strength_filter_update(filter, 85);
+	strength_filter_reset(filter);
+
+	wait_ms(150);
+	g_assert(reports->len == 3);
+
+	strength_filter_free(filter);
+	g_array_free(reports, TRUE);
+}
+
+int main(int argc, char **argv)
+{
+	g_test_init(&argc, &argv, NULL);
+
+	g_test_add_func("/teststrength/Default", test_default);
+	g_test_add_func("/teststrength/Delta", test_delta);
+	g_test_add_func("/teststrength/Average", test_average);
+	g_test_add_func("/teststrength/Interval", test_interval);
+
+	return g_test_run();
+}
@@ -0,0 +1,567 @@
+/*
+ *
+ *  oFono - Open Source Telephony
+ *
+ *  Copyright (C) 2008-2010  Intel Corporation. All rights reserved.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <libudev.h>
+
+#include <glib.h>
+
+#define OFONO_API_SUBJECT_TO_CHANGE
+#include <ofono/plugin.h>
+#include <ofono/modem.h>
+#include <ofono/log.h>
+
+/*
+ * The plugin runs against a fake udev below: devices are built by the
+ * tests, and events are queued and signalled through a pipe standing in
+ * for the netlink socket.  The modem core is replaced as well, keeping
+ * just the properties and counting registrations.
+ */
+struct udev_list_entry {
+	const char *name;
+	const char *value;
+};
+
+struct udev_device {
+	char *devpath;
+	const char *subsystem;
+	const char *action;
+	char *devnode;
+	const char *interface;		/* The device/interface sysattr */
+	struct udev_list_entry properties[2];
+	struct udev_device *parent;
+};
+
+static int fake_udev;
+static int event_pipe[2];
+static GQueue *event_queue;
+
+struct udev *udev_new(void)
+{
+	return (struct udev *) &fake_udev;
+}
+
+void udev_unref(struct udev *udev)
+{
+}
+
+struct udev_monitor *udev_monitor_new_from_netlink(struct udev *udev,
+							const char *name)
+{
+	return (struct udev_monitor *) &fake_udev;
+}
+
+int udev_monitor_filter_add_match_subsystem_devtype(
+				struct udev_monitor *monitor,
+				const char *subsystem, const char *devtype)
+{
+	return 0;
+}
+
+int udev_monitor_filter_update(struct udev_monitor *monitor)
+{
+	return 0;
+}
+
+int udev_monitor_filter_remove(struct udev_monitor *monitor)
+{
+	return 0;
+}
+
+int udev_monitor_enable_receiving(struct udev_monitor *monitor)
+{
+	return 0;
+}
+
+int udev_monitor_get_fd(struct udev_monitor *monitor)
+{
+	return event_pipe[0];
+}
+
+void udev_monitor_unref(struct udev_monitor *monitor)
+{
+}
+
+struct udev_device *udev_monitor_receive_device(struct udev_monitor *monitor)
+{
+	char c;
+
+	if (read(event_pipe[0], &c, 1) != 1)
+		return NULL;
+
+	return g_queue_pop_head(event_queue);
+}
+
+/* Nothing is present at startup, everything arrives as an event */
+struct udev_enumerate *udev_enumerate_new(struct udev *udev)
+{
+	return NULL;
+}
+
+int udev_enumerate_add_match_subsystem(struct udev_enumerate *enumerate,
+					const char *subsystem)
+{
+	return 0;
+}
+
+int udev_enumerate_scan_devices(struct udev_enumerate *enumerate)
+{
+	return 0;
+}
+
+struct udev_list_entry *udev_enumerate_get_list_entry(
+					struct udev_enumerate *enumerate)
+{
+	return NULL;
+}
+
+void udev_enumerate_unref(struct udev_enumerate *enumerate)
+{
+}
+
+struct udev_device *udev_device_new_from_syspath(struct udev *udev,
+							const char *syspath)
+{
+	return NULL;
+}
+
+void udev_device_unref(struct udev_device *device)
+{
+}
+
+struct udev_device *udev_device_get_parent(struct udev_device *device)
+{
+	return device->parent;
+}
+
+const char *udev_device_get_devpath(struct udev_device *device)
+{
+	return device->devpath;
+}
+
+const char *udev_device_get_subsystem(struct udev_device *device)
+{
+	return device->subsystem;
+}
+
+const char *udev_device_get_action(struct udev_device *device)
+{
+	return device->action;
+}
+
+const char *udev_device_get_devnode(struct udev_device *device)
+{
+	return device->devnode;
+}
+
+const char *udev_device_get_sysattr_value(struct udev_device *device,
+						const char *sysattr)
+{
+	if (g_str_equal(sysattr, "device/interface"))
+		return device->interface;
+
+	return NULL;
+}
+
+const char *udev_device_get_property_value(struct udev_device *device,
+						const char *key)
+{
+	unsigned int i;
+
+	for (i = 0; i < G_N_ELEMENTS(device->properties); i++)
+		if (g_strcmp0(device->properties[i].name, key) == 0)
+			return device->properties[i].value;
+
+	return NULL;
+}
+
+struct udev_list_entry *udev_device_get_properties_list_entry(
+						struct udev_device *device)
+{
+	return NULL;
+}
+
+const char *udev_list_entry_get_name(struct udev_list_entry *entry)
+{
+	return entry->name;
+}
+
+const char *udev_list_entry_get_value(struct udev_list_entry *entry)
+{
+	return entry->value;
+}
+
+struct udev_list_entry *udev_list_entry_get_next(struct udev_list_entry *entry)
+{
+	return NULL;
+}
+
+struct ofono_modem {
+	GHashTable *strings;
+	GHashTable *integers;
+};
+
+static int modems_created;
+static int modems_registered;
+static int modems_complete;	/* Registered with the GPS port known */
+static int modems_removed;
+
+struct ofono_modem *ofono_modem_create(const char *name, const char *type)
+{
+	struct ofono_modem *modem;
+
+	modem = g_new0(struct ofono_modem, 1);
+	modem->strings = g_hash_table_new_full(g_str_hash, g_str_equal,
+						g_free, g_free);
+	modem->integers = g_hash_table_new_full(g_str_hash, g_str_equal,
+						g_free, NULL);
+
+	modems_created += 1;
+
+	return modem;
+}
+
+int ofono_modem_set_string(struct ofono_modem *modem,
+				const char *key, const char *value)
+{
+	g_hash_table_replace(modem->strings, g_strdup(key), g_strdup(value));
+
+	return 0;
+}
+
+const char *ofono_modem_get_string(struct ofono_modem *modem, const char *key)
+{
+	return g_hash_table_lookup(modem->strings, key);
+}
+
+int ofono_modem_set_integer(struct ofono_modem *modem,
+				const char *key, int value)
+{
+	g_hash_table_replace(modem->integers, g_strdup(key),
+				GINT_TO_POINTER(value));
+
+	return 0;
+}
+
+int ofono_modem_get_integer(struct ofono_modem *modem, const char *key)
+{
+	return GPOINTER_TO_INT(g_hash_table_lookup(modem->integers, key));
+}
+
+int ofono_modem_set_boolean(struct ofono_modem *modem,
+				const char *key, ofono_bool_t value)
+{
+	return ofono_modem_set_integer(modem, key, value);
+}
+
+int ofono_modem_register(struct ofono_modem *modem)
+{
+	if (ofono_modem_get_string(modem, "GPSDevice") != NULL)
+		modems_complete += 1;
+
+	modems_registered += 1;
+
+	return 0;
+}
+
+void ofono_modem_remove(struct ofono_modem *modem)
+{
+	g_hash_table_destroy(modem->strings);
+	g_hash_table_destroy(modem->integers);
+	g_free(modem);
+
+	modems_removed += 1;
+}
+
+void ofono_debug(const char *format, ...)
+{
+}
+
+void ofono_error(const char *format, ...)
+{
+}
+
+extern struct ofono_plugin_desc __ofono_builtin_udev;
+
+/* A USB MBM modem: modem, data and GPS ports and a network adapter */
+struct fake_modem {
+	struct udev_device usb;
+	struct udev_device intf[4];
+	struct udev_device port[4];
+};
+
+static const char *mbm_interfaces[] = {
+	"Minicard Modem",
+	"Minicard Data Modem",
+	"Minicard Network Adapter",
+	"Minicard GPS Port",
+};
+
+static struct fake_modem *fake_modem_new(unsigned int n)
+{
+	struct fake_modem *fm = g_new0(struct fake_modem, 1);
+	unsigned int i;
+
+	fm->usb.devpath = g_strdup_printf("/devices/usb1/1-%u", n);
+	fm->usb.properties[0].name = "OFONO_DRIVER";
+	fm->usb.properties[0].value = "mbm";
+
+	for (i = 0; i < 4; i++) {
+		struct udev_device *intf = &fm->intf[i];
+		struct udev_device *port = &fm->port[i];
+
+		intf->devpath = g_strdup_printf("%s/1-%u:1.%u",
+						fm->usb.devpath, n, i);
+		intf->parent = &fm->usb;
+
+		port->parent = intf;
+		port->interface = mbm_interfaces[i];
+
+		if (i == 2) {
+			port->subsystem = "net";
+			port->devpath = g_strdup_printf("%s/net/wwan%u",
+							intf->devpath, n);
+			port->properties[0].name = "INTERFACE";
+			port->properties[0].value = port->devpath +
+						strlen(intf->devpath) + 5;
+		} else {
+			port->subsystem = "tty";
+			port->devnode = g_strdup_printf("/dev/ttyACM%u",
+							n * 4 + i);
+			port->devpath = g_strdup_printf("%s/tty/ttyACM%u",
+						intf->devpath, n * 4 + i);
+		}
+	}
+
+	return fm;
+}
+
+static void fake_modem_free(struct fake_modem *fm)
+{
+	unsigned int i;
+
+	for (i = 0; i < 4; i++) {
+		g_free(fm->intf[i].devpath);
+		g_free(fm->port[i].devpath);
+		g_free(fm->port[i].devnode);
+	}
+
+	g_free(fm->usb.devpath);
+	g_free(fm);
+}
+
+static void inject(struct udev_device *device, const char *action)
+{
+	device->action = action;
+	g_queue_push_tail(event_queue, device);
+
+	g_assert(write(event_pipe[1], "e", 1) == 1);
+}
+
+static gboolean quit_loop(gpointer user_data)
+{
+	g_main_loop_quit(user_data);
+
+	return FALSE;
+}
+
+/* Dispatches all queued events and waits for the modems to settle */
+static void settle(void)
+{
+	GMainLoop *loop = g_main_loop_new(NULL, FALSE);
+
+	g_timeout_add(500, quit_loop, loop);
+	g_main_loop_run(loop);
+	g_main_loop_unref(loop);
+
+	g_assert(g_queue_is_empty(event_queue));
+}
+
+static void harness_start(void)
+{
+	g_assert(pipe(event_pipe) == 0);
+	event_queue = g_queue_new();
+
+	modems_created = 0;
+	modems_registered = 0;
+	modems_complete = 0;
+	modems_removed = 0;
+
+	g_assert(__ofono_builtin_udev.init() == 0);
+}
+
+static void harness_stop(void)
+{
+	__ofono_builtin_udev.exit();
+
+	g_queue_free(event_queue);
+	close(event_pipe[0]);
+	close(event_pipe[1]);
+}
+
+static void test_burst(void)
+{
+	struct fake_modem *fm[8];
+	unsigned int i, j;
+
+	harness_start();
+
+	for (i = 0; i < G_N_ELEMENTS(fm); i++)
+		fm[i] = fake_modem_new(i);
+
+	/* Enumeration after a hub reset interleaves the modems' ports */
+	for (j = 0; j < 4; j++)
+		for (i = 0; i < G_N_ELEMENTS(fm); i++)
+			inject(&fm[i]->port[j], "add");
+
+	settle();
+
+	g_assert(modems_created == G_N_ELEMENTS(fm));
+	g_assert(modems_registered == G_N_ELEMENTS(fm));
+	g_assert(modems_complete == G_N_ELEMENTS(fm));
+
+	/* A port showing up again does not register the modem twice */
+	inject(&fm[0]->port[0], "add");
+	settle();
+	g_assert(modems_registered == G_N_ELEMENTS(fm));
+
+	/* Any port going away takes its modem, once */
+	inject(&fm[3]->port[1], "remove");
+	inject(&fm[3]->port[0], "remove");
+	settle();
+	g_assert(modems_removed == 1);
+
+	/* And it comes back as a fresh modem */
+	for (j = 0; j < 4; j++)
+		inject(&fm[3]->port[j], "add");
+
+	settle();
+	g_assert(modems_created == G_N_ELEMENTS(fm) + 1);
+	g_assert(modems_registered == G_N_ELEMENTS(fm) + 1);
+
+	harness_stop();
+
+	g_assert(modems_removed == G_N_ELEMENTS(fm) + 1);
+
+	for (i = 0; i < G_N_ELEMENTS(fm); i++)
+		fake_modem_free(fm[i]);
+}
+
+static void test_settle(void)
+{
+	struct udev_device stray = {
+		.devpath = "/devices/usb9/9-1/9-1:1.0/tty/ttyUSB0",
+		.subsystem = "tty",
+	};
+	struct fake_modem *fm;
+	GMainLoop *loop;
+
+	harness_start();
+
+	fm = fake_modem_new(0);
+
+	/*
+	 * The GPS port comes last and after the modem already has what
+	 * it needs, but still within the burst: it must not be missed.
+	 */
+	inject(&fm->port[0], "add");
+	inject(&fm->port[1], "add");
+	inject(&fm->port[2], "add");
+
+	loop = g_main_loop_new(NULL, FALSE);
+	g_timeout_add(50, quit_loop, loop);
+	g_main_loop_run(loop);
+	g_main_loop_unref(loop);
+
+	g_assert(modems_registered == 0);
+
+	inject(&fm->port[3], "add");
+	settle();
+
+	g_assert(modems_registered == 1);
+	g_assert(modems_complete == 1);
+
+	/* Removing a port that never made it to a modem is harmless */
+	inject(&stray, "remove");
+	settle();
+	g_assert(modems_removed == 0);
+
+	harness_stop();
+
+	fake_modem_free(fm);
+}
+
+static void test_many(void)
+{
+	GPtrArray *modems = g_ptr_array_new();
+	GTimer *timer;
+	unsigned int i, j;
+	double elapsed;
+
+	harness_start();
+
+	for (i = 0; i < 500; i++)
+		g_ptr_array_add(modems, fake_modem_new(i));
+
+	timer = g_timer_new();
+
+	for (i = 0; i < modems->len; i++) {
+		struct fake_modem *fm = g_ptr_array_index(modems, i);
+
+		for (j = 0; j < 4; j++)
+			inject(&fm->port[j], "add");
+	}
+
+	settle();
+
+	elapsed = g_timer_elapsed(timer, NULL);
+	g_timer_destroy(timer);
+
+	if (g_test_verbose())
+		g_print("%u modems settled in %.3f s\n", modems->len, elapsed);
+
+	g_assert(modems_registered == (int) modems->len);
+
+	harness_stop();
+
+	for (i = 0; i < modems->len; i++)
+		fake_modem_free(g_ptr_array_index(modems, i));
+
+	g_ptr_array_free(modems, TRUE);
+}
+
+int main(int argc, char **argv)
+{
+	g_test_init(&argc, &argv, NULL);
+
+	g_test_add_func("/testudev/Event burst", test_burst);
+	g_test_add_func("/testudev/Settle", test_settle);
+	g_test_add_func("/testudev/Many modems", test_many);
+
+	return g_test_run();
+}
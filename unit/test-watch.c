@@ -0,0 +1,252 @@
+/*
+ *
+ *  oFono - Open Source Telephony
+ *
+ *  Copyright (C) 2008-2010  Intel Corporation. All rights reserved.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+
+#include <glib.h>
+#include <gdbus.h>
+
+/*
+ * The watches are exercised without a bus: the few libdbus calls that
+ * talk to the bus or the connection are replaced below, and messages
+ * are fed straight to the filter gdbus installs.
+ */
+static int fake_connection;
+#define CONNECTION ((DBusConnection *) &fake_connection)
+
+static DBusHandleMessageFunction installed_filter;
+static int match_rules;
+
+void dbus_bus_add_match(DBusConnection *connection, const char *rule,
+				DBusError *error)
+{
+	match_rules += 1;
+}
+
+void dbus_bus_remove_match(DBusConnection *connection, const char *rule,
+				DBusError *error)
+{
+	match_rules -= 1;
+}
+
+dbus_bool_t dbus_connection_add_filter(DBusConnection *connection,
+					DBusHandleMessageFunction function,
+					void *user_data,
+					DBusFreeFunction free_data_function)
+{
+	g_assert(installed_filter == NULL);
+	installed_filter = function;
+
+	return TRUE;
+}
+
+void dbus_connection_remove_filter(DBusConnection *connection,
+					DBusHandleMessageFunction function,
+					void *user_data)
+{
+	g_assert(installed_filter == function);
+	installed_filter = NULL;
+}
+
+DBusConnection *dbus_connection_ref(DBusConnection *connection)
+{
+	return connection;
+}
+
+void dbus_connection_unref(DBusConnection *connection)
+{
+}
+
+static DBusMessage *new_signal(const char *sender, const char *path,
+				const char *interface, const char *member)
+{
+	DBusMessage *msg;
+
+	msg = dbus_message_new_signal(path, interface, member);
+	dbus_message_set_sender(msg, sender);
+
+	return msg;
+}
+
+static void dispatch(DBusMessage *msg)
+{
+	g_assert(installed_filter != NULL);
+
+	installed_filter(CONNECTION, msg, NULL);
+	dbus_message_unref(msg);
+}
+
+static DBusMessage *name_lost(const char *name)
+{
+	DBusMessage *msg;
+	const char *new_owner = "";
+
+	msg = new_signal(DBUS_SERVICE_DBUS, DBUS_PATH_DBUS,
+				DBUS_INTERFACE_DBUS, "NameOwnerChanged");
+
+	dbus_message_append_args(msg, DBUS_TYPE_STRING, &name,
+					DBUS_TYPE_STRING, &name,
+					DBUS_TYPE_STRING, &new_owner,
+					DBUS_TYPE_INVALID);
+
+	return msg;
+}
+
+static int signal_hits[3];
+static int disconnects;
+
+static gboolean signal_cb(DBusConnection *connection, DBusMessage *msg,
+				void *user_data)
+{
+	signal_hits[GPOINTER_TO_INT(user_data)] += 1;
+
+	return TRUE;
+}
+
+static void disconnect_cb(DBusConnection *connection, void *user_data)
+{
+	disconnects += 1;
+}
+
+static void test_dispatch(void)
+{
+	guint exact, wildcard, service;
+
+	exact = g_dbus_add_signal_watch(CONNECTION, NULL, "/modem0",
+					"org.ofono.Modem", "PropertyChanged",
+					signal_cb, GINT_TO_POINTER(0), NULL);
+	wildcard = g_dbus_add_signal_watch(CONNECTION, NULL, NULL,
+					"org.ofono.SimManager", NULL,
+					signal_cb, GINT_TO_POINTER(1), NULL);
+	service = g_dbus_add_disconnect_watch(CONNECTION, ":1.7",
+					disconnect_cb, NULL, NULL);
+
+	g_assert(exact && wildcard && service);
+	g_assert(match_rules == 3);
+
+	dispatch(new_signal(":1.1", "/modem0", "org.ofono.Modem",
+				"PropertyChanged"));
+	dispatch(new_signal(":1.1", "/modem1", "org.ofono.Modem",
+				"PropertyChanged"));
+	dispatch(new_signal(":1.1", "/modem1", "org.ofono.SimManager",
+				"PropertyChanged"));
+	dispatch(new_signal(":1.1", "/modem0", "org.ofono.SimManager",
+				"Foo"));
+
+	g_assert(signal_hits[0] == 1);
+	g_assert(signal_hits[1] == 2);
+
+	/* Someone else going away is of no interest */
+	dispatch(name_lost(":1.8"));
+	g_assert(disconnects == 0);
+
+	/* A disconnect watch fires once and removes itself */
+	dispatch(name_lost(":1.7"));
+	dispatch(name_lost(":1.7"));
+	g_assert(disconnects == 1);
+	g_assert(match_rules == 2);
+	g_assert(g_dbus_remove_watch(CONNECTION, service) == FALSE);
+
+	g_assert(g_dbus_remove_watch(CONNECTION, exact) == TRUE);
+	g_assert(g_dbus_remove_watch(CONNECTION, exact) == FALSE);
+
+	dispatch(new_signal(":1.1", "/modem0", "org.ofono.Modem",
+				"PropertyChanged"));
+	g_assert(signal_hits[0] == 1);
+
+	g_dbus_remove_all_watches(CONNECTION);
+	g_assert(installed_filter == NULL);
+}
+
+/*
+ * Registers watches like those of many modems and clients, then times
+ * the dispatch of signals which match one of them and of signals which
+ * match none.
+ */
+static double time_dispatch(unsigned int watches, unsigned int rounds)
+{
+	GTimer *timer;
+	unsigned int i;
+	double elapsed;
+	char buf[32];
+
+	for (i = 0; i < watches; i++) {
+		snprintf(buf, sizeof(buf), ":1.%u", i);
+		g_dbus_add_disconnect_watch(CONNECTION, buf, disconnect_cb,
+						NULL, NULL);
+
+		snprintf(buf, sizeof(buf), "/modem%u", i);
+		g_dbus_add_signal_watch(CONNECTION, NULL, buf,
+					"org.ofono.Modem", "PropertyChanged",
+					signal_cb, GINT_TO_POINTER(2), NULL);
+	}
+
+	signal_hits[2] = 0;
+	timer = g_timer_new();
+
+	for (i = 0; i < rounds; i++) {
+		snprintf(buf, sizeof(buf), "/modem%u", i % watches);
+		dispatch(new_signal(":1.1", buf, "org.ofono.Modem",
+					"PropertyChanged"));
+
+		dispatch(name_lost(":1.unknown"));
+	}
+
+	elapsed = g_timer_elapsed(timer, NULL);
+	g_timer_destroy(timer);
+
+	g_assert(signal_hits[2] == (int) rounds);
+
+	g_dbus_remove_all_watches(CONNECTION);
+
+	if (g_test_verbose())
+		g_print("%u watches: %.2f us per signal\n", watches * 2,
+				elapsed * 1000000 / (rounds * 2));
+
+	return elapsed;
+}
+
+static void test_dispatch_scaling(void)
+{
+	double few, many;
+
+	few = time_dispatch(10, 20000);
+	many = time_dispatch(5000, 20000);
+
+	/* Generous, a linear scan would be hundreds of times slower */
+	g_assert(many < few * 10);
+}
+
+int main(int argc, char **argv)
+{
+	g_test_init(&argc, &argv, NULL);
+
+	g_test_add_func("/testwatch/Dispatch", test_dispatch);
+	g_test_add_func("/testwatch/Dispatch scaling",
+				test_dispatch_scaling);
+
+	return g_test_run();
+}